@@ -0,0 +1,269 @@
+#include "AssetCache.h"
+#include "Geometry.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace ferraris::tools {
+namespace asset_cache {
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr u32 entry_magic{ 0x48434146 }; // "FACH"
+
+// Layout of an entry file: entry_header, key bytes, data bytes.
+struct entry_header
+{
+	u32 magic;
+	u32 key_size;
+	u64 data_size;
+};
+
+struct entry
+{
+	u64					size;		// of the whole file
+	fs::file_time_type	last_used;
+};
+
+std::mutex						cache_mutex;
+fs::path						directory{};	// set on first use, see resolve()
+u64								max_size{ default_max_size };
+u32								max_entries{ default_max_entries };
+// Entries that are on disk, by key hash. Filled from the directory on first use.
+std::unordered_map<u64, entry>	entries;
+bool							is_scanned{ false };
+asset_cache_stats				stats{};
+
+// Relative paths, like the default directory, are relative to the executable. The working
+// directory of the editor changes when a project is opened, the cache shouldn't move with it.
+fs::path
+resolve(const char* path)
+{
+	const fs::path p{ path };
+	if (p.is_absolute()) return p;
+	wchar_t module_path[MAX_PATH]{};
+	const DWORD length{ GetModuleFileNameW(nullptr, module_path, MAX_PATH) };
+	if (!length || length == MAX_PATH) return p;
+	return fs::path{ module_path }.parent_path() / p;
+}
+
+fs::path
+entry_path(u64 hash)
+{
+	char name[32]{};
+	sprintf_s(name, "%016llx.bin", (unsigned long long)hash);
+	return directory / name;
+}
+
+void
+scan_directory()
+{
+	if (is_scanned) return;
+	is_scanned = true;
+	if (directory.empty()) directory = resolve(default_directory);
+	entries.clear();
+	stats.size = 0;
+
+	std::error_code error;
+	fs::create_directories(directory, error);
+	for (const auto& file : fs::directory_iterator{ directory, error })
+	{
+		if (!file.is_regular_file(error) || file.path().extension() != ".bin") continue;
+		const std::string name{ file.path().stem().string() };
+		char* end{ nullptr };
+		const u64 hash{ strtoull(name.c_str(), &end, 16) };
+		if (name.size() != 16 || *end) continue;
+
+		const entry e{ (u64)file.file_size(error), file.last_write_time(error) };
+		entries[hash] = e;
+		stats.size += e.size;
+	}
+	stats.entry_count = (u32)entries.size();
+}
+
+void
+remove_entry(u64 hash)
+{
+	auto it{ entries.find(hash) };
+	if (it == entries.end()) return;
+	std::error_code error;
+	fs::remove(entry_path(hash), error);
+	stats.size -= it->second.size;
+	entries.erase(it);
+	stats.entry_count = (u32)entries.size();
+}
+
+// Remove the least recently used entries until the cache is within its limits.
+void
+evict()
+{
+	if (stats.size <= max_size && entries.size() <= max_entries) return;
+
+	// Sort the entries by last use once, instead of looking for the oldest one for every eviction.
+	utl::vector<std::pair<fs::file_time_type, u64>> by_age;
+	by_age.reserve(entries.size());
+	for (const auto& [hash, e] : entries) by_age.emplace_back(e.last_used, hash);
+	std::sort(by_age.begin(), by_age.end());
+
+	for (u32 i{ 0 }; i < by_age.size() && (stats.size > max_size || entries.size() > max_entries); ++i)
+	{
+		remove_entry(by_age[i].second);
+		++stats.evictions;
+	}
+}
+} // anonymous namespace
+
+void
+configure(const char* path, u64 size, u32 count)
+{
+	assert(path && size && count);
+	std::lock_guard lock{ cache_mutex };
+	directory = resolve(path);
+	max_size = size;
+	max_entries = count;
+	is_scanned = false;
+	scan_directory();
+	evict();
+}
+
+bool
+load(const cache_key& key, scene_data& data)
+{
+	std::lock_guard lock{ cache_mutex };
+	scan_directory();
+	const u64 hash{ key.hash() };
+	auto it{ entries.find(hash) };
+	if (it == entries.end())
+	{
+		++stats.misses;
+		return false;
+	}
+
+	const fs::path path{ entry_path(hash) };
+	std::ifstream file{ path, std::ios::in | std::ios::binary };
+	entry_header header{};
+	bool result{ file && file.read((char*)&header, sizeof(header)) &&
+		header.magic == entry_magic && header.key_size == key.size() &&
+		header.data_size && header.data_size <= u32_invalid_id &&
+		sizeof(header) + header.key_size + header.data_size == it->second.size };
+
+	if (result)
+	{
+		// Compare the whole key, the hash alone could collide.
+		utl::vector<u8> stored_key(header.key_size);
+		result = file.read((char*)stored_key.data(), header.key_size) && !memcmp(stored_key.data(), key.data(), key.size());
+	}
+
+	u8* buffer{ nullptr };
+	if (result)
+	{
+		buffer = (u8*)CoTaskMemAlloc(header.data_size);
+		result = buffer && file.read((char*)buffer, header.data_size);
+	}
+	file.close();
+
+	if (!result)
+	{
+		if (buffer) CoTaskMemFree(buffer);
+		// Wrong key or a damaged file. Either way the tool runs and stores a new entry.
+		remove_entry(hash);
+		++stats.misses;
+		return false;
+	}
+
+	data.buffer = buffer;
+	data.buffer_size = (u32)header.data_size;
+	// The file time is the last use, so it survives restarts of the editor.
+	std::error_code error;
+	it->second.last_used = fs::file_time_type::clock::now();
+	fs::last_write_time(path, it->second.last_used, error);
+	++stats.hits;
+	stats.bytes_read += header.data_size;
+	return true;
+}
+
+void
+store(const cache_key& key, const scene_data& data)
+{
+	assert(data.buffer && data.buffer_size);
+	std::lock_guard lock{ cache_mutex };
+	scan_directory();
+	const u64 hash{ key.hash() };
+	remove_entry(hash);
+
+	// Write to a temporary file first, so that a crash or a full disk
+	// can't leave a partly written entry behind.
+	const fs::path path{ entry_path(hash) };
+	fs::path temp_path{ path };
+	temp_path += ".tmp";
+	const entry_header header{ entry_magic, (u32)key.size(), data.buffer_size };
+	{
+		std::ofstream file{ temp_path, std::ios::out | std::ios::binary | std::ios::trunc };
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)key.data(), key.size());
+		file.write((const char*)data.buffer, data.buffer_size);
+	}
+	std::error_code error;
+	if (fs::file_size(temp_path, error) != sizeof(header) + key.size() + data.buffer_size)
+	{
+		fs::remove(temp_path, error);
+		return;
+	}
+	fs::rename(temp_path, path, error);
+	if (error)
+	{
+		fs::remove(temp_path, error);
+		return;
+	}
+
+	const entry e{ sizeof(header) + key.size() + data.buffer_size, fs::last_write_time(path, error) };
+	entries[hash] = e;
+	stats.size += e.size;
+	stats.entry_count = (u32)entries.size();
+	++stats.stores;
+	stats.bytes_written += data.buffer_size;
+	evict();
+}
+
+void
+clear()
+{
+	std::lock_guard lock{ cache_mutex };
+	scan_directory();
+	while (!entries.empty()) remove_entry(entries.begin()->first);
+}
+
+asset_cache_stats
+get_stats()
+{
+	std::lock_guard lock{ cache_mutex };
+	scan_directory();
+	return stats;
+}
+} // asset_cache namespace
+
+EDITOR_INTERFACE void
+ConfigureAssetCache(const char* directory, u64 max_size, u32 max_entries)
+{
+	asset_cache::configure(directory, max_size, max_entries);
+}
+
+EDITOR_INTERFACE void
+GetAssetCacheStats(asset_cache_stats* stats)
+{
+	assert(stats);
+	*stats = asset_cache::get_stats();
+}
+
+EDITOR_INTERFACE void
+ClearAssetCache()
+{
+	asset_cache::clear();
+}
+}
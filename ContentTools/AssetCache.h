@@ -0,0 +1,82 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace ferraris::tools {
+
+struct scene_data;
+
+// Bump this whenever a change in ContentTools changes the packed output for the same
+// inputs. It's part of every cache key, so entries written by older versions are never used.
+constexpr u32 tools_version{ 1 };
+
+// Kind of asset a cache entry holds, so different tools with the same inputs get different keys.
+enum class cache_entry_type : u32
+{
+	primitive_mesh,
+	geometry_import,
+};
+
+// The inputs of a tool, appended field by field. Structs are added one field at a time
+// instead of as a whole, so that padding bytes never end up in the key.
+class cache_key
+{
+public:
+	explicit cache_key(cache_entry_type type)
+	{
+		add(tools_version);
+		add((u32)type);
+	}
+
+	template<typename T>
+	void add(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		add(&value, sizeof(T));
+	}
+
+	void add(const void* const data, u64 size)
+	{
+		const u64 offset{ _bytes.size() };
+		_bytes.resize(offset + size);
+		memcpy(&_bytes[offset], data, size);
+	}
+
+	[[nodiscard]] u64 hash() const { return utl::fnv1a_64((const char*)_bytes.data(), _bytes.size()); }
+	[[nodiscard]] const u8* data() const { return _bytes.data(); }
+	[[nodiscard]] u64 size() const { return _bytes.size(); }
+
+private:
+	utl::vector<u8>		_bytes;
+};
+
+struct asset_cache_stats
+{
+	u64 hits;
+	u64 misses;
+	u64 stores;
+	u64 evictions;
+	u64 bytes_read;
+	u64 bytes_written;
+	u64 size;			// bytes on disk
+	u32 entry_count;
+};
+
+// An on-disk cache of packed tool outputs, addressed by the hash of a cache_key.
+// Each entry is one file that also stores the whole key, so a hash collision is a miss
+// and never returns the wrong asset. When the cache grows past its limits, the least
+// recently used entries are deleted. All functions are thread-safe.
+namespace asset_cache {
+
+// Relative directories are relative to the executable, not to the working directory.
+constexpr const char* default_directory{ "ContentCache" };
+constexpr u64 default_max_size{ 1024ull * 1024 * 1024 };
+constexpr u32 default_max_entries{ 16 * 1024 };
+
+void configure(const char* directory, u64 max_size, u32 max_entries);
+// On a hit, data.buffer is allocated with CoTaskMemAlloc like pack_data() does. The settings aren't changed.
+bool load(const cache_key& key, scene_data& data);
+void store(const cache_key& key, const scene_data& data);
+void clear();
+asset_cache_stats get_stats();
+}
+}
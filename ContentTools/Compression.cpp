@@ -0,0 +1,31 @@
+#include "ToolsCommon.h"
+#include "Geometry.h"
+#include "..\Engine\Utilities\Compression.h"
+
+namespace ferraris::tools {
+
+// Replace data->buffer with a compressed container that the engine's content::read_file()
+// decompresses when it's loaded. Works on any buffer, e.g. the output of pack_data() or
+// a game.bin written by the editor. The buffer is left as is if compression doesn't make it smaller.
+EDITOR_INTERFACE void
+CompressSceneData(scene_data* data)
+{
+	assert(data && data->buffer && data->buffer_size);
+	if (!data || !data->buffer || !data->buffer_size) return;
+	if (compression::is_compressed(data->buffer, data->buffer_size)) return;
+
+	memory::scoped_tag memory_tag{ memory::tag::geometry };
+	const u64 capacity{ compression::compress_bound(data->buffer_size) };
+	std::unique_ptr<u8[]> buffer{ std::make_unique<u8[]>(capacity) };
+	const u64 size{ compression::compress(data->buffer, data->buffer_size, buffer.get(), capacity) };
+	if (!size || size >= data->buffer_size) return;
+
+	u8* const compressed{ (u8*)CoTaskMemAlloc(size) };
+	assert(compressed);
+	if (!compressed) return;
+	memcpy(compressed, buffer.get(), size);
+	CoTaskMemFree(data->buffer);
+	data->buffer = compressed;
+	data->buffer_size = (u32)size;
+}
+}
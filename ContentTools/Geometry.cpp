@@ -1,4 +1,5 @@
 #include "Geometry.h"
+#include "AssetCache.h"
 
 namespace ferraris::tools {
 
@@ -363,4 +364,15 @@ pack_data(const scene& scene, scene_data& data)
 	}
 	assert(scene_size == at);
 }
+
+void
+add_to_cache_key(cache_key& key, const geometry_import_settings& settings)
+{
+	key.add(settings.smoothing_angle);
+	key.add(settings.calculate_normals);
+	key.add(settings.calculate_tangents);
+	key.add(settings.reverse_handedness);
+	key.add(settings.import_embedded_texture);
+	key.add(settings.import_animations);
+}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "ToolsCommon.h"
 
 namespace ferraris::tools {
+class cache_key;
 // packed data sending to the GPU
 namespace packed_vertex{
 
@@ -72,5 +73,7 @@ struct scene_data
 
 void process_scene(scene& scene, const geometry_import_settings& setting);
 void pack_data(const scene& scene, scene_data& data);
+// Add the settings that change the output of process_scene() to an asset cache key.
+void add_to_cache_key(cache_key& key, const geometry_import_settings& settings);
 
 }
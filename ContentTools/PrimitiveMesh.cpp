@@ -1,5 +1,6 @@
 #include "PrimitiveMesh.h"
 #include "Geometry.h"
+#include "AssetCache.h"
 namespace ferraris::tools {
 
 
@@ -282,11 +283,23 @@ CreatePrimitiveMesh(scene_data* data, primitive_init_info* info)
 {
 	assert(data && info);
 	assert(info->type < primitive_mesh_type::count);
+	memory::scoped_tag memory_tag{ memory::tag::geometry };
+	data->settings.calculate_normals = 1;
+
+	// The same inputs always produce the same mesh, so look in the cache first.
+	cache_key key{ cache_entry_type::primitive_mesh };
+	key.add(info->type);
+	key.add(info->segments);
+	key.add(info->size);
+	key.add(info->lod);
+	add_to_cache_key(key, data->settings);
+	if (asset_cache::load(key, *data)) return;
+
 	scene scene{}; 
 	creators[info->type](scene, *info);
-	data->settings.calculate_normals = 1;
 	process_scene(scene, data->settings);
 	pack_data(scene, *data);
+	asset_cache::store(key, *data);
 }
 
 }
\ No newline at end of file
@@ -18,6 +18,7 @@ entity create(entity_info info)
 {
 	assert(info.transform); // all entities must have a transform component
 	if (!info.transform) return entity{};
+	memory::scoped_tag memory_tag{ memory::tag::entity };
 	entity_id id;
 	if (free_ids.size() > id::min_delete_elements)
 	{
@@ -53,6 +54,56 @@ entity create(entity_info info)
 	return new_entity;
 }
 
+bool create(const entity_range_info& info, entity* entities)
+{
+	assert(info.count && info.positions && info.rotations && info.scales && entities);
+	if (!info.count || !entities) return false;
+	memory::scoped_tag memory_tag{ memory::tag::entity };
+
+	// Reuse free ids first, then add new ids. New ids are consecutive, which lets
+	// transform::create() copy their transforms into the component arrays in bulk.
+	u32 i{ 0 };
+	for (; i < info.count && free_ids.size() > id::min_delete_elements; ++i)
+	{
+		entity_id id{ free_ids.front() };
+		assert(!is_alive(id));
+		free_ids.pop_front();
+		id = entity_id{ id::new_generation(id) };
+		++generations[id::index(id)];
+		entities[i] = entity{ id };
+	}
+	if (i < info.count)
+	{
+		const id::id_type first_index{ (id::id_type)generations.size() };
+		const u64 new_size{ first_index + (info.count - i) };
+		generations.resize(new_size);
+		transforms.resize(new_size);
+		scripts.resize(new_size);
+		for (id::id_type index{ first_index }; i < info.count; ++i, ++index)
+		{
+			entities[i] = entity{ entity_id{ index } };
+		}
+	}
+
+	transform::create(info.positions, info.rotations, info.scales, entities, info.count);
+
+	bool result{ true };
+	for (i = 0; i < info.count; ++i)
+	{
+		const id::id_type index{ id::index(entities[i].get_id()) };
+		assert(!transforms[index].is_valid());
+		transforms[index] = transform::component{ transform::transform_id{ (id::id_type)entities[i].get_id() } };
+
+		if (info.script_creators && info.script_creators[i])
+		{
+			assert(!scripts[index].is_valid());
+			scripts[index] = script::create(script::init_info{ info.script_creators[i] }, entities[i]);
+			result &= scripts[index].is_valid();
+		}
+	}
+	return result;
+}
+
 void remove(entity_id id)
 {
 	const id::id_type index{ id::index(id) };
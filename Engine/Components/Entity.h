@@ -18,7 +18,21 @@ struct entity_info
 	transform::init_info* transform{ nullptr };
 	script::init_info* script{ nullptr };
 };
+// Describes a batch of entities. Transforms are given as arrays with one item per entity.
+struct entity_range_info
+{
+	u32 count{ 0 };
+	const math::v3* positions{ nullptr };
+	const math::v4* rotations{ nullptr };
+	const math::v3* scales{ nullptr };
+	// Optional. One creator per entity, entities with a nullptr creator don't get a script.
+	const script::detail::script_creator* script_creators{ nullptr };
+};
+
 entity create(entity_info info);
+// Create info.count entities at once and write them to 'entities'. Returns false if
+// a script couldn't be created, the entities are created nevertheless.
+bool create(const entity_range_info& info, entity* entities);
 void remove(entity_id id);
 bool is_alive(entity_id id);
 }
@@ -11,7 +11,7 @@ utl::vector<id::id_type>			id_mapping;// id -> index -> entity_scripts[id_mappin
 utl::vector<id::generation_type>	generations;// restore the generation part of id
 utl::deque<script_id>				free_ids;// restore the free id
 
-using script_registry = std::unordered_map<size_t, detail::script_creator>;
+using script_registry = utl::flat_map<size_t, detail::script_creator>;
 
 script_registry&
 registery()
@@ -63,7 +63,7 @@ get_script_creator(size_t tag)
 {
 	auto script = ferraris::script::registery().find(tag);
 	assert(script != ferraris::script::registery().end() && script->first == tag);
-	return script->second;
+	return script != ferraris::script::registery().end() ? script->second : nullptr;
 }
 
 #ifdef USE_WITH_EDITOR
@@ -82,6 +82,7 @@ create(const init_info& info, game_entity::entity entity)
 {
 	assert(entity.is_valid());
 	assert(info.script_creator);
+	memory::scoped_tag memory_tag{ memory::tag::script };
 
 	script_id id{};
 	if (free_ids.size() > id::min_delete_elements)// reuse the free_ids
@@ -19,6 +19,7 @@ component create(const init_info& info, game_entity::entity entity)
 {
 	assert(entity.is_valid());
 	const id::id_type entity_index{ id::index(entity.get_id()) };
+	memory::scoped_tag memory_tag{ memory::tag::transform };
 
 	if (positions.size() > entity_index)
 	{
@@ -37,6 +38,40 @@ component create(const init_info& info, game_entity::entity entity)
 	return component(transform_id{ (id::id_type)entity.get_id() });
 }
 
+void create(const math::v3* src_positions, const math::v4* src_rotations, const math::v3* src_scales,
+			const game_entity::entity* entities, u32 count)
+{
+	assert(src_positions && src_rotations && src_scales && entities && count);
+	memory::scoped_tag memory_tag{ memory::tag::transform };
+
+	// Entities that reuse an id overwrite their slot.
+	u32 i{ 0 };
+	for (; i < count; ++i)
+	{
+		assert(entities[i].is_valid());
+		const id::id_type entity_index{ id::index(entities[i].get_id()) };
+		if (entity_index >= positions.size()) break;
+		positions[entity_index] = src_positions[i];
+		rotations[entity_index] = src_rotations[i];
+		scales[entity_index] = src_scales[i];
+	}
+
+	// The rest are new entities with consecutive ids at the end of the storage.
+	if (i < count)
+	{
+		const id::id_type first_index{ id::index(entities[i].get_id()) };
+		const u32 new_count{ count - i };
+		assert(first_index == positions.size());
+		assert(id::index(entities[count - 1].get_id()) == first_index + new_count - 1);
+		positions.resize(first_index + new_count);
+		rotations.resize(first_index + new_count);
+		scales.resize(first_index + new_count);
+		memcpy(&positions[first_index], &src_positions[i], new_count * sizeof(math::v3));
+		memcpy(&rotations[first_index], &src_rotations[i], new_count * sizeof(math::v4));
+		memcpy(&scales[first_index], &src_scales[i], new_count * sizeof(math::v3));
+	}
+}
+
 void remove([[maybe_unused]] component c)
 {
 	assert(c.is_valid());
@@ -10,5 +10,10 @@ struct init_info
 };
 
 component create(const init_info& info, game_entity::entity entity);
+// Create the transforms of 'count' entities from arrays of positions, rotations and scales.
+// Entities that are new (have ids past the end of the transform storage) must come last
+// and have consecutive ids, so that their transforms can be copied with one memcpy per array.
+void create(const math::v3* positions, const math::v4* rotations, const math::v3* scales,
+			const game_entity::entity* entities, u32 count);
 void remove(component c);
 }
\ No newline at end of file
@@ -1,14 +1,20 @@
 #include "ContentLoader.h"
+#include "MappedFile.h"
+#include "ShaderLibrary.h"
+#include "LevelFormat.h"
+#include "..\Utilities\Compression.h"
 #include "..\Components\Entity.h"
 #include "..\Components\Transform.h"
 #include "..\Components\Script.h"
 #include "Graphics\GraphicsPlatformInterface.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <string>
+#include <thread>
 
 #if !defined(SHIPPING)
 
-#include <fstream>
-#include <filesystem>
-#include <Windows.h>
 namespace ferraris::content {
 namespace {
 enum component_type
@@ -19,48 +25,211 @@ enum component_type
 	count
 };
 utl::vector<game_entity::entity> entities;
-transform::init_info transform_info{};
-script::init_info script_info{};
 
+// Entities of a level that are ready to be created. For the sectioned format the
+// transform arrays point into the file data, for the old format they point to
+// the vectors below, which hold the decoded transforms.
+struct level_data
+{
+	file_data										file{};
+	u32												count{ 0 };
+	const math::v3*									positions{ nullptr };
+	const math::v4*									rotations{ nullptr };
+	const math::v3*									scales{ nullptr };
+	// One per entity. Empty if no entity has a script.
+	utl::vector<script::detail::script_creator>		script_creators;
+
+	utl::vector<math::v3>							decoded_positions;
+	utl::vector<math::v4>							decoded_rotations;
+	utl::vector<math::v3>							decoded_scales;
+};
+
+// Written by the parser every now and then, so that loads can report progress.
+// Counts in units of 1/progress_steps. Reading an out of date value is fine.
+using progress_counter = std::atomic<u32>;
+constexpr u32 progress_steps{ 1024 };
+
+u32
+read_u32(const u8*& data)
+{
+	u32 value{ 0 };
+	memcpy(&value, data, sizeof(u32)); data += sizeof(u32);
+	return value;
+}
+
+std::atomic<u32> worker_thread_count{ 0 }; // 0: one per hardware thread
+
+// The threads of parallel_for(). They're started by content::initialize() and stopped by
+// content::shutdown(), so that a load doesn't pay for creating threads every time it splits
+// work. Without workers, the thread that calls parallel_for() does all of the work.
+class worker_pool
+{
+public:
+	// A parallel_for() call. It's split into ranges, which are taken by the workers and by
+	// the thread that made the call.
+	struct job
+	{
+		bool				(*call)(void* func, u32 begin, u32 end);
+		void*				func;
+		u32					count;
+		u32					range;
+		u32					range_count;
+		u32					next_range{ 0 };	// guarded by the mutex of the pool
+		std::atomic<u32>	remaining{ 0 };
+		std::atomic<bool>	result{ true };
+	};
+
+	worker_pool() = default;
+	DISABLE_COPY_AND_MOVE(worker_pool);
+	~worker_pool() { assert(_workers.empty()); }
+
+	void initialize()
+	{
+		std::lock_guard lock{ _mutex };
+		assert(_workers.empty());
+		_is_stopping = false;
+		const u32 hardware_threads{ std::thread::hardware_concurrency() };
+		const u32 worker_count{ hardware_threads > 1 ? hardware_threads - 1 : 1 };
+		_workers.reserve(worker_count);
+		for (u32 i{ 0 }; i < worker_count; ++i) _workers.emplace_back([this]() { worker(); });
+	}
+
+	// Waits for the jobs that are still queued.
+	void shutdown()
+	{
+		{
+			std::lock_guard lock{ _mutex };
+			_is_stopping = true;
+		}
+		_job_ready.notify_all();
+		for (u32 i{ 0 }; i < _workers.size(); ++i) _workers[i].join();
+		_workers.clear();
+	}
+
+	// Returns once every range of the job is done.
+	bool run(job& j)
+	{
+		std::unique_lock lock{ _mutex };
+		j.remaining.store(j.range_count, std::memory_order_relaxed);
+		_jobs.emplace_back(&j);
+		_job_ready.notify_all();
+
+		// This thread works on its own job too, so the job is done even if all workers are busy with other loads.
+		while (j.next_range < j.range_count)
+		{
+			const u32 index{ take_range(j) };
+			lock.unlock();
+			run_range(j, index);
+			lock.lock();
+		}
+		_job_done.wait(lock, [&j]() { return !j.remaining.load(std::memory_order_acquire); });
+		return j.result.load(std::memory_order_relaxed);
+	}
+
+private:
+	void worker()
+	{
+		std::unique_lock lock{ _mutex };
+		while (true)
+		{
+			_job_ready.wait(lock, [this]() { return !_jobs.empty() || _is_stopping; });
+			if (_jobs.empty()) return;
+			job& j{ *_jobs.front() };
+			const u32 index{ take_range(j) };
+			lock.unlock();
+			run_range(j, index);
+			lock.lock();
+		}
+	}
+
+	// Call with the mutex locked. The job leaves the queue when its last range is taken.
+	u32 take_range(job& j)
+	{
+		const u32 index{ j.next_range++ };
+		if (j.next_range == j.range_count)
+		{
+			for (u32 i{ 0 }; i < _jobs.size(); ++i)
+			{
+				if (_jobs[i] != &j) continue;
+				_jobs.erase(_jobs.begin() + i);
+				break;
+			}
+		}
+		return index;
+	}
+
+	void run_range(job& j, u32 index)
+	{
+		const u32 begin{ index * j.range };
+		const u32 end{ j.count - begin < j.range ? j.count : begin + j.range };
+		if (!j.call(j.func, begin, end)) j.result.store(false, std::memory_order_relaxed);
+		// NOTE: the caller may return as soon as the count is 0, so the job isn't used after this.
+		if (j.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard lock{ _mutex };
+			_job_done.notify_all();
+		}
+	}
+
+	std::mutex					_mutex;
+	std::condition_variable		_job_ready;
+	std::condition_variable		_job_done;
+	utl::deque<job*>			_jobs;
+	utl::vector<std::thread>	_workers;
+	bool						_is_stopping{ false };
+};
+
+worker_pool pool;
+
+// Split [0, count) into ranges of at least 'min_range' items and call func(begin, end)
+// for each range on the worker threads. Returns false if any call returned false.
+template<typename function>
 bool
-read_transform(const u8*& data, game_entity::entity_info& info)
+parallel_for(u32 count, u32 min_range, function func)
+{
+	u32 thread_count{ worker_thread_count.load(std::memory_order_relaxed) };
+	if (!thread_count) thread_count = std::thread::hardware_concurrency();
+	if (!thread_count) thread_count = 1;
+	if (count / min_range < thread_count) thread_count = count / min_range ? count / min_range : 1;
+	if (thread_count == 1) return func(0u, count);
+
+	worker_pool::job job{};
+	job.call = [](void* f, u32 begin, u32 end) { return (*(function*)f)(begin, end); };
+	job.func = &func;
+	job.count = count;
+	job.range = (count + thread_count - 1) / thread_count;
+	job.range_count = (count + job.range - 1) / job.range;
+	return pool.run(job);
+}
+
+bool
+read_transform(const u8* data, level_data& level, u32 entity_index)
 {
 	using namespace DirectX;
 	f32 rotation[3];
 
-	assert(!info.transform);
-	memcpy(&transform_info.position[0], data, sizeof(transform_info.position)); data += sizeof(transform_info.position);
+	memcpy(&level.decoded_positions[entity_index], data, sizeof(math::v3)); data += sizeof(math::v3);
 	memcpy(&rotation[0], data, sizeof(rotation)); data += sizeof(rotation);
-	memcpy(&transform_info.scale[0], data, sizeof(transform_info.scale)); data += sizeof(transform_info.scale);
+	memcpy(&level.decoded_scales[entity_index], data, sizeof(math::v3));
 
 	XMFLOAT3A rot{ &rotation[0] };
 	XMVECTOR quat{ XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3A(&rot)) };
-	XMFLOAT4A rot_quat{};
-	XMStoreFloat4A(&rot_quat, quat);
-	memcpy(&transform_info.rotation[0], &rot_quat, sizeof(transform_info.rotation));
-
-	info.transform = &transform_info;
+	XMStoreFloat4(&level.decoded_rotations[entity_index], quat);
 	return true;
 }
+
 bool
-read_script(const u8*& data, game_entity::entity_info& info)
+read_script(const u8* data, level_data& level, u32 entity_index)
 {
-	assert(!info.script);
-	const u32 name_length{ *data }; data += sizeof(u32);
-	// if a script name is longer than 255 characters then something is probably
-	// very wrong, either with the binary writer or the game programmer.
-	assert(name_length < 256);
-	char script_name[256];
-	memcpy(&script_name[0], data, name_length); data += name_length;
-	// make the name a zero-terminated c-string.
-	script_name[name_length] = 0;
-
-	script_info.script_creator = script::detail::get_script_creator(script::detail::string_hash()(script_name));
-	info.script = &script_info;
-	return script_info.script_creator != nullptr;
+	// the editor writes the hash of the script name instead of the name,
+	// so we can look up the creator without hashing anything here.
+	u64 script_hash{ 0 };
+	memcpy(&script_hash, data, sizeof(u64));
+	level.script_creators[entity_index] = script::detail::get_script_creator(script_hash);
+	return level.script_creators[entity_index] != nullptr;
 }
 
-using component_reader = bool(*)(const u8*&, game_entity::entity_info&);
+using component_reader = bool(*)(const u8*, level_data&, u32);
 component_reader component_readers[]
 {
 	read_transform,
@@ -68,74 +237,452 @@ component_reader component_readers[]
 };
 static_assert(_countof(component_readers) == component_type::count);
 
+// Size of each component in the old format, not counting its type.
+constexpr u32 component_sizes[]
+{
+	sizeof(f32) * 9,	// position, rotation (euler angles), scale
+	sizeof(u64),		// script name hash
+};
+static_assert(_countof(component_sizes) == component_type::count);
+
+// Parse the sectioned level format, see LevelFormat.h.
 bool
-read_file(std::filesystem::path path, std::unique_ptr<u8[]>& data, u64& size)
+parse_level(level_data& level, progress_counter& progress)
 {
-	if (!std::filesystem::exists(path)) return false;
+	const u8* const data{ level.file.data() };
+	const u64 size{ level.file.size() };
+	assert(size >= sizeof(level::header));
+	const level::header& h{ *(const level::header*)data };
+	if (h.version != level::version || h.section_count != level::section::count || !h.entity_count) return false;
+
+	for (u32 i{ 0 }; i < level::section::count; ++i)
+	{
+		const level::section_info& s{ h.sections[i] };
+		if (s.offset % level::section_alignment || s.offset > size || s.size > size - s.offset) return false;
+	}
 
-	size = std::filesystem::file_size(path);
-	assert(size);
-	if (!size) return false;
-	data = std::make_unique<u8[]>(size);
-	std::ifstream file{ path, std::ios::in | std::ios::binary };
-	if (!file || !file.read((char*)data.get(), size))
+	const u32 count{ h.entity_count };
+	const u64 script_count{ h.sections[level::section::scripts].size / sizeof(level::script_record) };
+	if (h.sections[level::section::entities].size != count * sizeof(level::entity_record) ||
+		h.sections[level::section::positions].size != count * sizeof(math::v3) ||
+		h.sections[level::section::rotations].size != count * sizeof(math::v4) ||
+		h.sections[level::section::scales].size != count * sizeof(math::v3) ||
+		h.sections[level::section::scripts].size != script_count * sizeof(level::script_record))
 	{
-		file.close();
 		return false;
 	}
-	file.close();
+
+	const auto* const entity_records{ (const level::entity_record*)&data[h.sections[level::section::entities].offset] };
+	const auto* const script_records{ (const level::script_record*)&data[h.sections[level::section::scripts].offset] };
+
+	// Look up each script creator once, not once per entity.
+	utl::vector<script::detail::script_creator> creators(script_count);
+	for (u64 i{ 0 }; i < script_count; ++i)
+	{
+		creators[i] = script::detail::get_script_creator(script_records[i].hash);
+		if (!creators[i]) return false;
+	}
+
+	// Every entity has a fixed size record, so workers can take any range of entities.
+	// Each one assigns the scripts of its entities and touches every page of their
+	// transforms, so that the file is read from disk here and not when the entities
+	// are created, which may happen on the main thread.
+	if (script_count) level.script_creators.resize(count);
+	const math::v3* const positions{ (const math::v3*)&data[h.sections[level::section::positions].offset] };
+	const math::v4* const rotations{ (const math::v4*)&data[h.sections[level::section::rotations].offset] };
+	const math::v3* const scales{ (const math::v3*)&data[h.sections[level::section::scales].offset] };
+	std::atomic<u32> done{ 0 };
+	const bool result{ parallel_for(count, 16 * 1024, [&](u32 begin, u32 end) {
+		for (u32 i{ begin }; i < end; ++i)
+		{
+			const u32 script_index{ entity_records[i].script_index };
+			if (script_index == u32_invalid_id) continue;
+			if (script_index >= script_count) return false;
+			level.script_creators[i] = creators[script_index];
+		}
+		constexpr u32 page_size{ 4096 };
+		u8 sum{ 0 };
+		for (u32 i{ begin }; i < end; i += page_size / sizeof(math::v4))
+		{
+			sum += *(const u8*)&positions[i];
+			sum += *(const u8*)&rotations[i];
+			sum += *(const u8*)&scales[i];
+		}
+		[[maybe_unused]] volatile u8 touched{ sum };
+		const u32 total{ done.fetch_add(end - begin, std::memory_order_relaxed) + end - begin };
+		progress.store((u32)((u64)total * progress_steps / count), std::memory_order_relaxed);
+		return true;
+	}) };
+	if (!result) return false;
+
+	level.count = count;
+	level.positions = positions;
+	level.rotations = rotations;
+	level.scales = scales;
 	return true;
 }
 
-} // anonymous namespace
+// Parse the old format without a header, where each entity is stored as a list
+// of components. The size of an entity is only known after reading its components,
+// so a quick sequential pass finds where each entity starts. Then the entities are
+// decoded in parallel into arrays.
 bool
-load_game()
+parse_legacy_level(level_data& level, progress_counter& progress)
 {
-	// read game.bin and create the entities.
-	std::unique_ptr<u8[]> game_data{};
-	u64 size{ 0 };
-	if (!read_file("game.bin", game_data, size)) return false;
-	assert(game_data.get());
-	const u8* at{ game_data.get() };
-	constexpr u32 su32{ sizeof(u32) };
-	const u32 num_entities{ *at }; at += su32;
-	if (!num_entities) return false;
-	for (u32 entity_index{ 0 }; entity_index < num_entities; ++entity_index)
-	{
-		game_entity::entity_info info{};
-		const u32 entity_type{ *at }; at += su32;
-		const u32 num_components{ *at }; at += su32;
+	const u8* const data{ level.file.data() };
+	const u64 size{ level.file.size() };
+	const u8* at{ data };
+	if (size < sizeof(u32)) return false;
+	const u32 count{ read_u32(at) };
+	if (!count) return false;
+
+	utl::vector<u64> entity_offsets(count);
+	bool has_scripts{ false };
+	for (u32 entity_index{ 0 }; entity_index < count; ++entity_index)
+	{
+		entity_offsets[entity_index] = (u64)(at - data);
+		if ((u64)(data + size - at) < 2 * sizeof(u32)) return false;
+		[[maybe_unused]] const u32 entity_type{ read_u32(at) };
+		const u32 num_components{ read_u32(at) };
+		// all entities must have a transform component and it must be the first one.
+		if (!num_components) return false;
 		for (u32 component_index{ 0 }; component_index < num_components; ++component_index)
 		{
-			const u32 component_type{ *at }; at += su32;
+			if ((u64)(data + size - at) < sizeof(u32)) return false;
+			const u32 component_type{ read_u32(at) };
 			assert(component_type < component_type::count);
-			if (!component_readers[component_type](at, info)) return false;// once if a component read false.
+			if (component_type >= component_type::count) return false;
+			if ((component_index == 0) != (component_type == component_type::transform)) return false;
+			if ((u64)(data + size - at) < component_sizes[component_type]) return false;
+			has_scripts |= component_type == component_type::script;
+			at += component_sizes[component_type];
 		}
+	}
+	assert(at == data + size);
+	progress.store(progress_steps / 4, std::memory_order_relaxed);
+
+	level.decoded_positions.resize(count);
+	level.decoded_rotations.resize(count);
+	level.decoded_scales.resize(count);
+	if (has_scripts) level.script_creators.resize(count);
+
+	std::atomic<u32> done{ 0 };
+	const bool result{ parallel_for(count, 4 * 1024, [&](u32 begin, u32 end) {
+		for (u32 entity_index{ begin }; entity_index < end; ++entity_index)
+		{
+			const u8* entity_data{ data + entity_offsets[entity_index] + sizeof(u32) };
+			const u32 num_components{ read_u32(entity_data) };
+			for (u32 component_index{ 0 }; component_index < num_components; ++component_index)
+			{
+				const u32 component_type{ read_u32(entity_data) };
+				if (!component_readers[component_type](entity_data, level, entity_index)) return false;
+				entity_data += component_sizes[component_type];
+			}
+		}
+		const u32 total{ done.fetch_add(end - begin, std::memory_order_relaxed) + end - begin };
+		progress.store(progress_steps / 4 + (u32)((u64)total * (progress_steps * 3 / 4) / count), std::memory_order_relaxed);
+		return true;
+	}) };
+	if (!result) return false;
+
+	level.count = count;
+	level.positions = level.decoded_positions.data();
+	level.rotations = level.decoded_rotations.data();
+	level.scales = level.decoded_scales.data();
+	return true;
+}
+
+// Read the file and parse it. Nothing is created yet, so this can run on any thread.
+bool
+parse_level(const char* path, level_data& level, progress_counter& progress)
+{
+	memory::scoped_tag memory_tag{ memory::tag::content };
+	if (!read_file(path, level.file)) return false;
+
+	u32 magic{ 0 };
+	if (level.file.size() >= sizeof(level::header)) memcpy(&magic, level.file.data(), sizeof(u32));
+	const bool result{ magic == level::magic ? parse_level(level, progress) : parse_legacy_level(level, progress) };
+	progress.store(progress_steps, std::memory_order_relaxed);
+	return result;
+}
+
+// Create entities [first, first + count) of a parsed level. If any of them fails,
+// the whole batch is removed again, so 'entities' only holds live entities.
+bool
+create_entities(const level_data& level, u32 first, u32 count)
+{
+	assert(first + count <= level.count);
+	if (!count) return true;
+	memory::scoped_tag memory_tag{ memory::tag::content };
+	game_entity::entity_range_info info{};
+	info.count = count;
+	info.positions = &level.positions[first];
+	info.rotations = &level.rotations[first];
+	info.scales = &level.scales[first];
+	info.script_creators = level.script_creators.empty() ? nullptr : &level.script_creators[first];
+
+	const u64 offset{ entities.size() };
+	entities.resize(offset + count);
+	if (game_entity::create(info, &entities[offset])) return true;
 
-		// create game entity
-		assert(info.transform);
-		game_entity::entity entity{ game_entity::create(info) };
-		if (!entity.is_valid()) return false;
-		entities.emplace_back(entity);
+	for (u64 i{ offset }; i < entities.size(); ++i)
+	{
+		const game_entity::entity_id id{ entities[i].get_id() };
+		if (id::is_valid(id) && game_entity::is_alive(id)) game_entity::remove(id);
 	}
-	assert(at == game_data.get() + size);
+	entities.resize(offset);
+	return false;
+}
+
+// An asynchronous load. The file is mapped and parsed by 'worker', the entities
+// are created by update_level_loads() on the main thread.
+struct level_load
+{
+	level_data				level{};
+	std::thread				worker{};
+	std::atomic<u32>		state{ (u32)level_load_state::loading };
+	progress_counter		parse_progress{ 0 };
+	std::atomic<u32>		created_count{ 0 };
+	u32						batch_size{ 256 };
+
+	// main thread only
+	f32						max_commit_ms{ 0.f };
+	f32						total_commit_ms{ 0.f };
+	u32						commit_frames{ 0 };
+};
+
+utl::free_list<std::unique_ptr<level_load>>		level_loads;
+// Every load that wasn't released yet, so that unload_game() can release them.
+utl::vector<level_load_id>						active_loads;
+// Loads that still have entities to create, in the order they were started.
+utl::vector<level_load_id>						committing_loads;
+
+void
+finish_parsing(level_load& load)
+{
+	if (load.worker.joinable()) load.worker.join();
+}
+} // anonymous namespace
+
+bool
+initialize()
+{
+	pool.initialize();
 	return true;
 }
 
+void
+shutdown()
+{
+	assert(active_loads.empty() && entities.empty());
+	pool.shutdown();
+}
+
+bool
+read_file(const char* path, file_data& file)
+{
+	assert(path);
+	mapped_file mapped{};
+	if (!mapped.open(path)) return false;
+	if (!compression::is_compressed(mapped.data(), mapped.size()))
+	{
+		file.set(std::move(mapped));
+		return true;
+	}
+
+	// Chunks are independent, so each thread decompresses a range of them. Reading
+	// the file happens as the threads touch the pages of their compressed chunks,
+	// so disk reads of one range overlap with decompressing the others.
+	memory::scoped_tag memory_tag{ memory::tag::content };
+	const compression::container_header& header{ *compression::get_header(mapped.data(), mapped.size()) };
+	const u64 size{ header.uncompressed_size };
+	// NOTE: not std::make_unique, which would clear the buffer before it's overwritten.
+	std::unique_ptr<u8[]> buffer{ new u8[size] };
+	const u8* const data{ mapped.data() };
+	const u64 data_size{ mapped.size() };
+	u8* const dst{ buffer.get() };
+	const bool result{ parallel_for(header.chunk_count, 1, [data, data_size, dst](u32 begin, u32 end) {
+		for (u32 i{ begin }; i < end; ++i)
+		{
+			if (!compression::decompress_chunk(data, data_size, i, dst)) return false;
+		}
+		return true;
+	}) };
+	if (!result) return false;
+
+	file.set(std::move(buffer), size);
+	return true;
+}
+
+bool
+load_game(const char* path)
+{
+	// read game.bin and create the entities.
+	level_data level{};
+	progress_counter progress{ 0 };
+	if (!parse_level(path, level, progress)) return false;
+	// The file is closed when we're done.
+	return create_entities(level, 0, level.count);
+}
+
+void
+set_level_loader_thread_count(u32 count)
+{
+	worker_thread_count.store(count, std::memory_order_relaxed);
+}
+
 void
 unload_game()
 {
+	// Loads that are still running use the entities, so they're released first.
+	while (!active_loads.empty())
+	{
+		release_level_load(active_loads[0]);
+	}
 	for (auto entity : entities)
 	{
 		game_entity::remove(entity.get_id());
 	}
+	entities.clear();
+}
+
+level_load_id
+load_level_async(const char* path)
+{
+	assert(path);
+	const level_load_id id{ level_loads.add(std::make_unique<level_load>()) };
+	level_load& load{ *level_loads[id] };
+	// NOTE: the path is copied because the caller's string may be gone before the worker starts.
+	load.worker = std::thread{ [&load, file_path = std::string{ path }]() {
+		const bool result{ parse_level(file_path.c_str(), load.level, load.parse_progress) };
+		load.state.store((u32)(result ? level_load_state::committing : level_load_state::failed), std::memory_order_release);
+	} };
+	committing_loads.emplace_back(id);
+	active_loads.emplace_back(id);
+	return id;
+}
+
+level_load_status
+get_level_load_status(level_load_id id)
+{
+	assert(id::is_valid(id));
+	const level_load& load{ *level_loads[id] };
+	level_load_status status{};
+	status.state = (level_load_state)load.state.load(std::memory_order_acquire);
+	// The number of entities is known once the worker is done.
+	status.entity_count = status.state == level_load_state::loading ? 0 : load.level.count;
+	status.created_count = load.created_count.load(std::memory_order_relaxed);
+
+	// Parsing and creating count as one half of the work each.
+	const f32 parsed{ (f32)load.parse_progress.load(std::memory_order_relaxed) / (f32)progress_steps };
+	const f32 created{ status.entity_count && status.state != level_load_state::loading
+		? (f32)status.created_count / (f32)status.entity_count : 0.f };
+	status.progress = status.state == level_load_state::done ? 1.f : (parsed + created) * 0.5f;
+
+	status.max_commit_ms = load.max_commit_ms;
+	status.total_commit_ms = load.total_commit_ms;
+	status.commit_frames = load.commit_frames;
+	return status;
+}
+
+void
+update_level_loads(f32 budget_ms)
+{
+	using clock = std::chrono::steady_clock;
+	const clock::time_point start{ clock::now() };
+	auto elapsed_ms = [start]() { return std::chrono::duration<f32, std::milli>(clock::now() - start).count(); };
+
+	u32 i{ 0 };
+	while (i < committing_loads.size())
+	{
+		level_load& load{ *level_loads[committing_loads[i]] };
+		const level_load_state state{ (level_load_state)load.state.load(std::memory_order_acquire) };
+		if (state == level_load_state::loading)
+		{
+			++i;
+			continue;
+		}
+
+		if (state == level_load_state::committing)
+		{
+			finish_parsing(load);
+			const clock::time_point frame_start{ clock::now() };
+			u32 created{ load.created_count.load(std::memory_order_relaxed) };
+			// Create entities in batches until we run out of time. The batch size adapts,
+			// so that one batch takes about a quarter of the budget.
+			while (created < load.level.count && elapsed_ms() < budget_ms)
+			{
+				const u32 count{ load.level.count - created < load.batch_size ? load.level.count - created : load.batch_size };
+				const clock::time_point batch_start{ clock::now() };
+				if (!create_entities(load.level, created, count))
+				{
+					load.state.store((u32)level_load_state::failed, std::memory_order_release);
+					break;
+				}
+				created += count;
+				load.created_count.store(created, std::memory_order_relaxed);
+
+				const f32 batch_ms{ std::chrono::duration<f32, std::milli>(clock::now() - batch_start).count() };
+				if (batch_ms < budget_ms * 0.125f && load.batch_size < (1u << 20)) load.batch_size <<= 1;
+				else if (batch_ms > budget_ms * 0.5f && load.batch_size > 16) load.batch_size >>= 1;
+			}
+
+			const f32 commit_ms{ std::chrono::duration<f32, std::milli>(clock::now() - frame_start).count() };
+			load.max_commit_ms = commit_ms > load.max_commit_ms ? commit_ms : load.max_commit_ms;
+			load.total_commit_ms += commit_ms;
+			++load.commit_frames;
+
+			if (created == load.level.count && load.state.load(std::memory_order_relaxed) == (u32)level_load_state::committing)
+			{
+				load.state.store((u32)level_load_state::done, std::memory_order_release);
+			}
+		}
+
+		if (load.state.load(std::memory_order_relaxed) == (u32)level_load_state::committing)
+		{
+			// out of time
+			break;
+		}
+
+		// Done or failed. Close the file and free the parsed data, but keep the status until the load is released.
+		finish_parsing(load);
+		const u32 count{ load.level.count };
+		load.level = {};
+		load.level.count = count;
+		committing_loads.erase(i);
+	}
+}
+
+void
+release_level_load(level_load_id id)
+{
+	assert(id::is_valid(id));
+	level_load& load{ *level_loads[id] };
+	// NOTE: this blocks until the file is parsed if the load isn't finished yet.
+	finish_parsing(load);
+	for (u32 i{ 0 }; i < committing_loads.size(); ++i)
+	{
+		if (committing_loads[i] == id)
+		{
+			committing_loads.erase(i);
+			break;
+		}
+	}
+	for (u32 i{ 0 }; i < active_loads.size(); ++i)
+	{
+		if (active_loads[i] == id)
+		{
+			active_loads.erase(i);
+			break;
+		}
+	}
+	level_loads.remove(id);
 }
 
 bool
-load_engine_shaders(std::unique_ptr<u8[]>& shaders_blob, u64 & size)
+load_engine_shaders(shader_library& shaders)
 {
-	auto path = graphics::get_engine_shaders_path();
-	return read_file(path, shaders_blob, size);
+	return shaders.open(graphics::get_engine_shaders_path());
 }
 }
 #endif // !defined(SHIPPING)
\ No newline at end of file
@@ -2,8 +2,65 @@
 #include "CommonHeaders.h"
 #if !defined(SHIPPING)
 namespace ferraris::content {
-bool load_game();
+class file_data;
+class shader_library;
+
+// Start and stop the threads that decompress and parse content. initialize() is called
+// before anything is loaded, shutdown() after unload_game(). Without them, loading still
+// works, but only on the calling thread.
+bool initialize();
+void shutdown();
+
+// Read a whole file. Plain files are mapped into memory, compressed containers
+// (see Utilities\Compression.h) are detected by their header and decompressed
+// on several threads. Returns false if the file can't be read or the compressed
+// data is malformed. There are no checksums, so other corruption isn't detected.
+bool read_file(const char* path, file_data& file);
+
+bool load_game(const char* path = "game.bin");
+// Remove all entities that were created by load_game() and by asynchronous loads.
+// Loads that weren't released yet are released first.
 void unload_game();
-bool load_engine_shaders(std::unique_ptr<u8[]>& shaders_blob, u64& size);
+// Levels are parsed by several threads. 0 (the default) uses one per hardware thread.
+void set_level_loader_thread_count(u32 count);
+
+// Asynchronous level loading. The file is mapped and parsed on a worker thread,
+// then update_level_loads() creates the entities on the main thread a few at a
+// time, so that frames keep their budget while a level is loading.
+DEFINE_TYPED_ID(level_load_id);
+
+enum class level_load_state : u32
+{
+	loading,	// the file is being read and parsed
+	committing,	// entities are being created
+	done,
+	failed,
+};
+
+struct level_load_status
+{
+	level_load_state	state{ level_load_state::loading };
+	f32					progress{ 0.f };		// 0 to 1, reading and creating count as one half each
+	u32					entity_count{ 0 };		// 0 until the file is parsed
+	u32					created_count{ 0 };
+	// Main thread time spent creating entities: the longest frame, all frames and the number of frames.
+	f32					max_commit_ms{ 0.f };
+	f32					total_commit_ms{ 0.f };
+	u32					commit_frames{ 0 };
+};
+
+constexpr f32 default_level_commit_budget_ms{ 2.f };
+
+// Start loading a level file. The handle must be released with release_level_load()
+// once it's no longer needed, the loaded entities stay alive until unload_game().
+level_load_id load_level_async(const char* path);
+level_load_status get_level_load_status(level_load_id id);
+// Call once per frame on the main thread. Creates entities of parsed levels until
+// 'budget_ms' milliseconds have passed. Loads are committed in the order they were started.
+void update_level_loads(f32 budget_ms = default_level_commit_budget_ms);
+// Blocks if the file is still being parsed. Entities that weren't created yet are dropped.
+void release_level_load(level_load_id id);
+// Open the library of compiled engine shaders. It stays open until the library is closed.
+bool load_engine_shaders(shader_library& shaders);
 }
 #endif // !defined(SHIPPING)
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "GeometryLoader.h"
+#include "ContentLoader.h"
+
+#if !defined(SHIPPING)
+
+namespace ferraris::content {
+namespace {
+
+// Reads fields one after another and fails, instead of reading past the end,
+// when the data is shorter than its header fields say.
+class blob_reader
+{
+public:
+	blob_reader(const u8* data, u64 size) : _at{ data }, _end{ data + size } {}
+
+	bool read(u32& value) { return read_bytes(&value, sizeof(u32)); }
+	bool read(f32& value) { return read_bytes(&value, sizeof(f32)); }
+
+	// Returns a pointer to the next 'size' bytes and skips them.
+	bool skip(u64 size, const u8*& data)
+	{
+		if ((u64)(_end - _at) < size) return false;
+		data = _at;
+		_at += size;
+		return true;
+	}
+
+	bool read_name(const char*& name, u32& length)
+	{
+		const u8* data{ nullptr };
+		if (!read(length) || !skip(length, data)) return false;
+		name = (const char*)data;
+		return true;
+	}
+
+	[[nodiscard]] constexpr bool at_end() const { return _at == _end; }
+
+private:
+	bool read_bytes(void* value, u64 size)
+	{
+		if ((u64)(_end - _at) < size) return false;
+		memcpy(value, _at, size);
+		_at += size;
+		return true;
+	}
+
+	const u8*		_at;
+	const u8* const	_end;
+};
+
+bool
+read_submesh(blob_reader& reader, submesh_view& submesh)
+{
+	if (!reader.read_name(submesh.name, submesh.name_length) ||
+		!reader.read(submesh.lod_id) ||
+		!reader.read(submesh.vertex_size) ||
+		!reader.read(submesh.vertex_count) ||
+		!reader.read(submesh.index_size) ||
+		!reader.read(submesh.index_count) ||
+		!reader.read(submesh.lod_threshold))
+	{
+		return false;
+	}
+
+	if (!submesh.vertex_size || (submesh.index_size != sizeof(u16) && submesh.index_size != sizeof(u32))) return false;
+	// 64-bit math, so that large counts can't wrap around the bounds check.
+	return reader.skip((u64)submesh.vertex_size * submesh.vertex_count, submesh.vertices) &&
+		reader.skip((u64)submesh.index_size * submesh.index_count, submesh.indices);
+}
+} // anonymous namespace
+
+bool
+geometry_asset::load(const char* path)
+{
+	assert(path);
+	release();
+	file_data file{};
+	if (!read_file(path, file)) return false;
+	if (!load(file.data(), file.size())) return false;
+	_file = std::move(file);
+	return true;
+}
+
+bool
+geometry_asset::load(const u8* data, u64 size)
+{
+	assert(data && size);
+	release();
+	memory::scoped_tag memory_tag{ memory::tag::content };
+	blob_reader reader{ data, size };
+
+	u32 lod_count{ 0 };
+	if (!reader.read_name(_name, _name_length) || !reader.read(lod_count)) return false;
+	// Every LOD takes at least 8 bytes, which also keeps a bad count from reserving too much.
+	if (lod_count > size / (2 * sizeof(u32))) return false;
+	_lods.resize(lod_count);
+
+	bool result{ true };
+	for (u32 i{ 0 }; i < lod_count && result; ++i)
+	{
+		lod_view& lod{ _lods[i] };
+		result = reader.read_name(lod.name, lod.name_length) && reader.read(lod.submesh_count);
+		if (!result) break;
+		lod.first_submesh = (u32)_submeshes.size();
+
+		for (u32 j{ 0 }; j < lod.submesh_count && result; ++j)
+		{
+			_submeshes.emplace_back();
+			result = read_submesh(reader, _submeshes.back());
+		}
+		if (result && lod.submesh_count) lod.threshold = _submeshes[lod.first_submesh].lod_threshold;
+	}
+
+	// pack_data() sizes the buffer exactly, so there shouldn't be anything left.
+	result = result && reader.at_end();
+	if (!result) release();
+	return result;
+}
+
+void
+geometry_asset::release()
+{
+	_file.close();
+	_name = nullptr;
+	_name_length = 0;
+	_lods.clear();
+	_submeshes.clear();
+}
+}
+#endif // !defined(SHIPPING)
@@ -0,0 +1,86 @@
+#pragma once
+#include "CommonHeaders.h"
+#include "MappedFile.h"
+
+#if !defined(SHIPPING)
+
+// Runtime loader for the geometry written by ContentTools' pack_data():
+//
+//	u32 scene name length, scene name
+//	u32 LOD count
+//	for each LOD:
+//		u32 LOD name length, LOD name
+//		u32 mesh count
+//		for each mesh:
+//			u32 mesh name length, mesh name
+//			u32 LOD id
+//			u32 vertex size
+//			u32 vertex count
+//			u32 index size (2 or 4)
+//			u32 index count
+//			f32 LOD threshold
+//			vertex data		vertex size * vertex count bytes
+//			index data		index size * index count bytes
+//
+// Vertex and index data are used in place: a submesh view points into the file,
+// nothing is copied per vertex. Names are variable length, so the data isn't aligned.
+// The graphics backends copy it into upload buffers anyway, so that doesn't matter.
+namespace ferraris::content {
+
+struct submesh_view
+{
+	const char*		name{ nullptr };		// not zero-terminated
+	u32				name_length{ 0 };
+	u32				lod_id{ 0 };
+	f32				lod_threshold{ 0.f };
+	const u8*		vertices{ nullptr };	// vertex_count * vertex_size bytes
+	const u8*		indices{ nullptr };		// index_count * index_size bytes
+	u32				vertex_size{ 0 };
+	u32				vertex_count{ 0 };
+	u32				index_size{ 0 };		// sizeof(u16) or sizeof(u32)
+	u32				index_count{ 0 };
+};
+
+struct lod_view
+{
+	const char*		name{ nullptr };		// not zero-terminated
+	u32				name_length{ 0 };
+	f32				threshold{ 0.f };		// threshold of the first submesh, they're all the same in a LOD
+	u32				first_submesh{ 0 };		// index into geometry_asset::submeshes()
+	u32				submesh_count{ 0 };
+};
+
+class geometry_asset
+{
+public:
+	geometry_asset() = default;
+	DISABLE_COPY(geometry_asset);
+
+	geometry_asset(geometry_asset&& o) noexcept = default;
+	geometry_asset& operator=(geometry_asset&& o) noexcept = default;
+
+	// Read a geometry file (plain or compressed, see content::read_file()) and build
+	// the views. Returns false if the file can't be read or its layout is invalid.
+	bool load(const char* path);
+	// Build the views for geometry that's already in memory. The data isn't copied,
+	// so it must stay alive for as long as the views are used.
+	bool load(const u8* data, u64 size);
+	void release();
+
+	[[nodiscard]] constexpr const char* name() const { return _name; }
+	[[nodiscard]] constexpr u32 name_length() const { return _name_length; }
+	[[nodiscard]] u32 lod_count() const { return (u32)_lods.size(); }
+	[[nodiscard]] const lod_view& lod(u32 index) const { assert(index < _lods.size()); return _lods[index]; }
+	[[nodiscard]] u32 submesh_count() const { return (u32)_submeshes.size(); }
+	[[nodiscard]] const submesh_view& submesh(u32 index) const { assert(index < _submeshes.size()); return _submeshes[index]; }
+	[[nodiscard]] const submesh_view* submeshes() const { return _submeshes.data(); }
+
+private:
+	file_data						_file{};
+	const char*						_name{ nullptr };
+	u32								_name_length{ 0 };
+	utl::vector<lod_view>			_lods;
+	utl::vector<submesh_view>		_submeshes;
+};
+}
+#endif // !defined(SHIPPING)
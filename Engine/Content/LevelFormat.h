@@ -0,0 +1,65 @@
+#pragma once
+#include "CommonHeaders.h"
+
+// Layout of game.bin. The file is written by the editor (Project.SaveToBinary)
+// and parsed in place by content::load_game().
+//
+//	header
+//	entities		entity_record[entity_count]
+//	positions		math::v3[entity_count]
+//	rotations		math::v4[entity_count] (quaternions)
+//	scales			math::v3[entity_count]
+//	scripts			script_record[script_count]
+//	strings			script names, UTF-8, not zero-terminated
+//
+// Sections are stored in this order, each starts at a multiple of 'section_alignment'
+// and the header holds the offset (from the start of the file) and size of each of them.
+// Transforms are stored as structure of arrays, so the loader can copy each array
+// into the transform component storage at once. Every entity has a transform.
+namespace ferraris::content::level {
+
+constexpr u32 magic{ 0x4c564c46 }; // "FLVL"
+constexpr u32 version{ 1 };
+constexpr u64 section_alignment{ 16 };
+
+enum section : u32
+{
+	entities = 0,
+	positions,
+	rotations,
+	scales,
+	scripts,
+	strings,
+
+	count
+};
+
+struct section_info
+{
+	u64 offset;
+	u64 size;
+};
+
+struct header
+{
+	u32				magic;
+	u32				version;
+	u32				entity_count;
+	u32				section_count;
+	section_info	sections[section::count];
+};
+static_assert(sizeof(header) % section_alignment == 0);
+
+struct entity_record
+{
+	u32 type;			// reserved for later
+	u32 script_index;	// index into the script table or u32_invalid_id if the entity has no script
+};
+
+struct script_record
+{
+	u64 hash;			// utl::fnv1a_64 of the script name
+	u32 name_offset;	// offset of the name in the string section
+	u32 name_length;
+};
+}
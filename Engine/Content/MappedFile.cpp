@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#ifdef _WIN64
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN64
+
+namespace ferraris::content {
+
+#ifdef _WIN64
+
+bool
+mapped_file::open(const char* path)
+{
+	assert(path);
+	close();
+
+	// We read the files from front to back, so let the OS know it can read ahead.
+	const HANDLE file{ CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+								   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || !size.QuadPart)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* const view{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+	if (!view)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	_data = (const u8*)view;
+	_size = (u64)size.QuadPart;
+	_file = (u64)file;
+	_mapping = (u64)mapping;
+	return true;
+}
+
+void
+mapped_file::close()
+{
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping != invalid_handle) CloseHandle((HANDLE)_mapping);
+	if (_file != invalid_handle) CloseHandle((HANDLE)_file);
+	_data = nullptr;
+	_size = 0;
+	_file = invalid_handle;
+	_mapping = invalid_handle;
+}
+
+#else
+
+bool
+mapped_file::open(const char* path)
+{
+	assert(path);
+	close();
+
+	const int fd{ ::open(path, O_RDONLY | O_CLOEXEC) };
+	if (fd < 0) return false;
+
+	struct stat info {};
+	if (fstat(fd, &info) || info.st_size <= 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* const view{ mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) };
+	if (view == MAP_FAILED)
+	{
+		::close(fd);
+		return false;
+	}
+	// We read the files from front to back, so let the OS know it can read ahead.
+	madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	_data = (const u8*)view;
+	_size = (u64)info.st_size;
+	_file = (u64)fd;
+	return true;
+}
+
+void
+mapped_file::close()
+{
+	if (_data) munmap((void*)_data, (size_t)_size);
+	if (_file != invalid_handle) ::close((int)_file);
+	_data = nullptr;
+	_size = 0;
+	_file = invalid_handle;
+	_mapping = invalid_handle;
+}
+
+#endif // _WIN64
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace ferraris::content {
+
+/**
+* A read-only view of a whole file that is mapped into memory. The loaders
+* parse the data in place, so there's no intermediate copy of the file and
+* only the pages that are actually touched are read from disk.
+*
+* NOTE: the mapping is released when the object is destroyed or close() is
+*		called, so pointers into data() must not be kept after that.
+*/
+class mapped_file
+{
+public:
+	mapped_file() = default;
+	explicit mapped_file(const char* path) { open(path); }
+	~mapped_file() { close(); }
+
+	DISABLE_COPY(mapped_file);
+
+	mapped_file(mapped_file&& o) noexcept { move(o); }
+	mapped_file& operator=(mapped_file&& o) noexcept
+	{
+		assert(this != std::addressof(o));
+		if (this != std::addressof(o))
+		{
+			close();
+			move(o);
+		}
+		return *this;
+	}
+
+	// Map the file at 'path'. Returns false if the file doesn't exist, is empty
+	// or can't be mapped. Any previously mapped file is closed first.
+	bool open(const char* path);
+	void close();
+
+	[[nodiscard]] constexpr const u8* data() const { return _data; }
+	[[nodiscard]] constexpr u64 size() const { return _size; }
+	[[nodiscard]] constexpr bool is_open() const { return _data != nullptr; }
+
+private:
+	void move(mapped_file& o)
+	{
+		_data = o._data;
+		_size = o._size;
+		_file = o._file;
+		_mapping = o._mapping;
+		o._data = nullptr;
+		o._size = 0;
+		o._file = invalid_handle;
+		o._mapping = invalid_handle;
+	}
+
+	// OS handles are stored as integers so that this header doesn't need any platform headers.
+	// On Windows these are the file and file mapping handles, on Linux only _file is used
+	// and holds the file descriptor.
+	constexpr static u64 invalid_handle{ u64_invalid_id };
+
+	const u8*	_data{ nullptr };
+	u64			_size{ 0 };
+	u64			_file{ invalid_handle };
+	u64			_mapping{ invalid_handle };
+};
+
+/**
+* The contents of a file read by content::read_file(). Plain files are mapped and
+* used in place. Files that were written as a compressed container (see
+* Utilities\Compression.h) are decompressed into a buffer owned by this object.
+*
+* NOTE: as with mapped_file, pointers into data() are only valid until close().
+*/
+class file_data
+{
+public:
+	file_data() = default;
+	~file_data() { close(); }
+
+	DISABLE_COPY(file_data);
+
+	file_data(file_data&& o) noexcept { move(o); }
+	file_data& operator=(file_data&& o) noexcept
+	{
+		assert(this != std::addressof(o));
+		if (this != std::addressof(o))
+		{
+			close();
+			move(o);
+		}
+		return *this;
+	}
+
+	void close()
+	{
+		_file.close();
+		_buffer.reset();
+		_data = nullptr;
+		_size = 0;
+	}
+
+	[[nodiscard]] constexpr const u8* data() const { return _data; }
+	[[nodiscard]] constexpr u64 size() const { return _size; }
+	[[nodiscard]] constexpr bool is_open() const { return _data != nullptr; }
+	[[nodiscard]] bool is_compressed() const { return _buffer != nullptr; }
+
+	// Use the mapped file as is.
+	void set(mapped_file&& file)
+	{
+		close();
+		_file = std::move(file);
+		_data = _file.data();
+		_size = _file.size();
+	}
+
+	// Use a decompressed copy of the file.
+	void set(std::unique_ptr<u8[]>&& buffer, u64 size)
+	{
+		close();
+		_buffer = std::move(buffer);
+		_data = _buffer.get();
+		_size = size;
+	}
+
+private:
+	void move(file_data& o)
+	{
+		// Neither the mapping nor the buffer moves in memory, so _data stays valid.
+		_file = std::move(o._file);
+		_buffer = std::move(o._buffer);
+		_data = o._data;
+		_size = o._size;
+		o._data = nullptr;
+		o._size = 0;
+	}
+
+	mapped_file				_file{};
+	std::unique_ptr<u8[]>	_buffer{};
+	const u8*				_data{ nullptr };
+	u64						_size{ 0 };
+};
+}
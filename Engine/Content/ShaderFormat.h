@@ -0,0 +1,51 @@
+#pragma once
+#include "CommonHeaders.h"
+
+// Layout of a compiled shader library, e.g. shaders.bin. The file is written by the
+// shader build (EngineTest\ShaderCompilation.cpp) and used in place by content::shader_library.
+//
+//	header
+//	entry[table_size]		hash table of shaders, keyed by the hash of the shader name
+//	byte code				each shader starts at a multiple of 'alignment'
+//
+// The table is an open addressing hash table with linear probing. Its size is a power
+// of two, at least twice the number of shaders, and empty slots have a key of 0. A shader
+// is found by probing from slot (key & (table_size - 1)), so a lookup doesn't depend on
+// the number of shaders and opening a library doesn't need to read anything but the header.
+namespace ferraris::content::shader_format {
+
+constexpr u32 magic{ 0x4c485346 }; // "FSHL"
+constexpr u32 version{ 1 };
+constexpr u64 alignment{ 16 };
+
+struct header
+{
+	u32 magic;
+	u32 version;
+	u32 shader_count;
+	u32 table_size;		// number of entries in the table, a power of two
+};
+
+struct entry
+{
+	u64 key;			// 0 for an empty slot
+	u64 offset;			// of the byte code, from the start of the file
+	u64 size;			// of the byte code in bytes
+};
+
+// Shaders are identified by their name, which is the name of the entry function.
+// The hash is stable across builds, so it can be stored in other files.
+constexpr u64
+shader_key(const char* name)
+{
+	return utl::fnv1a_64(name);
+}
+
+constexpr u32
+table_size_for(u32 shader_count)
+{
+	u32 size{ 4 };
+	while (size < shader_count * 2) size <<= 1;
+	return size;
+}
+}
@@ -0,0 +1,64 @@
+#include "ShaderLibrary.h"
+#include "ShaderFormat.h"
+#include "ContentLoader.h"
+
+#if !defined(SHIPPING)
+
+namespace ferraris::content {
+
+bool
+shader_library::open(const char* path)
+{
+	assert(path);
+	close();
+	if (!read_file(path, _file)) return false;
+
+	// Only the header and the size of the table are checked here, entries are checked when they're used.
+	const u8* const data{ _file.data() };
+	const u64 size{ _file.size() };
+	const shader_format::header* const header{ (const shader_format::header*)data };
+	const bool result{ size >= sizeof(shader_format::header) &&
+		header->magic == shader_format::magic && header->version == shader_format::version &&
+		header->table_size && !(header->table_size & (header->table_size - 1)) &&
+		header->shader_count < header->table_size &&
+		(size - sizeof(shader_format::header)) / sizeof(shader_format::entry) >= header->table_size };
+	if (!result) close();
+	return result;
+}
+
+void
+shader_library::close()
+{
+	_file.close();
+}
+
+u32
+shader_library::shader_count() const
+{
+	return is_open() ? ((const shader_format::header*)_file.data())->shader_count : 0;
+}
+
+shader_bytecode
+shader_library::find(u64 key) const
+{
+	assert(is_open() && key);
+	if (!is_open() || !key) return {};
+	const u8* const data{ _file.data() };
+	const u64 size{ _file.size() };
+	const shader_format::header& header{ *(const shader_format::header*)data };
+	const shader_format::entry* const table{ (const shader_format::entry*)(data + sizeof(shader_format::header)) };
+
+	const u32 mask{ header.table_size - 1 };
+	// The table is never full, so there's always an empty slot that ends the probing.
+	for (u32 i{ (u32)key & mask }, probes{ 0 }; probes < header.table_size; i = (i + 1) & mask, ++probes)
+	{
+		const shader_format::entry& e{ table[i] };
+		if (!e.key) break;
+		if (e.key != key) continue;
+		if (e.offset % shader_format::alignment || e.offset > size || e.size > size - e.offset || !e.size) return {};
+		return { data + e.offset, e.size };
+	}
+	return {};
+}
+}
+#endif // !defined(SHIPPING)
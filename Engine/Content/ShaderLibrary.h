@@ -0,0 +1,43 @@
+#pragma once
+#include "CommonHeaders.h"
+#include "MappedFile.h"
+
+#if !defined(SHIPPING)
+
+namespace ferraris::content {
+
+struct shader_bytecode
+{
+	const u8*	byte_code{ nullptr };
+	u64			size{ 0 };
+};
+
+/**
+* A compiled shader library (see ShaderFormat.h), used in place. Opening it only
+* checks the header, shaders are looked up in the library's hash table when they're
+* needed. The file is mapped, so the byte code of a shader is only read from disk
+* when it's used, and the cost of opening doesn't grow with the number of shaders.
+*/
+class shader_library
+{
+public:
+	shader_library() = default;
+	DISABLE_COPY(shader_library);
+
+	// Read the library at 'path' (plain or compressed, see content::read_file()).
+	// Returns false if the file can't be read or isn't a shader library.
+	bool open(const char* path);
+	void close();
+
+	// Returns an empty shader_bytecode if there's no shader with this key,
+	// or if its entry points outside of the file.
+	[[nodiscard]] shader_bytecode find(u64 key) const;
+
+	[[nodiscard]] bool is_open() const { return _file.is_open(); }
+	[[nodiscard]] u32 shader_count() const;
+
+private:
+	file_data		_file{};
+};
+}
+#endif // !defined(SHIPPING)
@@ -39,7 +39,7 @@ LRESULT win_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
 
 bool engine_initialize()
 {
-	if (!ferraris::content::load_game()) return false;
+	if (!ferraris::content::initialize() || !ferraris::content::load_game()) return false;
 
 	platform::window_init_info info
 	{
@@ -53,13 +53,16 @@ bool engine_initialize()
 }
 void engine_update()
 {
+	ferraris::content::update_level_loads();
 	ferraris::script::update(10.f);
+	ferraris::memory::update();
 	std::this_thread::sleep_for(std::chrono::milliseconds(10));
 }
 void engine_shutdown()
 {
 	platform::remove_window(game_window.window.get_id());
 	ferraris::content::unload_game();
+	ferraris::content::shutdown();
 }
 
 #endif // !defined(SHIPPING)
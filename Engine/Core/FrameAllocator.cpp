@@ -0,0 +1,143 @@
+#include "FrameAllocator.h"
+#include <atomic>
+
+namespace ferraris::memory {
+namespace {
+
+struct frame_arena
+{
+	u8*						buffer{ nullptr };
+	std::atomic<u64>		offset{ 0 };
+	// Allocations that didn't fit in the arena. They're freed when the arena is reset.
+	utl::vector<void*>		overflow;
+	std::mutex				overflow_mutex{};
+};
+
+frame_arena				arenas[frame_arena_count]{};
+std::atomic<u32>		current_arena{ 0 };
+u64						arena_capacity{ 0 };
+std::atomic<u64>		peak_usage{ 0 };
+std::atomic<u32>		overflow_count{ 0 };
+
+constexpr u64
+align_up(u64 value, u64 alignment)
+{
+	assert(alignment && !(alignment & (alignment - 1)));
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void
+free_overflow(frame_arena& arena)
+{
+	std::lock_guard lock{ arena.overflow_mutex };
+	if (!arena.overflow.empty())
+	{
+		for (void* block : arena.overflow) memory::free(block);
+		arena.overflow.clear();
+	}
+}
+
+void
+update_peak(u64 used)
+{
+	u64 peak{ peak_usage.load(std::memory_order_relaxed) };
+	while (used > peak && !peak_usage.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+}
+} // anonymous namespace
+
+bool
+initialize_frame_arenas(u64 arena_size)
+{
+	assert(arena_size);
+	shutdown_frame_arenas();
+	arena_capacity = align_up(arena_size, 16);
+	for (u32 i{ 0 }; i < frame_arena_count; ++i)
+	{
+		frame_arena& arena{ arenas[i] };
+		// NOTE: memory::allocate() returns 16-byte aligned memory, which is the
+		//		 minimum alignment of every frame allocation.
+		arena.buffer = (u8*)memory::allocate(arena_capacity);
+		if (!arena.buffer)
+		{
+			shutdown_frame_arenas();
+			return false;
+		}
+		arena.offset.store(0, std::memory_order_relaxed);
+	}
+	current_arena.store(0, std::memory_order_release);
+	peak_usage.store(0, std::memory_order_relaxed);
+	overflow_count.store(0, std::memory_order_relaxed);
+	return true;
+}
+
+void
+shutdown_frame_arenas()
+{
+	for (u32 i{ 0 }; i < frame_arena_count; ++i)
+	{
+		frame_arena& arena{ arenas[i] };
+		free_overflow(arena);
+		memory::free(arena.buffer);
+		arena.buffer = nullptr;
+		arena.offset.store(0, std::memory_order_relaxed);
+	}
+	arena_capacity = 0;
+}
+
+void
+begin_frame_arena(u32 frame_index)
+{
+	assert(frame_index < frame_arena_count);
+	frame_arena& arena{ arenas[frame_index] };
+	if (!arena.buffer) return;
+
+	update_peak(arena.offset.load(std::memory_order_relaxed));
+	free_overflow(arena);
+	// Fill the freed memory with garbage to catch data that's used after its frame.
+	DEBUG_OP(memset(arena.buffer, 0xcd, arena_capacity));
+	arena.offset.store(0, std::memory_order_relaxed);
+	current_arena.store(frame_index, std::memory_order_release);
+}
+
+void*
+frame_allocate(u64 size, u64 alignment)
+{
+	assert(size);
+	frame_arena& arena{ arenas[current_arena.load(std::memory_order_acquire)] };
+	assert(arena.buffer);
+
+	// All offsets are multiples of 16, so alignments up to 16 come for free.
+	// Larger alignments need some padding.
+	const u64 padded_size{ align_up(size, 16) + (alignment > 16 ? alignment - 16 : 0) };
+	const u64 offset{ arena.offset.fetch_add(padded_size, std::memory_order_relaxed) };
+	if (offset + padded_size <= arena_capacity)
+	{
+		return (void*)align_up((u64)(arena.buffer + offset), alignment);
+	}
+
+	// The arena is full. Fall back to the heap and free the block when the arena is reset.
+	// NOTE: if this happens often, the arenas should be bigger.
+	overflow_count.fetch_add(1, std::memory_order_relaxed);
+	u8* const block{ (u8*)memory::allocate(size + alignment) };
+	if (!block) return nullptr;
+	{
+		std::lock_guard lock{ arena.overflow_mutex };
+		arena.overflow.emplace_back(block);
+	}
+	return (void*)align_up((u64)block, alignment);
+}
+
+frame_arena_stats
+get_frame_arena_stats()
+{
+	const frame_arena& arena{ arenas[current_arena.load(std::memory_order_acquire)] };
+	frame_arena_stats stats{};
+	stats.capacity = arena_capacity;
+	stats.used = arena.offset.load(std::memory_order_relaxed);
+	if (stats.used > arena_capacity) stats.used = arena_capacity;
+	stats.peak = peak_usage.load(std::memory_order_relaxed);
+	if (stats.peak > arena_capacity) stats.peak = arena_capacity;
+	stats.overflows = overflow_count.load(std::memory_order_relaxed);
+	return stats;
+}
+}
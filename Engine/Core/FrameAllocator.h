@@ -0,0 +1,142 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace ferraris::memory {
+
+// Number of per-frame scratch arenas. This should be the same as the number of
+// frames the graphics backend keeps in flight, because an arena is only reset
+// after the GPU has finished the frame that it was used for.
+constexpr u32 frame_arena_count{ 3 };
+constexpr u64 default_frame_arena_size{ 4 * 1024 * 1024 };
+
+struct frame_arena_stats
+{
+	u64 capacity{ 0 };		// size of each arena in bytes
+	u64 used{ 0 };			// bytes used in the current frame so far
+	u64 peak{ 0 };			// highest number of bytes used in any frame
+	u32 overflows{ 0 };		// allocations that didn't fit in an arena since initialization
+};
+
+bool initialize_frame_arenas(u64 arena_size = default_frame_arena_size);
+void shutdown_frame_arenas();
+
+// Called by the graphics backend in graphics::begin_frame(), once the fence of
+// frame 'frame_index' has completed. Everything that was allocated in that frame
+// is freed at once and the arena becomes the one used for new allocations.
+void begin_frame_arena(u32 frame_index);
+
+// Allocate scratch memory that stays valid until the same frame index comes
+// around again, i.e. for 'frame_arena_count' frames. It's never freed explicitly.
+// Can be called from any thread.
+[[nodiscard]] void* frame_allocate(u64 size, u64 alignment = 16);
+frame_arena_stats get_frame_arena_stats();
+
+template<typename T>
+[[nodiscard]] T*
+frame_alloc(u64 count)
+{
+	static_assert(std::is_trivially_destructible<T>::value,
+		"Frame memory is never freed, so T's destructor wouldn't be called.");
+	return static_cast<T*>(frame_allocate(count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16));
+}
+
+/**
+* A vector that lives in per-frame scratch memory. It has the same basic
+* interface as utl::vector, but growing it just bump-allocates a new buffer
+* from the frame arena. The old buffer and the vector's memory are reclaimed
+* when the arena is reset. Therefore items must be trivially copyable and
+* trivially destructible, and the vector must not outlive its frame.
+*/
+template<typename T>
+class frame_vector
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable.");
+	static_assert(std::is_trivially_destructible<T>::value, "Type must be trivially destructible.");
+public:
+	frame_vector() = default;
+
+	constexpr explicit frame_vector(u64 count)
+	{
+		resize(count);
+	}
+
+	template<class... params>
+	constexpr decltype(auto) emplace_back(params&&... p)
+	{
+		if (_size == _capacity)
+		{
+			reserve(((_capacity + 1) * 3) >> 1); // reserve 50% more
+		}
+		T* const item{ new (std::addressof(_data[_size])) T(std::forward<params>(p)...) };
+		++_size;
+		return *item;
+	}
+
+	constexpr void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	constexpr void resize(u64 new_size)
+	{
+		static_assert(std::is_default_constructible<T>::value,
+			"Type must be default-constructible.");
+		reserve(new_size);
+		while (_size < new_size)
+		{
+			emplace_back();
+		}
+		_size = new_size;
+	}
+
+	constexpr void reserve(u64 new_capacity)
+	{
+		if (new_capacity > _capacity)
+		{
+			T* const new_buffer{ frame_alloc<T>(new_capacity) };
+			assert(new_buffer);
+			if (new_buffer)
+			{
+				if (_size) memcpy(new_buffer, _data, _size * sizeof(T));
+				_data = new_buffer;
+				_capacity = new_capacity;
+			}
+		}
+	}
+
+	constexpr void clear() { _size = 0; }
+
+	[[nodiscard]] constexpr T* data() { return _data; }
+	[[nodiscard]] constexpr const T* data() const { return _data; }
+	[[nodiscard]] constexpr bool empty() const { return _size == 0; }
+	[[nodiscard]] constexpr u64 size() const { return _size; }
+	[[nodiscard]] constexpr u64 capacity() const { return _capacity; }
+
+	[[nodiscard]] T& operator[](u64 index)
+	{
+		assert(_data && index < _size);
+		return _data[index];
+	}
+
+	[[nodiscard]] const T& operator[](u64 index) const
+	{
+		assert(_data && index < _size);
+		return _data[index];
+	}
+
+	[[nodiscard]] T& front() { assert(_data && _size); return _data[0]; }
+	[[nodiscard]] const T& front() const { assert(_data && _size); return _data[0]; }
+	[[nodiscard]] T& back() { assert(_data && _size); return _data[_size - 1]; }
+	[[nodiscard]] const T& back() const { assert(_data && _size); return _data[_size - 1]; }
+
+	[[nodiscard]] T* begin() { return _data; }
+	[[nodiscard]] const T* begin() const { return _data; }
+	[[nodiscard]] T* end() { return _data + _size; }
+	[[nodiscard]] const T* end() const { return _data + _size; }
+
+private:
+	T*	_data{ nullptr };
+	u64	_size{ 0 };
+	u64	_capacity{ 0 };
+};
+}
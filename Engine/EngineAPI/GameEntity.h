@@ -30,6 +30,15 @@ public:
 	virtual ~entity_script() = default;
 	virtual void begin_play() {}
 	virtual void update(float) {}
+
+	// Scripts are created by game code with std::make_unique. Routing them through
+	// the memory tracker makes them show up under memory::tag::script.
+	static void* operator new(size_t size)
+	{
+		memory::scoped_tag memory_tag{ memory::tag::script };
+		return memory::allocate(size);
+	}
+	static void operator delete(void* block) { memory::free(block); }
 protected:
 	constexpr explicit entity_script(game_entity::entity entity) 
 		: game_entity::entity{ entity.get_id() }{}
@@ -39,7 +48,13 @@ namespace detail {
 
 using script_ptr = std::unique_ptr<entity_script>;
 using script_creator = script_ptr(*)(game_entity::entity entity);// define a pointer to the script create function
-using string_hash = std::hash<std::string>;
+// Scripts are identified by the FNV-1a hash of their class name. The hash is
+// stable across builds, so the editor can store it in game.bin.
+struct string_hash
+{
+	constexpr u64 operator()(const char* name) const { return utl::fnv1a_64(name); }
+	constexpr u64 operator()(const char* name, u64 length) const { return utl::fnv1a_64(name, length); }
+};
 u8 register_script(size_t, script_creator);
 #ifdef USE_WITH_EDITOR
 extern "C" __declspec(dllexport)
@@ -59,9 +74,11 @@ u8 add_script_name(const char* name);
 // register_script() to regist the fucntion into GameEngine, add_script_name to Editor level.
 #define REGISTER_SCRIPT(TYPE)											\
 		namespace {														\
+		constexpr u64 _hash_##TYPE										\
+		{ ferraris::script::detail::string_hash()(#TYPE) };				\
 		const u8 _reg_##TYPE											\
 		{ ferraris::script::detail::register_script(					\
-				ferraris::script::detail::string_hash()(#TYPE),			\
+				_hash_##TYPE,											\
 				&ferraris::script::detail::create_script<TYPE>) };		\
 		const u8 _name_##TYPE											\
 		{ ferraris::script::detail::add_script_name(#TYPE) };			\
@@ -69,9 +86,11 @@ u8 add_script_name(const char* name);
 #else
 #define REGISTER_SCRIPT(TYPE)											\
 		namespace {														\
+		constexpr u64 _hash_##TYPE										\
+		{ ferraris::script::detail::string_hash()(#TYPE) };				\
 		const u8 _reg_##TYPE											\
 		{ ferraris::script::detail::register_script(					\
-				ferraris::script::detail::string_hash()(#TYPE),			\
+				_hash_##TYPE,											\
 				&ferraris::script::detail::create_script<TYPE>) };		\
 		}
 
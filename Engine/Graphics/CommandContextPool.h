@@ -0,0 +1,235 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <atomic>
+
+namespace ferraris::graphics {
+
+struct command_context_stats
+{
+	u32 context_count;			// command lists created, over all frames
+	u32 used;					// command lists submitted in the last frame
+	u32 peak;					// most command lists submitted in one frame
+};
+
+/**
+* Command lists for recording on several threads at once. Every frame of the ring of
+* 'frame_count' frames has its own command lists, each with its own allocator, so an
+* allocator is only reset after the GPU finished the frame it was used in.
+*
+* A thread acquires a context for a sequence of commands with an order key, records into
+* its list and closes it. At the end of the frame collect() returns the lists sorted by
+* their order keys. So the order of submission only depends on the keys (e.g. the index
+* of a draw batch), never on which thread finished first. Contexts can only be acquired
+* between begin_frame() and collect(), so none of them end up in a frame that's been submitted.
+* Every frame also has one reserved context, which comes after all others, for the thread that
+* ends the frame (e.g. for the timestamp at the end of the frame).
+*
+* The graphics API is hidden behind 'backend', which provides:
+*	list_type, allocator_type
+*	bool create(list_type&, allocator_type&)		a list that's closed
+*	void destroy(list_type&, allocator_type&)
+*	void reset(allocator_type)					the GPU has finished with the allocator
+*	void begin(list_type, allocator_type)			open the list for recording
+*	void end(list_type)							close the list
+* create(), begin() and end() are called on the recording threads.
+*/
+template<typename backend, u32 frame_count>
+class command_context_pool
+{
+public:
+	constexpr static u32 max_contexts{ 64 };		// per frame
+	constexpr static u32 max_lists{ max_contexts + 1 };	// with the reserved context
+	constexpr static u32 reserved_order{ u32_invalid_id };
+	using list_type = typename backend::list_type;
+	using allocator_type = typename backend::allocator_type;
+
+	struct context
+	{
+		list_type		list{};
+		allocator_type	allocator{};
+		u32				order{ 0 };
+		bool			is_recording{ false };
+	};
+
+	command_context_pool() = default;
+	DISABLE_COPY_AND_MOVE(command_context_pool);
+	~command_context_pool() { assert(!_backend); }
+
+	void initialize(backend& b)
+	{
+		assert(!_backend);
+		_backend = &b;
+		_frame_index = 0;
+		_stats = {};
+		_is_frame_open.store(false, std::memory_order_relaxed);
+	}
+
+	// NOTE: the GPU must have finished all frames.
+	void release()
+	{
+		if (!_backend) return;
+		for (u32 f{ 0 }; f < frame_count; ++f)
+		{
+			frame_data& frame{ _frames[f] };
+			for (u32 i{ 0 }; i < max_lists; ++i)
+			{
+				std::unique_ptr<context>& c{ frame.contexts[i] };
+				if (!c) continue;
+				assert(!c->is_recording);
+				_backend->destroy(c->list, c->allocator);
+				c.reset();
+			}
+			frame.used.store(0, std::memory_order_relaxed);
+			frame.is_reserved_used = false;
+		}
+		_created.store(0, std::memory_order_relaxed);
+		_is_frame_open.store(false, std::memory_order_relaxed);
+		_backend = nullptr;
+	}
+
+	// Call when the GPU has finished the frame that used 'frame_index' last. Contexts that are
+	// acquired from now on belong to this frame.
+	void begin_frame(u32 frame_index)
+	{
+		assert(_backend && frame_index < frame_count);
+		assert(!_is_frame_open.load(std::memory_order_relaxed));
+		frame_data& frame{ _frames[frame_index] };
+		const u32 used{ used_count(frame) };
+		for (u32 i{ 0 }; i < used; ++i)
+		{
+			context* const c{ frame.contexts[i].get() };
+			if (!c) continue;
+			assert(!c->is_recording);
+			_backend->reset(c->allocator);
+		}
+		if (frame.is_reserved_used) _backend->reset(frame.contexts[max_contexts]->allocator);
+		frame.used.store(0, std::memory_order_relaxed);
+		frame.is_reserved_used = false;
+		_frame_index = frame_index;
+		_is_frame_open.store(true, std::memory_order_release);
+	}
+
+	// Thread-safe. Returns a context with its list open for recording, or nullptr if no frame is
+	// open or all 'max_contexts' contexts of the frame are in use. Order keys in a frame must be unique,
+	// and reserved_order is taken by the reserved context.
+	[[nodiscard]] context* acquire(u32 order)
+	{
+		assert(_backend && order != reserved_order);
+		if (order == reserved_order || !_is_frame_open.load(std::memory_order_acquire)) return nullptr;
+		frame_data& frame{ _frames[_frame_index] };
+		const u32 index{ frame.used.fetch_add(1, std::memory_order_relaxed) };
+		assert(index < max_contexts);
+		if (index >= max_contexts) return nullptr;
+
+		// Only this thread got 'index', so it can create the context without a lock.
+		return open(frame.contexts[index], order);
+	}
+
+	// Returns the reserved context of the frame, which is submitted after all others, or nullptr
+	// if no frame is open or it's been acquired already.
+	// NOTE: not thread-safe, call it on the thread that calls collect().
+	[[nodiscard]] context* acquire_reserved()
+	{
+		assert(_backend);
+		frame_data& frame{ _frames[_frame_index] };
+		if (frame.is_reserved_used || !_is_frame_open.load(std::memory_order_relaxed)) return nullptr;
+		context* const c{ open(frame.contexts[max_contexts], reserved_order) };
+		frame.is_reserved_used = c != nullptr;
+		return c;
+	}
+
+	// Thread-safe.
+	void close(context* const c)
+	{
+		assert(_backend && c && c->is_recording);
+		_backend->end(c->list);
+		c->is_recording = false;
+	}
+
+	// Call after all contexts of the frame were closed and the recording threads are synchronized
+	// with the calling thread. Writes the lists of the frame sorted by order and returns their number.
+	// This closes the frame, acquire() fails until the next begin_frame().
+	template<typename T>
+	u32 collect(T* const lists, u32 capacity)
+	{
+		assert(_backend);
+		_is_frame_open.store(false, std::memory_order_relaxed);
+		frame_data& frame{ _frames[_frame_index] };
+		const u32 used{ used_count(frame) };
+		context* sorted[max_lists];
+		u32 count{ 0 };
+		for (u32 i{ 0 }; i < used; ++i)
+		{
+			context* const c{ frame.contexts[i].get() };
+			if (!c) continue;	// creating the context failed
+			assert(!c->is_recording);
+			// Insertion sort, there are only a few contexts and they are usually acquired in order.
+			u32 j{ count++ };
+			for (; j && sorted[j - 1]->order > c->order; --j) sorted[j] = sorted[j - 1];
+			assert(!j || sorted[j - 1]->order != c->order);
+			sorted[j] = c;
+		}
+		// The reserved context has the largest order.
+		if (frame.is_reserved_used)
+		{
+			context* const c{ frame.contexts[max_contexts].get() };
+			assert(!c->is_recording);
+			sorted[count++] = c;
+		}
+
+		assert(count <= capacity);
+		count = count < capacity ? count : capacity;
+		for (u32 i{ 0 }; i < count; ++i) lists[i] = sorted[i]->list;
+
+		_stats.used = count;
+		_stats.peak = count > _stats.peak ? count : _stats.peak;
+		return count;
+	}
+
+	[[nodiscard]] command_context_stats stats() const
+	{
+		command_context_stats stats{ _stats };
+		stats.context_count = _created.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	struct frame_data
+	{
+		std::unique_ptr<context>	contexts[max_lists]{};	// the last one is reserved
+		std::atomic<u32>			used{ 0 };
+		bool						is_reserved_used{ false };
+	};
+
+	context* open(std::unique_ptr<context>& slot, u32 order)
+	{
+		if (!slot)
+		{
+			memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+			std::unique_ptr<context> c{ std::make_unique<context>() };
+			if (!_backend->create(c->list, c->allocator)) return nullptr;
+			slot = std::move(c);
+			_created.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		context* const c{ slot.get() };
+		c->order = order;
+		c->is_recording = true;
+		_backend->begin(c->list, c->allocator);
+		return c;
+	}
+
+	static u32 used_count(const frame_data& frame)
+	{
+		const u32 used{ frame.used.load(std::memory_order_acquire) };
+		return used < max_contexts ? used : max_contexts;
+	}
+
+	frame_data				_frames[frame_count]{};
+	backend*				_backend{ nullptr };
+	std::atomic<u32>		_created{ 0 };
+	command_context_stats	_stats{};
+	u32						_frame_index{ 0 };
+	std::atomic<bool>		_is_frame_open{ false };
+};
+}
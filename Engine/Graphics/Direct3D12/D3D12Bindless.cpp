@@ -0,0 +1,136 @@
+#include "D3D12Bindless.h"
+#include "D3D12Core.h"
+
+namespace ferraris::graphics::d3d12::bindless {
+namespace {
+
+// The contents of the table change while it's bound, and most of it is never accessed by a shader.
+constexpr u32 unbounded{ UINT_MAX };
+constexpr D3D12_DESCRIPTOR_RANGE_FLAGS range_flags{ D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE };
+
+struct table_layout
+{
+	u32									srv_count;		// of each SRV range
+	u32									uav_count;
+	d3dx::d3d12_descriptor_range		ranges[3];
+};
+
+constexpr table_layout
+make_layout(u32 srv_count, u32 uav_count)
+{
+	return table_layout{ srv_count, uav_count, {
+		d3dx::d3d12_descriptor_range{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, srv_count, 0, first_register_space, range_flags, 0 },
+		d3dx::d3d12_descriptor_range{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, srv_count, 0, first_register_space + 1, range_flags, 0 },
+		d3dx::d3d12_descriptor_range{ D3D12_DESCRIPTOR_RANGE_TYPE_UAV, uav_count, 0, first_register_space + 2, range_flags, 0 },
+	} };
+}
+
+// The limits of each resource binding tier. Only tier 3 has unbounded UAV ranges, tier 2 allows 64
+// UAVs. Tier 1 allows 128 SRVs per shader stage, which the two SRV ranges split, and 8 UAVs, or 64
+// from feature level 11.1 on.
+constexpr table_layout tier_3_layout{ make_layout(unbounded, unbounded) };
+constexpr table_layout tier_2_layout{ make_layout(unbounded, 64) };
+constexpr table_layout tier_1_layout{ make_layout(64, 8) };
+constexpr table_layout tier_1_11_1_layout{ make_layout(64, 64) };
+
+// Selected by table_capacity() when the device is created.
+const table_layout* layout{ nullptr };
+
+const table_layout&
+get_layout(id3d12_device* device)
+{
+	assert(device);
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+	DXCall(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+	if (options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_3) return tier_3_layout;
+	if (options.ResourceBindingTier == D3D12_RESOURCE_BINDING_TIER_2) return tier_2_layout;
+
+	constexpr D3D_FEATURE_LEVEL feature_levels[]{ D3D_FEATURE_LEVEL_11_0, D3D_FEATURE_LEVEL_11_1 };
+	D3D12_FEATURE_DATA_FEATURE_LEVELS feature_level_info{};
+	feature_level_info.NumFeatureLevels = _countof(feature_levels);
+	feature_level_info.pFeatureLevelsRequested = feature_levels;
+	DXCall(device->CheckFeatureSupport(D3D12_FEATURE_FEATURE_LEVELS, &feature_level_info, sizeof(feature_level_info)));
+	return feature_level_info.MaxSupportedFeatureLevel >= D3D_FEATURE_LEVEL_11_1 ? tier_1_11_1_layout : tier_1_layout;
+}
+
+} // anonymous namespace
+
+u32
+table_capacity(id3d12_device* device)
+{
+	layout = &get_layout(device);
+	// Every index has to be valid in the SRV ranges. A larger heap wouldn't be of any use.
+	return layout->srv_count == unbounded ? D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_2 : layout->srv_count;
+}
+
+u32
+add_srv(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+{
+	descriptor_heap& heap{ core::srv_heap() };
+	const descriptor_handle handle{ heap.allocate() };
+	// The heap is full.
+	if (!handle.is_valid()) return invalid_index;
+	core::device()->CreateShaderResourceView(resource, desc, handle.cpu);
+	return heap.index(handle);
+}
+
+u32
+add_uav(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc)
+{
+	assert(layout);
+	descriptor_heap& heap{ core::srv_heap() };
+	descriptor_handle handle{ heap.allocate() };
+	if (!handle.is_valid()) return invalid_index;
+	// Below tier 3 the UAV range is smaller than the heap, and the index must be in the range.
+	const u32 index{ heap.index(handle) };
+	if (layout->uav_count != unbounded && index >= layout->uav_count)
+	{
+		heap.free(handle);
+		return invalid_index;
+	}
+	core::device()->CreateUnorderedAccessView(resource, nullptr, desc, handle.cpu);
+	return index;
+}
+
+void
+remove(u32& index)
+{
+	if (index == invalid_index) return;
+	descriptor_heap& heap{ core::srv_heap() };
+	descriptor_handle handle{ heap.handle(index) };
+	heap.free(handle);
+	index = invalid_index;
+}
+
+void
+bind_heap(id3d12_graphics_command_list* cmd_list)
+{
+	ID3D12DescriptorHeap* const heaps[]{ core::srv_heap().heap() };
+	cmd_list->SetDescriptorHeaps(_countof(heaps), &heaps[0]);
+}
+
+void
+as_root_parameter(d3dx::d3d12_root_parameter& parameter, D3D12_SHADER_VISIBILITY visibility)
+{
+	assert(layout);
+	parameter.as_descriptor_table(visibility, &layout->ranges[0], _countof(layout->ranges));
+}
+
+void
+set_graphics_table(id3d12_graphics_command_list* cmd_list, u32 root_parameter_index)
+{
+	cmd_list->SetGraphicsRootDescriptorTable(root_parameter_index, core::srv_heap().gpu_start());
+}
+
+void
+set_compute_table(id3d12_graphics_command_list* cmd_list, u32 root_parameter_index)
+{
+	cmd_list->SetComputeRootDescriptorTable(root_parameter_index, core::srv_heap().gpu_start());
+}
+
+descriptor_heap_stats
+get_stats()
+{
+	return core::srv_heap().stats();
+}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "D3D12CommomHeaders.h"
+
+// A bindless table of shader resources on top of the shader-visible SRV heap. Every SRV or UAV
+// added to the table gets the index of its descriptor in the heap, which stays the same until
+// it's removed. Shaders declare unbounded arrays and are given the indices, e.g. in root
+// constants, instead of a descriptor table per draw:
+//
+//		Texture2D			textures[]	: register(t0, space1);
+//		ByteAddressBuffer	buffers[]	: register(t0, space2);
+//		RWTexture2D<float4>	rw_textures[] : register(u0, space3);
+//
+// All three arrays start at the beginning of the heap, so an index is valid for the array of
+// its kind of view. The heap is bound once per command list, and the table once per root
+// signature. Allocating is lock-free (see descriptor_heap). Removing is deferred until the
+// frame is complete. The ranges are unbounded on resource binding tier 3. Tier 2 has 64 UAVs,
+// and tier 1 has 64 SRVs in each SRV range and 8 UAVs, or 64 from feature level 11.1 on. Below
+// tier 3 UAVs can only use the first indices of the heap, and on tier 1 the heap is only as large
+// as an SRV range.
+namespace ferraris::graphics::d3d12::bindless {
+
+constexpr u32 invalid_index{ u32_invalid_id };
+constexpr u32 first_register_space{ 1 };
+
+// The capacity of the SRV heap the device supports with bindless access. Called once when the
+// device is created, it also picks the ranges of the table for the device's binding tier.
+u32 table_capacity(id3d12_device* device);
+
+// Both return invalid_index if the heap is full. add_uav() also does if the index is outside
+// the UAV range.
+[[nodiscard]] u32 add_srv(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+[[nodiscard]] u32 add_uav(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc);
+// Sets 'index' to invalid_index.
+void remove(u32& index);
+
+// Sets the SRV heap on a command list. Needed once after it's reset.
+void bind_heap(id3d12_graphics_command_list* cmd_list);
+// Makes 'parameter' the descriptor table with the whole heap. Call after the device was created.
+void as_root_parameter(d3dx::d3d12_root_parameter& parameter, D3D12_SHADER_VISIBILITY visibility);
+void set_graphics_table(id3d12_graphics_command_list* cmd_list, u32 root_parameter_index);
+void set_compute_table(id3d12_graphics_command_list* cmd_list, u32 root_parameter_index);
+
+descriptor_heap_stats get_stats();
+}
@@ -10,7 +10,7 @@
 #pragma comment(lib, "d3d12.lib")
 
 namespace ferraris::graphics::d3d12{
-constexpr u32 frame_buffer_count{ 3 };
+constexpr u32 frame_buffer_count{ max_frames_in_flight };
 using id3d12_device = ID3D12Device8;
 using id3d12_graphics_command_list = ID3D12GraphicsCommandList6;
 }
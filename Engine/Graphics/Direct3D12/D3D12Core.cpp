@@ -1,6 +1,12 @@
 #include "D3D12Core.h"
 #include "D3D12Surface.h"
 #include "D3D12Shaders.h"
+#include "D3D12Upload.h"
+#include "D3D12Memory.h"
+#include "D3D12Bindless.h"
+#include "D3D12Pipeline.h"
+#include "Core/FrameAllocator.h"
+#include "Graphics/FrameTimer.h"
 // Note that while ComPtr is used to manage the lifetime of resources on the CPU,
 // it has no understanding of the lifetime of resources on the GPU. Apps must account
 // for the GPU lifetime of resources to avoid destroying objects that may still be
@@ -11,6 +17,29 @@ using namespace Microsoft::WRL;
 namespace ferraris::graphics::d3d12::core {
 namespace {
 
+// The per-frame scratch arenas are reset when the fence of their frame has completed.
+static_assert(memory::frame_arena_count == frame_buffer_count);
+
+// The queues and their fences for queue_timeline. The graphics queue and its fence belong to gfx_command.
+struct d3d12_queue_backend
+{
+	ID3D12CommandQueue*	queues[queue_type::count]{};
+	ID3D12Fence1*		fences[queue_type::count]{};
+
+	u64 completed_value(u32 queue) { return fences[queue]->GetCompletedValue(); }
+	void signal(u32 queue, u64 value) { DXCall(queues[queue]->Signal(fences[queue], value)); }
+	void wait(u32 queue, u32 other, u64 value) { DXCall(queues[queue]->Wait(fences[other], value)); }
+	// Without an event SetEventOnCompletion() blocks until the fence reaches the value,
+	// so several threads can wait at the same time.
+	void wait_on_cpu(u32 queue, u64 value) { DXCall(fences[queue]->SetEventOnCompletion(value, nullptr)); }
+};
+
+// Pipelines that were compiled by the driver in earlier runs.
+constexpr const char* pipeline_library_path{ ".\\shaders\\d3d12\\pipelines.bin" };
+
+d3d12_queue_backend						queue_backend{};
+queue_timeline<d3d12_queue_backend>		timeline;
+
 	
 class d3d12_command
 {
@@ -27,6 +56,8 @@ public:
 		desc.Type = type;
 		DXCall(hr = device->CreateCommandQueue(&desc, IID_PPV_ARGS(&_cmd_queue))); 
 		if (FAILED(hr)) goto _error;
+		_queue_type = type == D3D12_COMMAND_LIST_TYPE_DIRECT ? queue_type::graphics :
+					  type == D3D12_COMMAND_LIST_TYPE_COMPUTE ? queue_type::compute : queue_type::copy;
 		NAME_D3D12_OBJECT(_cmd_queue,
 						  type == D3D12_COMMAND_LIST_TYPE_DIRECT ?
 						  L"GFX Command Queue" :
@@ -60,6 +91,45 @@ public:
 
 		// Win32 API create the Event
 		_fence_event = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+
+		// Timestamps at the start and the end of every frame, for the GPU frame time.
+		// It's fine to go without them, so failing here isn't an error.
+		if (SUCCEEDED(_cmd_queue->GetTimestampFrequency(&_timestamp_frequency)) && _timestamp_frequency)
+		{
+			D3D12_QUERY_HEAP_DESC query_desc{};
+			query_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+			query_desc.Count = 2 * frame_buffer_count;
+			query_desc.NodeMask = 0;
+
+			D3D12_RESOURCE_DESC buffer_desc{};
+			buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			buffer_desc.Alignment = 0;
+			buffer_desc.Width = 2 * frame_buffer_count * sizeof(u64);
+			buffer_desc.Height = 1;
+			buffer_desc.DepthOrArraySize = 1;
+			buffer_desc.MipLevels = 1;
+			buffer_desc.Format = DXGI_FORMAT_UNKNOWN;
+			buffer_desc.SampleDesc = { 1, 0 };
+			buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			buffer_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+			if (FAILED(device->CreateQueryHeap(&query_desc, IID_PPV_ARGS(&_timestamp_heap))) ||
+				FAILED(device->CreateCommittedResource(&d3dx::heap_properties.readback_heap, D3D12_HEAP_FLAG_NONE, &buffer_desc,
+													   D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&_timestamp_buffer))))
+			{
+				core::release(_timestamp_heap);
+				_timestamp_frequency = 0;
+			}
+			else
+			{
+				NAME_D3D12_OBJECT(_timestamp_heap, L"Frame Timestamp Query Heap");
+				NAME_D3D12_OBJECT(_timestamp_buffer, L"Frame Timestamp Readback Buffer");
+			}
+		}
+
+		_context_backend.device = device;
+		_context_backend.type = type;
+		_contexts.initialize(_context_backend);
 		return;
 
 		_error:
@@ -74,24 +144,57 @@ public:
 	// Resetting the command allocator will free memory used by previously record commands.
 	// Resetting the command list will reopen it for recording new commands.
 	// Wait for the current frame to be signaled and reset the command list/allocator
-	void begin_frame()
+	void begin_frame(frame_timer& timer)
 	{
+		// Wait for the frame that was submitted 'frames in flight' frames ago. That's the frame
+		// which used this frame index before, or a later one if fewer frames are in flight.
+		// Fence values only go up, so this frame index is free either way.
+		const u32 oldest{ (_frame_index + frame_buffer_count - _frames_in_flight) % frame_buffer_count };
+		timer.begin_wait();
+		_cmd_frames[oldest].wait(_fence_event, _fence);
+		timer.end_wait();
+
 		command_frame& frame{ _cmd_frames[_frame_index] };
-		frame.wait(_fence_event, _fence);// check if current _fence_value is is greater than the frame fence value.
+		if (frame.has_timestamps)
+		{
+			timer.add_gpu_frame_time(read_gpu_frame_time(_frame_index));
+			frame.has_timestamps = false;
+		}
 		DXCall(frame.cmd_allocator->Reset());
 		DXCall(_cmd_list->Reset(frame.cmd_allocator, nullptr));// the pipeline state object describe the GPU with shaders and resources should be used, and more
+		bindless::bind_heap(_cmd_list);
+		if (_timestamp_heap) _cmd_list->EndQuery(_timestamp_heap, D3D12_QUERY_TYPE_TIMESTAMP, 2 * _frame_index);
+		_contexts.begin_frame(_frame_index);
 	}
-	// Signal the fence with the new fence value.
-	void end_frame()
+	// Submit the frame's command list followed by the lists recorded on other threads in one call,
+	// present the surfaces and signal the fence with the new fence value.
+	// NOTE: all contexts must be closed and their threads synchronized with this one.
+	template<typename present_function>
+	void end_frame(present_function present)
 	{
+		if (_timestamp_heap)
+		{
+			// The end timestamp goes into the reserved context, which is submitted after all others.
+			d3d12_command_context* const context{ _contexts.acquire_reserved() };
+			if (context)
+			{
+				context->list->EndQuery(_timestamp_heap, D3D12_QUERY_TYPE_TIMESTAMP, 2 * _frame_index + 1);
+				context->list->ResolveQueryData(_timestamp_heap, D3D12_QUERY_TYPE_TIMESTAMP, 2 * _frame_index, 2,
+												_timestamp_buffer, 2 * _frame_index * sizeof(u64));
+				_contexts.close(context);
+				_cmd_frames[_frame_index].has_timestamps = true;
+			}
+		}
 		DXCall(_cmd_list->Close());
-		ID3D12CommandList* const cmd_lists[]{ _cmd_list };
-		_cmd_queue->ExecuteCommandLists(_countof(cmd_lists), &cmd_lists[0]);
-		u64& fence_value{ _fence_value };
-		++fence_value;
+		ID3D12CommandList* cmd_lists[1 + d3d12_command_context_pool::max_lists];
+		cmd_lists[0] = _cmd_list;
+		const u32 count{ 1 + _contexts.collect(&cmd_lists[1], d3d12_command_context_pool::max_lists) };
+		_cmd_queue->ExecuteCommandLists(count, &cmd_lists[0]);
+		// After the commands that render to the back buffers.
+		present();
 		command_frame& frame{ _cmd_frames[_frame_index] };
-		frame.fence_value = fence_value; // recording current frame fence value
-		_cmd_queue->Signal(_fence, fence_value);
+		// The fence values come from the timeline, so that other queues can wait for this frame.
+		frame.fence_value = timeline.signal(_queue_type).value; // recording current frame fence value
 		_frame_index = (_frame_index + 1) % frame_buffer_count;
 	}
 
@@ -102,18 +205,22 @@ public:
 		{
 			_cmd_frames[i].wait(_fence_event, _fence);
 		}
-		_frame_index = 0;
+		// NOTE: the frame index isn't reset, because a frame may be open. Fence values only go up,
+		//		 so the frame that's next in the ring is free either way.
 	}
 	void release()
 	{
 		flush();
 		core::release(_fence);
-		_fence_value = 0;
 
 		// unbind the Event
 		CloseHandle(_fence_event);
 		_fence_event = nullptr;
 
+		_contexts.release();
+		core::release(_timestamp_heap);
+		core::release(_timestamp_buffer);
+		_timestamp_frequency = 0;
 		core::release(_cmd_queue);
 		core::release(_cmd_list);
 
@@ -125,17 +232,26 @@ public:
 
 	constexpr ID3D12CommandQueue *const command_queue() const { return _cmd_queue; }
 	constexpr id3d12_graphics_command_list* const command_list() const { return _cmd_list; }
+	constexpr ID3D12Fence1* const fence() const { return _fence; }
 	const u32 frame_index() const { return _frame_index; }
+	d3d12_command_context_pool& contexts() { return _contexts; }
+	void set_frames_in_flight(u32 count)
+	{
+		assert(count && count <= frame_buffer_count);
+		_frames_in_flight = count;
+	}
 private:
 	struct command_frame
 	{
 		ID3D12CommandAllocator* cmd_allocator{ nullptr };
 		u64						fence_value{ 0 };
+		bool					has_timestamps{ false };	// resolved at the end of the frame
 
 		void release()
 		{
 			core::release(cmd_allocator);
 			fence_value = 0;
+			has_timestamps = false;
 		}
 		void wait(HANDLE fence_event, ID3D12Fence1* fence)
 		{
@@ -153,13 +269,34 @@ private:
 			}
 		}
 	};
+
+	// NOTE: the GPU must have finished the frame.
+	f32 read_gpu_frame_time(u32 frame_index)
+	{
+		const D3D12_RANGE range{ 2 * frame_index * sizeof(u64), (2 * frame_index + 2) * sizeof(u64) };
+		void* cpu_address{ nullptr };
+		DXCall(_timestamp_buffer->Map(0, &range, &cpu_address));
+		const u64* const timestamps{ (const u64*)cpu_address + 2 * frame_index };
+		const u64 ticks{ timestamps[1] > timestamps[0] ? timestamps[1] - timestamps[0] : 0 };
+		// The CPU doesn't write anything.
+		const D3D12_RANGE written_range{};
+		_timestamp_buffer->Unmap(0, &written_range);
+		return (f32)ticks * 1000.f / (f32)_timestamp_frequency;
+	}
+
 	ID3D12CommandQueue*				_cmd_queue{ nullptr };
 	id3d12_graphics_command_list*	_cmd_list{ nullptr };
 	ID3D12Fence1*					_fence{ nullptr };
-	u64								_fence_value{ 0 };
+	queue_type::type				_queue_type{ queue_type::graphics };
 	HANDLE							_fence_event{ nullptr };
 	command_frame					_cmd_frames[frame_buffer_count]{};
+	d3d12_command_backend			_context_backend{};
+	d3d12_command_context_pool		_contexts{};
+	ID3D12QueryHeap*				_timestamp_heap{ nullptr };
+	ID3D12Resource*					_timestamp_buffer{ nullptr };		// readback, two timestamps per frame
+	u64								_timestamp_frequency{ 0 };			// ticks per second
 	u32								_frame_index{ 0 };
+	u32								_frames_in_flight{ frame_buffer_count };
 
 
 
@@ -171,18 +308,67 @@ id3d12_device*					main_device{ nullptr };
 IDXGIFactory7*					dxgi_factory{ nullptr };
 d3d12_command					gfx_command;
 surface_collection				surfaces;
+frame_pacing					pacing{ frame_pacing_preset::balanced };
+frame_timer						timer;
+// Every surface, so that they can all be created again when the frame latency changes.
+utl::vector<surface_id>			surface_ids;
+// Surfaces rendered in the open frame, which are presented when it ends.
+utl::vector<surface_id>			frame_surfaces;
+// Surfaces that presented a frame since wait_for_display(). New surfaces are added too,
+// so that their first frame waits for the display like every other frame.
+utl::vector<surface_id>			display_surfaces;
+bool							is_frame_open{ false };
+bool							is_display_waited{ false };
 
 descriptor_heap					rtv_desc_heap{ D3D12_DESCRIPTOR_HEAP_TYPE_RTV };
 descriptor_heap					dsv_desc_heap{ D3D12_DESCRIPTOR_HEAP_TYPE_DSV };
 descriptor_heap					srv_desc_heap{ D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV };
 descriptor_heap					uav_desc_heap{ D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV };
 
-utl::vector<IUnknown*>			deferred_releases[frame_buffer_count]{};
-u32								deferred_release_flag[frame_buffer_count]{};
+// Any thread can release resources and set the flags without a lock. The mutex only keeps
+// two threads from processing the same frame at once.
+utl::concurrent_push_lists<IUnknown*, frame_buffer_count>	deferred_releases;
+std::atomic<u32>				deferred_release_flag[frame_buffer_count]{};
 std::mutex						deferred_release_mutex{};
+// Releases that fit without taking the overflow lock, for all frames together.
+constexpr u32					deferred_release_capacity{ 16 * 1024 };
 
 constexpr D3D_FEATURE_LEVEL		minimum_feature_level{ D3D_FEATURE_LEVEL_11_0 };
 
+// Fills the surfaces with a color, with the engine's full screen triangle. Like every pipeline
+// it's created by the pipeline cache, and the surfaces aren't drawn to until it's ready.
+constexpr u64					fill_color_root_signature_key{ 0x46696c6c436f6c72 };	// stays the same in every run
+ID3D12RootSignature*			fill_color_root_signature{ nullptr };
+u64								fill_color_pipeline{ 0 };
+
+
+// A queue for work that runs next to the graphics queue, with its own fence.
+bool
+create_async_queue(D3D12_COMMAND_LIST_TYPE type, queue_type::type queue)
+{
+	HRESULT hr{ S_OK };
+	D3D12_COMMAND_QUEUE_DESC desc{};
+	desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	desc.NodeMask = 0;
+	desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+	desc.Type = type;
+	DXCall(hr = main_device->CreateCommandQueue(&desc, IID_PPV_ARGS(&queue_backend.queues[queue])));
+	if (FAILED(hr)) return false;
+	DXCall(hr = main_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&queue_backend.fences[queue])));
+	if (FAILED(hr)) return false;
+
+	if (queue == queue_type::compute)
+	{
+		NAME_D3D12_OBJECT(queue_backend.queues[queue], L"Compute Command Queue");
+		NAME_D3D12_OBJECT(queue_backend.fences[queue], L"Compute Queue Fence");
+	}
+	else
+	{
+		NAME_D3D12_OBJECT(queue_backend.queues[queue], L"Copy Command Queue");
+		NAME_D3D12_OBJECT(queue_backend.fences[queue], L"Copy Queue Fence");
+	}
+	return true;
+}
 
 bool
 failed_init()
@@ -241,19 +427,126 @@ process_deferred_releases(u32 frame_idx)
 	// NOTE: we clear this flag in the beginning. If we'd clear it at the end.
 	//		 then it might overwrite some other thread that was trying to set it.
 	//		 It's fine if overwriting happens before processing the items.
-	deferred_release_flag[frame_idx] = 0;
+	//		 Reading the flag with acquire makes sure we see the items of the thread that set it.
+	deferred_release_flag[frame_idx].exchange(0, std::memory_order_acq_rel);
 	rtv_desc_heap.process_deferred_free(frame_idx);
 	dsv_desc_heap.process_deferred_free(frame_idx);
 	srv_desc_heap.process_deferred_free(frame_idx);
 	uav_desc_heap.process_deferred_free(frame_idx);
-	
-	utl::vector<IUnknown*>& resources{ deferred_releases[frame_idx] };
-	if (!resources.empty())
+
+	deferred_releases.take_all(frame_idx, [](IUnknown* resource) { release(resource); });
+	// After the resources, since they may be placed in the memory.
+	gpu_memory::process_deferred_free(frame_idx);
+
+}
+
+bool
+request_fill_color_pipeline()
+{
+	d3dx::d3d12_root_parameter parameters[1]{};
+	bindless::as_root_parameter(parameters[0], D3D12_SHADER_VISIBILITY_ALL);
+	fill_color_root_signature = d3dx::d3d12_root_signature_desc{ &parameters[0], _countof(parameters) }.create();
+	if (!fill_color_root_signature) return false;
+	NAME_D3D12_OBJECT(fill_color_root_signature, L"Fill Color Root Signature");
+
+	pipeline::graphics_pipeline_desc desc{};
+	desc.root_signature_key = fill_color_root_signature_key;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC& d{ desc.desc };
+	d.pRootSignature = fill_color_root_signature;
+	d.VS = shaders::get_engine_shader(shaders::engine_shader::fullscreen_triangle_vs);
+	d.PS = shaders::get_engine_shader(shaders::engine_shader::fill_color_ps);
+
+	D3D12_RENDER_TARGET_BLEND_DESC& blend{ d.BlendState.RenderTarget[0] };
+	blend.SrcBlend = blend.SrcBlendAlpha = D3D12_BLEND_ONE;
+	blend.DestBlend = blend.DestBlendAlpha = D3D12_BLEND_ZERO;
+	blend.BlendOp = blend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	blend.LogicOp = D3D12_LOGIC_OP_NOOP;
+	blend.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	d.SampleMask = UINT_MAX;
+
+	d.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	d.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	d.RasterizerState.DepthClipEnable = TRUE;
+	d.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+	const D3D12_DEPTH_STENCILOP_DESC keep{ D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS };
+	d.DepthStencilState.DepthEnable = FALSE;
+	d.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	d.DepthStencilState.FrontFace = keep;
+	d.DepthStencilState.BackFace = keep;
+
+	d.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	d.NumRenderTargets = 1;
+	d.RTVFormats[0] = d3d12_surface::default_back_buffer_format;
+	d.SampleDesc = { 1, 0 };
+
+	fill_color_pipeline = pipeline::request(desc);
+	return fill_color_pipeline != 0;
+}
+
+void
+fill_surface(id3d12_graphics_command_list* cmd_list, const d3d12_surface& surface, ID3D12PipelineState* pipeline_state)
+{
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	barrier.Transition.pResource = surface.back_buffer();
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	cmd_list->ResourceBarrier(1, &barrier);
+
+	const D3D12_CPU_DESCRIPTOR_HANDLE rtv{ surface.rtv() };
+	cmd_list->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+	cmd_list->RSSetViewports(1, &surface.viewport());
+	cmd_list->RSSetScissorRects(1, &surface.scissor_rect());
+	cmd_list->SetGraphicsRootSignature(fill_color_root_signature);
+	bindless::set_graphics_table(cmd_list, 0);
+	cmd_list->SetPipelineState(pipeline_state);
+	cmd_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	cmd_list->DrawInstanced(3, 1, 0, 0);
+
+	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+	cmd_list->ResourceBarrier(1, &barrier);
+}
+
+// Removes every occurrence of 'id' and keeps the order of the other surfaces.
+void
+remove_surface_id(utl::vector<surface_id>& ids, surface_id id)
+{
+	u32 count{ 0 };
+	for (u32 i{ 0 }; i < ids.size(); ++i)
 	{
-		for (auto& resource : resources) release(resource);
-		resources.clear();
+		if (ids[i] != id) ids[count++] = ids[i];
 	}
+	ids.resize(count);
+}
 
+// Rather than changing the latency under a waitable object that was signaled for the old
+// one, the swap chains are created again. It only happens when the frame pacing changes,
+// and only between frames.
+void
+apply_frame_latency()
+{
+	assert(!is_frame_open);
+	bool is_flushed{ false };
+	for (u32 i{ 0 }; i < surface_ids.size(); ++i)
+	{
+		d3d12_surface& surface{ surfaces[surface_ids[i]] };
+		if (surface.max_frame_latency() == pacing.max_frame_latency) continue;
+		if (!is_flushed)
+		{
+			gfx_command.flush();
+			is_flushed = true;
+		}
+		memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+		surface.create_swap_chain(dxgi_factory, gfx_command.command_queue(), pacing.max_frame_latency, surface.format());
+		// The new swap chain hasn't presented anything yet.
+		remove_surface_id(display_surfaces, surface_ids[i]);
+		display_surfaces.emplace_back(surface_ids[i]);
+	}
 }
 } // anonymous namespace
 
@@ -263,9 +556,10 @@ void
 deferred_release(IUnknown* resource)
 {
 	const u32 frame_idx{ current_frame_index() };
-	std::lock_guard lock{ deferred_release_mutex };
-	deferred_releases[frame_idx].push_back(resource);
-	set_deferred_release_flag();
+	// NOTE: the tag is only used if the lock-free slots run out.
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	deferred_releases.push(frame_idx, resource);
+	deferred_release_flag[frame_idx].store(1, std::memory_order_release);
 }
 } // detail namespace
 
@@ -276,6 +570,8 @@ initialize()
 	// determine what is the maximun feature level that is support
 	// create a ID3D12Device (this is virtual adapter).
 	if (main_device) shutdown();
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	deferred_releases.initialize(deferred_release_capacity);
 
 	u32 dxgi_factory_flags{ 0 };
 #ifdef _DEBUG
@@ -330,17 +626,37 @@ initialize()
 	bool result{ true };
 	result &= rtv_desc_heap.initialize(512, false);
 	result &= dsv_desc_heap.initialize(512, false);
-	result &= srv_desc_heap.initialize(4096, true);
+	result &= srv_desc_heap.initialize(bindless::table_capacity(main_device), true);
 	result &= uav_desc_heap.initialize(512, false);
 	if (!result) return failed_init();
 
 	// Here using the placement new to create the gfx_command
 	new(&gfx_command) d3d12_command(main_device, D3D12_COMMAND_LIST_TYPE_DIRECT);
 	if (!gfx_command.command_queue()) return failed_init();
+	gfx_command.set_frames_in_flight(pacing.frames_in_flight);
+
+	// Async compute and copy queues. Work on different queues is ordered with the timeline.
+	queue_backend.queues[queue_type::graphics] = gfx_command.command_queue();
+	queue_backend.fences[queue_type::graphics] = gfx_command.fence();
+	if (!create_async_queue(D3D12_COMMAND_LIST_TYPE_COMPUTE, queue_type::compute) ||
+		!create_async_queue(D3D12_COMMAND_LIST_TYPE_COPY, queue_type::copy))
+	{
+		return failed_init();
+	}
+	timeline.initialize(queue_backend);
+	if (!gpu_memory::initialize(main_adapter.Get())) return failed_init();
+	if (!upload::initialize()) return failed_init();
 
 	// init shader module
 	if (!shaders::initialize())
 		return failed_init();
+	if (!pipeline::initialize(pipeline_library_path)) return failed_init();
+	// The surfaces just aren't filled without the pipeline, which is no reason to fail.
+	if (!request_fill_color_pipeline())
+	{
+		OutputDebugStringA("Warning: the fill color pipeline couldn't be requested, surfaces won't be filled.\n");
+		fill_color_pipeline = 0;
+	}
 
 	NAME_D3D12_OBJECT(main_device, L"Main D3D12 DEVICE");
 	NAME_D3D12_OBJECT(rtv_desc_heap.heap(), L"RTV Descriptor Heap");
@@ -354,7 +670,19 @@ initialize()
 void
 shutdown()
 {
+	upload::shutdown();
+	if (queue_backend.fences[queue_type::copy])
+	{
+		timeline.flush();
+		timeline.release();
+	}
 	gfx_command.release();
+	for (u32 i{ queue_type::compute }; i < queue_type::count; ++i)
+	{
+		release(queue_backend.queues[i]);
+		release(queue_backend.fences[i]);
+	}
+	queue_backend = {};
 	// NOTE: we don't process_deferred_release at the end
 	//		 because some resources (such as swap chains) can't release before
 	//		 their depending resources are released.
@@ -362,6 +690,10 @@ shutdown()
 	{
 		process_deferred_releases(i);
 	}
+	// The GPU is idle, so the pipelines can go. This also writes the pipeline library.
+	pipeline::shutdown();
+	release(fill_color_root_signature);
+	fill_color_pipeline = 0;
 	// shutdown shader module
 	shaders::shutdown();
 
@@ -383,8 +715,15 @@ shutdown()
 
 	// NOTE: some types only use deferred release for their resources during
 	//		 shutdown/reset/clear. To finnaly release these resources we call
-	//		 process_deferred_release once more.
-	process_deferred_releases(0);
+	//		 process_deferred_release once more. They go to the list of the current frame, which
+	//		 isn't necessarily the first one.
+	for (u32 i{ 0 }; i < frame_buffer_count; ++i)
+	{
+		process_deferred_releases(i);
+	}
+	deferred_releases.release();
+	// Resources released above free their memory, so the heaps go last.
+	gpu_memory::shutdown();
 #ifdef _DEBUG
 	{
 		{
@@ -425,21 +764,83 @@ uav_heap() { return uav_desc_heap; }
 
 u32 current_frame_index() { return gfx_command.frame_index(); }
 
-// followling is atom operator which does not need to lock.
+// The flag is atomic, so any thread can set it without a lock. Release ordering makes the
+// items pushed before visible to process_deferred_releases().
 void
-set_deferred_release_flag() { deferred_release_flag[current_frame_index()] = 1; }
+set_deferred_release_flag() { deferred_release_flag[current_frame_index()].store(1, std::memory_order_release); }
+
+d3d12_command_context*
+acquire_command_context(u32 order)
+{
+	return gfx_command.contexts().acquire(order);
+}
+
+void
+close_command_context(d3d12_command_context* context)
+{
+	gfx_command.contexts().close(context);
+}
+
+command_context_stats
+get_command_context_stats()
+{
+	return gfx_command.contexts().stats();
+}
+
+ID3D12CommandQueue* const
+command_queue(queue_type::type queue)
+{
+	assert(queue < queue_type::count);
+	return queue_backend.queues[queue];
+}
+
+sync_point
+signal(queue_type::type queue)
+{
+	return timeline.signal(queue);
+}
+
+bool
+wait(queue_type::type queue, sync_point point)
+{
+	return timeline.wait(queue, point);
+}
+
+bool
+is_complete(sync_point point)
+{
+	return timeline.is_complete(point);
+}
+
+void
+wait_on_cpu(sync_point point)
+{
+	timeline.wait_on_cpu(point);
+}
+
+queue_timeline_stats
+get_queue_timeline_stats()
+{
+	return timeline.stats();
+}
 
 surface
 create_surface(platform::window window)
 {
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
 	surface_id id{ surfaces.add(window) };
-	surfaces[id].create_swap_chain(dxgi_factory, gfx_command.command_queue());
+	surfaces[id].create_swap_chain(dxgi_factory, gfx_command.command_queue(), pacing.max_frame_latency);
+	surface_ids.emplace_back(id);
+	display_surfaces.emplace_back(id);
 	return surface{ id };
 }
 void
 remove_surface(surface_id id)
 {
 	gfx_command.flush();
+	remove_surface_id(surface_ids, id);
+	remove_surface_id(frame_surfaces, id);
+	remove_surface_id(display_surfaces, id);
 	surfaces.remove(id);
 }
 void
@@ -459,28 +860,144 @@ surface_height(surface_id id)
 	return surfaces[id].height();
 }
 void
-render_surface(surface_id id)
+set_frame_pacing(const frame_pacing& new_pacing)
+{
+	assert(new_pacing.is_valid());
+	pacing = new_pacing;
+	gfx_command.set_frames_in_flight(pacing.frames_in_flight);
+	// A new frame latency is applied by the next wait_for_display(), between frames.
+	timer.reset();
+}
+
+frame_pacing
+get_frame_pacing()
 {
+	return pacing;
+}
+
+frame_timing_stats
+get_frame_timing_stats()
+{
+	return timer.stats();
+}
+
+void
+wait_for_display()
+{
+	assert(!is_frame_open);
+	if (is_display_waited) return;
+	apply_frame_latency();
+	// The frame starts here, so that the time spent waiting is part of it.
+	timer.begin_frame();
+	timer.begin_wait();
+	for (u32 i{ 0 }; i < display_surfaces.size(); ++i) surfaces[display_surfaces[i]].wait_for_display();
+	timer.end_wait();
+	display_surfaces.clear();
+	is_display_waited = true;
+}
+
+void
+begin_frame()
+{
+	assert(!is_frame_open);
+	// Wait for the display before anything else, so that what's drawn is based on input
+	// that's as recent as possible.
+	wait_for_display();
+	is_display_waited = false;
 	// Wait for the GPU to finish with the command allocator and
 	// reset the allocator once the GPU is done with it.
 	// This frees the memory that was used to store command.
-	gfx_command.begin_frame();
-	id3d12_graphics_command_list* cmd_list{ gfx_command.command_list() };
+	gfx_command.begin_frame(timer);
 
 	const u32 frame_idx{ current_frame_index() };
-	if (deferred_release_flag[frame_idx])
+	if (deferred_release_flag[frame_idx].load(std::memory_order_acquire))
 	{
 		process_deferred_releases(frame_idx);
 	}
-	const d3d12_surface& surface{ surfaces[id] };
+	// Once per frame of the engine, no matter how many surfaces it renders.
+	memory::begin_frame_arena(frame_idx);
+	// Submit the uploads that were recorded so far, and don't start the frame before they're done.
+	wait(queue_type::graphics, upload::flush());
+	is_frame_open = true;
+}
 
+void
+end_frame()
+{
+	assert(is_frame_open);
 	// Presenting swap chain buffers happens in lockstep with frame buffers.
-	surface.present();
-	// Record commands
-	// ...
 	// Done recording commands. Now execute commands,
 	// signal and increment the fence value for next frame.
-	gfx_command.end_frame();
+	gfx_command.end_frame([]() {
+		for (surface_id id : frame_surfaces) surfaces[id].present();
+	});
+	for (u32 i{ 0 }; i < frame_surfaces.size(); ++i) display_surfaces.emplace_back(frame_surfaces[i]);
+	frame_surfaces.clear();
+	is_frame_open = false;
+}
+
+void
+render_surface(surface_id id)
+{
+	assert(is_frame_open);
+	d3d12_surface& surface{ surfaces[id] };
+	surface.set_present_mode(pacing.present_mode);
+
+	id3d12_graphics_command_list* cmd_list{ gfx_command.command_list() };
+	// The pipeline is created on a worker thread. Until it's ready, the surface keeps what it shows.
+	ID3D12PipelineState* const fill_color{ fill_color_pipeline ? pipeline::get(fill_color_pipeline) : nullptr };
+	if (fill_color && surface.format() == d3d12_surface::default_back_buffer_format)
+	{
+		fill_surface(cmd_list, surface, fill_color);
+	}
+	frame_surfaces.emplace_back(id);
 }
 }
 
+namespace ferraris::graphics::d3d12 {
+
+bool
+d3d12_command_backend::create(list_type& list, allocator_type& allocator)
+{
+	assert(device);
+	HRESULT hr{ S_OK };
+	DXCall(hr = device->CreateCommandAllocator(type, IID_PPV_ARGS(&allocator)));
+	if (FAILED(hr)) return false;
+	DXCall(hr = device->CreateCommandList(0, type, allocator, nullptr, IID_PPV_ARGS(&list)));
+	if (FAILED(hr))
+	{
+		core::release(allocator);
+		return false;
+	}
+	DXCall(list->Close());
+	NAME_D3D12_OBJECT(allocator, L"Context Command Allocator");
+	NAME_D3D12_OBJECT(list, L"Context Command List");
+	return true;
+}
+
+void
+d3d12_command_backend::destroy(list_type& list, allocator_type& allocator)
+{
+	core::release(list);
+	core::release(allocator);
+}
+
+void
+d3d12_command_backend::reset(allocator_type allocator)
+{
+	DXCall(allocator->Reset());
+}
+
+void
+d3d12_command_backend::begin(list_type list, allocator_type allocator)
+{
+	DXCall(list->Reset(allocator, nullptr));
+	bindless::bind_heap(list);
+}
+
+void
+d3d12_command_backend::end(list_type list)
+{
+	DXCall(list->Close());
+}
+}
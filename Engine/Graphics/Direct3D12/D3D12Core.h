@@ -1,7 +1,28 @@
 #pragma once
 #include "D3D12CommomHeaders.h"
+#include "Graphics/CommandContextPool.h"
+#include "Graphics/QueueTimeline.h"
 namespace ferraris::graphics::d3d12 {
 class descriptor_heap;
+
+// Command lists and allocators of the command_context_pool of the graphics queue.
+struct d3d12_command_backend
+{
+	using list_type = id3d12_graphics_command_list*;
+	using allocator_type = ID3D12CommandAllocator*;
+
+	id3d12_device*			device{ nullptr };
+	D3D12_COMMAND_LIST_TYPE	type{ D3D12_COMMAND_LIST_TYPE_DIRECT };
+
+	bool create(list_type& list, allocator_type& allocator);
+	void destroy(list_type& list, allocator_type& allocator);
+	void reset(allocator_type allocator);
+	void begin(list_type list, allocator_type allocator);
+	void end(list_type list);
+};
+
+using d3d12_command_context_pool = command_context_pool<d3d12_command_backend, frame_buffer_count>;
+using d3d12_command_context = d3d12_command_context_pool::context;
 }
 namespace ferraris::graphics::d3d12::core {
 
@@ -44,11 +65,35 @@ descriptor_heap& uav_heap();
 u32 current_frame_index();
 void set_deferred_release_flag();
 
+// A command list for recording on any thread between graphics::begin_frame() and end_frame().
+// The lists are submitted together with the frame's command list, after it and sorted by 'order'.
+// Returns nullptr outside a frame. Any order but d3d12_command_context_pool::reserved_order can be
+// used: the timestamp at the end of the frame has the reserved context, which is submitted last.
+d3d12_command_context* acquire_command_context(u32 order);
+void close_command_context(d3d12_command_context* context);
+command_context_stats get_command_context_stats();
+
+// The graphics, async compute and copy queues, and ordering work between them without waiting
+// on the CPU, see QueueTimeline.h. Signal a queue after submitting work to it.
+ID3D12CommandQueue* const command_queue(queue_type::type queue);
+sync_point signal(queue_type::type queue);
+bool wait(queue_type::type queue, sync_point point);
+bool is_complete(sync_point point);
+void wait_on_cpu(sync_point point);
+queue_timeline_stats get_queue_timeline_stats();
+
+void set_frame_pacing(const frame_pacing& pacing);
+frame_pacing get_frame_pacing();
+frame_timing_stats get_frame_timing_stats();
 
 surface create_surface(platform::window);
 void remove_surface(surface_id);
 void resize_surface(surface_id, u32, u32);
 u32 surface_width(surface_id);
 u32 surface_height(surface_id);
+// All surfaces are rendered between begin_frame() and end_frame(), see Renderer.h.
+void wait_for_display();
+void begin_frame();
+void end_frame();
 void render_surface(surface_id);
 }
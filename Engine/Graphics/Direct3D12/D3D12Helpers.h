@@ -13,6 +13,24 @@ constexpr struct {
 		0,										// CreationNodeMask
 		0										// VisibleNodeMask
 	};
+
+	D3D12_HEAP_PROPERTIES upload_heap
+	{
+		D3D12_HEAP_TYPE_UPLOAD,					// Type
+		D3D12_CPU_PAGE_PROPERTY_UNKNOWN,		// CPUPageProperty
+		D3D12_MEMORY_POOL_UNKNOWN,				// MemoryPoolPreference
+		0,										// CreationNodeMask
+		0										// VisibleNodeMask
+	};
+
+	D3D12_HEAP_PROPERTIES readback_heap
+	{
+		D3D12_HEAP_TYPE_READBACK,				// Type
+		D3D12_CPU_PAGE_PROPERTY_UNKNOWN,		// CPUPageProperty
+		D3D12_MEMORY_POOL_UNKNOWN,				// MemoryPoolPreference
+		0,										// CreationNodeMask
+		0										// VisibleNodeMask
+	};
 } heap_properties;
 ID3D12RootSignature* create_root_signature(const D3D12_ROOT_SIGNATURE_DESC1& desc);
 
@@ -109,7 +127,8 @@ class alignas(void*) d3d12_pipeline_state_subobject
 public:
 	d3d12_pipeline_state_subobject() = default;
 	constexpr explicit d3d12_pipeline_state_subobject(T subobject) : _type{ type }, _subobject{ subobject }{}
-	d3d12_pipeline_state_subobject& operator=(const T& suboject) { _subobject = _subobject; return *this; }
+	d3d12_pipeline_state_subobject& operator=(const T& subobject) { _subobject = subobject; return *this; }
+	constexpr const T& subobject() const { return _subobject; }
 private:
 	const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE _type{ type };
 	T _subobject{};
@@ -129,7 +148,7 @@ PSS(stream_output, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT, D3D12_STRE
 PSS(blend, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND, D3D12_BLEND_DESC);
 PSS(sample_mask, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK, u32);
 PSS(rasterizer, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER, D3D12_RASTERIZER_DESC);
-PSS(depth_stencil, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL, D3D12_DEPTH_STENCILOP_DESC);
+PSS(depth_stencil, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL, D3D12_DEPTH_STENCIL_DESC);
 PSS(input_layout, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT, D3D12_INPUT_LAYOUT_DESC);
 PSS(ib_strip_cut_value, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE, D3D12_INDEX_BUFFER_STRIP_CUT_VALUE);
 PSS(primitive_topology, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY, D3D12_PRIMITIVE_TOPOLOGY_TYPE);
@@ -137,7 +156,7 @@ PSS(render_target_formats, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FOR
 PSS(depth_stencil_format, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT, DXGI_FORMAT);
 PSS(sample_desc, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC, DXGI_SAMPLE_DESC);
 PSS(node_mask, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK, u32);
-PSS(cached_pso, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CACHED_PSO, D3D12_PIPELINE_STATE_FLAGS);
+PSS(cached_pso, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CACHED_PSO, D3D12_CACHED_PIPELINE_STATE);
 PSS(flags, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS, D3D12_PIPELINE_STATE_FLAGS);
 PSS(depth_stencil1, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1, D3D12_DEPTH_STENCIL_DESC1);
 PSS(view_instancing, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING, D3D12_VIEW_INSTANCING_DESC);
@@ -9,6 +9,9 @@ void get_platform_interface(platform_interface& pi)
 {
 	pi.initialize = core::initialize;
 	pi.shutdown = core::shutdown;
+	pi.wait_for_display = core::wait_for_display;
+	pi.begin_frame = core::begin_frame;
+	pi.end_frame = core::end_frame;
 
 	pi.surface.create = core::create_surface;
 	pi.surface.remove = core::remove_surface;
@@ -17,6 +20,10 @@ void get_platform_interface(platform_interface& pi)
 	pi.surface.height = core::surface_height;
 	pi.surface.render = core::render_surface;
 
+	pi.pacing.set = core::set_frame_pacing;
+	pi.pacing.get = core::get_frame_pacing;
+	pi.pacing.stats = core::get_frame_timing_stats;
+
 	pi.platform = graphics_platform::direct3d12;
 }
 
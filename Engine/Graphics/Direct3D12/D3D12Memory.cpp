@@ -0,0 +1,367 @@
+#include "D3D12Memory.h"
+#include "D3D12Core.h"
+#include "D3D12Helpers.h"
+#include "Graphics/TlsfAllocator.h"
+
+namespace ferraris::graphics::d3d12::gpu_memory {
+namespace {
+
+struct pool_desc
+{
+	D3D12_HEAP_FLAGS	flags;
+	u64					block_size;
+	u64					alignment;		// of the heaps
+	const wchar_t*		name;
+};
+
+// Multisampled render targets need 4 MB alignment, everything else is aligned to 64 KB. Placing
+// small textures at 4 KB would save memory, but mixing alignments in a heap fragments it badly.
+constexpr pool_desc pool_descs[memory_pool::count]
+{
+	{ D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, 128 * 1024 * 1024, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT, L"Render Target Heap" },
+	{ D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, 64 * 1024 * 1024, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, L"Texture Heap" },
+	{ D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, 32 * 1024 * 1024, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, L"Buffer Heap" },
+};
+
+struct memory_block
+{
+	ID3D12Heap1*					heap;
+	tlsf_allocator*					allocator;		// nullptr for dedicated heaps
+	u64								size;
+	u64								allocated;
+	u32								allocation_count;
+};
+
+std::mutex						memory_mutex{};
+IDXGIAdapter3*					adapter{ nullptr };
+utl::vector<memory_block>		blocks[memory_pool::count]{};		// blocks without a heap are unused
+utl::vector<gpu_allocation>		deferred_frees[frame_buffer_count]{};
+
+constexpr u64
+align_up(u64 value, u64 alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr bool
+is_dedicated(const memory_block& block)
+{
+	return !block.allocator;
+}
+
+void
+release_block(memory_block& block)
+{
+	core::release(block.heap);
+	delete block.allocator;
+	block.allocator = nullptr;
+	block.size = 0;
+}
+
+// Releases empty blocks, keeping one regular block per pool unless 'keep_one' is false.
+void
+release_empty_blocks(bool keep_one)
+{
+	for (u32 pool{ 0 }; pool < memory_pool::count; ++pool)
+	{
+		bool kept{ !keep_one };
+		for (u32 i{ 0 }; i < blocks[pool].size(); ++i)
+		{
+			memory_block& block{ blocks[pool][i] };
+			if (!block.heap || block.allocation_count) continue;
+			if (!kept && !is_dedicated(block)) kept = true;
+			else release_block(block);
+		}
+	}
+}
+
+u32
+create_block(memory_pool::type pool, u64 size, bool dedicated)
+{
+	const pool_desc& desc{ pool_descs[pool] };
+	// Make room for the heap if the process already uses more than its budget. The new heap
+	// will still be created, but it's likely to end up in system memory.
+	if (adapter)
+	{
+		DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+		DXCall(adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info));
+		if (info.CurrentUsage + size > info.Budget) release_empty_blocks(false);
+	}
+
+	D3D12_HEAP_DESC heap_desc{};
+	heap_desc.SizeInBytes = size;
+	heap_desc.Properties = d3dx::heap_properties.default_heap;
+	heap_desc.Alignment = desc.alignment;
+	heap_desc.Flags = desc.flags;
+
+	ID3D12Heap1* heap{ nullptr };
+	HRESULT hr{ S_OK };
+	DXCall(hr = core::device()->CreateHeap1(&heap_desc, nullptr, IID_PPV_ARGS(&heap)));
+	if (FAILED(hr)) return u32_invalid_id;
+
+	// Reuse the slot of a released block, so that the index of the other blocks doesn't change.
+	utl::vector<memory_block>& pool_blocks{ blocks[pool] };
+	u32 index{ 0 };
+	while (index < pool_blocks.size() && pool_blocks[index].heap) ++index;
+	if (index == pool_blocks.size()) pool_blocks.emplace_back(memory_block{});
+	NAME_D3D12_OBJECT_INDEX(heap, index, desc.name);
+
+	memory_block& block{ pool_blocks[index] };
+	block.heap = heap;
+	block.size = size;
+	block.allocated = 0;
+	block.allocation_count = 0;
+	if (!dedicated)
+	{
+		block.allocator = new tlsf_allocator{};
+		block.allocator->initialize(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+	}
+	return index;
+}
+
+// Allocates from a regular block. Creates a new block if none has enough free memory.
+gpu_allocation
+allocate_from_blocks(memory_pool::type pool, u64 size, u64 alignment)
+{
+	utl::vector<memory_block>& pool_blocks{ blocks[pool] };
+	tlsf_allocator::allocation a{ tlsf_allocator::invalid_offset, 0, u32_invalid_id };
+	u32 index{ 0 };
+	for (; index < pool_blocks.size(); ++index)
+	{
+		memory_block& block{ pool_blocks[index] };
+		if (!block.heap || is_dedicated(block)) continue;
+		a = block.allocator->allocate(size, alignment);
+		if (a.is_valid()) break;
+	}
+
+	if (!a.is_valid())
+	{
+		index = create_block(pool, pool_descs[pool].block_size, false);
+		if (index == u32_invalid_id) return {};
+		a = pool_blocks[index].allocator->allocate(size, alignment);
+		assert(a.is_valid());
+	}
+
+	memory_block& block{ pool_blocks[index] };
+	block.allocated += a.size;
+	++block.allocation_count;
+
+	gpu_allocation allocation{};
+	allocation.heap = block.heap;
+	allocation.offset = a.offset;
+	allocation.size = a.size;
+	allocation.pool = pool;
+	allocation.block = index;
+	allocation.id = a.block;
+	return allocation;
+}
+
+gpu_allocation
+allocate_dedicated(memory_pool::type pool, u64 size)
+{
+	size = align_up(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+	const u32 index{ create_block(pool, size, true) };
+	if (index == u32_invalid_id) return {};
+
+	memory_block& block{ blocks[pool][index] };
+	block.allocated = size;
+	block.allocation_count = 1;
+
+	gpu_allocation allocation{};
+	allocation.heap = block.heap;
+	allocation.size = size;
+	allocation.pool = pool;
+	allocation.block = index;
+	allocation.id = 0;
+	return allocation;
+}
+
+// Frees an allocation right away. Only for memory the GPU doesn't use anymore.
+void
+free_now(const gpu_allocation& allocation)
+{
+	memory_block& block{ blocks[allocation.pool][allocation.block] };
+	assert(block.heap == allocation.heap && block.allocation_count);
+	block.allocated -= allocation.size;
+	--block.allocation_count;
+
+	if (is_dedicated(block))
+	{
+		release_block(block);
+	}
+	else
+	{
+		block.allocator->free({ allocation.offset, allocation.size, allocation.id });
+		if (!block.allocation_count)
+		{
+			// Keep the block if it's the only empty one of the pool.
+			for (u32 i{ 0 }; i < blocks[allocation.pool].size(); ++i)
+			{
+				const memory_block& other{ blocks[allocation.pool][i] };
+				if (i != allocation.block && other.heap && !is_dedicated(other) && !other.allocation_count)
+				{
+					release_block(block);
+					break;
+				}
+			}
+		}
+	}
+}
+
+void
+free_deferred(const gpu_allocation& allocation)
+{
+	deferred_frees[core::current_frame_index()].emplace_back(allocation);
+	core::set_deferred_release_flag();
+}
+
+} // anonymous namespace
+
+bool
+initialize(IDXGIAdapter3* main_adapter)
+{
+	assert(main_adapter && !adapter);
+	adapter = main_adapter;
+	adapter->AddRef();
+	return true;
+}
+
+void
+shutdown()
+{
+	std::lock_guard lock{ memory_mutex };
+	for (u32 i{ 0 }; i < frame_buffer_count; ++i)
+	{
+		for (u32 j{ 0 }; j < deferred_frees[i].size(); ++j) free_now(deferred_frees[i][j]);
+		deferred_frees[i].clear();
+	}
+	for (u32 pool{ 0 }; pool < memory_pool::count; ++pool)
+	{
+		for (u32 i{ 0 }; i < blocks[pool].size(); ++i)
+		{
+			// NOTE: blocks that still have allocations belong to resources that weren't released.
+			assert(!blocks[pool][i].allocation_count);
+			release_block(blocks[pool][i]);
+		}
+		blocks[pool].clear();
+	}
+	core::release(adapter);
+}
+
+gpu_allocation
+allocate(memory_pool::type pool, const D3D12_RESOURCE_ALLOCATION_INFO& info)
+{
+	assert(pool < memory_pool::count && info.SizeInBytes);
+	assert(info.Alignment <= pool_descs[pool].alignment);
+	std::lock_guard lock{ memory_mutex };
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+
+	// Large resources would leave too little room for others in a block.
+	if (info.SizeInBytes > pool_descs[pool].block_size / 2)
+	{
+		return allocate_dedicated(pool, info.SizeInBytes);
+	}
+	return allocate_from_blocks(pool, info.SizeInBytes, info.Alignment);
+}
+
+void
+free(gpu_allocation& allocation)
+{
+	if (!allocation.is_valid()) return;
+	{
+		std::lock_guard lock{ memory_mutex };
+		memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+		free_deferred(allocation);
+	}
+	allocation = {};
+}
+
+void
+process_deferred_free(u32 frame_idx)
+{
+	std::lock_guard lock{ memory_mutex };
+	utl::vector<gpu_allocation>& allocations{ deferred_frees[frame_idx] };
+	for (u32 i{ 0 }; i < allocations.size(); ++i) free_now(allocations[i]);
+	allocations.clear();
+}
+
+memory_pool::type
+pool_for(const D3D12_RESOURCE_DESC& desc)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) return memory_pool::buffers;
+	if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) return memory_pool::render_targets;
+	return memory_pool::textures;
+}
+
+ID3D12Resource*
+create_resource(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initial_state,
+	const D3D12_CLEAR_VALUE* clear_value, gpu_allocation& allocation)
+{
+	auto* const device{ core::device() };
+	assert(device);
+	const D3D12_RESOURCE_ALLOCATION_INFO info{ device->GetResourceAllocationInfo(0, 1, &desc) };
+	allocation = allocate(pool_for(desc), info);
+	if (!allocation.is_valid()) return nullptr;
+
+	ID3D12Resource* resource{ nullptr };
+	HRESULT hr{ S_OK };
+	DXCall(hr = device->CreatePlacedResource(allocation.heap, allocation.offset, &desc,
+		initial_state, clear_value, IID_PPV_ARGS(&resource)));
+	if (FAILED(hr))
+	{
+		free(allocation);
+		return nullptr;
+	}
+	return resource;
+}
+
+pool_stats
+get_pool_stats(memory_pool::type pool)
+{
+	assert(pool < memory_pool::count);
+	std::lock_guard lock{ memory_mutex };
+	pool_stats stats{};
+	u64 free_bytes{ 0 };
+	u64 largest_free_blocks{ 0 };
+	for (u32 i{ 0 }; i < blocks[pool].size(); ++i)
+	{
+		const memory_block& block{ blocks[pool][i] };
+		if (!block.heap) continue;
+		++stats.heap_count;
+		stats.allocation_count += block.allocation_count;
+		stats.reserved += block.size;
+		stats.allocated += block.allocated;
+		if (is_dedicated(block)) continue;
+
+		const tlsf_allocator::allocator_stats block_stats{ block.allocator->stats() };
+		stats.largest_free_block = block_stats.largest_free_block > stats.largest_free_block ? block_stats.largest_free_block : stats.largest_free_block;
+		free_bytes += block_stats.capacity - block_stats.used;
+		largest_free_blocks += block_stats.largest_free_block;
+	}
+	stats.fragmentation = free_bytes ? 1.f - (f32)largest_free_blocks / (f32)free_bytes : 0.f;
+	return stats;
+}
+
+memory_budget
+get_budget()
+{
+	memory_budget budget{};
+	if (adapter)
+	{
+		DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+		DXCall(adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info));
+		budget.budget = info.Budget;
+		budget.usage = info.CurrentUsage;
+	}
+	std::lock_guard lock{ memory_mutex };
+	for (u32 pool{ 0 }; pool < memory_pool::count; ++pool)
+	{
+		for (u32 i{ 0 }; i < blocks[pool].size(); ++i)
+		{
+			budget.reserved += blocks[pool][i].size;
+			budget.allocated += blocks[pool][i].allocated;
+		}
+	}
+	return budget;
+}
+}
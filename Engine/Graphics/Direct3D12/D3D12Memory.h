@@ -0,0 +1,79 @@
+#pragma once
+// Included by D3D12Resources.h, so it can't include D3D12CommomHeaders.h.
+#include "CommonHeaders.h"
+#include <dxgi1_6.h>
+#include <d3d12.h>
+
+// Places textures and buffers in large ID3D12Heap1 blocks instead of giving each of them a
+// committed resource with its own implicit heap. Every category of resource has a pool of blocks,
+// because resource heap tier 1 hardware can't mix render targets, other textures and buffers in
+// one heap. The blocks are sub-allocated with a TLSF allocator (see TlsfAllocator.h), which finds
+// a fitting free range in constant time. Resources that take up a good part of a block get a
+// dedicated heap of their own.
+//
+// Memory is freed with a delay of frame_buffer_count frames, like deferred releases, so that it's
+// reused only after the GPU has stopped using the resource. Empty blocks are released, but each
+// pool keeps one to avoid creating and destroying heaps over and over.
+// All functions are thread-safe.
+namespace ferraris::graphics::d3d12::gpu_memory {
+
+struct memory_pool {
+	enum type : u32 {
+		render_targets,		// render target and depth stencil textures
+		textures,
+		buffers,
+
+		count
+	};
+};
+
+struct gpu_allocation
+{
+	ID3D12Heap1*			heap{ nullptr };
+	u64						offset{ 0 };
+	u64						size{ 0 };
+	memory_pool::type		pool{ memory_pool::count };
+	u32						block{ u32_invalid_id };
+	u32						id{ u32_invalid_id };		// of the allocation in its block
+
+	constexpr bool is_valid() const { return heap != nullptr; }
+};
+
+struct pool_stats
+{
+	u32 heap_count;
+	u32 allocation_count;
+	u64 reserved;					// size of all heaps
+	u64 allocated;
+	u64 largest_free_block;
+	f32 fragmentation;				// 0 if the free memory of each heap is in one block, approaching 1 as it's split up
+};
+
+struct memory_budget
+{
+	u64 budget;						// what the OS gives this process, from IDXGIAdapter3::QueryVideoMemoryInfo()
+	u64 usage;						// what the process uses, including memory that's not in the pools
+	u64 reserved;					// size of all heaps of all pools
+	u64 allocated;
+	constexpr bool is_over_budget() const { return usage > budget; }
+};
+
+bool initialize(IDXGIAdapter3* adapter);
+void shutdown();
+
+// Allocates memory for a resource with the size and alignment from GetResourceAllocationInfo().
+[[nodiscard]] gpu_allocation allocate(memory_pool::type pool, const D3D12_RESOURCE_ALLOCATION_INFO& info);
+// Freed after frame_buffer_count frames. Resets 'allocation'.
+void free(gpu_allocation& allocation);
+void process_deferred_free(u32 frame_idx);
+
+// The pool a resource is placed in.
+memory_pool::type pool_for(const D3D12_RESOURCE_DESC& desc);
+// Allocates memory from the pool of the resource and places it there. Returns nullptr and
+// an invalid allocation if that fails.
+[[nodiscard]] ID3D12Resource* create_resource(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initial_state,
+	const D3D12_CLEAR_VALUE* clear_value, gpu_allocation& allocation);
+
+pool_stats get_pool_stats(memory_pool::type pool);
+memory_budget get_budget();
+}
@@ -0,0 +1,400 @@
+#include "D3D12Pipeline.h"
+#include "D3D12Core.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace ferraris::graphics::d3d12::pipeline {
+namespace {
+
+// Part of every key. Bump it when the way pipelines are created changes.
+constexpr u64 backend_version{ 2 };
+
+struct pipeline_type {
+	enum type : u32 {
+		graphics,
+		compute,
+	};
+};
+
+// Pipelines are created from pipeline state streams with these subobjects.
+struct graphics_stream
+{
+	d3dx::d3d12_pipeline_state_subobject_root_signature			root_signature;
+	d3dx::d3d12_pipeline_state_subobject_vs						vs;
+	d3dx::d3d12_pipeline_state_subobject_ps						ps;
+	d3dx::d3d12_pipeline_state_subobject_ds						ds;
+	d3dx::d3d12_pipeline_state_subobject_hs						hs;
+	d3dx::d3d12_pipeline_state_subobject_gs						gs;
+	d3dx::d3d12_pipeline_state_subobject_blend					blend;
+	d3dx::d3d12_pipeline_state_subobject_sample_mask			sample_mask;
+	d3dx::d3d12_pipeline_state_subobject_rasterizer				rasterizer;
+	d3dx::d3d12_pipeline_state_subobject_depth_stencil			depth_stencil;
+	d3dx::d3d12_pipeline_state_subobject_input_layout			input_layout;
+	d3dx::d3d12_pipeline_state_subobject_ib_strip_cut_value		ib_strip_cut_value;
+	d3dx::d3d12_pipeline_state_subobject_primitive_topology		primitive_topology;
+	d3dx::d3d12_pipeline_state_subobject_render_target_formats	render_target_formats;
+	d3dx::d3d12_pipeline_state_subobject_depth_stencil_format	depth_stencil_format;
+	d3dx::d3d12_pipeline_state_subobject_sample_desc			sample_desc;
+	d3dx::d3d12_pipeline_state_subobject_node_mask				node_mask;
+	d3dx::d3d12_pipeline_state_subobject_flags					flags;
+};
+
+struct compute_stream
+{
+	d3dx::d3d12_pipeline_state_subobject_root_signature			root_signature;
+	d3dx::d3d12_pipeline_state_subobject_cs						cs;
+	d3dx::d3d12_pipeline_state_subobject_node_mask				node_mask;
+	d3dx::d3d12_pipeline_state_subobject_flags					flags;
+};
+
+// Copied by the pipeline cache and handed back to create() on a worker thread. Both start with
+// the type. The input elements of a graphics pipeline follow it.
+struct graphics_create_info
+{
+	pipeline_type::type		type;
+	u32						element_count;
+	graphics_stream			stream;
+};
+
+struct compute_create_info
+{
+	pipeline_type::type		type;
+	compute_stream			stream;
+};
+
+ID3D12PipelineLibrary1*		library{ nullptr };
+// The library uses the serialized data without copying it, so it has to outlive the library.
+utl::vector<u8>				library_data;
+std::filesystem::path		library_path{};
+std::mutex					library_mutex;
+bool						is_library_changed{ false };
+
+// Writes the state field by field, so that padding bytes aren't part of the key.
+template<typename T>
+void
+append(utl::vector<u8>& state, const T& value)
+{
+	static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+	const u64 offset{ state.size() };
+	state.resize(offset + sizeof(T));
+	memcpy(&state[offset], &value, sizeof(T));
+}
+
+void
+append_state(utl::vector<u8>& state, const graphics_stream& stream)
+{
+	const D3D12_BLEND_DESC& blend{ stream.blend.subobject() };
+	append(state, blend.AlphaToCoverageEnable);
+	append(state, blend.IndependentBlendEnable);
+	for (u32 i{ 0 }; i < _countof(blend.RenderTarget); ++i)
+	{
+		const D3D12_RENDER_TARGET_BLEND_DESC& rt{ blend.RenderTarget[i] };
+		append(state, rt.BlendEnable);
+		append(state, rt.LogicOpEnable);
+		append(state, rt.SrcBlend);
+		append(state, rt.DestBlend);
+		append(state, rt.BlendOp);
+		append(state, rt.SrcBlendAlpha);
+		append(state, rt.DestBlendAlpha);
+		append(state, rt.BlendOpAlpha);
+		append(state, rt.LogicOp);
+		append(state, rt.RenderTargetWriteMask);
+	}
+	append(state, stream.sample_mask.subobject());
+
+	const D3D12_RASTERIZER_DESC& raster{ stream.rasterizer.subobject() };
+	append(state, raster.FillMode);
+	append(state, raster.CullMode);
+	append(state, raster.FrontCounterClockwise);
+	append(state, raster.DepthBias);
+	append(state, raster.DepthBiasClamp);
+	append(state, raster.SlopeScaledDepthBias);
+	append(state, raster.DepthClipEnable);
+	append(state, raster.MultisampleEnable);
+	append(state, raster.AntialiasedLineEnable);
+	append(state, raster.ForcedSampleCount);
+	append(state, raster.ConservativeRaster);
+
+	const D3D12_DEPTH_STENCIL_DESC& depth{ stream.depth_stencil.subobject() };
+	append(state, depth.DepthEnable);
+	append(state, depth.DepthWriteMask);
+	append(state, depth.DepthFunc);
+	append(state, depth.StencilEnable);
+	append(state, depth.StencilReadMask);
+	append(state, depth.StencilWriteMask);
+	for (const D3D12_DEPTH_STENCILOP_DESC* face : { &depth.FrontFace, &depth.BackFace })
+	{
+		append(state, face->StencilFailOp);
+		append(state, face->StencilDepthFailOp);
+		append(state, face->StencilPassOp);
+		append(state, face->StencilFunc);
+	}
+
+	const D3D12_INPUT_LAYOUT_DESC& layout{ stream.input_layout.subobject() };
+	append(state, layout.NumElements);
+	for (u32 i{ 0 }; i < layout.NumElements; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element{ layout.pInputElementDescs[i] };
+		for (const char* c{ element.SemanticName }; *c; ++c) append(state, *c);
+		append(state, '\0');
+		append(state, element.SemanticIndex);
+		append(state, element.Format);
+		append(state, element.InputSlot);
+		append(state, element.AlignedByteOffset);
+		append(state, element.InputSlotClass);
+		append(state, element.InstanceDataStepRate);
+	}
+
+	append(state, stream.ib_strip_cut_value.subobject());
+	append(state, stream.primitive_topology.subobject());
+	const D3D12_RT_FORMAT_ARRAY& formats{ stream.render_target_formats.subobject() };
+	append(state, formats.NumRenderTargets);
+	for (u32 i{ 0 }; i < _countof(formats.RTFormats); ++i) append(state, formats.RTFormats[i]);
+	append(state, stream.depth_stencil_format.subobject());
+	append(state, stream.sample_desc.subobject().Count);
+	append(state, stream.sample_desc.subobject().Quality);
+	append(state, stream.node_mask.subobject());
+	append(state, stream.flags.subobject());
+}
+
+graphics_stream
+make_stream(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	graphics_stream stream{};
+	stream.root_signature = desc.pRootSignature;
+	stream.vs = desc.VS;
+	stream.ps = desc.PS;
+	stream.ds = desc.DS;
+	stream.hs = desc.HS;
+	stream.gs = desc.GS;
+	stream.blend = desc.BlendState;
+	stream.sample_mask = desc.SampleMask;
+	stream.rasterizer = desc.RasterizerState;
+	stream.depth_stencil = desc.DepthStencilState;
+	stream.input_layout = desc.InputLayout;
+	stream.ib_strip_cut_value = desc.IBStripCutValue;
+	stream.primitive_topology = desc.PrimitiveTopologyType;
+	D3D12_RT_FORMAT_ARRAY formats{};
+	formats.NumRenderTargets = desc.NumRenderTargets;
+	for (u32 i{ 0 }; i < _countof(formats.RTFormats); ++i) formats.RTFormats[i] = desc.RTVFormats[i];
+	stream.render_target_formats = formats;
+	stream.depth_stencil_format = desc.DSVFormat;
+	stream.sample_desc = desc.SampleDesc;
+	stream.node_mask = desc.NodeMask;
+	stream.flags = desc.Flags;
+	return stream;
+}
+
+u64
+shader_key(u64 key, const D3D12_SHADER_BYTECODE& byte_code)
+{
+	if (key || !byte_code.BytecodeLength) return key;
+	return utl::fnv1a_64((const char*)byte_code.pShaderBytecode, byte_code.BytecodeLength);
+}
+
+// Pipelines are stored under their key.
+void
+get_name(u64 key, wchar_t(&name)[17])
+{
+	swprintf_s(name, L"%016llx", (unsigned long long)key);
+}
+
+pipeline_cache::create_result
+create_from_stream(u64 key, void* stream, u64 stream_size)
+{
+	wchar_t name[17];
+	get_name(key, name);
+	D3D12_PIPELINE_STATE_STREAM_DESC desc{};
+	desc.SizeInBytes = stream_size;
+	desc.pPipelineStateSubobjectStream = stream;
+
+	ID3D12PipelineState* pipeline_state{ nullptr };
+	if (library)
+	{
+		// Fails if the pipeline isn't in the library, or if its stream doesn't match.
+		// NOTE: loading is thread-safe, only storing and serializing need the mutex.
+		if (SUCCEEDED(library->LoadPipeline(name, &desc, IID_PPV_ARGS(&pipeline_state)))) return { pipeline_state, true };
+	}
+	pipeline_state = d3dx::create_pipeline_state(desc);
+	if (!pipeline_state) return { nullptr, false };
+
+	NAME_D3D12_OBJECT(pipeline_state, name);
+	if (library)
+	{
+		std::lock_guard lock{ library_mutex };
+		if (SUCCEEDED(library->StorePipeline(name, pipeline_state))) is_library_changed = true;
+	}
+	return { pipeline_state, false };
+}
+
+pipeline_cache::create_result
+create(const pipeline_cache::create_request& request)
+{
+	assert(request.create_info_size >= sizeof(pipeline_type::type));
+	if (*(const pipeline_type::type*)request.create_info == pipeline_type::graphics)
+	{
+		assert(request.create_info_size >= sizeof(graphics_create_info));
+		const graphics_create_info& info{ *(const graphics_create_info*)request.create_info };
+		// The stream is copied to point its input layout at the elements after the info.
+		graphics_stream stream{ info.stream };
+		const D3D12_INPUT_ELEMENT_DESC* const elements{ info.element_count ? (const D3D12_INPUT_ELEMENT_DESC*)(&info + 1) : nullptr };
+		stream.input_layout = D3D12_INPUT_LAYOUT_DESC{ elements, info.element_count };
+		return create_from_stream(request.key, &stream, sizeof(stream));
+	}
+
+	assert(*(const pipeline_type::type*)request.create_info == pipeline_type::compute);
+	assert(request.create_info_size >= sizeof(compute_create_info));
+	compute_stream stream{ ((const compute_create_info*)request.create_info)->stream };
+	return create_from_stream(request.key, &stream, sizeof(stream));
+}
+
+void
+destroy(void* pipeline_state)
+{
+	ID3D12PipelineState* p{ (ID3D12PipelineState*)pipeline_state };
+	core::release(p);
+}
+
+bool
+load_library()
+{
+	id3d12_device* const device{ core::device() };
+	HRESULT hr{ E_FAIL };
+	if (!library_path.empty())
+	{
+		std::ifstream file{ library_path, std::ios::in | std::ios::binary | std::ios::ate };
+		if (file)
+		{
+			library_data.resize((u64)file.tellg());
+			file.seekg(0);
+			if (!library_data.empty() && file.read((char*)library_data.data(), library_data.size()))
+			{
+				hr = device->CreatePipelineLibrary(library_data.data(), library_data.size(), IID_PPV_ARGS(&library));
+			}
+		}
+	}
+
+	// The library is from another driver or adapter, or there's none yet: start an empty one.
+	if (FAILED(hr))
+	{
+		library_data.clear();
+		hr = device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library));
+	}
+	// Not every driver supports pipeline libraries. Pipelines are still cached in memory then.
+	if (FAILED(hr))
+	{
+		library = nullptr;
+		return false;
+	}
+	NAME_D3D12_OBJECT(library, L"Pipeline Library");
+	return true;
+}
+
+void
+save_library()
+{
+	if (!library || !is_library_changed || library_path.empty()) return;
+	utl::vector<u8> data;
+	HRESULT hr{ S_OK };
+	{
+		std::lock_guard lock{ library_mutex };
+		data.resize(library->GetSerializedSize());
+		DXCall(hr = library->Serialize(data.data(), data.size()));
+	}
+	if (FAILED(hr)) return;
+
+	// Write to a temporary file first, so that a crash never leaves a partial library behind.
+	std::error_code error;
+	std::filesystem::create_directories(library_path.parent_path(), error);
+	std::filesystem::path temp_path{ library_path };
+	temp_path += ".tmp";
+	{
+		std::ofstream file{ temp_path, std::ios::out | std::ios::binary | std::ios::trunc };
+		file.write((const char*)data.data(), data.size());
+		if (!file) return;
+	}
+	std::filesystem::rename(temp_path, library_path, error);
+	if (error) std::filesystem::remove(temp_path, error);
+}
+} // anonymous namespace
+
+bool
+initialize(const char* path)
+{
+	assert(!library);
+	library_path = path ? path : "";
+	is_library_changed = false;
+	load_library();
+	return pipeline_cache::initialize({ create, destroy, backend_version });
+}
+
+void
+shutdown()
+{
+	// Stop the workers before the library is written.
+	pipeline_cache::shutdown();
+	save_library();
+	core::release(library);
+	library_data.clear();
+	library_path.clear();
+	is_library_changed = false;
+}
+
+u64
+request(const graphics_pipeline_desc& desc, u64 fallback)
+{
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC& d{ desc.desc };
+	assert(d.pRootSignature && desc.root_signature_key);
+	assert(!d.StreamOutput.NumEntries && !d.CachedPSO.CachedBlobSizeInBytes);
+	const u64 shaders[]{
+		shader_key(desc.shader_keys[0], d.VS), shader_key(desc.shader_keys[1], d.PS), shader_key(desc.shader_keys[2], d.DS),
+		shader_key(desc.shader_keys[3], d.HS), shader_key(desc.shader_keys[4], d.GS),
+	};
+	graphics_create_info info{ pipeline_type::graphics, d.InputLayout.NumElements, make_stream(d) };
+	utl::vector<u8> state;
+	state.reserve(512);
+	append(state, pipeline_type::graphics);
+	append_state(state, info.stream);
+
+	// The input elements are copied after the info, create() points the input layout at them.
+	const u32 element_count{ info.element_count };
+	info.stream.input_layout = D3D12_INPUT_LAYOUT_DESC{ nullptr, element_count };
+	utl::vector<u8> data(sizeof(info) + element_count * sizeof(D3D12_INPUT_ELEMENT_DESC));
+	memcpy(data.data(), &info, sizeof(info));
+	if (element_count) memcpy(&data[sizeof(info)], d.InputLayout.pInputElementDescs, element_count * sizeof(D3D12_INPUT_ELEMENT_DESC));
+
+	const pipeline_cache::pipeline_desc pipeline_desc{ shaders, _countof(shaders), desc.root_signature_key,
+		state.data(), (u32)state.size(), data.data(), (u32)data.size() };
+	return pipeline_cache::request(pipeline_desc, fallback);
+}
+
+u64
+request(const compute_pipeline_desc& desc, u64 fallback)
+{
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC& d{ desc.desc };
+	assert(d.pRootSignature && desc.root_signature_key);
+	assert(!d.CachedPSO.CachedBlobSizeInBytes);
+	const u64 shader{ shader_key(desc.shader_key, d.CS) };
+	compute_create_info info{ pipeline_type::compute, {} };
+	info.stream.root_signature = d.pRootSignature;
+	info.stream.cs = d.CS;
+	info.stream.node_mask = d.NodeMask;
+	info.stream.flags = d.Flags;
+
+	utl::vector<u8> state;
+	append(state, pipeline_type::compute);
+	append(state, info.stream.node_mask.subobject());
+	append(state, info.stream.flags.subobject());
+
+	const pipeline_cache::pipeline_desc pipeline_desc{ &shader, 1, desc.root_signature_key,
+		state.data(), (u32)state.size(), &info, (u32)sizeof(info) };
+	return pipeline_cache::request(pipeline_desc, fallback);
+}
+
+ID3D12PipelineState*
+get(u64 key)
+{
+	return (ID3D12PipelineState*)pipeline_cache::get(key).handle;
+}
+}
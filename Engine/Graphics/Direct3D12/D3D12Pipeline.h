@@ -0,0 +1,45 @@
+#pragma once
+#include "D3D12CommomHeaders.h"
+#include "Graphics/PipelineCache.h"
+
+// Pipeline state objects through the pipeline cache (see PipelineCache.h). Pipelines are created
+// from pipeline state streams on worker threads and stored in an ID3D12PipelineLibrary1, which is
+// written to disk on shutdown and loaded again on the next start. So a pipeline is compiled by the
+// driver only once, until the driver or the adapter changes and the library is thrown away.
+//
+// The desc is turned into a stream, and the key of a pipeline hashes the subobjects of the stream
+// field by field, so padding and pointers don't matter.
+// The pointers in the desc must stay valid until the pipeline is ready: shader byte code from
+// shader_variants or shaders::get_engine_shader() lasts until shutdown, and semantic names of
+// the input layout should be string literals. The input elements themselves are copied.
+// Stream output and cached PSOs are not supported, the library takes the place of the latter.
+namespace ferraris::graphics::d3d12::pipeline {
+
+struct graphics_pipeline_desc
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC	desc{};
+	// Keys of the VS, PS, DS, HS and GS that are the same in every run, e.g. from
+	// shader_variants::request(). A key that's 0 is made from the shader's byte code.
+	u64									shader_keys[5]{};
+	u64									root_signature_key{ 0 };
+};
+
+struct compute_pipeline_desc
+{
+	D3D12_COMPUTE_PIPELINE_STATE_DESC	desc{};
+	u64									shader_key{ 0 };		// 0 to use the byte code
+	u64									root_signature_key{ 0 };
+};
+
+// 'library_path' can be nullptr to keep pipelines only in memory.
+bool initialize(const char* library_path);
+// NOTE: the GPU must have finished using the pipelines.
+void shutdown();
+
+// Returns the key of the pipeline and starts creating it if it's not in memory yet. Until it's
+// ready get() returns the pipeline of 'fallback', if that one is ready.
+u64 request(const graphics_pipeline_desc& desc, u64 fallback = 0);
+u64 request(const compute_pipeline_desc& desc, u64 fallback = 0);
+// Non-blocking. Returns nullptr if neither the pipeline nor its fallback are ready.
+ID3D12PipelineState* get(u64 key);
+}
@@ -0,0 +1,241 @@
+#include "D3D12RenderGraph.h"
+#include "D3D12Core.h"
+#include "D3D12Helpers.h"
+
+namespace ferraris::graphics::d3d12 {
+namespace {
+
+// Hashes field by field, so that padding bytes aren't part of the hash.
+template<typename T>
+void
+hash_value(u64& hash, const T& value)
+{
+	static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+	hash = utl::fnv1a_64((const char*)&value, sizeof(T), hash);
+}
+
+void
+hash_texture_desc(u64& hash, const d3d12_transient_texture_desc& texture)
+{
+	const D3D12_RESOURCE_DESC& desc{ texture.desc };
+	hash_value(hash, desc.Dimension);
+	hash_value(hash, desc.Alignment);
+	hash_value(hash, desc.Width);
+	hash_value(hash, desc.Height);
+	hash_value(hash, desc.DepthOrArraySize);
+	hash_value(hash, desc.MipLevels);
+	hash_value(hash, desc.Format);
+	hash_value(hash, desc.SampleDesc.Count);
+	hash_value(hash, desc.SampleDesc.Quality);
+	hash_value(hash, desc.Layout);
+	hash_value(hash, desc.Flags);
+
+	// Only the member of the union that belongs to the kind of texture is set.
+	const D3D12_CLEAR_VALUE& clear_value{ texture.clear_value };
+	hash_value(hash, clear_value.Format);
+	if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+	{
+		hash_value(hash, clear_value.DepthStencil.Depth);
+		hash_value(hash, clear_value.DepthStencil.Stencil);
+	}
+	else
+	{
+		for (u32 i{ 0 }; i < _countof(clear_value.Color); ++i) hash_value(hash, clear_value.Color[i]);
+	}
+}
+
+u64
+get_layout_hash(const render_graph& graph, const d3d12_transient_texture_desc* const descs)
+{
+	u64 hash{ utl::fnv1a_64((const char*)&graph.stats().heap_size, sizeof(u64)) };
+	for (u32 i{ 0 }; i < graph.resource_count(); ++i)
+	{
+		const render_resource_id id{ i };
+		const render_graph::resource_info& info{ graph.resource(id) };
+		if (!info.is_transient || !info.is_used) continue;
+		hash_value(hash, i);
+		hash_value(hash, info.offset);
+		hash_value(hash, info.initial_usage);
+		hash_texture_desc(hash, descs[i]);
+	}
+	return hash;
+}
+} // anonymous namespace
+
+D3D12_RESOURCE_STATES
+get_resource_states(u32 usage)
+{
+	if (usage == resource_usage::present) return D3D12_RESOURCE_STATE_PRESENT;
+
+	u32 states{ D3D12_RESOURCE_STATE_COMMON };
+	if (usage & resource_usage::render_target) states |= D3D12_RESOURCE_STATE_RENDER_TARGET;
+	if (usage & resource_usage::depth_write) states |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	if (usage & resource_usage::depth_read) states |= D3D12_RESOURCE_STATE_DEPTH_READ;
+	if (usage & resource_usage::shader_resource)
+	{
+		states |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	}
+	if (usage & resource_usage::unordered_access) states |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	if (usage & resource_usage::copy_source) states |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+	if (usage & resource_usage::copy_destination) states |= D3D12_RESOURCE_STATE_COPY_DEST;
+	return (D3D12_RESOURCE_STATES)states;
+}
+
+transient_resource_desc
+get_transient_desc(const D3D12_RESOURCE_DESC& desc)
+{
+	assert(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+	auto* const device{ core::device() };
+	assert(device);
+	const D3D12_RESOURCE_ALLOCATION_INFO info{ device->GetResourceAllocationInfo(0, 1, &desc) };
+	return { info.SizeInBytes, info.Alignment, rt_ds_heap_group };
+}
+
+bool
+d3d12_transient_resources::update(const render_graph& graph, const d3d12_transient_texture_desc* const descs)
+{
+	assert(descs);
+	const u64 hash{ get_layout_hash(graph, descs) };
+	if (_heap && hash == _layout_hash) return true;
+
+	release();
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	const u32 resource_count{ graph.resource_count() };
+	_render_textures.resize(resource_count);
+	_depth_buffers.resize(resource_count);
+	_resources.resize(resource_count, nullptr);
+
+	const u64 heap_size{ graph.heap_size(rt_ds_heap_group) };
+	if (!heap_size) return true;
+
+	u64 alignment{ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT };
+	for (u32 i{ 0 }; i < resource_count; ++i)
+	{
+		const render_graph::resource_info& info{ graph.resource(render_resource_id{ i }) };
+		if (!info.is_transient || !info.is_used) continue;
+		const u64 resource_alignment{ graph.transient_desc(render_resource_id{ i }).alignment };
+		alignment = resource_alignment > alignment ? resource_alignment : alignment;
+	}
+
+	D3D12_HEAP_DESC heap_desc{};
+	heap_desc.SizeInBytes = heap_size;
+	heap_desc.Properties = d3dx::heap_properties.default_heap;
+	heap_desc.Alignment = alignment;
+	heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+
+	auto* const device{ core::device() };
+	assert(device);
+	HRESULT hr{ S_OK };
+	DXCall(hr = device->CreateHeap(&heap_desc, IID_PPV_ARGS(&_heap)));
+	if (FAILED(hr)) return false;
+	NAME_D3D12_OBJECT(_heap, L"Transient Resource Heap");
+
+	for (u32 i{ 0 }; i < resource_count; ++i)
+	{
+		const render_resource_id id{ i };
+		const render_graph::resource_info& info{ graph.resource(id) };
+		if (!info.is_transient || !info.is_used) continue;
+		assert(graph.transient_desc(id).heap_group == rt_ds_heap_group);
+
+		// NOTE: d3d12_depth_buffer changes the format in the description, so use a copy.
+		D3D12_RESOURCE_DESC desc{ descs[i].desc };
+		d3d12_texture_init_info texture_info{};
+		texture_info.heap = _heap;
+		texture_info.desc = &desc;
+		texture_info.allocation_info.Offset = info.offset;
+		texture_info.initial_state = get_resource_states(info.initial_usage);
+		texture_info.clear_value = descs[i].clear_value;
+
+		if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+		{
+			_depth_buffers[i] = d3d12_depth_buffer{ texture_info };
+			_resources[i] = _depth_buffers[i].resource();
+		}
+		else
+		{
+			assert(desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+			_render_textures[i] = d3d12_render_texture{ texture_info };
+			_resources[i] = _render_textures[i].resource();
+		}
+	}
+
+	_layout_hash = hash;
+	return true;
+}
+
+void
+d3d12_transient_resources::release()
+{
+	// The textures are released before the heap, so their deferred releases come first too.
+	_render_textures.clear();
+	_depth_buffers.clear();
+	_resources.clear();
+	core::deferred_release(_heap);
+	_layout_hash = 0;
+}
+
+void
+d3d12_transient_resources::set_imported(render_resource_id id, ID3D12Resource* resource)
+{
+	assert(id < _resources.size() && resource);
+	_resources[id] = resource;
+}
+
+void
+record_barriers(const render_barrier* barriers, u32 count, void* context)
+{
+	assert(barriers && context);
+	const d3d12_render_graph_context& ctx{ *(const d3d12_render_graph_context*)context };
+	assert(ctx.cmd_list && ctx.resources);
+
+	// Barriers are recorded in batches, since one ResourceBarrier() call is cheaper than many.
+	constexpr u32 batch_size{ 32 };
+	D3D12_RESOURCE_BARRIER batch[batch_size]{};
+	ID3D12Resource* discards[batch_size]{};
+	while (count)
+	{
+		const u32 batch_count{ count < batch_size ? count : batch_size };
+		u32 discard_count{ 0 };
+		for (u32 i{ 0 }; i < batch_count; ++i)
+		{
+			const render_barrier& barrier{ barriers[i] };
+			ID3D12Resource* const resource{ ctx.resources->resource(barrier.resource) };
+			assert(resource);
+			D3D12_RESOURCE_BARRIER& d3d12_barrier{ batch[i] };
+			d3d12_barrier = {};
+			d3d12_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+			switch (barrier.type)
+			{
+			case render_barrier::transition:
+				d3d12_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+				d3d12_barrier.Transition.pResource = resource;
+				d3d12_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+				d3d12_barrier.Transition.StateBefore = get_resource_states(barrier.before);
+				d3d12_barrier.Transition.StateAfter = get_resource_states(barrier.after);
+				break;
+			case render_barrier::aliasing:
+				d3d12_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+				d3d12_barrier.Aliasing.pResourceBefore = id::is_valid(barrier.resource_before) ?
+					ctx.resources->resource(barrier.resource_before) : nullptr;
+				d3d12_barrier.Aliasing.pResourceAfter = resource;
+				// The content of an aliased resource is undefined, render targets and depth buffers
+				// have to be cleared or discarded before they're used.
+				if (barrier.after & (resource_usage::render_target | resource_usage::depth_write))
+				{
+					discards[discard_count++] = resource;
+				}
+				break;
+			case render_barrier::uav:
+				d3d12_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+				d3d12_barrier.UAV.pResource = resource;
+				break;
+			}
+		}
+		ctx.cmd_list->ResourceBarrier(batch_count, &batch[0]);
+		for (u32 i{ 0 }; i < discard_count; ++i) ctx.cmd_list->DiscardResource(discards[i], nullptr);
+
+		barriers += batch_count;
+		count -= batch_count;
+	}
+}
+}
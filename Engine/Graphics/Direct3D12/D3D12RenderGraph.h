@@ -0,0 +1,62 @@
+#pragma once
+#include "D3D12CommomHeaders.h"
+#include "D3D12Resources.h"
+#include "Graphics/RenderGraph.h"
+
+// Direct3D12 side of the render graph: transient render targets and depth buffers are
+// placed resources in one heap, at the offsets the graph computed, and the graph's
+// barriers are recorded as resource barriers.
+namespace ferraris::graphics::d3d12 {
+
+// Heap group of transient render targets and depth buffers. Hardware with resource heap
+// tier 1 only allows them in heaps that hold nothing else.
+constexpr u32 rt_ds_heap_group{ 0 };
+
+struct d3d12_transient_texture_desc
+{
+	D3D12_RESOURCE_DESC		desc{};
+	D3D12_CLEAR_VALUE		clear_value{};
+};
+
+D3D12_RESOURCE_STATES get_resource_states(u32 usage);
+// Size and alignment of a transient render target or depth buffer, for render_graph::create().
+transient_resource_desc get_transient_desc(const D3D12_RESOURCE_DESC& desc);
+
+class d3d12_transient_resources
+{
+public:
+	d3d12_transient_resources() = default;
+	DISABLE_COPY_AND_MOVE(d3d12_transient_resources);
+	~d3d12_transient_resources() { assert(!_heap); }
+
+	// Creates the heap and a placed render texture or depth buffer for every transient resource
+	// the compiled graph uses. 'descs' has an entry for every resource of the graph, entries of
+	// imported resources are ignored. Keeps the current resources if the layout didn't change.
+	bool update(const render_graph& graph, const d3d12_transient_texture_desc* const descs);
+	void release();
+
+	// Call after update() for each imported resource, every frame.
+	void set_imported(render_resource_id id, ID3D12Resource* resource);
+
+	[[nodiscard]] ID3D12Resource* const resource(render_resource_id id) const { assert(id < _resources.size()); return _resources[id]; }
+	[[nodiscard]] const d3d12_render_texture& render_texture(render_resource_id id) const { assert(id < _render_textures.size()); return _render_textures[id]; }
+	[[nodiscard]] const d3d12_depth_buffer& depth_buffer(render_resource_id id) const { assert(id < _depth_buffers.size()); return _depth_buffers[id]; }
+
+private:
+	utl::vector<d3d12_render_texture>	_render_textures;		// by resource id, empty for other resources
+	utl::vector<d3d12_depth_buffer>		_depth_buffers;			// by resource id, empty for other resources
+	utl::vector<ID3D12Resource*>		_resources;				// by resource id
+	ID3D12Heap1*						_heap{ nullptr };
+	u64									_layout_hash{ 0 };
+};
+
+// Context of render_graph::execute() for the Direct3D12 backend.
+struct d3d12_render_graph_context
+{
+	id3d12_graphics_command_list*		cmd_list{ nullptr };
+	const d3d12_transient_resources*	resources{ nullptr };
+};
+
+// A render_graph::barrier_function. 'context' is a d3d12_render_graph_context.
+void record_barriers(const render_barrier* barriers, u32 count, void* context);
+}
@@ -8,7 +8,7 @@ bool
 descriptor_heap::initialize(u32 capacity, bool is_shader_visible)
 {
 	std::lock_guard lock{ _mutex };
-	assert(capacity && capacity < D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_2);
+	assert(capacity && capacity <= D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_2);
 	assert(!(_type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER &&
 			capacity > D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE));
 
@@ -33,11 +33,11 @@ descriptor_heap::initialize(u32 capacity, bool is_shader_visible)
 	DXCall(hr = device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&_heap)));
 	if (FAILED(hr)) return false;
 
-	_free_handles = std::move(std::make_unique<u32[]>)(capacity);
+	DEBUG_OP(for (u32 i{ 0 }; i < frame_buffer_count; ++i) assert(_deferred_free_indices.empty(i)));
+	_free_indices.initialize(capacity);
+	_deferred_free_indices.initialize(capacity);
 	_capacity = capacity;
-	_size = 0;
-	for (u32 i{ 0 }; i < capacity; ++i) _free_handles[i] = i;
-	DEBUG_OP(for (u32 i{ 0 }; i < frame_buffer_count; ++i) assert(_deferred_free_indices[i].empty()));
+	_peak.store(0, std::memory_order_relaxed);
 
 	_descriptor_size = device->GetDescriptorHandleIncrementSize(_type);
 	_cpu_start = _heap->GetCPUDescriptorHandleForHeapStart();
@@ -51,7 +51,7 @@ descriptor_heap::initialize(u32 capacity, bool is_shader_visible)
 void
 descriptor_heap::release()
 {
-	assert(!_size);
+	assert(!size());
 	core::deferred_release(_heap);
 }
 
@@ -61,29 +61,25 @@ descriptor_heap::process_deferred_free(u32 frame_idx)
 	std::lock_guard lock{ _mutex };
 	assert(frame_idx < frame_buffer_count);
 
-	// get the index vector for frame
-	utl::vector<u32>& indices{ _deferred_free_indices[frame_idx] };
-	if (!indices.empty())
-	{
-		for (auto index : indices)// add the index to the free handles
-		{
-			--_size;
-			_free_handles[_size] = index;
-		}
-		indices.clear();
-	}
+	// add the indices freed during the frame to the free handles
+	_deferred_free_indices.take_all(frame_idx, [this](u32 index) { _free_indices.free(index); });
 }
 
 descriptor_handle
 descriptor_heap::allocate()
 {
-	std::lock_guard lock{ _mutex };
+	// NOTE: allocating doesn't need the mutex. The free index pool is lock-free,
+	//		 so worker threads can create descriptors concurrently.
 	assert(_heap);
-	assert(_size < _capacity);
+	const u32 index{ _free_indices.allocate() };
+	// The heap is full. Callers get an invalid handle and don't create a view.
+	assert(index == u32_invalid_id || index < _capacity);
+	if (index == u32_invalid_id) return {};
+	const u32 used{ size() };
+	u32 peak{ _peak.load(std::memory_order_relaxed) };
+	while (used > peak && !_peak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
 	// calculate the next free address
-	const u32 index{ _free_handles[_size] };
 	const u32 offset{ index * _descriptor_size };
-	++_size;
 
 	descriptor_handle handle;
 	handle.cpu.ptr = _cpu_start.ptr + offset;
@@ -106,8 +102,9 @@ descriptor_heap::free(descriptor_handle& handle)
 {
 	if (!handle.is_valid()) return;
 
-	std::lock_guard lock{ _mutex };
-	assert(_heap && _size);
+	// NOTE: freeing doesn't need the mutex either. The index is pushed to the frame's
+	//		 list without a lock.
+	assert(_heap && size());
 	assert(handle.container == this);
 	assert(handle.cpu.ptr >= _cpu_start.ptr);
 	assert((handle.cpu.ptr - _cpu_start.ptr) % _descriptor_size == 0);
@@ -117,10 +114,38 @@ descriptor_heap::free(descriptor_handle& handle)
 	
 	// Removing the resource only if the resource is useless.
 	const u32 frame_idx{ core::current_frame_index() };
-	_deferred_free_indices[frame_idx].push_back(index);
+	_deferred_free_indices.push(frame_idx, index);
 	core::set_deferred_release_flag();
 	handle = {};
 }
+
+descriptor_handle
+descriptor_heap::handle(u32 index) const
+{
+	assert(_heap && index < _capacity);
+	const u32 offset{ index * _descriptor_size };
+
+	descriptor_handle handle;
+	handle.cpu.ptr = _cpu_start.ptr + offset;
+	if (is_shader_visible())
+	{
+		handle.gpu.ptr = _gpu_start.ptr + offset;
+	}
+#ifdef _DEBUG
+	handle.container = const_cast<descriptor_heap*>(this);
+	handle.index = index;
+#endif
+	return handle;
+}
+
+descriptor_heap_stats
+descriptor_heap::stats()
+{
+	std::lock_guard lock{ _mutex };
+	u32 deferred_count{ 0 };
+	for (u32 i{ 0 }; i < frame_buffer_count; ++i) deferred_count += _deferred_free_indices.size(i);
+	return { _capacity, size(), _peak.load(std::memory_order_relaxed), deferred_count };
+}
 #pragma endregion
 
 
@@ -160,23 +185,29 @@ d3d12_texture::d3d12_texture(d3d12_texture_init_info info)
 		// ID3D12Device::CreateReservedResource, create a resource that is reserved, and not yes mapped to any pages in a heap.
 		// The third case mainly used when dealing with resource that are beging streamed into gpu memory.
 		assert(!info.resource);
-		// just setting the type of heap
-		DXCall(device->CreateCommittedResource(&d3dx::heap_properties.default_heap, D3D12_HEAP_FLAG_NONE, info.desc,
-			info.initial_state, clear_value, IID_PPV_ARGS(&_resource)));
+		// Placed in a heap of the memory pools, instead of a committed resource with a heap of its own.
+		_resource = gpu_memory::create_resource(*info.desc, info.initial_state, clear_value, _allocation);
 
 	}
 	assert(_resource);
 	_srv = core::srv_heap().allocate();
-	device->CreateShaderResourceView(_resource, info.srv_desc, _srv.cpu);
+	if (_srv.is_valid()) device->CreateShaderResourceView(_resource, info.srv_desc, _srv.cpu);
 
 
 }
 
+u32
+d3d12_texture::srv_index() const
+{
+	return core::srv_heap().index(_srv);
+}
+
 void
 d3d12_texture::release()
 {
 	core::srv_heap().free(_srv);
 	core::deferred_release(_resource);
+	gpu_memory::free(_allocation);
 }
 #pragma endregion
 
@@ -199,7 +230,7 @@ d3d12_render_texture::d3d12_render_texture(d3d12_texture_init_info info)
 	for (u32 i{ 0 }; i < _mip_count; ++i)
 	{
 		_rtv[i] = rtv_heap.allocate();
-		device->CreateRenderTargetView(resource(), &desc, _rtv[i].cpu);
+		if (_rtv[i].is_valid()) device->CreateRenderTargetView(resource(), &desc, _rtv[i].cpu);
 		++desc.Texture2D.MipSlice;
 	}
 }
@@ -254,7 +285,7 @@ d3d12_depth_buffer::d3d12_depth_buffer(d3d12_texture_init_info info)
 
 	auto* const device{ core::device() };
 	assert(device);
-	device->CreateDepthStencilView(resource(), &dsv_desc, _dsv.cpu);
+	if (_dsv.is_valid()) device->CreateDepthStencilView(resource(), &dsv_desc, _dsv.cpu);
 
 }
 void d3d12_depth_buffer::release()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "D3D12CommomHeaders.h"
+#include "D3D12Memory.h"
 
 namespace ferraris::graphics::d3d12 {
 
@@ -22,6 +23,14 @@ private:
 #endif
 };
 
+struct descriptor_heap_stats
+{
+	u32 capacity;
+	u32 size;				// descriptors in use, including those that wait for their frame to complete
+	u32 peak;				// highest size since initialize()
+	u32 deferred_count;		// descriptors that wait for their frame to complete
+};
+
 class descriptor_heap
 {
 public:
@@ -36,12 +45,23 @@ public:
 	[[nodiscard]] descriptor_handle allocate();
 	void free(descriptor_handle& handle);
 
+	// The position of a descriptor in the heap. It doesn't change while the descriptor is
+	// allocated, so shaders can use it to index the heap (see D3D12Bindless.h).
+	constexpr u32 index(const descriptor_handle& handle) const
+	{
+		assert(handle.is_valid() && handle.cpu.ptr >= _cpu_start.ptr);
+		return (u32)((handle.cpu.ptr - _cpu_start.ptr) / _descriptor_size);
+	}
+	// The handle of an allocated descriptor from its index.
+	[[nodiscard]] descriptor_handle handle(u32 index) const;
+	descriptor_heap_stats stats();
+
 	constexpr D3D12_DESCRIPTOR_HEAP_TYPE type() const { return _type; }
 	constexpr D3D12_CPU_DESCRIPTOR_HANDLE cpu_start() const { return _cpu_start; }
 	constexpr D3D12_GPU_DESCRIPTOR_HANDLE gpu_start() const { return _gpu_start; }
 	constexpr ID3D12DescriptorHeap* const heap() const { return _heap; }
 	constexpr u32 capacity() const { return _capacity; }
-	constexpr u32 size() const { return _size; }
+	u32 size() const { return _free_indices.size(); }
 	constexpr u32 descriptor_size() const { return _descriptor_size; }
 	constexpr bool is_shader_visible() const { return _gpu_start.ptr != 0; }
 
@@ -49,11 +69,11 @@ private:
 	ID3D12DescriptorHeap*					_heap;
 	D3D12_CPU_DESCRIPTOR_HANDLE				_cpu_start{};
 	D3D12_GPU_DESCRIPTOR_HANDLE				_gpu_start{};
-	std::unique_ptr<u32[]>					_free_handles{};
-	utl::vector<u32>						_deferred_free_indices[frame_buffer_count]{};
+	utl::concurrent_index_pool				_free_indices{};
+	utl::concurrent_index_lists<frame_buffer_count>	_deferred_free_indices{};
 	std::mutex								_mutex{};
+	std::atomic<u32>						_peak{ 0 };
 	u32										_capacity{ 0 };
-	u32										_size{ 0 }; 
 	u32										_descriptor_size{};
 	const D3D12_DESCRIPTOR_HEAP_TYPE		_type{};
 };
@@ -77,7 +97,7 @@ public:
 	DISABLE_COPY(d3d12_texture);
 
 	constexpr d3d12_texture(d3d12_texture&& o) noexcept
-		: _resource{ o._resource }, _srv{ o._srv }
+		: _resource{ o._resource }, _srv{ o._srv }, _allocation{ o._allocation }
 	{
 		o.reset();
 	}
@@ -95,20 +115,25 @@ public:
 	void release();
 	constexpr ID3D12Resource* const resource() const { return _resource; }
 	constexpr descriptor_handle srv() const { return _srv; }
+	// Where shaders find the texture in the bindless table.
+	u32 srv_index() const;
 private:
 	constexpr void move(d3d12_texture& o)
 	{
 		_resource = o._resource;
 		_srv = o._srv;
+		_allocation = o._allocation;
 		o.reset();
 	}
 	constexpr void reset()
 	{
 		_resource = nullptr;
 		_srv = {};
+		_allocation = {};
 	}
 	ID3D12Resource*		_resource{ nullptr }; // upload or create the actual texture
 	descriptor_handle	_srv; // point to the shader resource view for this texture
+	gpu_memory::gpu_allocation	_allocation; // if the texture is placed in the memory pools
 
 };
 
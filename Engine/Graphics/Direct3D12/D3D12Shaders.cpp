@@ -1,49 +1,38 @@
 #include "D3D12Shaders.h"
 #include "Content\ContentLoader.h"
+#include "Content\ShaderFormat.h"
+#include "Content\ShaderLibrary.h"
 
 namespace ferraris::graphics::d3d12::shaders {
 
 namespace {
 
-typedef struct compiled_shader
+// Names of the engine shaders in the shader library, which are the names of their entry functions.
+constexpr u64 engine_shader_keys[]
 {
-	u64				size;
-	const u8*		byte_code;
-}const *compiled_shader_ptr;
+	content::shader_format::shader_key("FullScreenTriangleVS"),
+	content::shader_format::shader_key("FillColorPS"),
+};
+static_assert(_countof(engine_shader_keys) == engine_shader::count);
 
-// Each element in this array points to an offset withing the shaders blob.
-compiled_shader_ptr engine_shaders[engine_shader::count]{};
-
-// This is a chunk of memory that contains all complied  engine shaders.
-// The blob is array of shader byte code consisting of u64 size and
-// an array of bytes.
-std::unique_ptr<u8[]> shaders_blob{};
+// All compiled engine shaders. The library is mapped into memory and
+// the byte code is used in place.
+content::shader_library engine_shaders{};
 
 bool
 load_engine_shaders()
 {
-	assert(!shaders_blob);
-	u64 size{ 0 };
-	bool result{ content::load_engine_shaders(shaders_blob, size) };
-	assert(shaders_blob && size);
-	
-	u64 offset{ 0 };
-	u32 index{ 0 };
+	assert(!engine_shaders.is_open());
+	if (!content::load_engine_shaders(engine_shaders)) return false;
 
-	while (offset < size && result)
+	// Only check that every engine shader is there, the byte code isn't touched until it's used.
+	bool result{ true };
+	for (u32 i{ 0 }; i < engine_shader::count; ++i)
 	{
-		assert(index < engine_shader::count);
-		compiled_shader_ptr& shader{ engine_shaders[index] };
-		assert(!shader);
-		result &= index < engine_shader::count && !shader;
-		if (!result) break;
-		shader = reinterpret_cast<const compiled_shader_ptr>(&shaders_blob[offset]);
-		offset += sizeof(u64) + shader->size;
-		++index;
+		result &= engine_shaders.find(engine_shader_keys[i]).size != 0;
 	}
-	assert(offset == size && index == engine_shader::count);
-
-	return true;
+	assert(result);
+	return result;
 }
 } // anonymous namespace
 
@@ -56,19 +45,15 @@ initialize()
 void
 shutdown()
 {
-	for (u32 i{ 0 }; i < engine_shader::count; ++i)
-	{
-		engine_shaders[i] = {};
-	}
-	shaders_blob.reset();
+	engine_shaders.close();
 }
 
 D3D12_SHADER_BYTECODE
 get_engine_shader(engine_shader::id id)
 {
 	assert(id < engine_shader::count);
-	const compiled_shader_ptr shader{ engine_shaders[id] };
-	assert(shader && shader->size);
-	return { &shader->byte_code, shader->size };
+	const content::shader_bytecode shader{ engine_shaders.find(engine_shader_keys[id]) };
+	assert(shader.byte_code && shader.size);
+	return { shader.byte_code, shader.size };
 }
 }
\ No newline at end of file
@@ -13,14 +13,15 @@ to_non_srgb(DXGI_FORMAT format)
 
 } // anonymous namespace
 void
-d3d12_surface::create_swap_chain(IDXGIFactory7 * factory, ID3D12CommandQueue * cmd_queue, DXGI_FORMAT format)
+d3d12_surface::create_swap_chain(IDXGIFactory7 * factory, ID3D12CommandQueue * cmd_queue, u32 max_frame_latency, DXGI_FORMAT format)
 {
-	assert(factory && cmd_queue);
+	assert(factory && cmd_queue && max_frame_latency);
 	release();
 
-	if (SUCCEEDED(factory->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &_allow_tearing, sizeof(u32))) && _allow_tearing)
+	// NOTE: whether to tear is up to set_present_mode(), but the swap chain must allow it from the start.
+	if (FAILED(factory->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &_allow_tearing, sizeof(u32))))
 	{
-		_present_flags = DXGI_PRESENT_ALLOW_TEARING;
+		_allow_tearing = 0;
 	}
 
 	_format = format;
@@ -28,7 +29,7 @@ d3d12_surface::create_swap_chain(IDXGIFactory7 * factory, ID3D12CommandQueue * c
 	desc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
 	desc.BufferCount = buffer_count;
 	desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	desc.Flags = _allow_tearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+	desc.Flags = (_allow_tearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0) | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 	desc.Format = to_non_srgb(format);
 	desc.Height = _window.height();
 	desc.Width = _window.width();
@@ -45,6 +46,12 @@ d3d12_surface::create_swap_chain(IDXGIFactory7 * factory, ID3D12CommandQueue * c
 	DXCall(swap_chain->QueryInterface(IID_PPV_ARGS(&_swap_chain)));
 	core::release(swap_chain);
 
+	// With a waitable object the frame latency is set on the swap chain instead of the device.
+	// The object is signaled while fewer frames than that are queued for the display.
+	DXCall(_swap_chain->SetMaximumFrameLatency(max_frame_latency));
+	_frame_latency_waitable = _swap_chain->GetFrameLatencyWaitableObject();
+	_max_frame_latency = max_frame_latency;
+
 	_current_bb_index = _swap_chain->GetCurrentBackBufferIndex();
 
 	for (u32 i{ 0 }; i < buffer_count; ++i)
@@ -66,7 +73,7 @@ d3d12_surface::finalize()
 		D3D12_RENDER_TARGET_VIEW_DESC desc{};
 		desc.Format = _format;
 		desc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
-		core::device()->CreateRenderTargetView(data.resource, &desc, data.rtv.cpu);
+		if (data.rtv.is_valid()) core::device()->CreateRenderTargetView(data.resource, &desc, data.rtv.cpu);
 	}
 
 	DXGI_SWAP_CHAIN_DESC desc{};
@@ -87,11 +94,28 @@ d3d12_surface::finalize()
 
 }
 
+void
+d3d12_surface::wait_for_display() const
+{
+	assert(_frame_latency_waitable);
+	// Don't hang if the window is hidden and nothing gets presented.
+	WaitForSingleObjectEx(_frame_latency_waitable, 1000, true);
+}
+
+void
+d3d12_surface::set_present_mode(present_mode::type mode)
+{
+	assert(mode < present_mode::count);
+	// Tearing is only allowed with a sync interval of 0.
+	_sync_interval = mode == present_mode::vsync ? 1 : 0;
+	_present_flags = mode == present_mode::immediate && _allow_tearing ? DXGI_PRESENT_ALLOW_TEARING : 0;
+}
+
 void
 d3d12_surface::present() const
 {
 	assert(_swap_chain);
-	DXCall(_swap_chain->Present(0, _present_flags));
+	DXCall(_swap_chain->Present(_sync_interval, _present_flags));
 	_current_bb_index = _swap_chain->GetCurrentBackBufferIndex();
 }
 
@@ -106,6 +130,11 @@ d3d12_surface::release()
 		core::rtv_heap().free(data.rtv);
 	}
 
+	if (_frame_latency_waitable)
+	{
+		CloseHandle(_frame_latency_waitable);
+		_frame_latency_waitable = nullptr;
+	}
 	core::release(_swap_chain);
 }
 
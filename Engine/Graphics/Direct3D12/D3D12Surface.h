@@ -19,7 +19,8 @@ public:
 	constexpr d3d12_surface(d3d12_surface&& o) noexcept
 		: _swap_chain{ o._swap_chain }, _window{ o._window }, _current_bb_index{ o._current_bb_index },
 		_viewport{ o._viewport }, _scissor_rect{ o._scissor_rect }, _allow_tearing{ o._allow_tearing },
-		_present_flags{ o._present_flags }
+		_present_flags{ o._present_flags }, _sync_interval{ o._sync_interval },
+		_max_frame_latency{ o._max_frame_latency }, _frame_latency_waitable{ o._frame_latency_waitable }
 	{
 		for (u32 i{ 0 }; i < buffer_count; ++i)
 		{
@@ -44,7 +45,13 @@ public:
 
 	~d3d12_surface() { release(); }
 
-	void create_swap_chain(IDXGIFactory7* factory, ID3D12CommandQueue* cmd_queue, DXGI_FORMAT format = default_back_buffer_format);
+	void create_swap_chain(IDXGIFactory7* factory, ID3D12CommandQueue* cmd_queue, u32 max_frame_latency,
+						   DXGI_FORMAT format = default_back_buffer_format);
+	// Blocks until the swap chain has fewer than max_frame_latency frames queued for the display.
+	// Call it before the frame starts, so the CPU doesn't sample input for a frame that would
+	// only wait in the queue.
+	void wait_for_display() const;
+	void set_present_mode(present_mode::type mode);
 	void present() const;
 	void resize();
 
@@ -54,6 +61,8 @@ public:
 	constexpr D3D12_CPU_DESCRIPTOR_HANDLE rtv() const { return _render_target_data[_current_bb_index].rtv.cpu; }
 	constexpr const D3D12_VIEWPORT& viewport() const { return _viewport; }
 	constexpr const D3D12_RECT& scissor_rect() const { return _scissor_rect; }
+	constexpr DXGI_FORMAT format() const { return _format; }
+	constexpr u32 max_frame_latency() const { return _max_frame_latency; }
 
 private:
 	void finalize();
@@ -70,6 +79,9 @@ private:
 		_current_bb_index = o._current_bb_index;
 		_allow_tearing = o._allow_tearing;
 		_present_flags = o._present_flags;
+		_sync_interval = o._sync_interval;
+		_max_frame_latency = o._max_frame_latency;
+		_frame_latency_waitable = o._frame_latency_waitable;
 		_viewport = o._viewport;
 		_scissor_rect = o._scissor_rect;
 		
@@ -87,6 +99,9 @@ private:
 		_current_bb_index = 0;
 		_allow_tearing = 0;
 		_present_flags = 0;
+		_sync_interval = 1;
+		_max_frame_latency = 0;
+		_frame_latency_waitable = nullptr;
 		_viewport = {};
 		_scissor_rect = {};
 	}
@@ -105,6 +120,9 @@ private:
 	mutable u32				_current_bb_index{ 0 }; // current back-buffer index
 	u32						_allow_tearing{ 0 };
 	u32						_present_flags{ 0 };
+	u32						_sync_interval{ 1 };	// 0 presents right away, 1 on the next vertical blank
+	u32						_max_frame_latency{ 0 };
+	HANDLE					_frame_latency_waitable{ nullptr };
 	D3D12_VIEWPORT			_viewport{};
 	D3D12_RECT				_scissor_rect{};
 };
@@ -0,0 +1,310 @@
+#include "D3D12Upload.h"
+#include "D3D12Core.h"
+#include "Graphics/UploadRing.h"
+
+namespace ferraris::graphics::d3d12::upload {
+namespace {
+
+// Streaming content at a few hundred MB per second fills this several times per second, which
+// leaves the copy queue enough time to finish a batch before its memory is needed again.
+constexpr u64 ring_capacity{ 64 * 1024 * 1024 };
+// Larger uploads get their own buffer, so they don't make everyone else wait for the ring.
+constexpr u64 staging_threshold{ ring_capacity / 4 };
+constexpr u32 batch_count{ 4 };
+
+struct upload_batch
+{
+	ID3D12CommandAllocator*			cmd_allocator{ nullptr };
+	id3d12_graphics_command_list*	cmd_list{ nullptr };
+	u64								fence_value{ 0 };
+};
+
+struct staging_buffer
+{
+	ID3D12Resource*		buffer;
+	u64					fence_value;		// 0 until the batch that copies from it is submitted
+};
+
+std::mutex						upload_mutex{};
+upload_ring						ring;
+ID3D12Resource*					ring_buffer{ nullptr };
+u8*								ring_cpu_address{ nullptr };
+upload_batch					batches[batch_count]{};
+u32								current_batch{ 0 };
+bool							is_recording{ false };
+utl::vector<staging_buffer>		staging_buffers;
+utl::vector<u8>					footprint_scratch;
+sync_point						last_batch{ 0, queue_type::copy };
+upload_stats					stats{};
+
+ID3D12Resource*
+create_upload_buffer(u64 size)
+{
+	D3D12_RESOURCE_DESC desc{};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	desc.Alignment = 0;
+	desc.Width = size;
+	desc.Height = 1;
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = 1;
+	desc.Format = DXGI_FORMAT_UNKNOWN;
+	desc.SampleDesc = { 1, 0 };
+	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	ID3D12Resource* buffer{ nullptr };
+	DXCall(core::device()->CreateCommittedResource(&d3dx::heap_properties.upload_heap, D3D12_HEAP_FLAG_NONE, &desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer)));
+	return buffer;
+}
+
+// Upload buffers stay mapped until they're released.
+u8*
+map(ID3D12Resource* buffer)
+{
+	// The CPU never reads from upload buffers.
+	const D3D12_RANGE range{};
+	void* cpu_address{ nullptr };
+	DXCall(buffer->Map(0, &range, &cpu_address));
+	return (u8*)cpu_address;
+}
+
+// Frees the ring memory and the staging buffers of batches the copy queue has finished.
+void
+retire()
+{
+	for (u64 value{ ring.oldest_fence_value() }; value && core::is_complete({ value, queue_type::copy }); value = ring.oldest_fence_value())
+	{
+		ring.retire(value);
+	}
+
+	for (u32 i{ 0 }; i < staging_buffers.size();)
+	{
+		staging_buffer& staging{ staging_buffers[i] };
+		if (staging.fence_value && core::is_complete({ staging.fence_value, queue_type::copy }))
+		{
+			core::release(staging.buffer);
+			staging_buffers.erase_unordered(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+// The command list of the current batch, open for recording.
+id3d12_graphics_command_list*
+command_list()
+{
+	upload_batch& batch{ batches[current_batch] };
+	if (!is_recording)
+	{
+		// The allocator can only be reset once the copy queue has finished the batch that used it before.
+		core::wait_on_cpu({ batch.fence_value, queue_type::copy });
+		DXCall(batch.cmd_allocator->Reset());
+		DXCall(batch.cmd_list->Reset(batch.cmd_allocator, nullptr));
+		is_recording = true;
+	}
+	return batch.cmd_list;
+}
+
+sync_point
+submit()
+{
+	if (!is_recording) return last_batch;
+	upload_batch& batch{ batches[current_batch] };
+	DXCall(batch.cmd_list->Close());
+	ID3D12CommandList* const cmd_lists[]{ batch.cmd_list };
+	core::command_queue(queue_type::copy)->ExecuteCommandLists(_countof(cmd_lists), &cmd_lists[0]);
+	last_batch = core::signal(queue_type::copy);
+
+	batch.fence_value = last_batch.value;
+	ring.submit(last_batch.value);
+	for (u32 i{ 0 }; i < staging_buffers.size(); ++i)
+	{
+		if (!staging_buffers[i].fence_value) staging_buffers[i].fence_value = last_batch.value;
+	}
+
+	current_batch = (current_batch + 1) % batch_count;
+	is_recording = false;
+	++stats.batches;
+	return last_batch;
+}
+
+// Returns where to write 'size' bytes, and the buffer and offset to copy them from.
+u8*
+allocate(u64 size, u64 alignment, ID3D12Resource*& buffer, u64& offset)
+{
+	if (size > staging_threshold)
+	{
+		memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+		buffer = create_upload_buffer(size);
+		if (!buffer) return nullptr;
+		NAME_D3D12_OBJECT(buffer, L"Upload Staging Buffer");
+		staging_buffers.emplace_back(staging_buffer{ buffer, 0 });
+		++stats.staging_buffers;
+		offset = 0;
+		return map(buffer);
+	}
+
+	retire();
+	offset = ring.allocate(size, alignment);
+	while (offset == upload_ring::invalid_offset)
+	{
+		// The ring is full. Submit what was recorded, so that its memory can be freed too,
+		// and wait for the oldest batch.
+		submit();
+		assert(ring.oldest_fence_value());
+		++stats.stalls;
+		core::wait_on_cpu({ ring.oldest_fence_value(), queue_type::copy });
+		retire();
+		offset = ring.allocate(size, alignment);
+	}
+	buffer = ring_buffer;
+	return ring_cpu_address + offset;
+}
+
+bool
+failed_init()
+{
+	shutdown();
+	return false;
+}
+} // anonymous namespace
+
+bool
+initialize()
+{
+	auto* const device{ core::device() };
+	assert(device && !ring_buffer);
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	HRESULT hr{ S_OK };
+
+	for (u32 i{ 0 }; i < batch_count; ++i)
+	{
+		upload_batch& batch{ batches[i] };
+		DXCall(hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&batch.cmd_allocator)));
+		if (FAILED(hr)) return failed_init();
+		DXCall(hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, batch.cmd_allocator, nullptr, IID_PPV_ARGS(&batch.cmd_list)));
+		if (FAILED(hr)) return failed_init();
+		DXCall(batch.cmd_list->Close());
+		NAME_D3D12_OBJECT_INDEX(batch.cmd_allocator, i, L"Upload Command Allocator");
+		NAME_D3D12_OBJECT_INDEX(batch.cmd_list, i, L"Upload Command List");
+	}
+
+	ring_buffer = create_upload_buffer(ring_capacity);
+	if (!ring_buffer) return failed_init();
+	NAME_D3D12_OBJECT(ring_buffer, L"Upload Ring Buffer");
+	ring_cpu_address = map(ring_buffer);
+	ring.initialize(ring_capacity);
+
+	current_batch = 0;
+	is_recording = false;
+	last_batch = { 0, queue_type::copy };
+	stats = {};
+	return true;
+}
+
+void
+shutdown()
+{
+	std::lock_guard lock{ upload_mutex };
+	submit();
+	if (last_batch.is_valid()) core::wait_on_cpu(last_batch);
+	retire();
+	assert(staging_buffers.empty());
+
+	for (u32 i{ 0 }; i < batch_count; ++i)
+	{
+		core::release(batches[i].cmd_list);
+		core::release(batches[i].cmd_allocator);
+		batches[i].fence_value = 0;
+	}
+	core::release(ring_buffer);
+	ring_cpu_address = nullptr;
+}
+
+void
+upload_buffer(ID3D12Resource* destination, u64 offset, const void* data, u64 size)
+{
+	assert(destination && data && size);
+	std::lock_guard lock{ upload_mutex };
+	ID3D12Resource* source{ nullptr };
+	u64 source_offset{ 0 };
+	u8* const cpu_address{ allocate(size, 16, source, source_offset) };
+	if (!cpu_address) return;
+
+	memcpy(cpu_address, data, size);
+	command_list()->CopyBufferRegion(destination, offset, source, source_offset, size);
+	stats.bytes += size;
+}
+
+void
+upload_texture(ID3D12Resource* destination, u32 first_subresource, u32 subresource_count, const D3D12_SUBRESOURCE_DATA* data)
+{
+	assert(destination && data && subresource_count);
+	const D3D12_RESOURCE_DESC desc{ destination->GetDesc() };
+	std::lock_guard lock{ upload_mutex };
+
+	// Layouts, row sizes and row counts of the subresources in upload memory.
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	footprint_scratch.resize((sizeof(D3D12_PLACED_SUBRESOURCE_FOOTPRINT) + sizeof(u64) + sizeof(u32)) * subresource_count);
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT* const layouts{ (D3D12_PLACED_SUBRESOURCE_FOOTPRINT*)footprint_scratch.data() };
+	u64* const row_sizes{ (u64*)(layouts + subresource_count) };
+	u32* const row_counts{ (u32*)(row_sizes + subresource_count) };
+	u64 total_size{ 0 };
+	core::device()->GetCopyableFootprints(&desc, first_subresource, subresource_count, 0, layouts, row_counts, row_sizes, &total_size);
+
+	ID3D12Resource* source{ nullptr };
+	u64 source_offset{ 0 };
+	u8* const cpu_address{ allocate(total_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, source, source_offset) };
+	if (!cpu_address) return;
+
+	id3d12_graphics_command_list* const cmd_list{ command_list() };
+	for (u32 i{ 0 }; i < subresource_count; ++i)
+	{
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout{ layouts[i] };
+		const D3D12_SUBRESOURCE_DATA& subresource{ data[i] };
+		const u64 row_pitch{ layout.Footprint.RowPitch };
+		const u64 slice_size{ row_pitch * row_counts[i] };
+		u8* const dst{ cpu_address + layout.Offset };
+		for (u32 z{ 0 }; z < layout.Footprint.Depth; ++z)
+		{
+			for (u32 row{ 0 }; row < row_counts[i]; ++row)
+			{
+				memcpy(dst + slice_size * z + row_pitch * row,
+					(const u8*)subresource.pData + subresource.SlicePitch * z + subresource.RowPitch * row, row_sizes[i]);
+			}
+		}
+
+		D3D12_TEXTURE_COPY_LOCATION dst_location{};
+		dst_location.pResource = destination;
+		dst_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		dst_location.SubresourceIndex = first_subresource + i;
+
+		D3D12_TEXTURE_COPY_LOCATION src_location{};
+		src_location.pResource = source;
+		src_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		src_location.PlacedFootprint = layout;
+		src_location.PlacedFootprint.Offset += source_offset;
+
+		cmd_list->CopyTextureRegion(&dst_location, 0, 0, 0, &src_location, nullptr);
+	}
+	stats.bytes += total_size;
+}
+
+sync_point
+flush()
+{
+	std::lock_guard lock{ upload_mutex };
+	return submit();
+}
+
+upload_stats
+get_stats()
+{
+	std::lock_guard lock{ upload_mutex };
+	return stats;
+}
+}
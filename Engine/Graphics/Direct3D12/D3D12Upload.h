@@ -0,0 +1,37 @@
+#pragma once
+#include "D3D12CommomHeaders.h"
+#include "Graphics/QueueTimeline.h"
+
+// Copies data into GPU resources on the copy queue. The data is written into a persistently
+// mapped upload buffer that's sub-allocated as a ring (see UploadRing.h). Copies are recorded
+// into one command list until the batch is flushed, so many small uploads cost one submission.
+// Data that's too large for the ring gets its own upload buffer, which is released when the
+// copy has finished.
+//
+// Destination resources must be in D3D12_RESOURCE_STATE_COMMON: the copy queue can't transition
+// to other states. They decay back to COMMON after the copy, and the graphics queue promotes them
+// to the state it needs when it first uses them, after waiting for the sync point of the batch.
+// All functions are thread-safe.
+namespace ferraris::graphics::d3d12::upload {
+
+struct upload_stats
+{
+	u64 bytes;					// copied since initialize()
+	u64 batches;				// submitted to the copy queue
+	u64 staging_buffers;		// uploads that were too large for the ring
+	u64 stalls;					// times the ring was full and the CPU waited for the copy queue
+};
+
+bool initialize();
+void shutdown();
+
+// Copies 'size' bytes from 'data' to 'destination', starting at 'offset'.
+void upload_buffer(ID3D12Resource* destination, u64 offset, const void* data, u64 size);
+// Copies subresources, in the layout of D3D12_SUBRESOURCE_DATA, like UpdateSubresources() of d3dx12.h.
+void upload_texture(ID3D12Resource* destination, u32 first_subresource, u32 subresource_count, const D3D12_SUBRESOURCE_DATA* data);
+
+// Submits the copies recorded so far. Work that waits for the returned sync point sees the data.
+// Returns the sync point of the last batch if nothing was recorded since.
+sync_point flush();
+upload_stats get_stats();
+}
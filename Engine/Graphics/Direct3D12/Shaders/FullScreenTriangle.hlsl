@@ -1,7 +1,7 @@
 struct VSOutput
 {
 	noperspective float4 Position : SV_Position;
-	noperspective float2 UV : TEXTCOORD;
+	noperspective float2 UV : TEXCOORD;
 
 };
 
@@ -10,8 +10,10 @@ VSOutput FullScreenTriangleVS(in uint VertexIdx : SV_VertexID)
 {
 	VSOutput output;
 
-	// TODO: write fullscreen triangle code.
-	output.Position = float4(0, 0, 0, 1);
+	// One triangle that covers the screen: (-1, 1), (3, 1) and (-1, -3), with UVs 0 to 2.
+	const float2 uv = float2((VertexIdx << 1) & 2, VertexIdx & 2);
+	output.Position = float4(uv * float2(2.f, -2.f) + float2(-1.f, 1.f), 0.f, 1.f);
+	output.UV = uv;
 
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include "CommonHeaders.h"
+#include "Renderer.h"
+#include <chrono>
+
+namespace ferraris::graphics {
+
+/**
+* Measures the frame times of frame_timing_stats. The times are averaged over the last 'history'
+* frames, so that one slow frame doesn't make them jump around, while a change of frame pacing
+* still shows up within a second.
+*
+* The backend calls begin_frame() at the start of every frame, and begin_wait() and end_wait()
+* around every wait for the GPU or the display. GPU times arrive a few frames late, once the GPU
+* has finished the frame, so they're kept apart from the CPU times.
+* It's not thread-safe: it's only used by the thread that renders.
+*/
+class frame_timer
+{
+public:
+	constexpr static u32 history{ 64 };
+
+	frame_timer() = default;
+	DISABLE_COPY_AND_MOVE(frame_timer);
+
+	void begin_frame()
+	{
+		const clock::time_point now{ clock::now() };
+		if (_is_running)
+		{
+			// Finish the previous frame.
+			const u32 i{ (u32)(_frame_count % history) };
+			_cpu_times[i] = milliseconds(now - _frame_start);
+			_wait_times[i] = _wait;
+			++_frame_count;
+		}
+		_frame_start = now;
+		_wait = 0.f;
+		_is_running = true;
+	}
+
+	void begin_wait() { _wait_start = clock::now(); }
+	void end_wait() { _wait += milliseconds(clock::now() - _wait_start); }
+
+	void add_gpu_frame_time(f32 ms)
+	{
+		_gpu_times[_gpu_count % history] = ms;
+		++_gpu_count;
+	}
+
+	[[nodiscard]] frame_timing_stats stats() const
+	{
+		frame_timing_stats stats{ _frame_count, 0.f, 0.f, 0.f, 0.f };
+		const u32 count{ _frame_count < history ? (u32)_frame_count : history };
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			stats.cpu_frame_time += _cpu_times[i];
+			stats.cpu_wait_time += _wait_times[i];
+			stats.max_cpu_frame_time = _cpu_times[i] > stats.max_cpu_frame_time ? _cpu_times[i] : stats.max_cpu_frame_time;
+		}
+		if (count)
+		{
+			stats.cpu_frame_time /= (f32)count;
+			stats.cpu_wait_time /= (f32)count;
+		}
+
+		const u32 gpu_count{ _gpu_count < history ? (u32)_gpu_count : history };
+		for (u32 i{ 0 }; i < gpu_count; ++i) stats.gpu_frame_time += _gpu_times[i];
+		if (gpu_count) stats.gpu_frame_time /= (f32)gpu_count;
+		return stats;
+	}
+
+	// The next frame starts the measurement over, e.g. after the frame pacing has changed.
+	void reset()
+	{
+		_frame_count = 0;
+		_gpu_count = 0;
+		_wait = 0.f;
+		_is_running = false;
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	static f32 milliseconds(clock::duration d) { return std::chrono::duration<f32, std::milli>(d).count(); }
+
+	f32					_cpu_times[history]{};
+	f32					_wait_times[history]{};
+	f32					_gpu_times[history]{};
+	u64					_frame_count{ 0 };
+	u64					_gpu_count{ 0 };
+	clock::time_point	_frame_start{};
+	clock::time_point	_wait_start{};
+	f32					_wait{ 0.f };			// during the current frame
+	bool				_is_running{ false };
+};
+}
@@ -9,6 +9,9 @@ struct platform_interface
 {
 	bool (*initialize)(void);
 	void (*shutdown)(void);
+	void (*wait_for_display)(void);
+	void (*begin_frame)(void);
+	void (*end_frame)(void);
 	
 	// anonymous struct
 	struct {
@@ -20,6 +23,12 @@ struct platform_interface
 		void (*render)(surface_id);
 	} surface;
 
+	struct {
+		void (*set)(const frame_pacing&);
+		frame_pacing (*get)(void);
+		frame_timing_stats (*stats)(void);
+	} pacing;
+
 	graphics_platform platform;
 };
 }
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+#include "CommonHeaders.h"
+#include "Graphics/Renderer.h"
+
+namespace ferraris::graphics::null {
+// Same as the Direct3D12 backend, so the CPU side of a frame behaves the same way.
+constexpr u32 frame_buffer_count{ max_frames_in_flight };
+}
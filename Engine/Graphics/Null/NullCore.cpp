@@ -0,0 +1,444 @@
+#include "NullCore.h"
+#include "NullResources.h"
+#include "Core/FrameAllocator.h"
+#include "Graphics/FrameTimer.h"
+
+namespace ferraris::graphics::null::core {
+namespace {
+
+// The per-frame scratch arenas are reset when the fence of their frame has completed.
+static_assert(memory::frame_arena_count == frame_buffer_count);
+
+// Stands in for the command queue and its fence.
+class null_command
+{
+public:
+	null_command() = default;
+	DISABLE_COPY_AND_MOVE(null_command);
+
+	void initialize() { _contexts.initialize(_context_backend); }
+
+	// Wait for the frame that was submitted 'frames in flight' frames ago, like d3d12_command::begin_frame().
+	void begin_frame(frame_timer& timer)
+	{
+		const u32 oldest{ (_frame_index + frame_buffer_count - _frames_in_flight) % frame_buffer_count };
+		timer.begin_wait();
+		wait(_frame_fence_values[oldest]);
+		timer.end_wait();
+		_contexts.begin_frame(_frame_index);
+	}
+
+	// Submits the frame's command list and the closed contexts, like d3d12_command::end_frame().
+	void end_frame()
+	{
+		null_command_list* lists[null_command_context_pool::max_lists];
+		const u32 count{ _contexts.collect(&lists[0], null_command_context_pool::max_lists) };
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			assert(!lists[i]->is_open);
+			_submitted_commands += lists[i]->command_count;
+		}
+		_submitted_lists += 1 + count;
+
+		++_fence_value;
+		_frame_fence_values[_frame_index] = _fence_value;
+		_frame_index = (_frame_index + 1) % frame_buffer_count;
+		++_frame_count;
+	}
+
+	void flush()
+	{
+		for (u32 i{ 0 }; i < frame_buffer_count; ++i)
+		{
+			wait(_frame_fence_values[i]);
+		}
+		// NOTE: like d3d12_command::flush(), this keeps the frame index, because a frame may be open.
+	}
+
+	void release()
+	{
+		flush();
+		_fence_value = 0;
+		_completed_fence_value = 0;
+		_fence_waits = 0;
+		_frame_count = 0;
+		_submitted_lists = 0;
+		_submitted_commands = 0;
+		for (u32 i{ 0 }; i < frame_buffer_count; ++i) _frame_fence_values[i] = 0;
+		_contexts.release();
+	}
+
+	constexpr u32 frame_index() const { return _frame_index; }
+	void set_frames_in_flight(u32 count)
+	{
+		assert(count && count <= frame_buffer_count);
+		_frames_in_flight = count;
+	}
+	constexpr u64 fence_value() const { return _fence_value; }
+	constexpr u64 completed_fence_value() const { return _completed_fence_value; }
+	constexpr u64 fence_waits() const { return _fence_waits; }
+	constexpr u64 frame_count() const { return _frame_count; }
+	constexpr u64 submitted_lists() const { return _submitted_lists; }
+	constexpr u64 submitted_commands() const { return _submitted_commands; }
+	null_command_context_pool& contexts() { return _contexts; }
+
+private:
+	void wait(u64 value)
+	{
+		// The emulated GPU completes the frame right when it's waited for.
+		if (_completed_fence_value < value)
+		{
+			_completed_fence_value = value;
+			++_fence_waits;
+		}
+	}
+
+	u64		_frame_fence_values[frame_buffer_count]{};
+	u64		_fence_value{ 0 };
+	u64		_completed_fence_value{ 0 };
+	u64		_fence_waits{ 0 };
+	u64		_frame_count{ 0 };
+	u64		_submitted_lists{ 0 };
+	u64		_submitted_commands{ 0 };
+	u32		_frame_index{ 0 };
+	u32		_frames_in_flight{ frame_buffer_count };
+
+	null_command_backend		_context_backend{};
+	null_command_context_pool	_contexts{};
+};
+
+class null_surface
+{
+public:
+	constexpr static u32 buffer_count{ 3 };
+	// Used for surfaces without a window, e.g. on a server.
+	constexpr static u32 default_width{ 1920 };
+	constexpr static u32 default_height{ 1080 };
+
+	explicit null_surface(platform::window window)
+		: _window{ window }
+	{
+		if (_window.is_valid())
+		{
+			_width = _window.width();
+			_height = _window.height();
+		}
+		create_buffers();
+	}
+	DISABLE_COPY_AND_MOVE(null_surface);
+	~null_surface() { release(); }
+
+	void resize(u32 width, u32 height)
+	{
+		release();
+		_width = width;
+		_height = height;
+		create_buffers();
+	}
+
+	// Back buffers are used in turn, like a flip model swap chain.
+	void present() { _current_bb_index = (_current_bb_index + 1) % buffer_count; }
+
+	constexpr u32 width() const { return _width; }
+	constexpr u32 height() const { return _height; }
+
+private:
+	void create_buffers()
+	{
+		for (u32 i{ 0 }; i < buffer_count; ++i)
+		{
+			_rtv[i] = rtv_heap().allocate();
+		}
+		_current_bb_index = 0;
+	}
+
+	void release()
+	{
+		for (u32 i{ 0 }; i < buffer_count; ++i)
+		{
+			rtv_heap().free(_rtv[i]);
+		}
+	}
+
+	descriptor_handle	_rtv[buffer_count]{};
+	platform::window	_window{};
+	u32					_width{ default_width };
+	u32					_height{ default_height };
+	u32					_current_bb_index{ 0 };
+};
+
+// null_surface can't be moved, because it frees its descriptors when it's destroyed.
+using surface_collection = utl::free_list<std::unique_ptr<null_surface>>;
+
+null_command					gfx_command;
+surface_collection				surfaces;
+frame_pacing					pacing{ frame_pacing_preset::balanced };
+frame_timer						timer;
+// Surfaces rendered in the open frame, which are presented when it ends.
+utl::vector<surface_id>			frame_surfaces;
+bool							is_frame_open{ false };
+bool							is_display_waited{ false };
+
+descriptor_heap					rtv_desc_heap;
+descriptor_heap					dsv_desc_heap;
+descriptor_heap					srv_desc_heap;
+descriptor_heap					uav_desc_heap;
+
+std::atomic<u32>				deferred_release_flag[frame_buffer_count]{};
+std::mutex						deferred_release_mutex{};
+bool							is_initialized{ false };
+
+void
+process_deferred_releases(u32 frame_idx)
+{
+	std::lock_guard lock{ deferred_release_mutex };
+
+	// NOTE: clear the flag first, so that we don't overwrite it after another thread has set it.
+	deferred_release_flag[frame_idx].exchange(0, std::memory_order_acq_rel);
+	rtv_desc_heap.process_deferred_free(frame_idx);
+	dsv_desc_heap.process_deferred_free(frame_idx);
+	srv_desc_heap.process_deferred_free(frame_idx);
+	uav_desc_heap.process_deferred_free(frame_idx);
+}
+} // anonymous namespace
+
+bool
+initialize()
+{
+	if (is_initialized) shutdown();
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+
+	// Same RTV, DSV and UAV capacities as the Direct3D12 backend, so running out of descriptors shows
+	// up here too. There the SRV heap is sized for the bindless table of the device, up to a million
+	// descriptors, which the null backend has no use for.
+	bool result{ true };
+	result &= rtv_desc_heap.initialize(512);
+	result &= dsv_desc_heap.initialize(512);
+	result &= srv_desc_heap.initialize(4096);
+	result &= uav_desc_heap.initialize(512);
+	gfx_command.initialize();
+	is_initialized = true;
+	if (!result)
+	{
+		shutdown();
+		return false;
+	}
+	return true;
+}
+
+void
+shutdown()
+{
+	if (!is_initialized) return;
+	gfx_command.release();
+	for (u32 i{ 0 }; i < frame_buffer_count; ++i)
+	{
+		process_deferred_releases(i);
+	}
+
+	rtv_desc_heap.release();
+	dsv_desc_heap.release();
+	srv_desc_heap.release();
+	uav_desc_heap.release();
+	is_initialized = false;
+}
+
+descriptor_heap&
+rtv_heap() { return rtv_desc_heap; }
+
+descriptor_heap&
+dsv_heap() { return dsv_desc_heap; }
+
+descriptor_heap&
+srv_heap() { return srv_desc_heap; }
+
+descriptor_heap&
+uav_heap() { return uav_desc_heap; }
+
+u32 current_frame_index() { return gfx_command.frame_index(); }
+
+void
+set_deferred_release_flag() { deferred_release_flag[current_frame_index()].store(1, std::memory_order_release); }
+
+null_command_context*
+acquire_command_context(u32 order)
+{
+	return gfx_command.contexts().acquire(order);
+}
+
+void
+close_command_context(null_command_context* context)
+{
+	gfx_command.contexts().close(context);
+}
+
+command_context_stats
+get_command_context_stats()
+{
+	return gfx_command.contexts().stats();
+}
+
+void
+flush()
+{
+	gfx_command.flush();
+}
+
+null_stats
+get_stats()
+{
+	return { gfx_command.frame_count(), gfx_command.fence_value(), gfx_command.completed_fence_value(),
+		gfx_command.fence_waits(), gfx_command.submitted_lists(), gfx_command.submitted_commands(), surfaces.size() };
+}
+
+// There's no display, so only the frames in flight matter.
+void
+set_frame_pacing(const frame_pacing& new_pacing)
+{
+	assert(new_pacing.is_valid());
+	pacing = new_pacing;
+	gfx_command.set_frames_in_flight(pacing.frames_in_flight);
+	timer.reset();
+}
+
+frame_pacing
+get_frame_pacing()
+{
+	return pacing;
+}
+
+frame_timing_stats
+get_frame_timing_stats()
+{
+	return timer.stats();
+}
+
+surface
+create_surface(platform::window window)
+{
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	surface_id id{ surfaces.add(std::make_unique<null_surface>(window)) };
+	return surface{ id };
+}
+
+void
+remove_surface(surface_id id)
+{
+	gfx_command.flush();
+	for (u32 i{ 0 }; i < frame_surfaces.size(); ++i)
+	{
+		if (frame_surfaces[i] != id) continue;
+		for (u32 j{ i + 1 }; j < frame_surfaces.size(); ++j) frame_surfaces[j - 1] = frame_surfaces[j];
+		frame_surfaces.resize(frame_surfaces.size() - 1);
+		break;
+	}
+	surfaces.remove(id);
+}
+
+void
+resize_surface(surface_id id, u32 width, u32 height)
+{
+	gfx_command.flush();
+	surfaces[id]->resize(width, height);
+}
+
+u32
+surface_width(surface_id id)
+{
+	return surfaces[id]->width();
+}
+
+u32
+surface_height(surface_id id)
+{
+	return surfaces[id]->height();
+}
+
+// There's no display to wait for, but the frame starts here like in the Direct3D12 backend.
+void
+wait_for_display()
+{
+	assert(is_initialized && !is_frame_open);
+	if (is_display_waited) return;
+	timer.begin_frame();
+	is_display_waited = true;
+}
+
+void
+begin_frame()
+{
+	assert(is_initialized && !is_frame_open);
+	wait_for_display();
+	is_display_waited = false;
+	gfx_command.begin_frame(timer);
+
+	const u32 frame_idx{ current_frame_index() };
+	if (deferred_release_flag[frame_idx].load(std::memory_order_acquire))
+	{
+		process_deferred_releases(frame_idx);
+	}
+	// Once per frame of the engine, no matter how many surfaces it renders.
+	memory::begin_frame_arena(frame_idx);
+	is_frame_open = true;
+}
+
+void
+end_frame()
+{
+	assert(is_frame_open);
+	gfx_command.end_frame();
+	for (surface_id id : frame_surfaces) surfaces[id]->present();
+	frame_surfaces.clear();
+	is_frame_open = false;
+}
+
+void
+render_surface(surface_id id)
+{
+	assert(is_frame_open);
+	frame_surfaces.emplace_back(id);
+}
+}
+
+namespace ferraris::graphics::null {
+
+bool
+null_command_backend::create(list_type& list, allocator_type& allocator)
+{
+	allocator = new null_command_allocator{};
+	list = new null_command_list{ allocator, 0, false };
+	return true;
+}
+
+void
+null_command_backend::destroy(list_type& list, allocator_type& allocator)
+{
+	delete list;
+	delete allocator;
+	list = nullptr;
+	allocator = nullptr;
+}
+
+void
+null_command_backend::reset(allocator_type allocator)
+{
+	allocator->command_count = 0;
+	++allocator->reset_count;
+}
+
+void
+null_command_backend::begin(list_type list, allocator_type allocator)
+{
+	assert(!list->is_open);
+	list->allocator = allocator;
+	list->command_count = 0;
+	list->is_open = true;
+}
+
+void
+null_command_backend::end(list_type list)
+{
+	assert(list->is_open);
+	list->is_open = false;
+}
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "NullCommonHeaders.h"
+#include "Graphics/CommandContextPool.h"
+
+// A graphics backend without a GPU. It implements the platform interface with the same
+// CPU-side bookkeeping as the Direct3D12 backend: surfaces with back buffers and render
+// target descriptors, frame indices, a fence per frame and deferred freeing of descriptors.
+// Nothing is drawn or presented. It's used to run the engine loop where there's no GPU,
+// e.g. on servers and build machines, and to measure and test the CPU cost of rendering.
+//
+// The emulated GPU finishes a frame only when the CPU waits for it. So the CPU always runs
+// as many frames ahead as the frame pacing allows, 'frame_buffer_count' by default, which is
+// the worst case for anything that has to wait for a frame to complete, like deferred frees
+// and frame arenas. The GPU frame time of the timing stats is always 0.
+namespace ferraris::graphics::null {
+class descriptor_heap;
+
+// Stand in for a command allocator and a command list. Recording only counts commands.
+struct null_command_allocator
+{
+	u64 command_count;				// since the last reset
+	u32 reset_count;
+};
+
+struct null_command_list
+{
+	null_command_allocator*	allocator;
+	u32						command_count;		// since the list was opened
+	bool					is_open;
+
+	void record(u32 count)
+	{
+		assert(is_open && allocator);
+		command_count += count;
+		allocator->command_count += count;
+	}
+};
+
+struct null_command_backend
+{
+	using list_type = null_command_list*;
+	using allocator_type = null_command_allocator*;
+
+	bool create(list_type& list, allocator_type& allocator);
+	void destroy(list_type& list, allocator_type& allocator);
+	void reset(allocator_type allocator);
+	void begin(list_type list, allocator_type allocator);
+	void end(list_type list);
+};
+
+using null_command_context_pool = command_context_pool<null_command_backend, frame_buffer_count>;
+using null_command_context = null_command_context_pool::context;
+}
+namespace ferraris::graphics::null::core {
+
+struct null_stats
+{
+	u64 frame_count;				// frames rendered since initialize()
+	u64 fence_value;				// last value that was signaled
+	u64 completed_fence_value;		// last value the emulated GPU has reached
+	u64 fence_waits;				// number of times the CPU had to wait for a frame
+	u64 submitted_lists;			// including the frame's own command list
+	u64 submitted_commands;
+	u32 surface_count;
+};
+
+bool initialize();
+void shutdown();
+
+descriptor_heap& rtv_heap();
+descriptor_heap& dsv_heap();
+descriptor_heap& srv_heap();
+descriptor_heap& uav_heap();
+
+u32 current_frame_index();
+void set_deferred_release_flag();
+// Same as in the Direct3D12 backend, see D3D12Core.h.
+null_command_context* acquire_command_context(u32 order);
+void close_command_context(null_command_context* context);
+command_context_stats get_command_context_stats();
+// Make the emulated GPU finish every frame that was submitted.
+void flush();
+null_stats get_stats();
+
+void set_frame_pacing(const frame_pacing& pacing);
+frame_pacing get_frame_pacing();
+frame_timing_stats get_frame_timing_stats();
+
+surface create_surface(platform::window);
+void remove_surface(surface_id);
+void resize_surface(surface_id, u32, u32);
+u32 surface_width(surface_id);
+u32 surface_height(surface_id);
+void wait_for_display();
+void begin_frame();
+void end_frame();
+void render_surface(surface_id);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace ferraris::graphics {
+
+struct platform_interface;
+
+namespace null {
+void get_platform_interface(platform_interface& pi);
+}
+}
@@ -0,0 +1,76 @@
+#include "NullResources.h"
+#include "NullCore.h"
+
+namespace ferraris::graphics::null {
+
+bool
+descriptor_heap::initialize(u32 capacity)
+{
+	std::lock_guard lock{ _mutex };
+	assert(capacity);
+	if (!capacity) return false;
+	assert(!_capacity && !size());
+
+	DEBUG_OP(for (u32 i{ 0 }; i < frame_buffer_count; ++i) assert(_deferred_free_indices.empty(i)));
+	_free_indices.initialize(capacity);
+	_deferred_free_indices.initialize(capacity);
+	_capacity = capacity;
+	_peak.store(0, std::memory_order_relaxed);
+	return true;
+}
+
+void
+descriptor_heap::release()
+{
+	std::lock_guard lock{ _mutex };
+	assert(!size());
+	_free_indices.release();
+	_capacity = 0;
+}
+
+void
+descriptor_heap::process_deferred_free(u32 frame_idx)
+{
+	std::lock_guard lock{ _mutex };
+	assert(frame_idx < frame_buffer_count);
+
+	_deferred_free_indices.take_all(frame_idx, [this](u32 index) { _free_indices.free(index); });
+}
+
+descriptor_handle
+descriptor_heap::allocate()
+{
+	assert(_capacity);
+	descriptor_handle handle{ _free_indices.allocate() };
+	assert(handle.is_valid());
+	if (!handle.is_valid()) return handle;
+
+	const u32 used{ size() };
+	u32 peak{ _peak.load(std::memory_order_relaxed) };
+	while (used > peak && !_peak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+	return handle;
+}
+
+void
+descriptor_heap::free(descriptor_handle& handle)
+{
+	if (!handle.is_valid()) return;
+
+	assert(_capacity && size());
+	assert(handle.index < _capacity);
+
+	const u32 frame_idx{ core::current_frame_index() };
+	_deferred_free_indices.push(frame_idx, handle.index);
+	core::set_deferred_release_flag();
+	handle = {};
+}
+
+descriptor_heap_stats
+descriptor_heap::stats()
+{
+	std::lock_guard lock{ _mutex };
+	u32 deferred_count{ 0 };
+	for (u32 i{ 0 }; i < frame_buffer_count; ++i) deferred_count += _deferred_free_indices.size(i);
+	return { _capacity, size(), _peak.load(std::memory_order_relaxed), deferred_count };
+}
+}
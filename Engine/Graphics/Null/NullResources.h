@@ -0,0 +1,50 @@
+#pragma once
+#include "NullCommonHeaders.h"
+
+namespace ferraris::graphics::null {
+
+// A descriptor is only an index into its heap. There is no memory behind it.
+struct descriptor_handle
+{
+	u32 index{ u32_invalid_id };
+
+	constexpr bool is_valid() const { return index != u32_invalid_id; }
+};
+
+struct descriptor_heap_stats
+{
+	u32 capacity;
+	u32 size;				// descriptors in use, including those that wait for their frame to complete
+	u32 peak;				// highest size since initialize()
+	u32 deferred_count;		// descriptors that wait for their frame to complete
+};
+
+// Keeps the same account of descriptors as d3d12::descriptor_heap: allocating and freeing are lock-free,
+// freed descriptors only become available again after the frame they were freed in has
+// completed, and running out of descriptors is an error.
+class descriptor_heap
+{
+public:
+	descriptor_heap() = default;
+	DISABLE_COPY_AND_MOVE(descriptor_heap);
+	~descriptor_heap() { assert(!_capacity); }
+
+	bool initialize(u32 capacity);
+	void release();
+	void process_deferred_free(u32 frame_idx);
+
+	[[nodiscard]] descriptor_handle allocate();
+	void free(descriptor_handle& handle);
+
+	constexpr u32 capacity() const { return _capacity; }
+	u32 size() const { return _free_indices.size(); }
+	descriptor_heap_stats stats();
+
+private:
+	utl::concurrent_index_pool				_free_indices{};
+	utl::concurrent_index_lists<frame_buffer_count>	_deferred_free_indices{};
+	std::mutex								_mutex{};
+	std::atomic<u32>						_peak{ 0 };
+	u32										_capacity{ 0 };
+};
+}
@@ -0,0 +1,263 @@
+#include "PipelineCache.h"
+#include "Utilities/ConcurrentFreeList.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+namespace ferraris::graphics::pipeline_cache {
+namespace {
+
+constexpr u32 max_pipelines{ 4096 };
+// At most half full, so a lookup only probes a few slots.
+constexpr u32 lookup_capacity{ max_pipelines * 2 };
+static_assert(!(lookup_capacity & (lookup_capacity - 1)));
+
+struct pipeline_data
+{
+	std::atomic<u32>			state{ (u32)pipeline_state::pending };
+	void*						handle{ nullptr };		// written by a worker before the state is set to ready
+	utl::vector<u8>				create_info;
+	u64							key{ 0 };
+	u64							fallback{ 0 };
+};
+
+// An open addressing table from keys to pipelines, which get() reads without a lock. Entries are
+// only added, under the mutex, and never move or go away until shutdown(). A slot's index is
+// written before its key, so a reader that finds the key also sees the index.
+struct lookup_slot
+{
+	std::atomic<u64>	key{ 0 };		// 0 if the slot is empty, keys are never 0
+	std::atomic<u32>	index{ u32_invalid_id };
+};
+
+std::mutex												pipelines_mutex;
+std::condition_variable									work_ready;
+std::condition_variable									work_done;
+// Pipelines never move, so workers and get() use them without holding the mutex.
+utl::concurrent_free_list<pipeline_data>				pipelines;
+std::unique_ptr<lookup_slot[]>							lookup;
+utl::deque<u32>											queue;			// pipelines that need a worker
+u32														pending_count{ 0 };
+bool													is_running{ false };
+utl::vector<std::thread>								workers;
+backend_info											backend{};
+pipeline_cache_stats									stats{};		// the counters of get() are below
+f32														total_create_time{ 0.f };
+std::atomic<u64>										get_count{ 0 };
+std::atomic<u64>										fallback_count{ 0 };
+std::atomic<u64>										miss_count{ 0 };
+
+// Lock-free. Returns the index of the pipeline or u32_invalid_id.
+u32
+find(u64 key)
+{
+	for (u32 i{ (u32)key & (lookup_capacity - 1) };; i = (i + 1) & (lookup_capacity - 1))
+	{
+		const u64 slot_key{ lookup[i].key.load(std::memory_order_acquire) };
+		if (slot_key == key) return lookup[i].index.load(std::memory_order_relaxed);
+		if (!slot_key) return u32_invalid_id;
+	}
+}
+
+// NOTE: call with the mutex locked, the key must not be in the table yet.
+void
+insert(u64 key, u32 index)
+{
+	u32 i{ (u32)key & (lookup_capacity - 1) };
+	while (lookup[i].key.load(std::memory_order_relaxed)) i = (i + 1) & (lookup_capacity - 1);
+	lookup[i].index.store(index, std::memory_order_relaxed);
+	lookup[i].key.store(key, std::memory_order_release);
+}
+
+void
+worker()
+{
+	using clock = std::chrono::steady_clock;
+	while (true)
+	{
+		pipeline_data* pipeline{ nullptr };
+		{
+			std::unique_lock lock{ pipelines_mutex };
+			work_ready.wait(lock, []() { return !queue.empty() || !is_running; });
+			if (!is_running) return;
+			pipeline = &pipelines[queue.front()];
+			queue.pop_front();
+		}
+
+		// Pipelines aren't moved or removed while workers run.
+		const clock::time_point start{ clock::now() };
+		const create_request request{ pipeline->key, pipeline->create_info.data(), (u32)pipeline->create_info.size() };
+		const create_result result{ backend.create(request) };
+		const f32 ms{ std::chrono::duration<f32, std::milli>(clock::now() - start).count() };
+
+		pipeline->handle = result.pipeline;
+		pipeline->state.store((u32)(result.pipeline ? pipeline_state::ready : pipeline_state::failed), std::memory_order_release);
+
+		std::lock_guard lock{ pipelines_mutex };
+		if (!result.pipeline) ++stats.failures;
+		else if (result.from_library) ++stats.library_hits;
+		else ++stats.creates;
+		total_create_time += ms;
+		--pending_count;
+		work_done.notify_all();
+	}
+}
+
+pipeline
+get_ready(const pipeline_data& data, bool is_fallback)
+{
+	const pipeline_state state{ (pipeline_state)data.state.load(std::memory_order_acquire) };
+	if (state != pipeline_state::ready) return { state, nullptr, is_fallback };
+	return { state, data.handle, is_fallback };
+}
+} // anonymous namespace
+
+bool
+initialize(const backend_info& info, u32 worker_count)
+{
+	assert(info.create && info.destroy);
+	assert(!is_running);
+	if (!info.create || !info.destroy || is_running) return false;
+	backend = info;
+
+	if (!worker_count)
+	{
+		const u32 hardware_threads{ std::thread::hardware_concurrency() };
+		worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+	}
+	pipelines.initialize(max_pipelines);
+	lookup = std::make_unique<lookup_slot[]>(lookup_capacity);
+	is_running = true;
+	for (u32 i{ 0 }; i < worker_count; ++i) workers.emplace_back(worker);
+	return true;
+}
+
+void
+shutdown()
+{
+	{
+		std::lock_guard lock{ pipelines_mutex };
+		is_running = false;
+	}
+	work_ready.notify_all();
+	for (auto& thread : workers) thread.join();
+	workers.clear();
+
+	// NOTE: get() may not be called anymore.
+	for (u32 i{ 0 }; lookup && i < lookup_capacity; ++i)
+	{
+		if (!lookup[i].key.load(std::memory_order_relaxed)) continue;
+		const u32 index{ lookup[i].index.load(std::memory_order_relaxed) };
+		if (pipelines[index].handle) backend.destroy(pipelines[index].handle);
+		pipelines.remove(index);
+	}
+	queue.clear();
+	pending_count = 0;
+	lookup.reset();
+	pipelines.release();
+	stats = {};
+	total_create_time = 0.f;
+	get_count.store(0, std::memory_order_relaxed);
+	fallback_count.store(0, std::memory_order_relaxed);
+	miss_count.store(0, std::memory_order_relaxed);
+}
+
+u64
+get_key(const pipeline_desc& desc)
+{
+	assert(!desc.shader_count || desc.shaders);
+	assert(!desc.state_size || desc.state);
+	u64 hash{ utl::fnv1a_64((const char*)&backend.version, sizeof(u64)) };
+	hash = utl::fnv1a_64((const char*)&desc.shader_count, sizeof(u32), hash);
+	hash = utl::fnv1a_64((const char*)desc.shaders, desc.shader_count * sizeof(u64), hash);
+	hash = utl::fnv1a_64((const char*)&desc.root_signature, sizeof(u64), hash);
+	hash = utl::fnv1a_64((const char*)desc.state, desc.state_size, hash);
+	// 0 means no fallback.
+	return hash ? hash : 1;
+}
+
+u64
+request(const pipeline_desc& desc, u64 fallback)
+{
+	const u64 key{ get_key(desc) };
+	assert(key != fallback);
+
+	std::lock_guard lock{ pipelines_mutex };
+	assert(is_running);
+	// Nothing would create the pipeline.
+	if (!is_running) return 0;
+	++stats.requests;
+	if (find(key) != u32_invalid_id)
+	{
+		++stats.hits;
+		return key;
+	}
+
+	const u32 index{ pipelines.add() };
+	if (index == u32_invalid_id) return 0;
+	pipeline_data& pipeline{ pipelines[index] };
+	pipeline.create_info.resize(desc.create_info_size);
+	if (desc.create_info_size) memcpy(pipeline.create_info.data(), desc.create_info, desc.create_info_size);
+	pipeline.key = key;
+	pipeline.fallback = fallback;
+	// Published last, get() may find the pipeline right away.
+	insert(key, index);
+	queue.emplace_back(index);
+	++pending_count;
+	work_ready.notify_one();
+	return key;
+}
+
+pipeline
+get(u64 key)
+{
+	// Called for every draw, so it doesn't take the mutex.
+	assert(lookup);
+	get_count.fetch_add(1, std::memory_order_relaxed);
+	const u32 index{ find(key) };
+	if (index == u32_invalid_id) return { pipeline_state::failed, nullptr, false };
+
+	const pipeline_data& data{ pipelines[index] };
+	const pipeline result{ get_ready(data, false) };
+	if (result.state == pipeline_state::ready) return result;
+
+	// Draw with the fallback until this pipeline is ready, or for good if it failed.
+	if (data.fallback)
+	{
+		const u32 fallback{ find(data.fallback) };
+		if (fallback != u32_invalid_id)
+		{
+			const pipeline substitute{ get_ready(pipelines[fallback], true) };
+			if (substitute.state == pipeline_state::ready)
+			{
+				fallback_count.fetch_add(1, std::memory_order_relaxed);
+				return substitute;
+			}
+		}
+	}
+	miss_count.fetch_add(1, std::memory_order_relaxed);
+	return result;
+}
+
+void
+wait_idle()
+{
+	std::unique_lock lock{ pipelines_mutex };
+	work_done.wait(lock, []() { return !pending_count; });
+}
+
+pipeline_cache_stats
+get_stats()
+{
+	std::lock_guard lock{ pipelines_mutex };
+	pipeline_cache_stats result{ stats };
+	result.gets = get_count.load(std::memory_order_relaxed);
+	result.fallbacks = fallback_count.load(std::memory_order_relaxed);
+	result.misses = miss_count.load(std::memory_order_relaxed);
+	const u64 created{ stats.library_hits + stats.creates + stats.failures };
+	result.create_time = created ? total_create_time / (f32)created : 0.f;
+	return result;
+}
+}
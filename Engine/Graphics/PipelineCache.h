@@ -0,0 +1,105 @@
+#pragma once
+#include "CommonHeaders.h"
+
+// Pipeline state objects, identified by a key that's a hash of everything that goes into them:
+// the shaders, the root signature and the fixed-function state. The same description always
+// gets the same key, in every run, so a backend can use it to find the pipeline in a library
+// on disk (e.g. an ID3D12PipelineLibrary) instead of letting the driver compile it again.
+//
+// Pipelines are created on demand by worker threads, using the create function of the graphics
+// backend. Creating a pipeline can take a good part of a frame, so get() never waits: until a
+// pipeline is ready it returns its fallback, e.g. a simpler pipeline that was created up front.
+namespace ferraris::graphics::pipeline_cache {
+
+struct pipeline_desc
+{
+	const u64*	shaders{ nullptr };			// keys of the shaders, e.g. from shader_variants::request()
+	u32			shader_count{ 0 };
+	u64			root_signature{ 0 };		// a key of the root signature that's the same in every run
+	// The rest of the state, which is hashed as it is. It must not contain pointers or padding
+	// that isn't zeroed, or the key won't be the same in the next run.
+	const void*	state{ nullptr };
+	u32			state_size{ 0 };
+	// What the backend needs to create the pipeline. It's copied, and it may point to data that
+	// stays valid until the pipeline is ready, like shader byte code.
+	const void*	create_info{ nullptr };
+	u32			create_info_size{ 0 };
+};
+
+struct create_request
+{
+	u64			key;
+	const void*	create_info;
+	u32			create_info_size;
+};
+
+struct create_result
+{
+	void*		pipeline;					// nullptr if it failed
+	bool		from_library;				// found on disk rather than compiled
+};
+
+// Called on a worker thread, every worker on its own.
+using create_function = create_result(*)(const create_request& request);
+// Called on shutdown(), when the GPU has stopped using the pipeline.
+using destroy_function = void(*)(void* pipeline);
+
+struct backend_info
+{
+	create_function		create{ nullptr };
+	destroy_function	destroy{ nullptr };
+	// Part of every key. Change it when the backend or the way it creates pipelines changes,
+	// so pipelines in the library that were created differently aren't used.
+	u64					version{ 0 };
+};
+
+enum class pipeline_state : u32
+{
+	pending,
+	ready,
+	failed,
+};
+
+struct pipeline
+{
+	pipeline_state	state{ pipeline_state::pending };
+	void*			handle{ nullptr };		// valid until shutdown()
+	bool			is_fallback{ false };
+};
+
+struct pipeline_cache_stats
+{
+	u64 requests;
+	u64 hits;					// requests for pipelines that were already in memory
+	u64 library_hits;			// pipelines the backend found on disk
+	u64 creates;				// pipelines the backend had to compile
+	u64 failures;
+	u64 gets;
+	u64 fallbacks;				// gets that returned the fallback
+	u64 misses;					// gets that returned nothing, since neither was ready
+	f32 create_time;			// milliseconds per pipeline, on average
+
+	constexpr f32 hit_rate() const { return requests ? (f32)hits / (f32)requests : 0.f; }
+	constexpr f32 library_hit_rate() const
+	{
+		const u64 loaded{ library_hits + creates };
+		return loaded ? (f32)library_hits / (f32)loaded : 0.f;
+	}
+};
+
+// 'worker_count' 0 uses one thread per hardware thread, less one for the main thread.
+bool initialize(const backend_info& backend, u32 worker_count = 0);
+// Destroys all pipelines.
+void shutdown();
+
+u64 get_key(const pipeline_desc& desc);
+// Returns the key of the pipeline, and starts creating it if it's not in memory yet, or 0 if
+// there's no room for more pipelines. 'fallback' is the key of a pipeline that get() returns
+// instead until this one is ready, or 0 for none.
+u64 request(const pipeline_desc& desc, u64 fallback = 0);
+// Non-blocking and lock-free, so it can be called for every draw on any thread.
+pipeline get(u64 key);
+// Block until every requested pipeline is either ready or failed.
+void wait_idle();
+pipeline_cache_stats get_stats();
+}
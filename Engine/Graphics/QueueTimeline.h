@@ -0,0 +1,201 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <atomic>
+
+namespace ferraris::graphics {
+
+struct queue_type {
+	enum type : u32 {
+		graphics,
+		compute,		// async compute, runs next to graphics
+		copy,			// uploads and other copies, runs next to graphics
+
+		count
+	};
+};
+
+// A point on the timeline of a queue: the queue has reached it when its fence has reached 'value'.
+struct sync_point
+{
+	u64					value{ 0 };
+	queue_type::type	queue{ queue_type::graphics };
+
+	constexpr bool is_valid() const { return value != 0; }
+};
+
+struct queue_timeline_stats
+{
+	u64 signals;
+	u64 waits;				// waits that were sent to a queue
+	u64 skipped_waits;		// waits that were already satisfied, see queue_timeline::wait()
+	u64 cpu_waits;			// times the CPU had to block
+};
+
+/**
+* Keeps track of a fence per queue whose value only goes up, so that work on one queue can
+* wait for work on another one without waiting on the CPU. Signaling a queue returns a
+* sync_point, which other queues or the CPU can wait for.
+*
+* A queue only waits when it's needed. A wait is skipped if
+*	- it's for the same queue, which executes in order anyway,
+*	- the queue already waited for the same or a later point of the other queue, either directly
+*	  or through a queue that waited for it before signaling the point that is waited for,
+*	- or the other queue has already reached the point.
+*
+* The graphics API is hidden behind 'backend', which provides:
+*	u64 completed_value(u32 queue)					the last value the queue's fence has reached
+*	void signal(u32 queue, u64 value)				the queue sets its fence after the work submitted so far
+*	void wait(u32 queue, u32 other, u64 value)		the queue waits until the fence of 'other' reaches 'value'
+*	void wait_on_cpu(u32 queue, u64 value)			blocks until the queue's fence reaches 'value'
+* All functions are thread-safe. Signals and waits are sent to the backend in the order they're made.
+*/
+template<typename backend>
+class queue_timeline
+{
+public:
+	queue_timeline() = default;
+	DISABLE_COPY_AND_MOVE(queue_timeline);
+	~queue_timeline() { assert(!_backend); }
+
+	void initialize(backend& b)
+	{
+		assert(!_backend);
+		std::lock_guard lock{ _mutex };
+		_backend = &b;
+		for (u32 q{ 0 }; q < queue_type::count; ++q)
+		{
+			_signaled[q].store(0, std::memory_order_relaxed);
+			_completed[q].store(0, std::memory_order_relaxed);
+			_snapshot_value[q] = 0;
+			for (u32 other{ 0 }; other < queue_type::count; ++other)
+			{
+				_waited[q][other] = 0;
+				_snapshot[q][other] = 0;
+			}
+		}
+		_stats = {};
+	}
+
+	// NOTE: the queues must have finished, e.g. after flush().
+	void release()
+	{
+		std::lock_guard lock{ _mutex };
+		_backend = nullptr;
+	}
+
+	// Call after submitting work to 'queue'. Work that waits for the returned point will run after it.
+	sync_point signal(queue_type::type queue)
+	{
+		assert(_backend && queue < queue_type::count);
+		std::lock_guard lock{ _mutex };
+		const u64 value{ _signaled[queue].load(std::memory_order_relaxed) + 1 };
+		_backend->signal(queue, value);
+		_signaled[queue].store(value, std::memory_order_release);
+
+		// Everything 'queue' has waited for so far is done once it reaches 'value'.
+		_snapshot_value[queue] = value;
+		for (u32 other{ 0 }; other < queue_type::count; ++other) _snapshot[queue][other] = _waited[queue][other];
+		++_stats.signals;
+		return { value, queue };
+	}
+
+	// Work that is submitted to 'queue' after this call won't start before 'point' is reached.
+	// Returns false if the wait was skipped.
+	bool wait(queue_type::type queue, sync_point point)
+	{
+		assert(_backend && queue < queue_type::count && point.queue < queue_type::count);
+		if (!point.is_valid()) return false;
+		std::lock_guard lock{ _mutex };
+		// Waiting for a point that was never signaled would stall the queue forever.
+		assert(point.value <= _signaled[point.queue].load(std::memory_order_relaxed));
+
+		u64* const waited{ &_waited[queue][0] };
+		if (queue == point.queue || point.value <= waited[point.queue] || point.value <= completed_value(point.queue))
+		{
+			++_stats.skipped_waits;
+			return false;
+		}
+
+		_backend->wait(queue, point.queue, point.value);
+		waited[point.queue] = point.value;
+		// What the other queue waited for before it signaled a point at or before 'point' is done too.
+		if (point.value >= _snapshot_value[point.queue])
+		{
+			const u64* const implied{ &_snapshot[point.queue][0] };
+			for (u32 other{ 0 }; other < queue_type::count; ++other)
+			{
+				waited[other] = implied[other] > waited[other] ? implied[other] : waited[other];
+			}
+		}
+		++_stats.waits;
+		return true;
+	}
+
+	// Makes 'queue' wait for everything that was signaled on 'other' so far.
+	bool wait(queue_type::type queue, queue_type::type other)
+	{
+		return wait(queue, last_signaled(other));
+	}
+
+	[[nodiscard]] bool is_complete(sync_point point)
+	{
+		assert(_backend && point.queue < queue_type::count);
+		if (point.value <= _completed[point.queue].load(std::memory_order_acquire)) return true;
+		return point.value <= completed_value(point.queue);
+	}
+
+	void wait_on_cpu(sync_point point)
+	{
+		if (is_complete(point)) return;
+		assert(point.value <= _signaled[point.queue].load(std::memory_order_relaxed));
+		_backend->wait_on_cpu(point.queue, point.value);
+		update_completed(point.queue, point.value);
+		std::lock_guard lock{ _mutex };
+		++_stats.cpu_waits;
+	}
+
+	// Blocks until every queue has finished all work that was signaled.
+	void flush()
+	{
+		for (u32 q{ 0 }; q < queue_type::count; ++q) wait_on_cpu(last_signaled((queue_type::type)q));
+	}
+
+	[[nodiscard]] sync_point last_signaled(queue_type::type queue) const
+	{
+		assert(queue < queue_type::count);
+		return { _signaled[queue].load(std::memory_order_acquire), queue };
+	}
+
+	[[nodiscard]] queue_timeline_stats stats()
+	{
+		std::lock_guard lock{ _mutex };
+		return _stats;
+	}
+
+private:
+	// Asks the backend and caches the result, so that is_complete() usually doesn't have to.
+	u64 completed_value(u32 queue)
+	{
+		const u64 value{ _backend->completed_value(queue) };
+		update_completed(queue, value);
+		return value;
+	}
+
+	void update_completed(u32 queue, u64 value)
+	{
+		u64 completed{ _completed[queue].load(std::memory_order_relaxed) };
+		while (completed < value && !_completed[queue].compare_exchange_weak(completed, value, std::memory_order_release));
+	}
+
+	std::mutex				_mutex{};
+	backend*				_backend{ nullptr };
+	std::atomic<u64>		_signaled[queue_type::count]{};
+	std::atomic<u64>		_completed[queue_type::count]{};
+	// _waited[q][other]: the latest value of 'other' that 'q' waited for.
+	u64						_waited[queue_type::count][queue_type::count]{};
+	// _waited of each queue when it signaled _snapshot_value last.
+	u64						_snapshot[queue_type::count][queue_type::count]{};
+	u64						_snapshot_value[queue_type::count]{};
+	queue_timeline_stats	_stats{};
+};
+}
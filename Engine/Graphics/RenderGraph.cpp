@@ -0,0 +1,511 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+namespace ferraris::graphics {
+namespace {
+
+constexpr bool
+is_write(u32 usage)
+{
+	return (usage & resource_usage::write_mask) != 0;
+}
+
+constexpr u64
+align_up(u64 value, u64 alignment)
+{
+	assert(alignment && !(alignment & (alignment - 1)));
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr bool
+lifetimes_overlap(const render_graph::resource_info& a, const render_graph::resource_info& b)
+{
+	return !(a.last_pass < b.first_pass || b.last_pass < a.first_pass);
+}
+} // anonymous namespace
+
+void
+render_graph::reset()
+{
+	_passes.clear();
+	_resources.clear();
+	_accesses.clear();
+	_sorted_accesses.clear();
+	_resource_accesses.clear();
+	_barriers.clear();
+	for (u32 i{ 0 }; i < max_heap_groups; ++i) _heap_sizes[i] = 0;
+	_final_first_barrier = 0;
+	_final_barrier_count = 0;
+	_stats = {};
+	_is_compiled = false;
+}
+
+render_resource_id
+render_graph::create(const char* name, const transient_resource_desc& desc)
+{
+	assert(desc.size && desc.alignment && !(desc.alignment & (desc.alignment - 1)));
+	assert(desc.heap_group < max_heap_groups);
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	resource_data resource{};
+	resource.name = name;
+	resource.desc = desc;
+	resource.info.is_transient = true;
+	_resources.emplace_back(resource);
+	_is_compiled = false;
+	return render_resource_id{ (id::id_type)(_resources.size() - 1) };
+}
+
+render_resource_id
+render_graph::import(const char* name, u32 initial_usage, u32 final_usage)
+{
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	resource_data resource{};
+	resource.name = name;
+	resource.desc = { 0, 1, 0 };
+	resource.info.initial_usage = initial_usage;
+	resource.final_usage = final_usage;
+	_resources.emplace_back(resource);
+	_is_compiled = false;
+	return render_resource_id{ (id::id_type)(_resources.size() - 1) };
+}
+
+render_pass_id
+render_graph::add_pass(const char* name, execute_function function, void* data, bool has_side_effects)
+{
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	pass_data pass{};
+	pass.name = name;
+	pass.function = function;
+	pass.data = data;
+	pass.has_side_effects = has_side_effects;
+	_passes.emplace_back(pass);
+	_is_compiled = false;
+	return render_pass_id{ (id::id_type)(_passes.size() - 1) };
+}
+
+void
+render_graph::read(render_pass_id pass, render_resource_id resource, u32 usage)
+{
+	assert(pass < _passes.size() && resource < _resources.size());
+	assert(usage && !is_write(usage));
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	_accesses.emplace_back(access{ pass, resource, usage, 0 });
+	_is_compiled = false;
+}
+
+void
+render_graph::write(render_pass_id pass, render_resource_id resource, u32 usage)
+{
+	assert(pass < _passes.size() && resource < _resources.size());
+	assert(is_write(usage));
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	_accesses.emplace_back(access{ pass, resource, usage, 0 });
+	_is_compiled = false;
+}
+
+bool
+render_graph::compile()
+{
+	memory::scoped_tag memory_tag{ memory::tag::graphics_cpu };
+	const u32 pass_count{ (u32)_passes.size() };
+	const u32 access_count{ (u32)_accesses.size() };
+
+	// Sort the accesses by pass, keeping the order within a pass.
+	for (u32 i{ 0 }; i < pass_count; ++i) _passes[i].access_count = 0;
+	for (u32 i{ 0 }; i < access_count; ++i) ++_passes[_accesses[i].pass].access_count;
+	_scratch.resize(pass_count);
+	u32 offset{ 0 };
+	for (u32 i{ 0 }; i < pass_count; ++i)
+	{
+		_passes[i].first_access = offset;
+		_scratch[i] = offset;
+		offset += _passes[i].access_count;
+	}
+	_sorted_accesses.resize(access_count);
+	for (u32 i{ 0 }; i < access_count; ++i) _sorted_accesses[_scratch[_accesses[i].pass]++] = _accesses[i];
+
+	// A pass that uses a resource more than once uses it in all those ways at the same time.
+	offset = 0;
+	for (u32 p{ 0 }; p < pass_count; ++p)
+	{
+		pass_data& pass{ _passes[p] };
+		const u32 first{ offset };
+		for (u32 i{ pass.first_access }; i < pass.first_access + pass.access_count; ++i)
+		{
+			const access& a{ _sorted_accesses[i] };
+			u32 j{ first };
+			while (j < offset && _sorted_accesses[j].resource != a.resource) ++j;
+			if (j < offset)
+			{
+				// A resource that's written in a pass can't be used in any other way in the same pass.
+				const u32 usage{ _sorted_accesses[j].usage | a.usage };
+				assert(!is_write(usage) || !(usage & (usage - 1)));
+				_sorted_accesses[j].usage = usage;
+			}
+			else
+			{
+				_sorted_accesses[offset++] = a;
+			}
+		}
+		pass.first_access = first;
+		pass.access_count = offset - first;
+	}
+	_sorted_accesses.resize(offset);
+
+	cull_passes();
+	if (!compute_lifetimes()) return false;
+	place_transients();
+	compute_barriers();
+
+	_stats.pass_count = pass_count;
+	_stats.resource_count = (u32)_resources.size();
+	_is_compiled = true;
+	return true;
+}
+
+// Walk the passes backwards and keep every pass that has side effects, writes to an imported
+// resource or writes to a resource that a later pass which is kept reads from.
+void
+render_graph::cull_passes()
+{
+	_scratch.resize(_resources.size());
+	for (u32 r{ 0 }; r < _scratch.size(); ++r) _scratch[r] = 0;
+
+	_stats.culled_pass_count = 0;
+	for (u32 p{ (u32)_passes.size() }; p-- > 0;)
+	{
+		pass_data& pass{ _passes[p] };
+		const access* const accesses{ _sorted_accesses.data() + pass.first_access };
+		bool is_live{ pass.has_side_effects };
+		for (u32 i{ 0 }; i < pass.access_count && !is_live; ++i)
+		{
+			const access& a{ accesses[i] };
+			is_live = is_write(a.usage) && (!_resources[a.resource].info.is_transient || _scratch[a.resource]);
+		}
+
+		pass.is_live = is_live;
+		if (!is_live)
+		{
+			++_stats.culled_pass_count;
+			continue;
+		}
+		// NOTE: a write doesn't clear the flag. Passes that write to a resource before this one
+		//		 are kept as well, since e.g. a render target may be drawn over by several passes.
+		for (u32 i{ 0 }; i < pass.access_count; ++i)
+		{
+			if (!is_write(accesses[i].usage)) _scratch[accesses[i].resource] = 1;
+		}
+	}
+}
+
+bool
+render_graph::compute_lifetimes()
+{
+	for (u32 r{ 0 }; r < _resources.size(); ++r)
+	{
+		resource_data& resource{ _resources[r] };
+		resource.info.first_pass = u32_invalid_id;
+		resource.info.last_pass = u32_invalid_id;
+		resource.info.is_used = false;
+		resource.access_count = 0;
+	}
+
+	for (u32 p{ 0 }; p < _passes.size(); ++p)
+	{
+		const pass_data& pass{ _passes[p] };
+		if (!pass.is_live) continue;
+		for (u32 i{ pass.first_access }; i < pass.first_access + pass.access_count; ++i)
+		{
+			resource_info& info{ _resources[_sorted_accesses[i].resource].info };
+			if (!info.is_used) info.first_pass = p;
+			info.last_pass = p;
+			info.is_used = true;
+			++_resources[_sorted_accesses[i].resource].access_count;
+		}
+	}
+
+	// Lists of the accesses of each resource, in pass order.
+	u32 offset{ 0 };
+	_scratch.resize(_resources.size());
+	for (u32 r{ 0 }; r < _resources.size(); ++r)
+	{
+		_resources[r].first_access = offset;
+		_scratch[r] = offset;
+		offset += _resources[r].access_count;
+	}
+	_resource_accesses.resize(offset);
+	for (u32 p{ 0 }; p < _passes.size(); ++p)
+	{
+		const pass_data& pass{ _passes[p] };
+		if (!pass.is_live) continue;
+		for (u32 i{ pass.first_access }; i < pass.first_access + pass.access_count; ++i)
+		{
+			_resource_accesses[_scratch[_sorted_accesses[i].resource]++] = i;
+		}
+	}
+
+	for (u32 r{ 0 }; r < _resources.size(); ++r)
+	{
+		const resource_data& resource{ _resources[r] };
+		// The content of a transient resource is undefined until a pass writes to it.
+		if (resource.info.is_transient && resource.access_count &&
+			!is_write(_sorted_accesses[_resource_accesses[resource.first_access]].usage))
+		{
+			assert(!"Transient resource is read before it's written.");
+			return false;
+		}
+	}
+	return true;
+}
+
+// Place each transient resource at the lowest offset where it doesn't overlap the memory of any
+// resource that's alive at the same time. Larger resources are placed first, which keeps the heaps
+// smaller than placing them in pass order.
+void
+render_graph::place_transients()
+{
+	_scratch.clear();
+	_stats.transient_count = 0;
+	_stats.transient_size = 0;
+	_stats.heap_size = 0;
+	for (u32 i{ 0 }; i < max_heap_groups; ++i) _heap_sizes[i] = 0;
+
+	for (u32 r{ 0 }; r < _resources.size(); ++r)
+	{
+		resource_data& resource{ _resources[r] };
+		resource.info.offset = 0;
+		if (!resource.info.is_transient || !resource.info.is_used) continue;
+		_scratch.emplace_back(r);
+		++_stats.transient_count;
+		_stats.transient_size += resource.desc.size;
+	}
+
+	std::sort(_scratch.data(), _scratch.data() + _scratch.size(), [this](u32 a, u32 b) {
+		const resource_data& x{ _resources[a] };
+		const resource_data& y{ _resources[b] };
+		if (x.desc.heap_group != y.desc.heap_group) return x.desc.heap_group < y.desc.heap_group;
+		if (x.desc.size != y.desc.size) return x.desc.size > y.desc.size;
+		return x.info.first_pass < y.info.first_pass;
+	});
+
+	// Resources of the current heap group that are placed already, ordered by offset.
+	_placed.clear();
+	for (u32 i{ 0 }; i < _scratch.size(); ++i)
+	{
+		resource_data& resource{ _resources[_scratch[i]] };
+		if (i && _resources[_scratch[i - 1]].desc.heap_group != resource.desc.heap_group) _placed.clear();
+
+		// Skip over the memory of resources that are alive at the same time as this one.
+		u64 offset{ 0 };
+		for (u32 j{ 0 }; j < _placed.size(); ++j)
+		{
+			const resource_data& placed{ _resources[_placed[j]] };
+			if (!lifetimes_overlap(placed.info, resource.info)) continue;
+			if (offset + resource.desc.size <= placed.info.offset) break;
+			const u64 end{ placed.info.offset + placed.desc.size };
+			if (end > offset) offset = align_up(end, resource.desc.alignment);
+		}
+		resource.info.offset = offset;
+
+		u32 position{ (u32)_placed.size() };
+		_placed.emplace_back(_scratch[i]);
+		for (; position && _resources[_placed[position - 1]].info.offset > offset; --position)
+		{
+			_placed[position] = _placed[position - 1];
+		}
+		_placed[position] = _scratch[i];
+
+		u64& heap_size{ _heap_sizes[resource.desc.heap_group] };
+		const u64 end{ offset + resource.desc.size };
+		heap_size = end > heap_size ? end : heap_size;
+	}
+
+	for (u32 i{ 0 }; i < max_heap_groups; ++i) _stats.heap_size += _heap_sizes[i];
+}
+
+void
+render_graph::compute_barriers()
+{
+	_barriers.clear();
+	_stats.barrier_count = 0;
+	_stats.aliasing_barrier_count = 0;
+
+	// A read is transitioned to all states that the following reads need as well,
+	// so that consecutive readers with different usages need only one barrier.
+	for (u32 r{ 0 }; r < _resources.size(); ++r)
+	{
+		resource_data& resource{ _resources[r] };
+		u32 following_reads{ 0 };
+		for (u32 i{ resource.access_count }; i-- > 0;)
+		{
+			access& a{ _sorted_accesses[_resource_accesses[resource.first_access + i]] };
+			if (is_write(a.usage))
+			{
+				a.target = a.usage;
+				following_reads = 0;
+			}
+			else
+			{
+				a.target = a.usage | following_reads;
+				following_reads = a.target;
+			}
+		}
+		if (resource.info.is_transient)
+		{
+			// Transient resources are created in the state of their first use and are
+			// transitioned back to it at the end, so every frame starts in the same state.
+			resource.info.initial_usage = resource.access_count ?
+				_sorted_accesses[_resource_accesses[resource.first_access]].target : resource_usage::none;
+		}
+	}
+
+	// Current state of each resource.
+	_scratch.resize(_resources.size());
+	for (u32 r{ 0 }; r < _resources.size(); ++r) _scratch[r] = _resources[r].info.initial_usage;
+
+	for (u32 p{ 0 }; p < _passes.size(); ++p)
+	{
+		pass_data& pass{ _passes[p] };
+		pass.first_barrier = (u32)_barriers.size();
+		pass.barrier_count = 0;
+		if (!pass.is_live) continue;
+
+		for (u32 i{ pass.first_access }; i < pass.first_access + pass.access_count; ++i)
+		{
+			const access& a{ _sorted_accesses[i] };
+			const resource_data& resource{ _resources[a.resource] };
+			u32& state{ _scratch[a.resource] };
+
+			render_barrier barrier{};
+			barrier.resource = render_resource_id{ a.resource };
+			if (resource.info.is_transient && resource.info.first_pass == p)
+			{
+				// The first use of a transient resource that shares memory with other resources.
+				// Find the resource that used the memory last before it, if any.
+				bool is_aliased{ false };
+				u32 last_pass{ 0 };
+				for (u32 r{ 0 }; r < _resources.size(); ++r)
+				{
+					const resource_data& other{ _resources[r] };
+					if (r == a.resource || !other.info.is_transient || !other.info.is_used ||
+						other.desc.heap_group != resource.desc.heap_group ||
+						other.info.offset >= resource.info.offset + resource.desc.size ||
+						resource.info.offset >= other.info.offset + other.desc.size)
+					{
+						continue;
+					}
+					is_aliased = true;
+					if (other.info.last_pass < p && other.info.last_pass >= last_pass)
+					{
+						last_pass = other.info.last_pass;
+						barrier.resource_before = render_resource_id{ r };
+					}
+				}
+				if (is_aliased)
+				{
+					barrier.type = render_barrier::aliasing;
+					barrier.after = a.target;
+					_barriers.emplace_back(barrier);
+					++_stats.aliasing_barrier_count;
+				}
+				continue;
+			}
+
+			if (state == a.target || (!is_write(state) && !is_write(a.target) && !(a.target & ~state)))
+			{
+				if (a.target & resource_usage::unordered_access)
+				{
+					barrier.type = render_barrier::uav;
+					_barriers.emplace_back(barrier);
+				}
+				continue;
+			}
+			barrier.before = state;
+			barrier.after = a.target;
+			_barriers.emplace_back(barrier);
+			state = a.target;
+		}
+		pass.barrier_count = (u32)_barriers.size() - pass.first_barrier;
+	}
+
+	// Put all resources in the state that's expected after the graph.
+	_final_first_barrier = (u32)_barriers.size();
+	for (u32 r{ 0 }; r < _resources.size(); ++r)
+	{
+		const resource_data& resource{ _resources[r] };
+		const u32 final_usage{ resource.info.is_transient ? resource.info.initial_usage : resource.final_usage };
+		if (_scratch[r] == final_usage || (resource.info.is_transient && !resource.info.is_used)) continue;
+		render_barrier barrier{};
+		barrier.resource = render_resource_id{ r };
+		barrier.before = _scratch[r];
+		barrier.after = final_usage;
+		_barriers.emplace_back(barrier);
+	}
+	_final_barrier_count = (u32)_barriers.size() - _final_first_barrier;
+	_stats.barrier_count = (u32)_barriers.size();
+}
+
+void
+render_graph::execute(barrier_function barrier_func, void* context) const
+{
+	assert(_is_compiled);
+	for (u32 p{ 0 }; p < _passes.size(); ++p)
+	{
+		const pass_data& pass{ _passes[p] };
+		if (!pass.is_live) continue;
+		if (pass.barrier_count && barrier_func) barrier_func(&_barriers[pass.first_barrier], pass.barrier_count, context);
+		if (pass.function) pass.function(*this, render_pass_id{ p }, pass.data, context);
+	}
+	if (_final_barrier_count && barrier_func) barrier_func(&_barriers[_final_first_barrier], _final_barrier_count, context);
+}
+
+const char*
+render_graph::pass_name(render_pass_id id) const
+{
+	assert(id < _passes.size());
+	return _passes[id].name;
+}
+
+const char*
+render_graph::resource_name(render_resource_id id) const
+{
+	assert(id < _resources.size());
+	return _resources[id].name;
+}
+
+bool
+render_graph::is_culled(render_pass_id id) const
+{
+	assert(_is_compiled && id < _passes.size());
+	return !_passes[id].is_live;
+}
+
+const render_graph::resource_info&
+render_graph::resource(render_resource_id id) const
+{
+	assert(_is_compiled && id < _resources.size());
+	return _resources[id].info;
+}
+
+const transient_resource_desc&
+render_graph::transient_desc(render_resource_id id) const
+{
+	assert(id < _resources.size() && _resources[id].info.is_transient);
+	return _resources[id].desc;
+}
+
+const render_barrier*
+render_graph::barriers(render_pass_id id, u32& count) const
+{
+	assert(_is_compiled);
+	if (!id::is_valid(id))
+	{
+		count = _final_barrier_count;
+		return count ? &_barriers[_final_first_barrier] : nullptr;
+	}
+	assert(id < _passes.size());
+	count = _passes[id].barrier_count;
+	return count ? &_barriers[_passes[id].first_barrier] : nullptr;
+}
+}
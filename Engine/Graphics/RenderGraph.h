@@ -0,0 +1,182 @@
+#pragma once
+#include "CommonHeaders.h"
+
+// A frame graph. Every frame, passes are added in execution order together with the
+// resources they read and write. compile() then
+//	- culls passes whose results are never used,
+//	- computes the lifetime of each transient resource, as the first and last pass using it,
+//	- places transient resources with disjoint lifetimes at overlapping offsets of one heap
+//	  per heap group, so they share memory,
+//	- and computes the barriers each pass needs, batched into one list per pass.
+// The graph doesn't know the graphics API. Backends provide the size and alignment of
+// transient resources, create them at the computed offsets and translate the barriers
+// (see Direct3D12\D3D12RenderGraph.h). Compiling doesn't need a GPU, so it can be measured
+// and tested headless.
+namespace ferraris::graphics {
+
+DEFINE_TYPED_ID(render_pass_id);
+DEFINE_TYPED_ID(render_resource_id);
+
+// How a pass uses a resource. This is also the state the resource is in for the pass.
+struct resource_usage {
+	enum flags : u32 {
+		none				= 0x00,
+		render_target		= 0x01,
+		depth_write			= 0x02,
+		depth_read			= 0x04,
+		shader_resource		= 0x08,
+		unordered_access	= 0x10,
+		copy_source			= 0x20,
+		copy_destination	= 0x40,
+		present				= 0x80,
+
+		write_mask			= render_target | depth_write | unordered_access | copy_destination,
+	};
+};
+
+struct render_barrier
+{
+	enum barrier_type : u32 {
+		transition,
+		aliasing,		// the resource starts using memory that another resource used before
+		uav,			// between two passes that both access the resource as an unordered access view
+	};
+
+	render_resource_id	resource{ id::invalid_id };
+	// For aliasing barriers: the last resource that used the memory before, or invalid if unknown.
+	// The content of the resource is undefined after an aliasing barrier, and 'after' is the state
+	// of its first use, which the resource is already in.
+	render_resource_id	resource_before{ id::invalid_id };
+	u32					before{ resource_usage::none };
+	u32					after{ resource_usage::none };
+	barrier_type		type{ transition };
+};
+
+struct transient_resource_desc
+{
+	u64 size;			// in bytes, as the backend will allocate it
+	u64 alignment;		// a power of two
+	// Resources are only placed in the same heap as resources of the same group,
+	// e.g. because the API requires separate heaps for render targets and buffers.
+	u32 heap_group;
+};
+
+struct render_graph_stats
+{
+	u32 pass_count;
+	u32 culled_pass_count;
+	u32 resource_count;
+	u32 transient_count;				// transient resources that are used by a pass that wasn't culled
+	u32 barrier_count;
+	u32 aliasing_barrier_count;
+	u64 transient_size;					// memory the transient resources need without aliasing
+	u64 heap_size;						// memory the heaps need with aliasing
+};
+
+class render_graph
+{
+public:
+	constexpr static u32 max_heap_groups{ 4 };
+
+	// 'data' is the pointer that was given to add_pass() and 'context' the one that was given
+	// to execute(), e.g. the command list of the backend.
+	using execute_function = void(*)(const render_graph& graph, render_pass_id pass, void* data, void* context);
+	// Called before a pass with all barriers it needs, and once more at the end of the graph.
+	using barrier_function = void(*)(const render_barrier* barriers, u32 count, void* context);
+
+	struct resource_info
+	{
+		u64	offset;						// in the heap of the resource's heap group
+		u32	first_pass;					// index of the first pass using the resource
+		u32	last_pass;					// index of the last pass using the resource
+		u32	initial_usage;				// state of the resource at the start and the end of the graph
+		bool is_transient;
+		bool is_used;					// false if all passes using the resource were culled
+	};
+
+	render_graph() = default;
+	DISABLE_COPY_AND_MOVE(render_graph);
+
+	// Removes all passes and resources, but keeps the memory for the next frame.
+	void reset();
+
+	// A resource that only lives during the graph and can share memory with other transient resources.
+	render_resource_id create(const char* name, const transient_resource_desc& desc);
+	// A resource that lives outside of the graph, e.g. a back buffer. It's in 'initial_usage' when
+	// the graph starts and is transitioned to 'final_usage' at the end. Passes that write to
+	// imported resources are never culled.
+	render_resource_id import(const char* name, u32 initial_usage, u32 final_usage);
+
+	// Passes execute in the order they're added. 'name' and 'data' must outlive the graph.
+	render_pass_id add_pass(const char* name, execute_function function, void* data = nullptr, bool has_side_effects = false);
+	void read(render_pass_id pass, render_resource_id resource, u32 usage);
+	void write(render_pass_id pass, render_resource_id resource, u32 usage);
+
+	// Returns false if the graph is invalid, i.e. a transient resource is read before it's written.
+	bool compile();
+	void execute(barrier_function barriers, void* context) const;
+
+	[[nodiscard]] u32 pass_count() const { return (u32)_passes.size(); }
+	[[nodiscard]] u32 resource_count() const { return (u32)_resources.size(); }
+	[[nodiscard]] const char* pass_name(render_pass_id id) const;
+	[[nodiscard]] const char* resource_name(render_resource_id id) const;
+	[[nodiscard]] bool is_culled(render_pass_id id) const;
+	[[nodiscard]] const resource_info& resource(render_resource_id id) const;
+	[[nodiscard]] const transient_resource_desc& transient_desc(render_resource_id id) const;
+	// Barriers before pass 'id', or after the last pass if 'id' is invalid.
+	[[nodiscard]] const render_barrier* barriers(render_pass_id id, u32& count) const;
+	[[nodiscard]] u64 heap_size(u32 heap_group) const { assert(heap_group < max_heap_groups); return _heap_sizes[heap_group]; }
+	[[nodiscard]] constexpr const render_graph_stats& stats() const { return _stats; }
+
+private:
+	struct pass_data
+	{
+		const char*			name;
+		execute_function	function;
+		void*				data;
+		u32					first_access;		// accesses sorted by pass, in _sorted_accesses
+		u32					access_count;
+		u32					first_barrier;
+		u32					barrier_count;
+		bool				has_side_effects;
+		bool				is_live;
+	};
+
+	struct resource_data
+	{
+		const char*				name;
+		transient_resource_desc	desc;
+		resource_info			info;
+		u32						final_usage;	// for imported resources
+		u32						first_access;	// accesses of this resource in pass order, in _resource_accesses
+		u32						access_count;
+	};
+
+	struct access
+	{
+		u32	pass;
+		u32	resource;
+		u32	usage;
+		u32	target;		// state the resource is transitioned to, which includes reads of the following passes
+	};
+
+	void cull_passes();
+	bool compute_lifetimes();
+	void place_transients();
+	void compute_barriers();
+
+	utl::vector<pass_data>			_passes;
+	utl::vector<resource_data>		_resources;
+	utl::vector<access>				_accesses;				// in the order read()/write() were called
+	utl::vector<access>				_sorted_accesses;		// by pass
+	utl::vector<u32>				_resource_accesses;		// indices into _sorted_accesses, by resource
+	utl::vector<render_barrier>		_barriers;
+	utl::vector<u32>				_scratch;
+	utl::vector<u32>				_placed;
+	u64								_heap_sizes[max_heap_groups]{};
+	u32								_final_first_barrier{ 0 };
+	u32								_final_barrier_count{ 0 };
+	render_graph_stats				_stats{};
+	bool							_is_compiled{ false };
+};
+}
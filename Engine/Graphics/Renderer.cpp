@@ -1,12 +1,15 @@
 #include "Renderer.h"
 #include "GraphicsPlatformInterface.h"
 #include "Direct3D12/D3D12Interface.h"
+#include "Null/NullInterface.h"
+#include "Core/FrameAllocator.h"
 
 namespace ferraris::graphics {
 namespace {
 // Define the array of compiled engine shaders file is located for each one of supported APIs.
 constexpr const char* engine_shader_paths[]{
 	".\\shaders\\d3d12\\shaders.bin",
+	"",	// the null backend doesn't use shaders
 	// ".\\shaders\vulkan\\shaders.bin", etc.
 };
 platform_interface gfx{};
@@ -19,6 +22,9 @@ set_platform_interface(graphics_platform platform)
 	case ferraris::graphics::graphics_platform::direct3d12:
 		d3d12::get_platform_interface(gfx);
 		break;
+	case ferraris::graphics::graphics_platform::null:
+		null::get_platform_interface(gfx);
+		break;
 	default:
 		return false;
 	}
@@ -33,13 +39,38 @@ initialize(graphics_platform platform)
 {
 	// Allocate the gfx interface according the Render API type
 	// and call the initialize the Pipeline
-	return set_platform_interface(platform) && gfx.initialize();
+	if (!set_platform_interface(platform) || !gfx.initialize()) return false;
+	if (!memory::initialize_frame_arenas())
+	{
+		gfx.shutdown();
+		return false;
+	}
+	return true;
 }
 
 void
 shutdown()
 {
 	gfx.shutdown();
+	memory::shutdown_frame_arenas();
+}
+
+void
+wait_for_display()
+{
+	gfx.wait_for_display();
+}
+
+void
+begin_frame()
+{
+	gfx.begin_frame();
+}
+
+void
+end_frame()
+{
+	gfx.end_frame();
 }
 
 surface
@@ -55,6 +86,25 @@ remove_surface(surface_id id)
 	gfx.surface.remove(id);
 }
 
+void
+set_frame_pacing(const frame_pacing& pacing)
+{
+	assert(pacing.is_valid());
+	if (pacing.is_valid()) gfx.pacing.set(pacing);
+}
+
+frame_pacing
+get_frame_pacing()
+{
+	return gfx.pacing.get();
+}
+
+frame_timing_stats
+get_frame_timing_stats()
+{
+	return gfx.pacing.stats();
+}
+
 const char* 
 get_engine_shaders_path()
 {
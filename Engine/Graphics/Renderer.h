@@ -20,6 +20,7 @@ public:
 	void resize(u32 width, u32 height) const;
 	u32 width() const;
 	u32 height() const;
+	// NOTE: only between begin_frame() and end_frame().
 	void render() const;
 
 private:
@@ -33,9 +34,55 @@ struct render_surface
 	surface surface{};
 };
 
+// The most frames the CPU can run ahead of the GPU. Backends keep this many of their per-frame
+// resources, like command allocators and deferred release lists.
+constexpr u32 max_frames_in_flight{ 3 };
+
+struct present_mode {
+	enum type : u32 {
+		vsync,			// present on the vertical blank, never tears
+		immediate,		// present right away, tears if the display supports it
+
+		count
+	};
+};
+
+// How far ahead of the GPU and the display the CPU may run. Fewer frames in flight and a lower
+// frame latency shorten the time from input to photons, but the CPU and the GPU wait for each
+// other more, which costs throughput.
+struct frame_pacing
+{
+	u32					frames_in_flight;	// 1 to max_frames_in_flight frames submitted to the GPU that it hasn't finished
+	u32					max_frame_latency;	// 1 to 16 frames queued for the display before rendering waits for it
+	present_mode::type	present_mode;
+
+	constexpr bool is_valid() const
+	{
+		return frames_in_flight && frames_in_flight <= max_frames_in_flight &&
+			max_frame_latency && max_frame_latency <= 16 && present_mode < present_mode::count;
+	}
+};
+
+namespace frame_pacing_preset {
+constexpr frame_pacing balanced{ max_frames_in_flight, 2, present_mode::vsync };	// the default
+constexpr frame_pacing low_latency{ 1, 1, present_mode::immediate };				// competitive modes
+constexpr frame_pacing throughput{ max_frames_in_flight, 3, present_mode::immediate };	// benchmark modes
+}
+
+// Averages over the last frames, in milliseconds.
+struct frame_timing_stats
+{
+	u64 frame_count;				// frames rendered since the stats were reset
+	f32 cpu_frame_time;				// from the start of one frame to the start of the next
+	f32 max_cpu_frame_time;
+	f32 cpu_wait_time;				// of cpu_frame_time, waiting for the GPU or the display
+	f32 gpu_frame_time;				// 0 if the backend doesn't measure it
+};
+
 enum class graphics_platform : u32
 {
 	direct3d12 = 0,
+	null,			// no GPU, see Null\NullCore.h
 };
 
 bool initialize(graphics_platform platform);
@@ -49,6 +96,24 @@ const char* get_engine_shaders_path();
 // The path is for the graphics API that's currently in use.
 const char* get_engine_shaders_path(graphics_platform platform);
 
+// A frame of the engine. Every surface is rendered between begin_frame() and end_frame(), and
+// they're all submitted to the GPU and presented together when the frame ends. Per-frame
+// resources, like the frame arena, the frame timing stats and the command contexts of the
+// backend, are per frame of the engine, not per surface.
+// NOTE: call these on the thread that renders.
+void begin_frame();
+void end_frame();
+// Blocks until every surface can queue another frame for the display. begin_frame() does this
+// first, unless it was already done since the last frame. Call it before sampling input, so
+// that the frame is based on input that's as recent as possible.
+void wait_for_display();
+
 surface create_surface(platform::window window);
 void remove_surface(surface_id id);
+
+// Frame pacing applies to all surfaces from their next frame on, and resets the timing stats.
+// NOTE: call these on the thread that renders.
+void set_frame_pacing(const frame_pacing& pacing);
+frame_pacing get_frame_pacing();
+frame_timing_stats get_frame_timing_stats();
 }
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "ShaderVariants.h"
+#include "Utilities/ConcurrentFreeList.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace ferraris::graphics::shader_variants {
+namespace {
+
+struct shader_data
+{
+	std::string					file;
+	std::string					function;
+	utl::deque<std::string>		feature_names;
+	utl::vector<const char*>	features;		// points into feature_names
+	shader_source				source{};		// points into the strings above
+	u64							feature_mask{ 0 };
+};
+
+struct variant_data
+{
+	std::atomic<u32>			state{ (u32)variant_state::pending };
+	utl::vector<u8>				byte_code;		// written by a worker before the state is set to ready
+	shader_id					shader{ id::invalid_id };
+	u64							features{ 0 };
+};
+
+// Layout of a file in the on-disk cache:
+//	cache_header
+//	for each dependency: u32 length, path
+//	byte code
+constexpr u32 max_variants{ 4096 };
+
+constexpr u32 cache_magic{ 0x43565346 }; // "FSVC"
+constexpr u32 cache_version{ 1 };
+
+struct cache_header
+{
+	u32 magic;
+	u32 version;
+	u64 key;
+	u64 source_hash;		// of the source file and all dependencies
+	u32 dependency_count;
+	u32 reserved;
+	u64 byte_code_size;
+};
+
+std::mutex												variants_mutex;
+std::condition_variable									work_ready;
+std::condition_variable									work_done;
+utl::vector<std::unique_ptr<shader_data>>				shaders;
+// Variants never move, so workers use them without holding the mutex.
+utl::concurrent_free_list<variant_data>					variants;
+utl::flat_map<u64, u32>									variant_indices;	// key -> index in variants
+utl::deque<u64>											queue;			// keys of variants that need a worker
+u32														pending_count{ 0 };
+bool													is_running{ false };
+utl::vector<std::thread>								workers;
+compiler_info											compiler{};
+std::filesystem::path									cache_directory{};
+variant_stats											stats{};
+
+u64
+get_variant_key(const shader_data& shader, u64 features)
+{
+	u64 hash{ utl::fnv1a_64((const char*)&compiler.version, sizeof(u64)) };
+	hash = utl::fnv1a_64(shader.file.c_str(), shader.file.size() + 1, hash);
+	hash = utl::fnv1a_64(shader.function.c_str(), shader.function.size() + 1, hash);
+	hash = utl::fnv1a_64((const char*)&shader.source.type, sizeof(u32), hash);
+	return utl::fnv1a_64((const char*)&features, sizeof(u64), hash);
+}
+
+// Adds the contents of a file to 'hash'. Returns false if the file can't be read.
+bool
+hash_file(const std::string& path, u64& hash)
+{
+	std::ifstream file{ path, std::ios::in | std::ios::binary };
+	if (!file) return false;
+	hash = utl::fnv1a_64(path.c_str(), path.size() + 1, hash);
+	char buffer[4096];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount())
+	{
+		hash = utl::fnv1a_64(buffer, (u64)file.gcount(), hash);
+	}
+	return true;
+}
+
+// Returns 0 if any file is missing, which never matches a stored hash.
+u64
+hash_sources(const shader_data& shader, const utl::deque<std::string>& dependencies)
+{
+	u64 hash{ utl::fnv1a_64_offset_basis };
+	if (!hash_file(shader.file, hash)) return 0;
+	for (const auto& dependency : dependencies)
+	{
+		if (!hash_file(dependency, hash)) return 0;
+	}
+	return hash ? hash : 1;
+}
+
+std::filesystem::path
+get_cache_path(u64 key)
+{
+	char name[32]{};
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return cache_directory / name;
+}
+
+template<typename T>
+bool
+read(std::ifstream& file, T& value)
+{
+	return (bool)file.read((char*)&value, sizeof(T));
+}
+
+template<typename T>
+void
+write(std::ofstream& file, const T& value)
+{
+	file.write((const char*)&value, sizeof(T));
+}
+
+bool
+load_from_cache(u64 key, const shader_data& shader, utl::vector<u8>& byte_code)
+{
+	if (cache_directory.empty()) return false;
+	std::ifstream file{ get_cache_path(key), std::ios::in | std::ios::binary };
+	cache_header header{};
+	if (!file || !read(file, header) || header.magic != cache_magic || header.version != cache_version ||
+		header.key != key || !header.byte_code_size || header.byte_code_size > (1ull << 30))
+	{
+		return false;
+	}
+
+	utl::deque<std::string> dependencies;
+	for (u32 i{ 0 }; i < header.dependency_count; ++i)
+	{
+		u32 length{ 0 };
+		if (!read(file, length) || length > 4096) return false;
+		std::string path(length, '\0');
+		if (!file.read(path.data(), length)) return false;
+		dependencies.emplace_back(std::move(path));
+	}
+	// The source or an include changed since the variant was compiled.
+	if (hash_sources(shader, dependencies) != header.source_hash) return false;
+
+	byte_code.resize(header.byte_code_size);
+	return (bool)file.read((char*)byte_code.data(), header.byte_code_size);
+}
+
+void
+store_in_cache(u64 key, const shader_data& shader, const utl::vector<u8>& byte_code, const utl::deque<std::string>& dependencies)
+{
+	if (cache_directory.empty()) return;
+	const cache_header header{ cache_magic, cache_version, key, hash_sources(shader, dependencies),
+		(u32)dependencies.size(), 0, byte_code.size() };
+	if (!header.source_hash) return;
+
+	// Write to a temporary file first, so that other processes never see a partial file.
+	const std::filesystem::path path{ get_cache_path(key) };
+	std::filesystem::path temp_path{ path };
+	temp_path += ".tmp";
+	{
+		std::ofstream file{ temp_path, std::ios::out | std::ios::binary | std::ios::trunc };
+		write(file, header);
+		for (const auto& dependency : dependencies)
+		{
+			write(file, (u32)dependency.size());
+			file.write(dependency.c_str(), dependency.size());
+		}
+		file.write((const char*)byte_code.data(), byte_code.size());
+		if (!file) return;
+	}
+	std::error_code error;
+	std::filesystem::rename(temp_path, path, error);
+	if (error) std::filesystem::remove(temp_path, error);
+}
+
+void
+worker()
+{
+	while (true)
+	{
+		u64 key{ 0 };
+		variant_data* variant{ nullptr };
+		const shader_data* shader{ nullptr };
+		{
+			std::unique_lock lock{ variants_mutex };
+			work_ready.wait(lock, []() { return !queue.empty() || !is_running; });
+			if (!is_running) return;
+			key = queue.front();
+			queue.pop_front();
+			variant = &variants[variant_indices.find(key)->second];
+			shader = shaders[variant->shader].get();
+		}
+
+		// Neither the variant nor the shader are moved or removed while workers run.
+		utl::vector<u8> byte_code;
+		bool is_cached{ load_from_cache(key, *shader, byte_code) };
+		bool result{ is_cached };
+		if (!is_cached)
+		{
+			utl::deque<std::string> dependencies;
+			const compile_request request{ &shader->source, variant->features, key };
+			result = compiler.compile(request, byte_code, dependencies) && !byte_code.empty();
+			if (result) store_in_cache(key, *shader, byte_code, dependencies);
+		}
+
+		variant->byte_code = std::move(byte_code);
+		variant->state.store((u32)(result ? variant_state::ready : variant_state::failed), std::memory_order_release);
+
+		std::lock_guard lock{ variants_mutex };
+		if (is_cached) ++stats.disk_hits;
+		else if (result) ++stats.compiles;
+		else ++stats.failures;
+		--pending_count;
+		work_done.notify_all();
+	}
+}
+} // anonymous namespace
+
+bool
+initialize(const compiler_info& info, const char* directory, u32 worker_count)
+{
+	assert(info.compile);
+	assert(!is_running);
+	if (!info.compile || is_running) return false;
+	compiler = info;
+
+	cache_directory.clear();
+	if (directory)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		if (!error) cache_directory = directory;
+	}
+
+	if (!worker_count)
+	{
+		const u32 hardware_threads{ std::thread::hardware_concurrency() };
+		worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+	}
+	variants.initialize(max_variants);
+	is_running = true;
+	for (u32 i{ 0 }; i < worker_count; ++i) workers.emplace_back(worker);
+	return true;
+}
+
+void
+shutdown()
+{
+	{
+		std::lock_guard lock{ variants_mutex };
+		is_running = false;
+	}
+	work_ready.notify_all();
+	for (auto& thread : workers) thread.join();
+	workers.clear();
+	queue.clear();
+	pending_count = 0;
+	for (auto& [key, index] : variant_indices) variants.remove(index);
+	variant_indices.clear();
+	variants.release();
+	shaders.clear();
+	stats = {};
+}
+
+shader_id
+add_shader(const shader_source& source)
+{
+	assert(source.file && source.function);
+	assert(source.feature_count <= max_features);
+	std::unique_ptr<shader_data> shader{ std::make_unique<shader_data>() };
+	shader->file = source.file;
+	shader->function = source.function;
+	for (u32 i{ 0 }; i < source.feature_count; ++i) shader->feature_names.emplace_back(source.features[i]);
+	for (const auto& name : shader->feature_names) shader->features.emplace_back(name.c_str());
+	shader->source = { shader->file.c_str(), shader->function.c_str(), source.type,
+		shader->features.data(), source.feature_count };
+	shader->feature_mask = source.feature_count == max_features ? ~0ull : (1ull << source.feature_count) - 1;
+
+	std::lock_guard lock{ variants_mutex };
+	shaders.emplace_back(std::move(shader));
+	return shader_id{ (id::id_type)(shaders.size() - 1) };
+}
+
+u64
+request(shader_id id, u64 features)
+{
+	std::lock_guard lock{ variants_mutex };
+	if (!is_running || !id::is_valid(id) || id >= shaders.size()) return 0;
+	const shader_data& shader{ *shaders[id] };
+	features &= shader.feature_mask;
+	const u64 key{ get_variant_key(shader, features) };
+	++stats.requests;
+
+	if (variant_indices.contains(key))
+	{
+		++stats.memory_hits;
+		return key;
+	}
+
+	const u32 index{ variants.add() };
+	if (index == u32_invalid_id) return 0;
+	variant_data& variant{ variants[index] };
+	variant.shader = id;
+	variant.features = features;
+	variant_indices.emplace(key, index);
+	queue.emplace_back(key);
+	++pending_count;
+	work_ready.notify_one();
+	return key;
+}
+
+variant
+get(u64 key)
+{
+	std::lock_guard lock{ variants_mutex };
+	auto it{ variant_indices.find(key) };
+	if (it == variant_indices.end()) return { variant_state::failed, nullptr, 0 };
+	const variant_data& data{ variants[it->second] };
+	const variant_state state{ (variant_state)data.state.load(std::memory_order_acquire) };
+	if (state != variant_state::ready) return { state, nullptr, 0 };
+	return { state, data.byte_code.data(), data.byte_code.size() };
+}
+
+void
+wait_idle()
+{
+	std::unique_lock lock{ variants_mutex };
+	work_done.wait(lock, []() { return !pending_count; });
+}
+
+variant_stats
+get_stats()
+{
+	std::lock_guard lock{ variants_mutex };
+	return stats;
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <string>
+
+// Shader permutations. A shader is registered once with the list of its optional
+// features, each feature is a define that's set to 1 when its bit is set. A variant
+// is the shader compiled with one set of feature bits, identified by a key that's
+// a hash of the shader and the bits.
+//
+// Variants are compiled on demand by worker threads, using the compiler the application
+// provides (e.g. the DXC wrapper in EngineTest). Compiled variants are kept in memory
+// and in an on-disk cache, together with the files they included, so a variant is only
+// compiled again after its source or one of its includes changed.
+namespace ferraris::graphics::shader_variants {
+
+DEFINE_TYPED_ID(shader_id);
+
+constexpr u32 max_features{ 64 };
+
+struct shader_source
+{
+	const char*			file{ nullptr };		// path to the source file
+	const char*			function{ nullptr };	// entry function
+	u32					type{ 0 };				// shader type of the backend, e.g. d3d12::shaders::shader_type
+	const char* const*	features{ nullptr };	// name of the define for each feature bit
+	u32					feature_count{ 0 };
+};
+
+struct compile_request
+{
+	const shader_source*	source;
+	u64						features;
+	u64						key;
+};
+
+// Called on a worker thread. Fills 'byte_code' and the paths of all files that were
+// included, and returns false if compilation fails. Every worker calls it on its own
+// thread, so compilers that can't be shared must be per thread.
+// NOTE: utl::vector moves its items with realloc(), which std::string doesn't allow.
+using compile_function = bool(*)(const compile_request& request, utl::vector<u8>& byte_code, utl::deque<std::string>& dependencies);
+
+struct compiler_info
+{
+	compile_function	compile{ nullptr };
+	// Part of every variant key. Change it when the compiler or its settings change,
+	// so variants in the on-disk cache that were compiled differently aren't used.
+	u64					version{ 0 };
+};
+
+enum class variant_state : u32
+{
+	pending,
+	ready,
+	failed,
+};
+
+struct variant
+{
+	variant_state	state{ variant_state::pending };
+	const u8*		byte_code{ nullptr };	// valid until shutdown()
+	u64				size{ 0 };
+};
+
+struct variant_stats
+{
+	u64 requests;
+	u64 memory_hits;
+	u64 disk_hits;
+	u64 compiles;
+	u64 failures;
+};
+
+// 'worker_count' 0 uses one thread per hardware thread, less one for the main thread.
+bool initialize(const compiler_info& compiler, const char* cache_directory, u32 worker_count = 0);
+void shutdown();
+
+// The source, including the feature names, is copied.
+shader_id add_shader(const shader_source& source);
+
+// Returns the key of the variant of 'id' with 'features', and starts compiling it
+// if it's not in memory yet. Returns 0 if the system isn't running, 'id' is unknown or
+// there's no room for more variants. Bits above the feature count of the shader are ignored.
+u64 request(shader_id id, u64 features);
+// Non-blocking. A pending variant should be drawn with a fallback, e.g. the variant without features.
+variant get(u64 key);
+// Block until every requested variant is either ready or failed.
+void wait_idle();
+variant_stats get_stats();
+}
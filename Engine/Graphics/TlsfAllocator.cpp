@@ -0,0 +1,311 @@
+#include "TlsfAllocator.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ferraris::graphics {
+namespace {
+
+u32
+lowest_bit(u64 mask)
+{
+	assert(mask);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctzll(mask);
+#endif
+}
+
+u32
+highest_bit(u64 mask)
+{
+	assert(mask);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, mask);
+	return (u32)index;
+#else
+	return 63 - (u32)__builtin_clzll(mask);
+#endif
+}
+
+constexpr u64
+align_up(u64 value, u64 alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // anonymous namespace
+
+void
+tlsf_allocator::initialize(u64 capacity, u64 granularity)
+{
+	assert(capacity && granularity && !(granularity & (granularity - 1)));
+	_granularity = granularity;
+	_granularity_shift = highest_bit(granularity);
+	_capacity = capacity & ~(granularity - 1);
+	assert(_capacity);
+	_used = 0;
+	_allocation_count = 0;
+	_free_block_count = 0;
+	_fl_bitmap = 0;
+	_blocks.clear();
+	_unused_block = u32_invalid_id;
+	for (u32 fl{ 0 }; fl < fl_count; ++fl)
+	{
+		_sl_bitmaps[fl] = 0;
+		for (u32 sl{ 0 }; sl < sl_count; ++sl) _free_lists[fl][sl] = u32_invalid_id;
+	}
+
+	// All memory starts out as one free block.
+	const u32 index{ create_block() };
+	block& b{ _blocks[index] };
+	b.offset = 0;
+	b.size = _capacity;
+	insert_free_block(index);
+}
+
+tlsf_allocator::allocation
+tlsf_allocator::allocate(u64 size, u64 alignment)
+{
+	assert(size && alignment && !(alignment & (alignment - 1)));
+	assert(_capacity);
+	size = align_up(size, _granularity);
+	alignment = alignment > _granularity ? alignment : _granularity;
+	if (size > _capacity - _used) return { invalid_offset, 0, u32_invalid_id };
+
+	// A block of the size class usually fits, because heaps and most of their allocations share
+	// the same alignment. If it doesn't, look for one that also has room for the padding.
+	u32 index{ find_free_block(size) };
+	if (index != u32_invalid_id && align_up(_blocks[index].offset, alignment) + size > _blocks[index].offset + _blocks[index].size)
+	{
+		index = find_free_block(size + alignment - _granularity);
+		// Smaller blocks may still have room at an aligned offset. Only look when memory runs out.
+		if (index == u32_invalid_id) index = find_aligned_block(size, alignment);
+	}
+	if (index == u32_invalid_id) return { invalid_offset, 0, u32_invalid_id };
+
+	remove_free_block(index);
+	const u64 padding{ align_up(_blocks[index].offset, alignment) - _blocks[index].offset };
+	if (padding)
+	{
+		// Return the padding in front as a free block of its own. The block before it is in use,
+		// since free neighbours are always merged, so there's nothing to merge with.
+		split(index, padding);
+		const u32 front{ index };
+		index = _blocks[front].next_physical;
+		insert_free_block(front);
+	}
+	if (_blocks[index].size > size)
+	{
+		split(index, size);
+		insert_free_block(_blocks[index].next_physical);
+	}
+
+	block& b{ _blocks[index] };
+	b.is_free = false;
+	_used += b.size;
+	++_allocation_count;
+	return { b.offset, b.size, index };
+}
+
+void
+tlsf_allocator::free(const allocation& allocation)
+{
+	assert(allocation.is_valid() && allocation.block < _blocks.size());
+	u32 index{ allocation.block };
+	assert(!_blocks[index].is_free && _blocks[index].offset == allocation.offset);
+	_used -= _blocks[index].size;
+	--_allocation_count;
+
+	// Merge with the free neighbours.
+	const u32 prev{ _blocks[index].prev_physical };
+	if (prev != u32_invalid_id && _blocks[prev].is_free)
+	{
+		remove_free_block(prev);
+		_blocks[prev].size += _blocks[index].size;
+		_blocks[prev].next_physical = _blocks[index].next_physical;
+		if (_blocks[index].next_physical != u32_invalid_id) _blocks[_blocks[index].next_physical].prev_physical = prev;
+		destroy_block(index);
+		index = prev;
+	}
+	const u32 next{ _blocks[index].next_physical };
+	if (next != u32_invalid_id && _blocks[next].is_free)
+	{
+		remove_free_block(next);
+		_blocks[index].size += _blocks[next].size;
+		_blocks[index].next_physical = _blocks[next].next_physical;
+		if (_blocks[next].next_physical != u32_invalid_id) _blocks[_blocks[next].next_physical].prev_physical = index;
+		destroy_block(next);
+	}
+	insert_free_block(index);
+}
+
+tlsf_allocator::allocator_stats
+tlsf_allocator::stats() const
+{
+	allocator_stats stats{ _capacity, _used, 0, _allocation_count, _free_block_count };
+	if (_fl_bitmap)
+	{
+		// The largest free block is in the highest non-empty size class.
+		const u32 fl{ highest_bit(_fl_bitmap) };
+		const u32 sl{ highest_bit(_sl_bitmaps[fl]) };
+		for (u32 index{ _free_lists[fl][sl] }; index != u32_invalid_id; index = _blocks[index].next_free)
+		{
+			stats.largest_free_block = _blocks[index].size > stats.largest_free_block ? _blocks[index].size : stats.largest_free_block;
+		}
+	}
+	return stats;
+}
+
+// Size classes are based on the size in units of the granularity. Sizes below sl_count units
+// have a class each, larger sizes share a class with those in the same 1/16th of their power of two.
+void
+tlsf_allocator::mapping(u64 size, u32& fl, u32& sl) const
+{
+	const u64 units{ size >> _granularity_shift };
+	if (units < sl_count)
+	{
+		fl = 0;
+		sl = (u32)units;
+	}
+	else
+	{
+		const u32 msb{ highest_bit(units) };
+		fl = msb - sl_bits + 1;
+		sl = (u32)(units >> (msb - sl_bits)) - sl_count;
+	}
+}
+
+// Returns a free block of at least 'size' bytes, or u32_invalid_id if there's none.
+u32
+tlsf_allocator::find_free_block(u64 size) const
+{
+	// Round the size up to the next size class, so that every block in the class is large enough.
+	const u64 units{ size >> _granularity_shift };
+	if (units >= sl_count) size += ((1ull << (highest_bit(units) - sl_bits)) - 1) << _granularity_shift;
+	u32 fl, sl;
+	mapping(size, fl, sl);
+	if (fl >= fl_count) return u32_invalid_id;
+
+	u32 sl_bitmap{ _sl_bitmaps[fl] & (~0u << sl) };
+	if (!sl_bitmap)
+	{
+		// Nothing in this power of two: take the smallest class of the next non-empty one.
+		const u64 fl_bitmap{ fl + 1 < 64 ? _fl_bitmap & (~0ull << (fl + 1)) : 0 };
+		if (!fl_bitmap) return u32_invalid_id;
+		fl = lowest_bit(fl_bitmap);
+		sl_bitmap = _sl_bitmaps[fl];
+	}
+	sl = lowest_bit(sl_bitmap);
+	assert(_free_lists[fl][sl] != u32_invalid_id);
+	return _free_lists[fl][sl];
+}
+
+// Returns the first free block that fits 'size' bytes at an offset aligned to 'alignment', or
+// u32_invalid_id. Goes through the free lists one by one, so it's only used as a last resort.
+u32
+tlsf_allocator::find_aligned_block(u64 size, u64 alignment) const
+{
+	u32 fl, sl;
+	mapping(size, fl, sl);
+	for (; fl < fl_count; ++fl, sl = 0)
+	{
+		for (u32 sl_bitmap{ _sl_bitmaps[fl] & (~0u << sl) }; sl_bitmap; sl_bitmap &= sl_bitmap - 1)
+		{
+			for (u32 index{ _free_lists[fl][lowest_bit(sl_bitmap)] }; index != u32_invalid_id; index = _blocks[index].next_free)
+			{
+				const block& b{ _blocks[index] };
+				if (align_up(b.offset, alignment) + size <= b.offset + b.size) return index;
+			}
+		}
+	}
+	return u32_invalid_id;
+}
+
+u32
+tlsf_allocator::create_block()
+{
+	u32 index{ _unused_block };
+	if (index != u32_invalid_id)
+	{
+		_unused_block = _blocks[index].next_free;
+	}
+	else
+	{
+		index = (u32)_blocks.size();
+		_blocks.emplace_back();
+	}
+	_blocks[index] = { 0, 0, u32_invalid_id, u32_invalid_id, u32_invalid_id, u32_invalid_id, false };
+	return index;
+}
+
+void
+tlsf_allocator::destroy_block(u32 index)
+{
+	_blocks[index].next_free = _unused_block;
+	_blocks[index].is_free = false;
+	_unused_block = index;
+}
+
+void
+tlsf_allocator::insert_free_block(u32 index)
+{
+	block& b{ _blocks[index] };
+	u32 fl, sl;
+	mapping(b.size, fl, sl);
+	b.is_free = true;
+	b.prev_free = u32_invalid_id;
+	b.next_free = _free_lists[fl][sl];
+	if (b.next_free != u32_invalid_id) _blocks[b.next_free].prev_free = index;
+	_free_lists[fl][sl] = index;
+	_fl_bitmap |= 1ull << fl;
+	_sl_bitmaps[fl] |= 1u << sl;
+	++_free_block_count;
+}
+
+void
+tlsf_allocator::remove_free_block(u32 index)
+{
+	block& b{ _blocks[index] };
+	assert(b.is_free);
+	if (b.prev_free != u32_invalid_id) _blocks[b.prev_free].next_free = b.next_free;
+	if (b.next_free != u32_invalid_id) _blocks[b.next_free].prev_free = b.prev_free;
+
+	u32 fl, sl;
+	mapping(b.size, fl, sl);
+	if (_free_lists[fl][sl] == index)
+	{
+		_free_lists[fl][sl] = b.next_free;
+		if (b.next_free == u32_invalid_id)
+		{
+			_sl_bitmaps[fl] &= ~(1u << sl);
+			if (!_sl_bitmaps[fl]) _fl_bitmap &= ~(1ull << fl);
+		}
+	}
+	b.is_free = false;
+	--_free_block_count;
+}
+
+// Splits the first 'size' bytes off a block that isn't in a free list. The rest becomes a new
+// block after it, which isn't in a free list either.
+void
+tlsf_allocator::split(u32 index, u64 size)
+{
+	assert(size && size < _blocks[index].size && !(size & (_granularity - 1)));
+	const u32 rest{ create_block() };
+	// create_block() may have moved the blocks.
+	block& b{ _blocks[index] };
+	block& r{ _blocks[rest] };
+	r.offset = b.offset + size;
+	r.size = b.size - size;
+	r.prev_physical = index;
+	r.next_physical = b.next_physical;
+	if (b.next_physical != u32_invalid_id) _blocks[b.next_physical].prev_physical = rest;
+	b.next_physical = rest;
+	b.size = size;
+}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace ferraris::graphics {
+
+/**
+* Two-level segregated fit (TLSF) sub-allocator for a range of memory it never touches, e.g. a GPU
+* heap. Free blocks are kept in lists by size class: the first level is the power of two of the
+* size and the second level splits every power of two into 16 classes. A bitmap of non-empty lists
+* per level finds a large enough free block with a couple of bit scans, and a freed block is merged
+* with its free neighbours right away, so neither allocate() nor free() ever searches.
+*
+* The block headers live in a vector instead of the memory itself, because the CPU can't write to
+* GPU memory. Allocations are identified by the index of their block. Offsets and sizes are
+* multiples of the granularity given to initialize(). It's not thread-safe.
+*/
+class tlsf_allocator
+{
+public:
+	constexpr static u64 invalid_offset{ ~0ull };
+
+	struct allocation
+	{
+		u64 offset;
+		u64 size;		// rounded up to the granularity
+		u32 block;
+		constexpr bool is_valid() const { return offset != invalid_offset; }
+	};
+
+	struct allocator_stats
+	{
+		u64 capacity;
+		u64 used;
+		u64 largest_free_block;
+		u32 allocation_count;
+		u32 free_block_count;
+
+		// 0 if all free memory is in one block, approaching 1 as it's split into ever smaller blocks.
+		constexpr f32 fragmentation() const
+		{
+			const u64 free{ capacity - used };
+			return free ? 1.f - (f32)largest_free_block / (f32)free : 0.f;
+		}
+	};
+
+	tlsf_allocator() = default;
+	DISABLE_COPY_AND_MOVE(tlsf_allocator);
+
+	// 'granularity' must be a power of two. Frees all allocations.
+	void initialize(u64 capacity, u64 granularity);
+
+	// Returns an invalid allocation if there's no free block large enough.
+	// 'alignment' must be a power of two.
+	[[nodiscard]] allocation allocate(u64 size, u64 alignment);
+	void free(const allocation& allocation);
+
+	[[nodiscard]] allocator_stats stats() const;
+	[[nodiscard]] constexpr u64 capacity() const { return _capacity; }
+	[[nodiscard]] constexpr u64 used() const { return _used; }
+	[[nodiscard]] constexpr u32 allocation_count() const { return _allocation_count; }
+	[[nodiscard]] constexpr bool empty() const { return !_allocation_count; }
+
+private:
+	constexpr static u32 sl_bits{ 4 };
+	constexpr static u32 sl_count{ 1 << sl_bits };
+	constexpr static u32 fl_count{ 64 - sl_bits + 1 };
+
+	struct block
+	{
+		u64 offset;
+		u64 size;
+		u32 prev_physical;		// the neighbours in memory
+		u32 next_physical;
+		u32 prev_free;			// the neighbours in the free list of the block's size class
+		u32 next_free;			// also links unused headers
+		bool is_free;
+	};
+
+	void mapping(u64 size, u32& fl, u32& sl) const;
+	u32 find_free_block(u64 size) const;
+	u32 find_aligned_block(u64 size, u64 alignment) const;
+	u32 create_block();
+	void destroy_block(u32 index);
+	void insert_free_block(u32 index);
+	void remove_free_block(u32 index);
+	void split(u32 index, u64 size);
+
+	utl::vector<block>	_blocks;
+	u32					_unused_block{ u32_invalid_id };
+	u32					_free_lists[fl_count][sl_count];
+	u32					_sl_bitmaps[fl_count];
+	u64					_fl_bitmap{ 0 };
+	u64					_capacity{ 0 };
+	u64					_granularity{ 1 };
+	u32					_granularity_shift{ 0 };
+	u64					_used{ 0 };
+	u32					_allocation_count{ 0 };
+	u32					_free_block_count{ 0 };
+};
+}
@@ -0,0 +1,60 @@
+#include "UploadRing.h"
+
+namespace ferraris::graphics {
+
+void
+upload_ring::initialize(u64 capacity)
+{
+	assert(capacity);
+	_submissions.clear();
+	_capacity = capacity;
+	_head = 0;
+	_used = 0;
+	_pending = 0;
+}
+
+u64
+upload_ring::allocate(u64 size, u64 alignment)
+{
+	assert(size && alignment && !(alignment & (alignment - 1)));
+	if (size > _capacity) return invalid_offset;
+
+	u64 offset{ (_head + alignment - 1) & ~(alignment - 1) };
+	u64 skipped{ offset - _head };
+	if (offset + size > _capacity)
+	{
+		offset = 0;
+		skipped = _capacity - _head;
+	}
+	// The free memory always starts at the head, so the allocation fits if the
+	// memory it skips and the allocation itself are free.
+	if (_used + skipped + size > _capacity) return invalid_offset;
+
+	_head = offset + size;
+	_used += skipped + size;
+	_pending += skipped + size;
+	return offset;
+}
+
+void
+upload_ring::submit(u64 fence_value)
+{
+	if (!_pending) return;
+	assert(_submissions.empty() || _submissions.back().fence_value < fence_value);
+	_submissions.push_back({ fence_value, _pending });
+	_pending = 0;
+}
+
+void
+upload_ring::retire(u64 completed_fence_value)
+{
+	while (!_submissions.empty() && _submissions.front().fence_value <= completed_fence_value)
+	{
+		assert(_used >= _submissions.front().size);
+		_used -= _submissions.front().size;
+		_submissions.pop_front();
+	}
+	// Start over at the beginning when the ring is empty, so the next allocations don't have to skip memory.
+	if (!_used) _head = 0;
+}
+}
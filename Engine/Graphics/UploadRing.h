@@ -0,0 +1,55 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace ferraris::graphics {
+
+/**
+* Sub-allocates a buffer the CPU writes and the GPU reads, e.g. a persistently mapped upload
+* buffer, as a ring. Allocations are made at the head of the ring. Everything that was allocated
+* since the last submit() is in use until the GPU reaches the fence value given to submit(), and
+* retire() frees it once it has. An allocation that doesn't fit before the end of the buffer
+* starts at the beginning, and the space at the end is freed with it.
+*
+* The ring only deals with offsets and fence values, so it doesn't depend on a graphics API.
+* It's not thread-safe.
+*/
+class upload_ring
+{
+public:
+	constexpr static u64 invalid_offset{ ~0ull };
+
+	upload_ring() = default;
+	DISABLE_COPY_AND_MOVE(upload_ring);
+
+	void initialize(u64 capacity);
+
+	// Returns invalid_offset if there isn't enough free memory, until older submissions are retired.
+	// 'alignment' must be a power of two.
+	[[nodiscard]] u64 allocate(u64 size, u64 alignment);
+	// Fence values must increase with each submit.
+	void submit(u64 fence_value);
+	// Frees the memory of all submissions whose fence value is at most 'completed_fence_value'.
+	void retire(u64 completed_fence_value);
+
+	// The fence value the oldest submission waits for, or 0 if nothing was submitted.
+	[[nodiscard]] u64 oldest_fence_value() const { return _submissions.empty() ? 0 : _submissions.front().fence_value; }
+	[[nodiscard]] constexpr u64 capacity() const { return _capacity; }
+	// Including the space that was skipped at the end of the buffer.
+	[[nodiscard]] constexpr u64 used() const { return _used; }
+	// Allocated since the last submit.
+	[[nodiscard]] constexpr u64 pending() const { return _pending; }
+
+private:
+	struct submission
+	{
+		u64 fence_value;
+		u64 size;
+	};
+
+	utl::deque<submission>	_submissions;
+	u64						_capacity{ 0 };
+	u64						_head{ 0 };
+	u64						_used{ 0 };
+	u64						_pending{ 0 };
+};
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include "CommonHeaders.h"
+
+// Block compression for content files.
+//
+// The compressor is an LZ77 variant with the LZ4 block encoding: fast to decode
+// and with a moderate compression ratio. Data is split into chunks that are
+// compressed independently, so they can be decompressed in any order and on
+// different threads, as soon as their bytes have been read.
+//
+// NOTE: this header is used by the engine and by ContentTools, so it must not
+//		 depend on anything but CommonHeaders.h.
+namespace ferraris::compression {
+
+// Container layout:
+//	container_header
+//	chunk_info[chunk_count]
+//	compressed chunks
+constexpr u32 container_magic{ 0x504d4346 }; // "FCMP"
+constexpr u32 container_version{ 1 };
+constexpr u32 default_chunk_size{ 256 * 1024 };
+// Matches reach back at most 64 KB (offsets are 16-bit), whatever the size of a chunk. The limit
+// bounds the memory needed to decompress a chunk and lets get_header() reject corrupt headers.
+constexpr u32 max_chunk_size{ 1024 * 1024 };
+
+struct container_header
+{
+	u32 magic;
+	u32 version;
+	u64 uncompressed_size;
+	u32 chunk_size;		// uncompressed size of every chunk except the last one
+	u32 chunk_count;
+};
+
+struct chunk_info
+{
+	u64 offset;				// from the start of the container
+	u32 compressed_size;	// same as uncompressed_size if the chunk is stored as is
+	u32 uncompressed_size;
+};
+
+namespace detail {
+
+constexpr u32 min_match{ 4 };
+constexpr u32 max_offset{ 65535 };
+// The last match must start at least 12 bytes before the end of a block,
+// and the last 5 bytes are always literals (same rules as LZ4).
+constexpr u32 match_limit{ 12 };
+constexpr u32 last_literals{ 5 };
+constexpr u32 hash_bits{ 16 };
+
+inline u32
+read32(const u8* p)
+{
+	u32 value;
+	memcpy(&value, p, sizeof(u32));
+	return value;
+}
+
+constexpr u32
+hash4(u32 sequence)
+{
+	return (sequence * 2654435761u) >> (32 - hash_bits);
+}
+
+inline u8*
+write_length(u8* dst, u32 length)
+{
+	while (length >= 255)
+	{
+		*dst++ = 255;
+		length -= 255;
+	}
+	*dst++ = (u8)length;
+	return dst;
+}
+} // detail namespace
+
+// Number of entries of the hash table that compress_block() uses.
+constexpr u32 hash_table_size{ 1 << detail::hash_bits };
+
+// Worst case size of a compressed block of 'size' bytes.
+constexpr u64
+compress_block_bound(u64 size)
+{
+	return size + size / 255 + 16;
+}
+
+// Compress one block. 'table' is scratch memory of hash_table_size entries, which the caller
+// can reuse for every block. Returns the compressed size, or 0 if the result doesn't fit in 'capacity'.
+inline u32
+compress_block(const u8* const src, const u32 size, u8* const dst, const u32 capacity, u32* const table)
+{
+	using namespace detail;
+	assert(table);
+	if (capacity < compress_block_bound(size)) return 0;
+
+	memset(table, 0, hash_table_size * sizeof(u32));
+	u8* out{ dst };
+	const u8* anchor{ src };
+	const u8* const end{ src + size };
+
+	if (size > match_limit)
+	{
+		const u8* const limit{ end - match_limit };
+		const u8* at{ src };
+		// Positions are stored + 1, so that 0 means empty.
+		while (at < limit)
+		{
+			const u32 sequence{ read32(at) };
+			const u32 h{ hash4(sequence) };
+			const u8* const candidate{ table[h] ? src + table[h] - 1 : nullptr };
+			table[h] = (u32)(at - src) + 1;
+
+			if (!candidate || at - candidate > max_offset || read32(candidate) != sequence)
+			{
+				++at;
+				continue;
+			}
+
+			// Extend the match, but leave the last literals alone.
+			const u8* match_end{ at + min_match };
+			const u8* ref{ candidate + min_match };
+			const u8* const match_limit_ptr{ end - last_literals };
+			while (match_end < match_limit_ptr && *match_end == *ref) { ++match_end; ++ref; }
+
+			const u32 literal_length{ (u32)(at - anchor) };
+			const u32 match_length{ (u32)(match_end - at) - min_match };
+			u8* const token{ out++ };
+			*token = (u8)((literal_length < 15 ? literal_length : 15) << 4);
+			if (literal_length >= 15) out = write_length(out, literal_length - 15);
+			memcpy(out, anchor, literal_length); out += literal_length;
+
+			const u16 offset{ (u16)(at - candidate) };
+			memcpy(out, &offset, sizeof(u16)); out += sizeof(u16);
+			*token |= (u8)(match_length < 15 ? match_length : 15);
+			if (match_length >= 15) out = write_length(out, match_length - 15);
+
+			at = match_end;
+			anchor = at;
+		}
+	}
+
+	// Last sequence: only literals.
+	const u32 literal_length{ (u32)(end - anchor) };
+	*out++ = (u8)((literal_length < 15 ? literal_length : 15) << 4);
+	if (literal_length >= 15) out = write_length(out, literal_length - 15);
+	memcpy(out, anchor, literal_length); out += literal_length;
+
+	assert((u64)(out - dst) <= capacity);
+	return (u32)(out - dst);
+}
+
+// Decompress one block. Every read and write is checked, so corrupt data fails
+// instead of writing out of bounds. Returns false unless exactly 'dst_size' bytes were decoded.
+inline bool
+decompress_block(const u8* const src, const u32 src_size, u8* const dst, const u32 dst_size)
+{
+	const u8* in{ src };
+	const u8* const in_end{ src + src_size };
+	u8* out{ dst };
+	u8* const out_end{ dst + dst_size };
+
+	while (in < in_end)
+	{
+		const u8 token{ *in++ };
+
+		u32 literal_length{ (u32)(token >> 4) };
+		if (literal_length == 15)
+		{
+			u8 b;
+			do
+			{
+				if (in >= in_end) return false;
+				b = *in++;
+				literal_length += b;
+			} while (b == 255);
+		}
+		if ((u64)(in_end - in) < literal_length || (u64)(out_end - out) < literal_length) return false;
+		memcpy(out, in, literal_length);
+		in += literal_length;
+		out += literal_length;
+
+		// The last sequence has no match.
+		if (in == in_end) break;
+
+		if (in_end - in < 2) return false;
+		u16 offset;
+		memcpy(&offset, in, sizeof(u16)); in += sizeof(u16);
+		if (!offset || offset > out - dst) return false;
+
+		u32 match_length{ (u32)(token & 15) };
+		if (match_length == 15)
+		{
+			u8 b;
+			do
+			{
+				if (in >= in_end) return false;
+				b = *in++;
+				match_length += b;
+			} while (b == 255);
+		}
+		match_length += detail::min_match;
+		if ((u64)(out_end - out) < match_length) return false;
+
+		// A match may overlap the bytes it produces, i.e. it repeats the last 'offset' bytes.
+		// Copy what's already there and double the copied size each time, so that short
+		// repeats don't turn into byte-by-byte copies.
+		const u8* const ref{ out - offset };
+		while (match_length)
+		{
+			const u32 available{ (u32)(out - ref) };
+			const u32 n{ available < match_length ? available : match_length };
+			memcpy(out, ref, n);
+			out += n;
+			match_length -= n;
+		}
+	}
+	return out == out_end;
+}
+
+// Worst case size of a container for 'size' bytes of data.
+constexpr u64
+compress_bound(u64 size, u32 chunk_size = default_chunk_size)
+{
+	const u64 chunk_count{ (size + chunk_size - 1) / chunk_size };
+	return sizeof(container_header) + chunk_count * sizeof(chunk_info) + size + chunk_count * 16;
+}
+
+// Write 'size' bytes of 'src' to 'dst' as a container with independently compressed
+// chunks. Chunks that don't get smaller are stored as is. Returns the container size,
+// or 0 if 'dst_capacity' is less than compress_bound().
+inline u64
+compress(const u8* const src, const u64 size, u8* const dst, const u64 dst_capacity, const u32 chunk_size = default_chunk_size)
+{
+	assert(src && size && dst);
+	assert(chunk_size && chunk_size <= max_chunk_size);
+	if (dst_capacity < compress_bound(size, chunk_size) || !chunk_size || chunk_size > max_chunk_size) return 0;
+
+	const u64 chunk_count{ (size + chunk_size - 1) / chunk_size };
+	if (chunk_count > u32_invalid_id) return 0;
+
+	container_header header{ container_magic, container_version, size, chunk_size, (u32)chunk_count };
+	memcpy(dst, &header, sizeof(header));
+	chunk_info* const chunks{ (chunk_info*)(dst + sizeof(container_header)) };
+
+	const std::unique_ptr<u8[]> scratch{ std::make_unique<u8[]>(compress_block_bound(chunk_size)) };
+	// NOTE: not std::make_unique, compress_block() clears the table.
+	const std::unique_ptr<u32[]> table{ new u32[hash_table_size] };
+	u64 offset{ sizeof(container_header) + chunk_count * sizeof(chunk_info) };
+	for (u64 i{ 0 }; i < chunk_count; ++i)
+	{
+		const u8* const chunk{ src + i * chunk_size };
+		const u32 chunk_bytes{ (u32)(size - i * chunk_size < chunk_size ? size - i * chunk_size : chunk_size) };
+		const u32 compressed{ compress_block(chunk, chunk_bytes, scratch.get(), (u32)compress_block_bound(chunk_size), table.get()) };
+
+		chunk_info info{ offset, chunk_bytes, chunk_bytes };
+		if (compressed && compressed < chunk_bytes)
+		{
+			info.compressed_size = compressed;
+			memcpy(dst + offset, scratch.get(), compressed);
+		}
+		else
+		{
+			memcpy(dst + offset, chunk, chunk_bytes);
+		}
+		memcpy(&chunks[i], &info, sizeof(info));
+		offset += info.compressed_size;
+	}
+	assert(offset <= dst_capacity);
+	return offset;
+}
+
+// Returns the header if 'data' starts with a valid container header, nullptr otherwise.
+inline const container_header*
+get_header(const u8* const data, const u64 size)
+{
+	if (!data || size < sizeof(container_header)) return nullptr;
+	const container_header* const header{ (const container_header*)data };
+	if (header->magic != container_magic || header->version != container_version ||
+		!header->chunk_size || header->chunk_size > max_chunk_size ||
+		header->chunk_count != (header->uncompressed_size + header->chunk_size - 1) / header->chunk_size ||
+		size < sizeof(container_header) + (u64)header->chunk_count * sizeof(chunk_info))
+	{
+		return nullptr;
+	}
+	return header;
+}
+
+inline bool
+is_compressed(const u8* const data, const u64 size)
+{
+	return get_header(data, size) != nullptr;
+}
+
+// Decompress chunk 'index' of a container. 'dst' points to the start of the output
+// buffer for the whole container, which must be header->uncompressed_size bytes.
+inline bool
+decompress_chunk(const u8* const data, const u64 size, const u32 index, u8* const dst)
+{
+	const container_header* const header{ get_header(data, size) };
+	if (!header || index >= header->chunk_count) return false;
+
+	chunk_info chunk;
+	memcpy(&chunk, data + sizeof(container_header) + (u64)index * sizeof(chunk_info), sizeof(chunk_info));
+	const u64 dst_offset{ (u64)index * header->chunk_size };
+	const u64 expected_size{ header->uncompressed_size - dst_offset < header->chunk_size
+		? header->uncompressed_size - dst_offset : header->chunk_size };
+	if (chunk.uncompressed_size != expected_size || chunk.offset > size || chunk.compressed_size > size - chunk.offset)
+	{
+		return false;
+	}
+
+	if (chunk.compressed_size == chunk.uncompressed_size)
+	{
+		memcpy(dst + dst_offset, data + chunk.offset, chunk.uncompressed_size);
+		return true;
+	}
+	return decompress_block(data + chunk.offset, chunk.compressed_size, dst + dst_offset, chunk.uncompressed_size);
+}
+
+// Decompress all chunks on the calling thread.
+inline bool
+decompress(const u8* const data, const u64 size, u8* const dst, const u64 dst_size)
+{
+	const container_header* const header{ get_header(data, size) };
+	if (!header || dst_size != header->uncompressed_size) return false;
+	for (u32 i{ 0 }; i < header->chunk_count; ++i)
+	{
+		if (!decompress_chunk(data, size, i, dst)) return false;
+	}
+	return true;
+}
+}
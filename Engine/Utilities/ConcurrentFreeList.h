@@ -0,0 +1,513 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <new>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_PAUSE() _mm_pause()
+#else
+#define CPU_PAUSE() std::this_thread::yield()
+#endif
+
+namespace ferraris::utl {
+
+namespace detail {
+
+// Every thread gets an ordinal the first time it touches a concurrent pool.
+// Pools use it to pick a thread cache, so it doesn't need to be dense.
+inline u32
+thread_ordinal()
+{
+	static std::atomic<u32> next_ordinal{ 0 };
+	thread_local const u32 ordinal{ next_ordinal.fetch_add(1, std::memory_order_relaxed) };
+	return ordinal;
+}
+} // detail namespace
+
+/**
+* A fixed-capacity pool of u32 indices that can be allocated and freed from
+* any number of threads without a global lock.
+*
+* Free indices live in an intrusive stack (the links are kept in a separate
+* array, so the payload of a slot is never touched). The head of the stack
+* carries a 32-bit tag that's bumped on every update, which makes a stale
+* compare-exchange fail even if the same index was popped and pushed back in
+* the mean time (ABA problem).
+*
+* On top of the shared stack each thread owns a small cache of indices. Most
+* calls only touch the calling thread's cache. Caches are refilled from and
+* spilled back to the shared stack in batches. Every cache has a tiny lock
+* which is never contended by its owner, but allows other threads to steal
+* indices when the shared stack runs dry. That way an allocation never fails
+* while there are free indices somewhere in the pool.
+*/
+class concurrent_index_pool
+{
+public:
+	constexpr static u32 max_thread_caches{ 64 };
+	constexpr static u32 thread_cache_size{ 32 };
+
+	concurrent_index_pool() = default;
+	explicit concurrent_index_pool(u32 capacity) { initialize(capacity); }
+	DISABLE_COPY_AND_MOVE(concurrent_index_pool);
+	~concurrent_index_pool() { release(); }
+
+	// NOTE: initialize() and release() are not thread-safe.
+	void initialize(u32 capacity)
+	{
+		assert(capacity && capacity < u32_invalid_id);
+		release();
+		_next = std::make_unique<std::atomic<u32>[]>(capacity);
+		for (u32 i{ 0 }; i < capacity; ++i)
+		{
+			_next[i].store(i + 1 < capacity ? i + 1 : u32_invalid_id, std::memory_order_relaxed);
+		}
+		_caches = std::make_unique<thread_cache[]>(max_thread_caches);
+		// Don't let the caches hoard more than a fraction of a small pool.
+		const u32 limit{ capacity / (max_thread_caches / 4) };
+		_cache_limit = limit < 1 ? 1 : limit > thread_cache_size ? thread_cache_size : limit;
+		_capacity = capacity;
+		_size.store(0, std::memory_order_relaxed);
+		_head.store(make_head(0, 0), std::memory_order_release);
+	}
+
+	void release()
+	{
+		_next.reset();
+		_caches.reset();
+		_capacity = 0;
+		_size.store(0, std::memory_order_relaxed);
+		_head.store(make_head(0, u32_invalid_id), std::memory_order_relaxed);
+	}
+
+	// Returns a free index or u32_invalid_id if the pool is exhausted.
+	[[nodiscard]] u32 allocate()
+	{
+		assert(_next && _caches);
+		u32 index{ u32_invalid_id };
+		{
+			thread_cache& cache{ local_cache() };
+			cache.lock();
+			if (!cache.count)
+			{
+				// Refill half of the cache, so that a following free() doesn't
+				// immediately have to spill.
+				const u32 refill{ _cache_limit > 1 ? _cache_limit >> 1 : 1 };
+				while (cache.count < refill)
+				{
+					const u32 i{ pop() };
+					if (i == u32_invalid_id) break;
+					cache.indices[cache.count++] = i;
+				}
+			}
+			if (cache.count) index = cache.indices[--cache.count];
+			cache.unlock();
+		}
+
+		if (index == u32_invalid_id) index = steal();
+		if (index != u32_invalid_id) _size.fetch_add(1, std::memory_order_relaxed);
+		return index;
+	}
+
+	void free(u32 index)
+	{
+		assert(_next && _caches && index < _capacity);
+		thread_cache& cache{ local_cache() };
+		cache.lock();
+		if (cache.count == _cache_limit)
+		{
+			// Spill the older half of the cache to the shared stack in one go.
+			const u32 spill{ _cache_limit > 1 ? _cache_limit >> 1 : 1 };
+			push_chain(&cache.indices[0], spill);
+			cache.count -= spill;
+			memmove(&cache.indices[0], &cache.indices[spill], cache.count * sizeof(u32));
+		}
+		cache.indices[cache.count++] = index;
+		cache.unlock();
+		_size.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	// Returns the calling thread's cached indices to the shared stack.
+	// Threads that stop using a pool for good may call this before exiting.
+	void flush_thread_cache()
+	{
+		if (!_caches) return;
+		thread_cache& cache{ local_cache() };
+		cache.lock();
+		if (cache.count) push_chain(&cache.indices[0], cache.count);
+		cache.count = 0;
+		cache.unlock();
+	}
+
+	// Number of indices currently handed out.
+	[[nodiscard]] u32 size() const { return _size.load(std::memory_order_relaxed); }
+	[[nodiscard]] constexpr u32 capacity() const { return _capacity; }
+	[[nodiscard]] bool empty() const { return size() == 0; }
+
+private:
+	struct alignas(64) thread_cache
+	{
+		std::atomic_flag	flag = ATOMIC_FLAG_INIT;
+		u32					count{ 0 };
+		u32					indices[thread_cache_size]{};
+
+		void lock()
+		{
+			while (flag.test_and_set(std::memory_order_acquire)) CPU_PAUSE();
+		}
+		bool try_lock() { return !flag.test_and_set(std::memory_order_acquire); }
+		void unlock() { flag.clear(std::memory_order_release); }
+	};
+
+	constexpr static u64 make_head(u32 tag, u32 index) { return ((u64)tag << 32) | index; }
+	constexpr static u32 head_index(u64 head) { return (u32)head; }
+	constexpr static u32 head_tag(u64 head) { return (u32)(head >> 32); }
+
+	thread_cache& local_cache()
+	{
+		return _caches[detail::thread_ordinal() % max_thread_caches];
+	}
+
+	u32 pop()
+	{
+		u64 head{ _head.load(std::memory_order_acquire) };
+		while (true)
+		{
+			const u32 index{ head_index(head) };
+			if (index == u32_invalid_id) return u32_invalid_id;
+			// NOTE: _next[index] may have been changed by another thread which
+			//		 popped and pushed this index in the mean time. In that case
+			//		 the tag differs and the compare-exchange below fails.
+			const u32 next{ _next[index].load(std::memory_order_relaxed) };
+			if (_head.compare_exchange_weak(head, make_head(head_tag(head) + 1, next),
+											std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				return index;
+			}
+		}
+	}
+
+	// Push 'count' indices as a linked chain with a single compare-exchange.
+	void push_chain(const u32* const indices, u32 count)
+	{
+		assert(count);
+		for (u32 i{ 0 }; i < count - 1; ++i)
+		{
+			_next[indices[i]].store(indices[i + 1], std::memory_order_relaxed);
+		}
+		const u32 first{ indices[0] };
+		const u32 last{ indices[count - 1] };
+		u64 head{ _head.load(std::memory_order_relaxed) };
+		do
+		{
+			_next[last].store(head_index(head), std::memory_order_relaxed);
+		} while (!_head.compare_exchange_weak(head, make_head(head_tag(head) + 1, first),
+											  std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// Slow path: the calling thread's cache and the shared stack are both empty.
+	u32 steal()
+	{
+		u32 index{ pop() };
+		for (u32 i{ 0 }; i < max_thread_caches && index == u32_invalid_id; ++i)
+		{
+			thread_cache& cache{ _caches[i] };
+			if (!cache.try_lock()) continue;
+			if (cache.count) index = cache.indices[--cache.count];
+			cache.unlock();
+		}
+		// Caches that were busy may still hold indices, so wait for them before giving up.
+		// The locks are only held for a few instructions.
+		for (u32 i{ 0 }; i < max_thread_caches && index == u32_invalid_id; ++i)
+		{
+			thread_cache& cache{ _caches[i] };
+			cache.lock();
+			if (cache.count) index = cache.indices[--cache.count];
+			cache.unlock();
+		}
+		return index == u32_invalid_id ? pop() : index;
+	}
+
+	std::atomic<u64>						_head{ make_head(0, u32_invalid_id) };
+	std::atomic<u32>						_size{ 0 };
+	std::unique_ptr<std::atomic<u32>[]>		_next{};
+	std::unique_ptr<thread_cache[]>			_caches{};
+	u32										_capacity{ 0 };
+	u32										_cache_limit{ thread_cache_size };
+};
+
+/**
+* Thread-safe counterpart of utl::free_list. Unlike free_list it can't grow,
+* because growing would move items that other threads might be accessing.
+* add() and remove() may be called concurrently from any thread. Accessing an
+* item is only safe while no other thread removes that same item.
+*/
+template<typename T>
+class concurrent_free_list
+{
+public:
+	concurrent_free_list() = default;
+	explicit concurrent_free_list(u32 capacity) { initialize(capacity); }
+	DISABLE_COPY_AND_MOVE(concurrent_free_list);
+	~concurrent_free_list()
+	{
+		assert(_pool.empty());
+		release();
+	}
+
+	// NOTE: initialize() and release() are not thread-safe.
+	void initialize(u32 capacity)
+	{
+		release();
+		_pool.initialize(capacity);
+		_array = std::make_unique<storage[]>(capacity);
+		DEBUG_OP(_alive = std::make_unique<std::atomic<u8>[]>(capacity));
+	}
+
+	void release()
+	{
+		assert(_pool.empty());
+		_pool.release();
+		_array.reset();
+		DEBUG_OP(_alive.reset());
+	}
+
+	// Add a new item and return its index, or u32_invalid_id if the list is full.
+	// NOTE: the list can't grow, so callers must handle a full list.
+	template<class... params>
+	[[nodiscard]] u32 add(params&&... p)
+	{
+		const u32 id{ _pool.allocate() };
+		if (id == u32_invalid_id) return id;
+		DEBUG_OP(assert(!_alive[id].exchange(1, std::memory_order_relaxed)));
+		new (&_array[id]) T(std::forward<params>(p)...);
+		return id;
+	}
+
+	void remove(u32 id)
+	{
+		assert(id < capacity());
+		item(id).~T();
+		DEBUG_OP(assert(_alive[id].exchange(0, std::memory_order_relaxed)));
+		_pool.free(id);
+	}
+
+	[[nodiscard]] u32 size() const { return _pool.size(); }
+	[[nodiscard]] constexpr u32 capacity() const { return _pool.capacity(); }
+	[[nodiscard]] bool empty() const { return _pool.empty(); }
+
+	[[nodiscard]] T& operator[](u32 id)
+	{
+		DEBUG_OP(assert(id < capacity() && _alive[id].load(std::memory_order_relaxed)));
+		return item(id);
+	}
+
+	[[nodiscard]] const T& operator[](u32 id) const
+	{
+		DEBUG_OP(assert(id < capacity() && _alive[id].load(std::memory_order_relaxed)));
+		return item(id);
+	}
+
+private:
+	struct storage
+	{
+		alignas(T) std::byte bytes[sizeof(T)];
+	};
+
+	T& item(u32 id) { return *std::launder(reinterpret_cast<T*>(&_array[id])); }
+	const T& item(u32 id) const { return *std::launder(reinterpret_cast<const T*>(&_array[id])); }
+
+	concurrent_index_pool				_pool{};
+	std::unique_ptr<storage[]>			_array{};
+#ifdef _DEBUG
+	std::unique_ptr<std::atomic<u8>[]>	_alive{};
+#endif
+};
+
+/**
+* Lists of unique indices that any number of threads can push to without a lock, while one
+* thread at a time takes everything from a list at once, e.g. the descriptors that were freed
+* during a frame, once the GPU has finished it.
+*
+* An index can only be in one of the lists at a time, so all lists share one array of links.
+* Each list is an intrusive stack. Since indices are never popped one by one, only the whole
+* stack is exchanged for an empty one, it has no ABA problem and pushing is a single
+* compare-exchange.
+*/
+template<u32 list_count>
+class concurrent_index_lists
+{
+public:
+	concurrent_index_lists()
+	{
+		for (u32 i{ 0 }; i < list_count; ++i) _heads[i].store(u32_invalid_id, std::memory_order_relaxed);
+	}
+	DISABLE_COPY_AND_MOVE(concurrent_index_lists);
+
+	// NOTE: initialize() and release() are not thread-safe.
+	void initialize(u32 capacity)
+	{
+		assert(capacity && capacity < u32_invalid_id);
+		_next = std::make_unique<u32[]>(capacity);
+		_capacity = capacity;
+		for (u32 i{ 0 }; i < list_count; ++i)
+		{
+			_heads[i].store(u32_invalid_id, std::memory_order_relaxed);
+			_sizes[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void release()
+	{
+		DEBUG_OP(for (u32 i{ 0 }; i < list_count; ++i) assert(empty(i)));
+		_next.reset();
+		_capacity = 0;
+	}
+
+	void push(u32 list, u32 index)
+	{
+		assert(list < list_count && index < _capacity);
+		// Count the index before it can be taken, so that take_all() never subtracts it first
+		// and the size doesn't wrap around.
+		_sizes[list].fetch_add(1, std::memory_order_relaxed);
+		u32 head{ _heads[list].load(std::memory_order_relaxed) };
+		do
+		{
+			// NOTE: the index belongs to this thread until it's in the list, so nobody
+			//		 else writes its link.
+			_next[index] = head;
+		} while (!_heads[list].compare_exchange_weak(head, index, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// Takes all indices from 'list' and calls function(index) for each of them, most recently
+	// pushed first. Returns how many there were. Indices pushed meanwhile stay in the list.
+	// NOTE: only one thread may take from the same list at a time.
+	template<typename function>
+	u32 take_all(u32 list, function&& f)
+	{
+		assert(list < list_count);
+		u32 count{ 0 };
+		u32 index{ _heads[list].exchange(u32_invalid_id, std::memory_order_acquire) };
+		while (index != u32_invalid_id)
+		{
+			// Read the link first: 'f' may hand the index out again.
+			const u32 next{ _next[index] };
+			f(index);
+			index = next;
+			++count;
+		}
+		_sizes[list].fetch_sub(count, std::memory_order_relaxed);
+		return count;
+	}
+
+	[[nodiscard]] bool empty(u32 list) const { return _heads[list].load(std::memory_order_relaxed) == u32_invalid_id; }
+	// Can briefly count indices that are still being pushed.
+	[[nodiscard]] u32 size(u32 list) const { return _sizes[list].load(std::memory_order_relaxed); }
+	[[nodiscard]] constexpr u32 capacity() const { return _capacity; }
+
+private:
+	std::atomic<u32>			_heads[list_count]{};
+	std::atomic<u32>			_sizes[list_count]{};
+	std::unique_ptr<u32[]>		_next{};
+	u32							_capacity{ 0 };
+};
+
+/**
+* Lists of items that any number of threads can push to without a lock, while one thread at a
+* time takes everything from a list at once, e.g. the resources that were released during a
+* frame, once the GPU has finished it.
+*
+* Items are stored in slots from a concurrent_index_pool, which are linked with
+* concurrent_index_lists, so pushing doesn't allocate memory. If all slots are in use, items go
+* to an overflow vector behind a mutex instead, so a push never fails.
+*/
+template<typename T, u32 list_count>
+class concurrent_push_lists
+{
+public:
+	concurrent_push_lists() = default;
+	DISABLE_COPY_AND_MOVE(concurrent_push_lists);
+
+	// NOTE: initialize() and release() are not thread-safe.
+	void initialize(u32 capacity)
+	{
+		_slots.initialize(capacity);
+		_lists.initialize(capacity);
+		_items = std::make_unique<T[]>(capacity);
+		for (u32 i{ 0 }; i < list_count; ++i) _overflow_counts[i].store(0, std::memory_order_relaxed);
+	}
+
+	void release()
+	{
+		DEBUG_OP(for (u32 i{ 0 }; i < list_count; ++i) assert(empty(i)));
+		_lists.release();
+		_slots.release();
+		_items.reset();
+	}
+
+	void push(u32 list, T item)
+	{
+		assert(list < list_count);
+		// Once a list overflows, don't look for free slots again until it's been taken: a failed
+		// allocation has to check the caches of all threads.
+		const u32 slot{ _overflow_counts[list].load(std::memory_order_relaxed) ? u32_invalid_id : _slots.allocate() };
+		if (slot != u32_invalid_id)
+		{
+			_items[slot] = std::move(item);
+			_lists.push(list, slot);
+			return;
+		}
+
+		std::lock_guard lock{ _overflow_mutex };
+		_overflow[list].emplace_back(std::move(item));
+		_overflow_counts[list].fetch_add(1, std::memory_order_release);
+	}
+
+	// Takes all items from 'list' and calls function(item) for each of them. Returns how many
+	// there were. Items pushed meanwhile may stay in the list.
+	// NOTE: only one thread may take from the same list at a time.
+	template<typename function>
+	u32 take_all(u32 list, function&& f)
+	{
+		u32 count{ _lists.take_all(list, [this, &f](u32 slot)
+		{
+			f(_items[slot]);
+			_items[slot] = T{};
+			_slots.free(slot);
+		}) };
+
+		if (_overflow_counts[list].load(std::memory_order_acquire))
+		{
+			std::lock_guard lock{ _overflow_mutex };
+			utl::vector<T>& overflow{ _overflow[list] };
+			for (u32 i{ 0 }; i < overflow.size(); ++i) f(overflow[i]);
+			count += (u32)overflow.size();
+			_overflow_counts[list].store(0, std::memory_order_relaxed);
+			overflow.clear();
+		}
+		return count;
+	}
+
+	[[nodiscard]] bool empty(u32 list) const
+	{
+		return _lists.empty(list) && !_overflow_counts[list].load(std::memory_order_relaxed);
+	}
+	// Can be briefly off while other threads push or take.
+	[[nodiscard]] u32 size(u32 list) const
+	{
+		return _lists.size(list) + _overflow_counts[list].load(std::memory_order_relaxed);
+	}
+	[[nodiscard]] constexpr u32 capacity() const { return _slots.capacity(); }
+
+private:
+	concurrent_index_pool					_slots{};
+	concurrent_index_lists<list_count>		_lists{};
+	std::unique_ptr<T[]>					_items{};
+	std::atomic<u32>						_overflow_counts[list_count]{};
+	utl::vector<T>							_overflow[list_count]{};
+	std::mutex								_overflow_mutex{};
+};
+}
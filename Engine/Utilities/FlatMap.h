@@ -0,0 +1,418 @@
+#pragma once
+#include "CommonHeaders.h"
+#include "Memory.h"
+#include <functional>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FLAT_MAP_USE_SSE2 1
+#else
+#define FLAT_MAP_USE_SSE2 0
+#endif
+
+namespace ferraris::utl {
+
+namespace detail {
+
+// Every slot of a flat_map has a control byte. Full slots store the low 7 bits
+// of the key's hash, so most mismatches are rejected without touching the key.
+using ctrl_t = s8;
+constexpr ctrl_t ctrl_empty{ -128 };	// 0b1000'0000
+constexpr ctrl_t ctrl_deleted{ -2 };	// 0b1111'1110
+constexpr u32 group_width{ 16 };
+
+constexpr bool is_full(ctrl_t c) { return c >= 0; }
+
+// Bit i of the mask is set if control byte i in the group matched.
+class group
+{
+public:
+	explicit group(const ctrl_t* ctrl)
+	{
+#if FLAT_MAP_USE_SSE2
+		_ctrl = _mm_load_si128((const __m128i*)ctrl);
+#else
+		memcpy(&_ctrl[0], ctrl, group_width);
+#endif
+	}
+
+	u32 match(ctrl_t h2) const
+	{
+#if FLAT_MAP_USE_SSE2
+		return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl));
+#else
+		u32 mask{ 0 };
+		for (u32 i{ 0 }; i < group_width; ++i) mask |= (u32)(_ctrl[i] == h2) << i;
+		return mask;
+#endif
+	}
+
+	u32 match_empty() const { return match(ctrl_empty); }
+
+	// Empty or deleted slots have their sign bit set.
+	u32 match_empty_or_deleted() const
+	{
+#if FLAT_MAP_USE_SSE2
+		return (u32)_mm_movemask_epi8(_ctrl);
+#else
+		u32 mask{ 0 };
+		for (u32 i{ 0 }; i < group_width; ++i) mask |= (u32)(_ctrl[i] < 0) << i;
+		return mask;
+#endif
+	}
+
+private:
+#if FLAT_MAP_USE_SSE2
+	__m128i _ctrl;
+#else
+	ctrl_t _ctrl[group_width];
+#endif
+};
+
+inline u32
+lowest_bit(u32 mask)
+{
+	assert(mask);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctz(mask);
+#endif
+}
+
+// std::hash of integers is the identity function in some standard libraries.
+// Mix the bits so that both the group index and the 7-bit tag are well distributed.
+constexpr u64
+mix_hash(u64 h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+} // detail namespace
+
+/**
+* An open addressing hash map in the style of SwissTable.
+*
+* Keys and values are stored in one contiguous array of slots. A separate array
+* of control bytes (one per slot) tells if a slot is empty, deleted or full,
+* and for full slots holds 7 bits of the hash. Lookups probe groups of 16
+* control bytes at once with SSE2, so a lookup usually compares one group
+* and at most one key.
+*
+* NOTE: inserting may rehash, which invalidates all iterators and pointers to
+*		items. Erasing doesn't move any items.
+*/
+template<typename K, typename V, typename hasher = std::hash<K>, typename key_equal = std::equal_to<K>>
+class flat_map
+{
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<const K, V>;
+
+	template<bool is_const>
+	class iterator_base
+	{
+	public:
+		using map_type = std::conditional_t<is_const, const flat_map, flat_map>;
+		using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+		using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+
+		constexpr iterator_base() = default;
+		constexpr iterator_base(map_type* map, u64 index) : _map{ map }, _index{ index } { skip_empty(); }
+
+		reference operator*() const { return _map->slot(_index); }
+		pointer operator->() const { return &_map->slot(_index); }
+		iterator_base& operator++() { ++_index; skip_empty(); return *this; }
+		constexpr bool operator==(const iterator_base& o) const { return _index == o._index && _map == o._map; }
+		constexpr bool operator!=(const iterator_base& o) const { return !(*this == o); }
+
+	private:
+		void skip_empty()
+		{
+			while (_index < _map->_capacity && !detail::is_full(_map->_ctrl[_index])) ++_index;
+		}
+		map_type*	_map{ nullptr };
+		u64			_index{ 0 };
+	};
+
+	using iterator = iterator_base<false>;
+	using const_iterator = iterator_base<true>;
+
+	flat_map() = default;
+
+	explicit flat_map(u64 count)
+	{
+		reserve(count);
+	}
+
+	flat_map(const flat_map& o)
+	{
+		*this = o;
+	}
+
+	flat_map(flat_map&& o) noexcept
+	{
+		move(o);
+	}
+
+	flat_map& operator=(const flat_map& o)
+	{
+		assert(this != std::addressof(o));
+		if (this != std::addressof(o))
+		{
+			clear();
+			reserve(o._size);
+			for (const auto& item : o) emplace(item.first, item.second);
+		}
+		return *this;
+	}
+
+	flat_map& operator=(flat_map&& o) noexcept
+	{
+		assert(this != std::addressof(o));
+		if (this != std::addressof(o))
+		{
+			destroy();
+			move(o);
+		}
+		return *this;
+	}
+
+	~flat_map() { destroy(); }
+
+	// Insert the item if its key isn't in the map yet. Returns an iterator to the item
+	// with that key and true if the item was inserted.
+	std::pair<iterator, bool> insert(const value_type& value)
+	{
+		return emplace(value.first, value.second);
+	}
+
+	template<class... params>
+	std::pair<iterator, bool> emplace(const K& key, params&&... p)
+	{
+		const u64 hash{ hash_key(key) };
+		u64 index{ find_index(key, hash) };
+		if (index != u64_invalid_id) return { iterator{ this, index }, false };
+
+		if (_size + _deleted + 1 > max_load(_capacity))
+		{
+			// If there are many tombstones, rehashing in place is enough.
+			rehash(_size + 1 > max_load(_capacity) / 2 ? grow_capacity() : _capacity);
+		}
+		index = find_insert_index(hash);
+		if (_ctrl[index] == detail::ctrl_deleted) --_deleted;
+		set_ctrl(index, h2(hash));
+		new (&slot(index)) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+									  std::forward_as_tuple(std::forward<params>(p)...));
+		++_size;
+		return { iterator{ this, index }, true };
+	}
+
+	V& operator[](const K& key)
+	{
+		return emplace(key).first->second;
+	}
+
+	[[nodiscard]] iterator find(const K& key)
+	{
+		const u64 index{ find_index(key, hash_key(key)) };
+		return index == u64_invalid_id ? end() : iterator{ this, index };
+	}
+
+	[[nodiscard]] const_iterator find(const K& key) const
+	{
+		const u64 index{ find_index(key, hash_key(key)) };
+		return index == u64_invalid_id ? end() : const_iterator{ this, index };
+	}
+
+	[[nodiscard]] bool contains(const K& key) const
+	{
+		return find_index(key, hash_key(key)) != u64_invalid_id;
+	}
+
+	// Returns the number of removed items (0 or 1).
+	u64 erase(const K& key)
+	{
+		const u64 index{ find_index(key, hash_key(key)) };
+		if (index == u64_invalid_id) return 0;
+		slot(index).~value_type();
+		// If the group still has an empty slot, no probe sequence can have continued
+		// past this slot, so we can mark it as empty instead of deleted.
+		const u64 group_start{ index & ~(u64)(detail::group_width - 1) };
+		if (detail::group{ &_ctrl[group_start] }.match_empty())
+		{
+			set_ctrl(index, detail::ctrl_empty);
+		}
+		else
+		{
+			set_ctrl(index, detail::ctrl_deleted);
+			++_deleted;
+		}
+		--_size;
+		return 1;
+	}
+
+	// Makes sure that 'count' items fit without rehashing.
+	void reserve(u64 count)
+	{
+		u64 capacity{ _capacity ? _capacity : detail::group_width };
+		while (max_load(capacity) < count) capacity <<= 1;
+		if (capacity > _capacity) rehash(capacity);
+	}
+
+	void clear()
+	{
+		if (!_ctrl) return;
+		if constexpr (!std::is_trivially_destructible<value_type>::value)
+		{
+			for (u64 i{ 0 }; i < _capacity; ++i)
+			{
+				if (detail::is_full(_ctrl[i])) slot(i).~value_type();
+			}
+		}
+		memset(_ctrl, (u8)detail::ctrl_empty, _capacity);
+		_size = 0;
+		_deleted = 0;
+	}
+
+	[[nodiscard]] constexpr u64 size() const { return _size; }
+	[[nodiscard]] constexpr u64 capacity() const { return _capacity; }
+	[[nodiscard]] constexpr bool empty() const { return _size == 0; }
+
+	[[nodiscard]] iterator begin() { return iterator{ this, 0 }; }
+	[[nodiscard]] iterator end() { return iterator{ this, _capacity }; }
+	[[nodiscard]] const_iterator begin() const { return const_iterator{ this, 0 }; }
+	[[nodiscard]] const_iterator end() const { return const_iterator{ this, _capacity }; }
+
+private:
+	// Keep the load factor at or below 7/8.
+	constexpr static u64 max_load(u64 capacity) { return capacity - (capacity >> 3); }
+	constexpr static detail::ctrl_t h2(u64 hash) { return (detail::ctrl_t)(hash & 0x7f); }
+	constexpr static u64 h1(u64 hash) { return hash >> 7; }
+
+	u64 hash_key(const K& key) const { return detail::mix_hash((u64)hasher{}(key)); }
+	u64 group_mask() const { return (_capacity / detail::group_width) - 1; }
+	u64 grow_capacity() const { return _capacity ? _capacity << 1 : detail::group_width; }
+
+	value_type& slot(u64 index) { return _slots[index]; }
+	const value_type& slot(u64 index) const { return _slots[index]; }
+	void set_ctrl(u64 index, detail::ctrl_t c) { _ctrl[index] = c; }
+
+	// Groups are probed in a triangular sequence, which visits every group
+	// exactly once because the number of groups is a power of 2.
+	u64 find_index(const K& key, u64 hash) const
+	{
+		if (!_size) return u64_invalid_id;
+		const u64 mask{ group_mask() };
+		u64 g{ h1(hash) & mask };
+		for (u64 step{ 1 }; step <= mask + 1; ++step)
+		{
+			const u64 group_start{ g * detail::group_width };
+			const detail::group group{ &_ctrl[group_start] };
+			u32 match{ group.match(h2(hash)) };
+			while (match)
+			{
+				const u64 index{ group_start + detail::lowest_bit(match) };
+				if (key_equal{}(slot(index).first, key)) return index;
+				match &= match - 1;
+			}
+			if (group.match_empty()) return u64_invalid_id;
+			g = (g + step) & mask;
+		}
+		return u64_invalid_id;
+	}
+
+	u64 find_insert_index(u64 hash) const
+	{
+		assert(_capacity && _size + _deleted < _capacity);
+		const u64 mask{ group_mask() };
+		u64 g{ h1(hash) & mask };
+		for (u64 step{ 1 };; ++step)
+		{
+			const u64 group_start{ g * detail::group_width };
+			const u32 match{ detail::group{ &_ctrl[group_start] }.match_empty_or_deleted() };
+			if (match) return group_start + detail::lowest_bit(match);
+			g = (g + step) & mask;
+		}
+	}
+
+	void rehash(u64 new_capacity)
+	{
+		assert(new_capacity >= detail::group_width && !(new_capacity & (new_capacity - 1)));
+		detail::ctrl_t* const old_ctrl{ _ctrl };
+		value_type* const old_slots{ _slots };
+		void* const old_block{ _block };
+		const u64 old_capacity{ _capacity };
+
+		// Control bytes and slots share one allocation. The control bytes come
+		// first and are 16-byte aligned for the group loads.
+		const u64 slots_offset{ (new_capacity + alignof(value_type) - 1) & ~(u64)(alignof(value_type) - 1) };
+		_block = memory::allocate(slots_offset + new_capacity * sizeof(value_type));
+		assert(_block && !((u64)_block & (detail::group_width - 1)));
+		_ctrl = (detail::ctrl_t*)_block;
+		_slots = (value_type*)((u8*)_block + slots_offset);
+		_capacity = new_capacity;
+		_size = 0;
+		_deleted = 0;
+		memset(_ctrl, (u8)detail::ctrl_empty, _capacity);
+
+		for (u64 i{ 0 }; i < old_capacity; ++i)
+		{
+			if (!detail::is_full(old_ctrl[i])) continue;
+			value_type& item{ old_slots[i] };
+			const u64 hash{ hash_key(item.first) };
+			const u64 index{ find_insert_index(hash) };
+			set_ctrl(index, h2(hash));
+			new (&slot(index)) value_type(std::move(item));
+			item.~value_type();
+			++_size;
+		}
+		memory::free(old_block);
+	}
+
+	void move(flat_map& o)
+	{
+		_block = o._block;
+		_ctrl = o._ctrl;
+		_slots = o._slots;
+		_capacity = o._capacity;
+		_size = o._size;
+		_deleted = o._deleted;
+		o.reset();
+	}
+
+	void reset()
+	{
+		_block = nullptr;
+		_ctrl = nullptr;
+		_slots = nullptr;
+		_capacity = 0;
+		_size = 0;
+		_deleted = 0;
+	}
+
+	void destroy()
+	{
+		clear();
+		memory::free(_block);
+		reset();
+	}
+
+	void*				_block{ nullptr };
+	detail::ctrl_t*		_ctrl{ nullptr };
+	value_type*			_slots{ nullptr };
+	u64					_capacity{ 0 };
+	u64					_size{ 0 };
+	u64					_deleted{ 0 };
+};
+}
@@ -97,7 +97,7 @@ private:
 		{
 			u32 i{ sizeof(u32) }; // skip the first 4 bytes
 			const u8* const p{ (const u8* const)std::addressof(_array[id]) };
-			while( p[i] == 0xcc && i < sizeof(T) ) i++;
+			while( i < sizeof(T) && p[i] == 0xcc ) i++;
 			return i == sizeof(T);
 		}
 		// 4 bytes not enough, check by otherwise
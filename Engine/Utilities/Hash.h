@@ -0,0 +1,39 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace ferraris::utl {
+
+// 64-bit FNV-1a. Unlike std::hash, the result is the same for every compiler
+// and standard library, so it can be stored in files, and it can be computed
+// at compile time for string literals.
+constexpr u64 fnv1a_64_offset_basis{ 0xcbf29ce484222325ull };
+constexpr u64 fnv1a_64_prime{ 0x00000100000001b3ull };
+
+constexpr u64
+fnv1a_64(const char* data, u64 length, u64 hash = fnv1a_64_offset_basis)
+{
+	for (u64 i{ 0 }; i < length; ++i)
+	{
+		hash ^= (u64)(u8)data[i];
+		hash *= fnv1a_64_prime;
+	}
+	return hash;
+}
+
+// Hash a zero-terminated string.
+constexpr u64
+fnv1a_64(const char* str)
+{
+	u64 hash{ fnv1a_64_offset_basis };
+	while (*str)
+	{
+		hash ^= (u64)(u8)*str++;
+		hash *= fnv1a_64_prime;
+	}
+	return hash;
+}
+
+static_assert(fnv1a_64("") == fnv1a_64_offset_basis);
+static_assert(fnv1a_64("a") == 0xaf63dc4c8601ec8cull);
+static_assert(fnv1a_64("foobar") == 0x85944171f73967e8ull);
+}
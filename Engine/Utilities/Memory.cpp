@@ -0,0 +1,129 @@
+#include "Memory.h"
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+
+#ifdef _WIN64
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif // _WIN64
+
+namespace ferraris::memory {
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+f32					dump_interval{ 0.f };
+clock::time_point	last_dump{ clock::now() };
+std::mutex			dump_mutex{};
+
+void
+output(const char* text)
+{
+#ifdef _WIN64
+	OutputDebugStringA(text);
+#else
+	fputs(text, stderr);
+#endif // _WIN64
+}
+} // anonymous namespace
+
+#if MEMORY_TRACKING
+namespace detail {
+namespace {
+
+tag_counters		engine_counters[(u32)tag::count]{};
+tag_counters*		counters{ &engine_counters[0] };
+thread_local tag	current{ tag::general };
+} // anonymous namespace
+
+tag_counters*
+get_counters()
+{
+	return counters;
+}
+
+tag&
+thread_tag()
+{
+	return current;
+}
+} // detail namespace
+
+#ifdef USE_WITH_EDITOR
+void
+set_memory_counters(detail::tag_counters* counters)
+{
+	assert(counters && counters != detail::counters);
+	// Blocks that static initializers allocated so far will be freed into the new counters.
+	for (u32 i{ 0 }; i < (u32)tag::count; ++i)
+	{
+		const detail::tag_counters& own{ detail::counters[i] };
+		detail::tag_counters& c{ counters[i] };
+		const u64 current{ c.current_bytes.fetch_add(own.current_bytes, std::memory_order_relaxed) + own.current_bytes };
+		u64 peak{ c.peak_bytes.load(std::memory_order_relaxed) };
+		while (current > peak && !c.peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+		c.live_allocations.fetch_add(own.live_allocations, std::memory_order_relaxed);
+		c.total_allocations.fetch_add(own.total_allocations, std::memory_order_relaxed);
+		c.total_bytes.fetch_add(own.total_bytes, std::memory_order_relaxed);
+	}
+	detail::counters = counters;
+}
+#endif // USE_WITH_EDITOR
+#endif // MEMORY_TRACKING
+
+void
+dump()
+{
+#if MEMORY_TRACKING
+	char line[256];
+	output("Memory usage by subsystem:\n");
+	output("  tag            current (KB)    peak (KB)   live allocs  total allocs\n");
+	tag_stats total{};
+	for (u32 i{ 0 }; i < (u32)tag::count; ++i)
+	{
+		const tag_stats stats{ get_stats((tag)i) };
+		total.current_bytes += stats.current_bytes;
+		total.peak_bytes += stats.peak_bytes;
+		total.live_allocations += stats.live_allocations;
+		total.total_allocations += stats.total_allocations;
+		snprintf(line, sizeof(line), "  %-12s %14.1f %12.1f %13llu %13llu\n", tag_name((tag)i),
+				 (f32)stats.current_bytes / 1024.f, (f32)stats.peak_bytes / 1024.f,
+				 (unsigned long long)stats.live_allocations, (unsigned long long)stats.total_allocations);
+		output(line);
+	}
+	// NOTE: the peaks of different tags don't necessarily happen at the same time,
+	//		 so their sum is an upper bound of the overall peak.
+	snprintf(line, sizeof(line), "  %-12s %14.1f %12.1f %13llu %13llu\n", "all",
+			 (f32)total.current_bytes / 1024.f, (f32)total.peak_bytes / 1024.f,
+			 (unsigned long long)total.live_allocations, (unsigned long long)total.total_allocations);
+	output(line);
+#else
+	output("Memory tracking is disabled (MEMORY_TRACKING is 0).\n");
+#endif // MEMORY_TRACKING
+}
+
+void
+set_dump_interval(f32 seconds)
+{
+	std::lock_guard lock{ dump_mutex };
+	assert(seconds >= 0.f);
+	dump_interval = seconds;
+	last_dump = clock::now();
+}
+
+void
+update()
+{
+	std::lock_guard lock{ dump_mutex };
+	if (dump_interval <= 0.f) return;
+	const clock::time_point now{ clock::now() };
+	if (std::chrono::duration<f32>(now - last_dump).count() >= dump_interval)
+	{
+		last_dump = now;
+		dump();
+	}
+}
+}
@@ -0,0 +1,215 @@
+#pragma once
+// NOTE: this header is included by Vector.h, which is part of CommonHeaders.h,
+//		 so it can't include CommonHeaders.h itself.
+#include "..\Common\PrimitiveTypes.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <atomic>
+
+// Memory tracking is on in debug builds only. Without it all functions below
+// reduce to plain malloc/realloc/free calls and the statistics are empty.
+// NOTE: the engine and the game code must be built with the same setting,
+//		 because tracked blocks have a header in front of them.
+#ifndef MEMORY_TRACKING
+#ifdef _DEBUG
+#define MEMORY_TRACKING 1
+#else
+#define MEMORY_TRACKING 0
+#endif
+#endif
+
+namespace ferraris::memory {
+
+// Subsystem an allocation is accounted to.
+enum class tag : u32
+{
+	general = 0,
+	entity,
+	transform,
+	script,
+	content,
+	geometry,
+	graphics_cpu,
+
+	count
+};
+
+struct tag_stats
+{
+	u64 current_bytes{ 0 };		// bytes that are currently allocated
+	u64 peak_bytes{ 0 };		// highest value current_bytes has reached
+	u64 live_allocations{ 0 };	// number of blocks that are currently allocated
+	u64 total_allocations{ 0 };	// number of allocate/reallocate calls so far
+	u64 total_bytes{ 0 };		// number of bytes requested so far
+};
+
+constexpr const char*
+tag_name(tag t)
+{
+	constexpr const char* names[]{ "general", "entity", "transform", "script", "content", "geometry", "graphics_cpu" };
+	static_assert(_countof(names) == (u32)tag::count);
+	return (u32)t < (u32)tag::count ? names[(u32)t] : "unknown";
+}
+
+#if MEMORY_TRACKING
+namespace detail {
+
+struct tag_counters
+{
+	std::atomic<u64> current_bytes{ 0 };
+	std::atomic<u64> peak_bytes{ 0 };
+	std::atomic<u64> live_allocations{ 0 };
+	std::atomic<u64> total_allocations{ 0 };
+	std::atomic<u64> total_bytes{ 0 };
+};
+
+// Every tracked block is preceded by this header, so that reallocate() and
+// free() know how much memory to account and to which subsystem.
+// NOTE: the header is 16 bytes to keep the alignment that malloc() guarantees.
+struct alignas(16) block_header
+{
+	u64 size;
+	u32 tag;
+	u32 magic;
+};
+constexpr u32 block_magic{ 0xfe77a215 };
+
+// These are defined in Memory.cpp. Game code that's built as a DLL links its own copy
+// of the engine, so the editor points it to the counters of the engine after loading it.
+tag_counters* get_counters();
+tag& thread_tag();
+
+inline void
+add(tag t, u64 size)
+{
+	tag_counters& c{ get_counters()[(u32)t] };
+	const u64 current{ c.current_bytes.fetch_add(size, std::memory_order_relaxed) + size };
+	u64 peak{ c.peak_bytes.load(std::memory_order_relaxed) };
+	while (current > peak && !c.peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+	c.total_allocations.fetch_add(1, std::memory_order_relaxed);
+	c.total_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+inline void
+remove(tag t, u64 size)
+{
+	tag_counters& c{ get_counters()[(u32)t] };
+	assert(c.current_bytes.load(std::memory_order_relaxed) >= size);
+	c.current_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+inline block_header*
+header_from_block(void* block)
+{
+	block_header* const header{ (block_header*)block - 1 };
+	assert(header->magic == block_magic && header->tag < (u32)tag::count);
+	return header;
+}
+} // detail namespace
+
+#ifdef USE_WITH_EDITOR
+// Exported by the game code DLL, see detail::get_counters().
+extern "C" __declspec(dllexport) void set_memory_counters(detail::tag_counters* counters);
+#endif // USE_WITH_EDITOR
+
+// All allocations made by the calling thread while an instance of this
+// class is in scope are accounted to the given tag.
+class scoped_tag
+{
+public:
+	explicit scoped_tag(tag t) : _previous{ detail::thread_tag() } { detail::thread_tag() = t; }
+	~scoped_tag() { detail::thread_tag() = _previous; }
+	scoped_tag(const scoped_tag&) = delete;
+	scoped_tag& operator=(const scoped_tag&) = delete;
+private:
+	const tag _previous;
+};
+
+inline tag
+current_tag()
+{
+	return detail::thread_tag();
+}
+
+[[nodiscard]] inline void*
+allocate(u64 size)
+{
+	using namespace detail;
+	block_header* const header{ (block_header*)malloc(sizeof(block_header) + size) };
+	if (!header) return nullptr;
+	const tag t{ thread_tag() };
+	header->size = size;
+	header->tag = (u32)t;
+	header->magic = block_magic;
+	add(t, size);
+	get_counters()[(u32)t].live_allocations.fetch_add(1, std::memory_order_relaxed);
+	return header + 1;
+}
+
+// NOTE: the block keeps the tag it was allocated with.
+[[nodiscard]] inline void*
+reallocate(void* block, u64 size)
+{
+	using namespace detail;
+	if (!block) return allocate(size);
+	block_header* header{ header_from_block(block) };
+	const u64 old_size{ header->size };
+	const tag t{ (tag)header->tag };
+	header = (block_header*)realloc(header, sizeof(block_header) + size);
+	if (!header) return nullptr;
+	header->size = size;
+	remove(t, old_size);
+	add(t, size);
+	return header + 1;
+}
+
+inline void
+free(void* block)
+{
+	using namespace detail;
+	if (!block) return;
+	block_header* const header{ header_from_block(block) };
+	const tag t{ (tag)header->tag };
+	remove(t, header->size);
+	get_counters()[(u32)t].live_allocations.fetch_sub(1, std::memory_order_relaxed);
+	header->magic = 0;
+	::free(header);
+}
+
+inline tag_stats
+get_stats(tag t)
+{
+	assert((u32)t < (u32)tag::count);
+	const detail::tag_counters& c{ detail::get_counters()[(u32)t] };
+	tag_stats stats{};
+	stats.current_bytes = c.current_bytes.load(std::memory_order_relaxed);
+	stats.peak_bytes = c.peak_bytes.load(std::memory_order_relaxed);
+	stats.live_allocations = c.live_allocations.load(std::memory_order_relaxed);
+	stats.total_allocations = c.total_allocations.load(std::memory_order_relaxed);
+	stats.total_bytes = c.total_bytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+#else
+class scoped_tag
+{
+public:
+	constexpr explicit scoped_tag(tag) {}
+	scoped_tag(const scoped_tag&) = delete;
+	scoped_tag& operator=(const scoped_tag&) = delete;
+};
+
+constexpr tag current_tag() { return tag::general; }
+[[nodiscard]] inline void* allocate(u64 size) { return malloc(size); }
+[[nodiscard]] inline void* reallocate(void* block, u64 size) { return realloc(block, size); }
+inline void free(void* block) { ::free(block); }
+constexpr tag_stats get_stats(tag) { return {}; }
+#endif // MEMORY_TRACKING
+
+// Periodic reporting. These are implemented in the engine library.
+// Write the statistics of all tags to the debug output.
+void dump();
+// Dump the statistics every 'seconds' when update() is called. 0 disables dumping.
+void set_dump_interval(f32 seconds);
+void update();
+}
@@ -49,4 +49,7 @@ namespace ferraris::utl {
 
 }
 #include "FreeList.h"
+#include "ConcurrentFreeList.h"
+#include "FlatMap.h"
+#include "Hash.h"
 
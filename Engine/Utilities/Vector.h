@@ -1,5 +1,6 @@
 #pragma once
 #include "CommonHeaders.h"
+#include "Memory.h"
 
 namespace ferraris::utl {
 
@@ -161,7 +162,9 @@ public:
 		{
 			// NOTE: realloc() will automatically copy the data in the buffer
 			//		 if a new region of memory is allocated.
-			void* new_buffer{ realloc(_data, new_capacity * sizeof(T)) };
+			//		 memory::reallocate() calls realloc() and accounts the memory
+			//		 to the subsystem that first allocated the buffer.
+			void* new_buffer{ memory::reallocate(_data, new_capacity * sizeof(T)) };
 			assert(new_buffer);
 			if (new_buffer)
 			{
@@ -187,9 +190,10 @@ public:
 		if constexpr (destruct) item->~T();
 		--_size;
 		// Only move if not the last one item
+		// NOTE: the ranges overlap, so it has to be memmove.
 		if (item < std::addressof(_data[_size]))
 		{
-			memcpy(item, item + 1, (std::addressof(_data[_size]) - item) * sizeof(T));
+			memmove(item, item + 1, (std::addressof(_data[_size]) - item) * sizeof(T));
 		}
 		return item;
 	}
@@ -379,7 +383,7 @@ private:
 		assert([&] { return _capacity ? _data != nullptr : _data == nullptr; }());
 		clear();
 		_capacity = 0;
-		if (_data) free(_data);
+		if (_data) memory::free(_data);
 		_data = nullptr;
 	}
 	u64 _capacity{ 0 };
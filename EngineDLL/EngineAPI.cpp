@@ -22,6 +22,9 @@ using _get_script_creator = ferraris::script::detail::script_creator(*)(size_t);
 _get_script_creator get_script_creator{ nullptr };
 using _get_script_names = LPSAFEARRAY(*)(void);
 _get_script_names get_script_names{ nullptr };
+#if MEMORY_TRACKING
+using _set_memory_counters = void(*)(memory::detail::tag_counters*);
+#endif // MEMORY_TRACKING
 
 utl::vector<graphics::render_surface> surfaces;
 } // anonymous namespace
@@ -35,6 +38,11 @@ LoadGameCodeDll(const char* dll_path)
 
 	get_script_creator = (_get_script_creator)GetProcAddress(game_code_dll, "get_script_creator");
 	get_script_names = (_get_script_names)GetProcAddress(game_code_dll, "get_script_names");
+#if MEMORY_TRACKING
+	// The game code has its own copy of the engine. Let it count its memory in ours.
+	const _set_memory_counters set_memory_counters{ (_set_memory_counters)GetProcAddress(game_code_dll, "set_memory_counters") };
+	if (set_memory_counters) set_memory_counters(memory::detail::get_counters());
+#endif // MEMORY_TRACKING
 
 	return (game_code_dll && get_script_creator && get_script_names) ? TRUE : FALSE;// if load success
 }
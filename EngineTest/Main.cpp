@@ -7,6 +7,40 @@
 #include "TestRenderer.h"
 #elif TEST_WINDOW
 #include "TestWindow.h"
+#elif TEST_CONCURRENT_FREE_LIST
+#include "TestConcurrentFreeList.h"
+#elif TEST_FLAT_MAP
+#include "TestFlatMap.h"
+#elif TEST_LEVEL_LOADING
+#include "TestLevelLoading.h"
+#elif TEST_LEVEL_STREAMING
+#include "TestLevelStreaming.h"
+#elif TEST_COMPRESSION
+#include "TestCompression.h"
+#elif TEST_MESH_LOADING
+#include "TestMeshLoading.h"
+#elif TEST_NULL_RENDERER
+#include "TestNullRenderer.h"
+#elif TEST_RENDER_GRAPH
+#include "TestRenderGraph.h"
+#elif TEST_COMMAND_CONTEXTS
+#include "TestCommandContexts.h"
+#elif TEST_QUEUE_TIMELINE
+#include "TestQueueTimeline.h"
+#elif TEST_UPLOAD_RING
+#include "TestUploadRing.h"
+#elif TEST_TLSF_ALLOCATOR
+#include "TestTlsfAllocator.h"
+#elif TEST_DEFERRED_RELEASE
+#include "TestDeferredRelease.h"
+#elif TEST_FRAME_PACING
+#include "TestFramePacing.h"
+#elif TEST_PIPELINE_CACHE
+#include "TestPipelineCache.h"
+#elif TEST_SHADER_VARIANTS
+#include "TestShaderVariants.h"
+#elif TEST_FRAME_ALLOCATOR
+#include "TestFrameAllocator.h"
 #else
 #error One of the tests need to enabled
 #endif
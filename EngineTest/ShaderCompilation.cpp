@@ -4,9 +4,13 @@
 
 #include "Graphics\Direct3D12\D3D12Core.h"
 #include "Graphics\Direct3D12\D3D12Shaders.h"
+#include "Content\ShaderFormat.h"
+#include "Content\ShaderLibrary.h"
 
+#include <atomic>
 #include <fstream>
 #include <filesystem>
+#include <thread>
 // NOTE: we wouldn't need to do this if DXC had a Nuget package.
 #pragma comment(lib, "../packages/DirectXShaderCompiler/lib/x64/dxcompiler.lib")
 using namespace ferraris;
@@ -38,6 +42,50 @@ to_wstring(const char* c)
 	return { s.begin(), s.end() };
 }
 
+// Bump when the compiler arguments change, so that every shader is rebuilt.
+constexpr u32 shader_build_version{ 1 };
+#if _DEBUG
+constexpr u32 is_debug_build{ 1 };
+#else
+constexpr u32 is_debug_build{ 0 };
+#endif
+
+// Passes #include requests on to DXC's default handler and remembers which files
+// were loaded, so that a shader is rebuilt when any file it includes changes.
+// NOTE: it lives on the stack for one Compile() call, so it isn't reference counted.
+class include_recorder : public IDxcIncludeHandler
+{
+public:
+	include_recorder(IDxcIncludeHandler* handler, utl::vector<std::filesystem::path>& files)
+		: _handler{ handler }, _files{ files } {}
+
+	HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR file_name, IDxcBlob** include_source) override
+	{
+		const HRESULT hr{ _handler->LoadSource(file_name, include_source) };
+		if (SUCCEEDED(hr)) _files.emplace_back(file_name);
+		return hr;
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (!object) return E_POINTER;
+		if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+		{
+			*object = static_cast<IDxcIncludeHandler*>(this);
+			return S_OK;
+		}
+		*object = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+private:
+	IDxcIncludeHandler* const				_handler;
+	utl::vector<std::filesystem::path>&		_files;
+};
+
 class shader_compiler
 {
 public:
@@ -54,8 +102,10 @@ public:
 	}
 	DISABLE_COPY_AND_MOVE(shader_compiler);
 
-	// Loading file + compile
-	IDxcBlob* compile(shader_file_info info, std::filesystem::path full_path)
+	// Loading file + compile. 'dependencies' receives the files that were included.
+	// Each of 'defines' is passed with -D, e.g. L"FEATURE=1".
+	IDxcBlob* compile(shader_file_info info, std::filesystem::path full_path, utl::vector<std::filesystem::path>& dependencies,
+					  const utl::vector<std::wstring>& defines = {})
 	{
 		assert(_compiler && _utils && _include_handler);
 		HRESULT hr{ S_OK };
@@ -66,7 +116,8 @@ public:
 		assert(source_blob && source_blob->GetBufferSize());
 
 		// Convert the info to wstring for serialization.
-		std::wstring file{ to_wstring(info.file) };
+		// NOTE: the full path is the file name, so that includes are found relative to the shader.
+		std::wstring file{ full_path.wstring() };
 		std::wstring func{ to_wstring(info.function) };
 		std::wstring prof{ to_wstring(_profile_strings[(u32)info.type]) };
 
@@ -90,14 +141,25 @@ public:
 			L"-Qstrip_reflect",						// Strip reflections into a separate blob
 			L"-Qstrip_debug"						// Strip debug information into a separate blob
 		};
+		utl::vector<LPCWSTR> all_args;
+		all_args.reserve(_countof(args) + defines.size() * 2);
+		for (u32 i{ 0 }; i < _countof(args); ++i) all_args.emplace_back(args[i]);
+		for (u32 i{ 0 }; i < defines.size(); ++i)
+		{
+			all_args.emplace_back(L"-D");
+			all_args.emplace_back(defines[i].c_str());
+		}
 
-		OutputDebugStringA("Compiling");
-		OutputDebugStringA(info.file);
-
-		return compile(source_blob.Get(), args, _countof(args));
+		// Shaders are compiled on several threads, so each one writes its log in one go.
+		std::string log{ "Compiling " };
+		log += info.file;
+		include_recorder includes{ _include_handler.Get(), dependencies };
+		IDxcBlob* const shader{ compile(source_blob.Get(), all_args.data(), (u32)all_args.size(), &includes, log) };
+		OutputDebugStringA(log.c_str());
+		return shader;
 	}
 	// compile only
-	IDxcBlob* compile(IDxcBlobEncoding* source_blob, LPCWSTR* args, u32 args_num)
+	IDxcBlob* compile(IDxcBlobEncoding* source_blob, LPCWSTR* args, u32 args_num, IDxcIncludeHandler* include_handler, std::string& log)
 	{
 		DxcBuffer buffer{};
 		buffer.Encoding = DXC_CP_ACP;				// use if blob contain text. For binary or ANSI code DXC_CP_ACP
@@ -106,7 +168,7 @@ public:
 
 		HRESULT hr{ S_OK };
 		ComPtr<IDxcResult> results{ nullptr };
-		DXCall(hr = _compiler->Compile(&buffer, args, args_num, _include_handler.Get(), IID_PPV_ARGS(&results)));
+		DXCall(hr = _compiler->Compile(&buffer, args, args_num, include_handler, IID_PPV_ARGS(&results)));
 		if (FAILED(hr)) return nullptr;
 
 		ComPtr<IDxcBlobUtf8> errors{ nullptr };
@@ -115,14 +177,14 @@ public:
 
 		if (errors && errors->GetStringLength())
 		{
-			OutputDebugStringA("\nShader compilation error: \n");
-			OutputDebugStringA(errors->GetStringPointer());
+			log += "\nShader compilation error: \n";
+			log += errors->GetStringPointer();
 		}
 		else
 		{
-			OutputDebugStringA(" [ Succeeded ]");
+			log += " [ Succeeded ]";
 		}
-		OutputDebugStringA("\n");
+		log += "\n";
 
 		HRESULT status{ S_OK };
 		DXCall(hr = results->GetStatus(&status));
@@ -154,39 +216,180 @@ get_engine_shaders_path()
 	return std::filesystem::path{ graphics::get_engine_shaders_path(graphics::graphics_platform::direct3d12) };
 }
 
-bool
-compiled_shaders_are_up_to_date()
+// The manifest sits next to the shaders blob and holds, for each engine shader, the hash
+// of everything that went into compiling it and the list of files it included:
+//	u32 magic, u32 shader count
+//	for each shader: u64 hash, u32 dependency count, for each dependency: u32 length, path (UTF-8)
+constexpr u32 manifest_magic{ 0x4d444853 }; // "SHDM"
+
+struct shader_build_info
 {
-	auto engine_shaders_path = get_engine_shaders_path();
-	if (!std::filesystem::exists(engine_shaders_path))return false;
-	auto shaders_compilation_time = std::filesystem::last_write_time(engine_shaders_path);
+	u64										hash{ 0 };
+	utl::vector<std::filesystem::path>		dependencies;
+};
 
-	std::filesystem::path path{};
-	std::filesystem::path full_path{};
+std::filesystem::path
+get_manifest_path()
+{
+	std::filesystem::path path{ get_engine_shaders_path() };
+	path += ".deps";
+	return path;
+}
 
-	// Check if either of engine shader source files is newer than the compiled shader file.
-	// In that case, we need to recompile.
-	for (u32 i{ 0 }; i < engine_shader::count; ++i)
+std::filesystem::path
+get_source_path(const shader_file_info& info)
+{
+	std::filesystem::path path{ shaders_source_path };
+	path += info.file;
+	return path;
+}
+
+// Adds the contents of a file to 'hash'. Returns false if the file can't be read.
+bool
+hash_file(const std::filesystem::path& path, u64& hash)
+{
+	std::ifstream file{ path, std::ios::in | std::ios::binary };
+	if (!file) return false;
+	char buffer[4096];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount())
 	{
-		auto& info = shader_files[i];
+		hash = utl::fnv1a_64(buffer, (u64)file.gcount(), hash);
+	}
+	return true;
+}
 
-		path = shaders_source_path;
-		path += info.file;
-		full_path = path;
-		if (!std::filesystem::exists(full_path))return false;
+// Everything that changes the output: build settings, the source and every included file.
+// Returns 0 if any of the files is missing, which never matches a stored hash.
+u64
+hash_shader(const shader_file_info& info, const utl::vector<std::filesystem::path>& dependencies)
+{
+	u64 hash{ utl::fnv1a_64_offset_basis };
+	const u32 settings[]{ shader_build_version, (u32)info.type, is_debug_build };
+	hash = utl::fnv1a_64((const char*)&settings[0], sizeof(settings), hash);
+	hash = utl::fnv1a_64(info.function, strlen(info.function), hash);
+	if (!hash_file(get_source_path(info), hash)) return 0;
+	for (u32 i{ 0 }; i < dependencies.size(); ++i)
+	{
+		const std::string name{ dependencies[i].generic_u8string() };
+		hash = utl::fnv1a_64(name.c_str(), name.size(), hash);
+		if (!hash_file(dependencies[i], hash)) return 0;
+	}
+	return hash ? hash : 1;
+}
+
+template<typename T>
+bool
+read(std::ifstream& file, T& value)
+{
+	return (bool)file.read((char*)&value, sizeof(T));
+}
+
+template<typename T>
+void
+write(std::ofstream& file, const T& value)
+{
+	file.write((const char*)&value, sizeof(T));
+}
 
-		auto shader_file_time = std::filesystem::last_write_time(full_path);
-		if (shader_file_time > shaders_compilation_time)
+// Returns false if there's no manifest or it's for a different set of shaders.
+bool
+load_manifest(utl::vector<shader_build_info>& infos)
+{
+	std::ifstream file{ get_manifest_path(), std::ios::in | std::ios::binary };
+	u32 magic{ 0 }, count{ 0 };
+	if (!file || !read(file, magic) || !read(file, count) || magic != manifest_magic || count != engine_shader::count) return false;
+
+	infos.resize(count);
+	for (auto& info : infos)
+	{
+		u32 dependency_count{ 0 };
+		if (!read(file, info.hash) || !read(file, dependency_count)) return false;
+		for (u32 i{ 0 }; i < dependency_count; ++i)
 		{
-			return false;
+			u32 length{ 0 };
+			if (!read(file, length) || length > 4096) return false;
+			std::string name(length, '\0');
+			if (!file.read(name.data(), length)) return false;
+			info.dependencies.emplace_back(std::filesystem::u8path(name));
 		}
 	}
 	return true;
 }
 
 bool
-save_compiled_shaders(const utl::vector<ComPtr<IDxcBlob>>& shaders)
+save_manifest(const utl::vector<shader_build_info>& infos)
 {
+	std::ofstream file{ get_manifest_path(), std::ios::out | std::ios::binary };
+	if (!file) return false;
+	write(file, manifest_magic);
+	write(file, (u32)infos.size());
+	for (const auto& info : infos)
+	{
+		write(file, info.hash);
+		write(file, (u32)info.dependencies.size());
+		for (u32 i{ 0 }; i < info.dependencies.size(); ++i)
+		{
+			const std::string name{ info.dependencies[i].generic_u8string() };
+			write(file, (u32)name.size());
+			file.write(name.c_str(), name.size());
+		}
+	}
+	return (bool)file;
+}
+
+// Read the existing library, so that the byte code of unchanged shaders can be reused.
+bool
+load_compiled_shaders(utl::vector<utl::vector<u8>>& shaders)
+{
+	content::shader_library library{};
+	if (!library.open(get_engine_shaders_path().string().c_str())) return false;
+	shaders.resize(engine_shader::count);
+	for (u32 i{ 0 }; i < engine_shader::count; ++i)
+	{
+		const content::shader_bytecode shader{ library.find(content::shader_format::shader_key(shader_files[i].function)) };
+		if (!shader.size) return false;
+		shaders[i].resize(shader.size);
+		memcpy(shaders[i].data(), shader.byte_code, shader.size);
+	}
+	// NOTE: the library is closed here, before the file is written again.
+	return true;
+}
+
+constexpr u64
+align_offset(u64 offset)
+{
+	return (offset + content::shader_format::alignment - 1) & ~(content::shader_format::alignment - 1);
+}
+
+// Write the shaders as a library, see ShaderFormat.h.
+bool
+save_compiled_shaders(const utl::vector<utl::vector<u8>>& shaders)
+{
+	namespace format = content::shader_format;
+	const u32 count{ (u32)shaders.size() };
+	const u32 table_size{ format::table_size_for(count) };
+	const u32 mask{ table_size - 1 };
+	utl::vector<format::entry> table(table_size);
+
+	u64 offset{ align_offset(sizeof(format::header) + table_size * sizeof(format::entry)) };
+	utl::vector<u64> offsets(count);
+	for (u32 i{ 0 }; i < count; ++i)
+	{
+		const u64 key{ format::shader_key(shader_files[i].function) };
+		assert(key);
+		u32 slot{ (u32)key & mask };
+		while (table[slot].key)
+		{
+			// two shaders with the same name, or a hash collision between their names.
+			assert(table[slot].key != key);
+			if (table[slot].key == key) return false;
+			slot = (slot + 1) & mask;
+		}
+		table[slot] = { key, offset, shaders[i].size() };
+		offsets[i] = offset;
+		offset = align_offset(offset + shaders[i].size());
+	}
+
 	auto engine_shaders_path = get_engine_shaders_path();
 	std::filesystem::create_directories(engine_shaders_path.parent_path());
 	std::ofstream file{ engine_shaders_path, std::ios::out | std::ios::binary };
@@ -196,15 +399,19 @@ save_compiled_shaders(const utl::vector<ComPtr<IDxcBlob>>& shaders)
 		return false;
 	}
 
-	for (auto& shader : shaders)
+	const format::header header{ format::magic, format::version, count, table_size };
+	write(file, header);
+	file.write((const char*)table.data(), table.size() * sizeof(format::entry));
+	for (u32 i{ 0 }; i < count; ++i)
 	{
-		const D3D12_SHADER_BYTECODE byte_code{ shader->GetBufferPointer(), shader->GetBufferSize() };
-		file.write((char*)&byte_code.BytecodeLength, sizeof(byte_code.BytecodeLength));
-		file.write((char*)&byte_code.pShaderBytecode, byte_code.BytecodeLength);
+		// padding up to the aligned offset of the byte code.
+		constexpr char zeros[format::alignment]{};
+		file.write(zeros, offsets[i] - (u64)file.tellp());
+		file.write((const char*)shaders[i].data(), shaders[i].size());
 	}
 
 	file.close();
-	return true;
+	return (bool)file;
 }
 } // anonymous namespace
 
@@ -212,29 +419,100 @@ save_compiled_shaders(const utl::vector<ComPtr<IDxcBlob>>& shaders)
 bool
 compile_shaders()
 {
-	if (compiled_shaders_are_up_to_date()) return true;
-	utl::vector<ComPtr<IDxcBlob>> shaders;
-	std::filesystem::path path{};
-	std::filesystem::path full_path{};
-	shader_compiler compiler{};
-	// compiled shaders in a buffer in the same order of compilation.
-	for (u32 i{ 0 }; i < engine_shader::count; ++i)
+	// Reuse the byte code of every shader whose inputs have the same hash as last time.
+	utl::vector<shader_build_info> infos;
+	utl::vector<utl::vector<u8>> shaders;
+	const bool can_reuse{ load_manifest(infos) && load_compiled_shaders(shaders) };
+	if (!can_reuse)
 	{
-		auto& info = shader_files[i];
+		infos.clear();
+		infos.resize(engine_shader::count);
+		shaders.clear();
+		shaders.resize(engine_shader::count);
+	}
 
-		path = shaders_source_path;
-		path += info.file;
-		full_path = path;
-		if (!std::filesystem::exists(full_path)) return false;
-		ComPtr<IDxcBlob> compiled_shader{ compiler.compile(info, full_path) };
-		if (compiled_shader != nullptr && compiled_shader->GetBufferPointer() && compiled_shader->GetBufferSize())
-		{
-			shaders.emplace_back(std::move(compiled_shader));
-		}
-		else
+	utl::vector<u32> dirty;
+	for (u32 i{ 0 }; i < engine_shader::count; ++i)
+	{
+		if (!can_reuse || hash_shader(shader_files[i], infos[i].dependencies) != infos[i].hash) dirty.emplace_back(i);
+	}
+	if (dirty.empty()) return true;
+
+	// Compile the changed shaders on several threads. DXC compiler instances can't be
+	// shared between threads, so every worker has its own.
+	std::atomic<u32> next{ 0 };
+	std::atomic<bool> result{ true };
+	auto worker = [&]() {
+		shader_compiler compiler{};
+		for (u32 job{ next++ }; job < dirty.size() && result; job = next++)
 		{
-			return false;
+			const u32 index{ dirty[job] };
+			const shader_file_info& info{ shader_files[index] };
+			const std::filesystem::path full_path{ std::filesystem::absolute(get_source_path(info)) };
+			utl::vector<std::filesystem::path> dependencies;
+			ComPtr<IDxcBlob> compiled_shader{ std::filesystem::exists(full_path) ? compiler.compile(info, full_path, dependencies) : nullptr };
+			if (!compiled_shader || !compiled_shader->GetBufferPointer() || !compiled_shader->GetBufferSize())
+			{
+				result = false;
+				break;
+			}
+			// Each worker only writes the entries of its own jobs.
+			const u8* const byte_code{ (const u8*)compiled_shader->GetBufferPointer() };
+			shaders[index].resize(compiled_shader->GetBufferSize());
+			memcpy(shaders[index].data(), byte_code, shaders[index].size());
+			infos[index].dependencies = std::move(dependencies);
+			infos[index].hash = hash_shader(info, infos[index].dependencies);
 		}
+	};
+
+	const u32 hardware_threads{ std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1 };
+	const u32 thread_count{ (u32)dirty.size() < hardware_threads ? (u32)dirty.size() : hardware_threads };
+	utl::vector<std::thread> threads;
+	for (u32 i{ 1 }; i < thread_count; ++i) threads.emplace_back(worker);
+	worker();
+	for (u32 i{ 0 }; i < threads.size(); ++i) threads[i].join();
+	if (!result) return false;
+
+	// Splice the new byte code in with the unchanged shaders. The manifest is written
+	// last, so if saving the blob fails, the next build compiles everything again.
+	std::error_code error;
+	std::filesystem::remove(get_manifest_path(), error);
+	return save_compiled_shaders(shaders) && save_manifest(infos);
+}
+
+namespace {
+bool
+compile_shader_variant(const graphics::shader_variants::compile_request& request, utl::vector<u8>& byte_code,
+					   utl::deque<std::string>& dependencies)
+{
+	// Called on the variant workers. DXC compilers can't be shared between threads.
+	thread_local shader_compiler compiler{};
+	const graphics::shader_variants::shader_source& source{ *request.source };
+	assert(source.type < shader_type::count);
+
+	utl::vector<std::wstring> defines;
+	for (u32 i{ 0 }; i < source.feature_count; ++i)
+	{
+		if (request.features & (1ull << i)) defines.emplace_back(to_wstring(source.features[i]) + L"=1");
 	}
-	return save_compiled_shaders(shaders);
+
+	const shader_file_info info{ source.file, source.function, engine_shader::count, (shader_type::type)source.type };
+	const std::filesystem::path full_path{ std::filesystem::absolute(source.file) };
+	if (!std::filesystem::exists(full_path)) return false;
+	utl::vector<std::filesystem::path> paths;
+	ComPtr<IDxcBlob> shader{ compiler.compile(info, full_path, paths, defines) };
+	if (!shader || !shader->GetBufferPointer() || !shader->GetBufferSize()) return false;
+
+	byte_code.resize(shader->GetBufferSize());
+	memcpy(byte_code.data(), shader->GetBufferPointer(), byte_code.size());
+	for (u32 i{ 0 }; i < paths.size(); ++i) dependencies.emplace_back(paths[i].string());
+	return true;
+}
+} // anonymous namespace
+
+graphics::shader_variants::compiler_info
+get_shader_variant_compiler()
+{
+	// The build settings of the variants are the same as for the engine shaders.
+	return { compile_shader_variant, ((u64)shader_build_version << 1) | is_debug_build };
 }
\ No newline at end of file
@@ -1,3 +1,6 @@
 #pragma once
+#include "Graphics\ShaderVariants.h"
 
 bool compile_shaders();
+// Compiles shader variants with DXC, see graphics::shader_variants::initialize().
+ferraris::graphics::shader_variants::compiler_info get_shader_variant_compiler();
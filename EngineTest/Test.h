@@ -6,6 +6,23 @@
 #define TEST_ENTITY_COMPONENTS 0
 #define TEST_WINDOW 0
 #define TEST_RENDERER 1
+#define TEST_CONCURRENT_FREE_LIST 0
+#define TEST_FLAT_MAP 0
+#define TEST_LEVEL_LOADING 0
+#define TEST_LEVEL_STREAMING 0
+#define TEST_COMPRESSION 0
+#define TEST_MESH_LOADING 0
+#define TEST_NULL_RENDERER 0
+#define TEST_RENDER_GRAPH 0
+#define TEST_COMMAND_CONTEXTS 0
+#define TEST_QUEUE_TIMELINE 0
+#define TEST_UPLOAD_RING 0
+#define TEST_TLSF_ALLOCATOR 0
+#define TEST_DEFERRED_RELEASE 0
+#define TEST_FRAME_PACING 0
+#define TEST_PIPELINE_CACHE 0
+#define TEST_SHADER_VARIANTS 0
+#define TEST_FRAME_ALLOCATOR 0
 
 class test {
 public:
@@ -0,0 +1,198 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\Renderer.h"
+#include "..\Engine\Graphics\Null\NullCore.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Records the draw calls of a frame on 1 to N threads into the command lists of a
+// command_context_pool and reports how the CPU time of a frame scales with threads.
+// Each batch of draws is recorded into its own context with the batch index as order key,
+// and a different number of draws per batch. That makes it possible to check that the lists
+// always come out in batch order, no matter which thread recorded which batch. The pool uses
+// the command lists of the null backend, so this doesn't need a GPU.
+// The frames are recorded twice: with a pool of the test, and with the contexts of the null
+// backend between graphics::begin_frame() and end_frame(), like a game would.
+// NOTE: measure release builds.
+class engine_test : public test
+{
+public:
+	bool initialize() override
+	{
+		_pool.initialize(_backend);
+		if (!graphics::initialize(graphics::graphics_platform::null)) return false;
+		_surface = graphics::create_surface(platform::window{});
+		return true;
+	}
+
+	void run() override
+	{
+		const u32 hardware_threads{ std::thread::hardware_concurrency() };
+		do {
+			std::cout << "path   | threads | frame (us) | speedup | lists | contexts\n";
+			for (const bool use_engine : { false, true })
+			{
+				_use_engine = use_engine;
+				f32 single_thread_us{ 0.f };
+				for (u32 thread_count{ 1 }; thread_count <= max_threads; thread_count *= 2)
+				{
+					if (thread_count > 1 && thread_count > hardware_threads) break;
+					const f32 us{ measure(thread_count) };
+					if (thread_count == 1) single_thread_us = us;
+					const graphics::command_context_stats stats{ use_engine ? graphics::null::core::get_command_context_stats() : _pool.stats() };
+					std::cout << (use_engine ? "engine" : "pool  ") << " | " << std::setw(7) << thread_count << " | "
+						<< std::setw(10) << std::fixed << std::setprecision(1) << us << " | "
+						<< std::setw(7) << std::setprecision(2) << single_thread_us / us << " | "
+						<< std::setw(5) << stats.used << " | " << std::setw(8) << stats.context_count << "\n";
+				}
+			}
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override
+	{
+		if (_surface.is_valid()) graphics::remove_surface(_surface.get_id());
+		graphics::shutdown();
+		_pool.release();
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static u32 frame_count{ 1000 };
+	constexpr static u32 max_threads{ 16 };
+	constexpr static u32 batch_count{ 48 };
+	constexpr static u32 draws_per_batch{ 64 };		// batch i has draws_per_batch + i draws
+	constexpr static u32 work_per_draw{ 256 };		// stands in for setting state and writing commands
+
+	using null_command_context = graphics::null::null_command_context;
+
+	null_command_context* acquire(u32 order)
+	{
+		return _use_engine ? graphics::null::core::acquire_command_context(order) : _pool.acquire(order);
+	}
+
+	void close(null_command_context* context)
+	{
+		if (_use_engine) graphics::null::core::close_command_context(context);
+		else _pool.close(context);
+	}
+
+	// Each thread takes the next batch until there are none left.
+	void record_batches()
+	{
+		for (u32 batch{ _next_batch.fetch_add(1, std::memory_order_relaxed) }; batch < batch_count;
+			batch = _next_batch.fetch_add(1, std::memory_order_relaxed))
+		{
+			null_command_context* const context{ acquire(batch) };
+			assert(context);
+			u32 state{ batch };
+			for (u32 i{ 0 }; i < draws_per_batch + batch; ++i)
+			{
+				for (u32 j{ 0 }; j < work_per_draw; ++j) state = state * 1664525u + 1013904223u;
+				context->list->record(1);
+			}
+			_sink.fetch_xor(state, std::memory_order_relaxed);
+			close(context);
+		}
+	}
+
+	void worker(u32 frame)
+	{
+		while (true)
+		{
+			{
+				std::unique_lock lock{ _mutex };
+				_start.wait(lock, [this, frame]() { return _frame != frame || !_is_running; });
+				if (!_is_running) return;
+				frame = _frame;
+			}
+			record_batches();
+			std::lock_guard lock{ _mutex };
+			if (!--_busy_workers) _done.notify_one();
+		}
+	}
+
+	f32 measure(u32 thread_count)
+	{
+		// The calling thread records too.
+		const u32 worker_count{ thread_count - 1 };
+		_is_running = true;
+		std::thread workers[max_threads];
+		for (u32 i{ 0 }; i < worker_count; ++i) workers[i] = std::thread{ &engine_test::worker, this, _frame };
+
+		const clock::time_point start{ clock::now() };
+		for (u32 frame{ 0 }; frame < frame_count; ++frame)
+		{
+			// The null backend has no GPU, so every frame of the ring is ready right away.
+			if (_use_engine) graphics::begin_frame();
+			else _pool.begin_frame(frame % graphics::null::frame_buffer_count);
+			_next_batch.store(0, std::memory_order_relaxed);
+			{
+				std::lock_guard lock{ _mutex };
+				++_frame;
+				_busy_workers = worker_count;
+			}
+			_start.notify_all();
+			record_batches();
+			{
+				std::unique_lock lock{ _mutex };
+				_done.wait(lock, [this]() { return !_busy_workers; });
+			}
+
+			if (_use_engine)
+			{
+				const graphics::null::core::null_stats before{ graphics::null::core::get_stats() };
+				_surface.render();
+				graphics::end_frame();
+				[[maybe_unused]] const graphics::null::core::null_stats after{ graphics::null::core::get_stats() };
+				// The frame's own list and one per batch.
+				assert(after.submitted_lists - before.submitted_lists == 1 + batch_count);
+				assert(after.submitted_commands - before.submitted_commands == batch_count * draws_per_batch + batch_count * (batch_count - 1) / 2);
+				// The frame has been submitted, so there's nothing to record into.
+				assert(!graphics::null::core::acquire_command_context(0));
+				continue;
+			}
+
+			// The reserved context is submitted after all batches, like the end of the frame would be.
+			null_command_context* const last{ _pool.acquire_reserved() };
+			assert(last && !_pool.acquire_reserved());
+			last->list->record(1);
+			_pool.close(last);
+
+			graphics::null::null_command_list* lists[graphics::null::null_command_context_pool::max_lists];
+			const u32 count{ _pool.collect(&lists[0], _countof(lists)) };
+			assert(count == batch_count + 1 && lists[batch_count] == last->list);
+			for (u32 i{ 0 }; i < batch_count; ++i)
+			{
+				assert(lists[i]->command_count == draws_per_batch + i);
+			}
+		}
+		const f32 us{ (f32)std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count() / (f32)frame_count };
+
+		{
+			std::lock_guard lock{ _mutex };
+			_is_running = false;
+		}
+		_start.notify_all();
+		for (u32 i{ 0 }; i < worker_count; ++i) workers[i].join();
+		return us;
+	}
+
+	graphics::null::null_command_backend		_backend{};
+	graphics::null::null_command_context_pool	_pool{};
+	graphics::surface							_surface{};
+	std::mutex									_mutex{};
+	std::condition_variable						_start{};
+	std::condition_variable						_done{};
+	std::atomic<u32>							_next_batch{ 0 };
+	std::atomic<u32>							_sink{ 0 };
+	u32											_frame{ 0 };
+	u32											_busy_workers{ 0 };
+	bool										_is_running{ false };
+	bool										_use_engine{ false };
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Content\ContentLoader.h"
+#include "..\Engine\Content\MappedFile.h"
+#include "..\Engine\Graphics\Renderer.h"
+#include "..\Engine\Utilities\Compression.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Compression benchmark on real content: the compiled engine shaders, the game.bin that the
+// editor wrote for a project and every file in the project's Content folder. Copy game.bin and
+// the Content folder next to EngineTest.exe to include them. For each file it reports the ratio,
+// compression speed, single thread decompression speed and the time content::read_file()
+// takes for the plain and the compressed file, where chunks are decompressed in parallel.
+// The last row is the whole mix, which is what a shipped game would see.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return content::initialize(); }
+
+	void run() override
+	{
+		do {
+			std::cout << "content          |  size (MB) | ratio | compress (MB/s) | decompress (GB/s) | read plain (ms) | read compressed (ms)\n";
+			results total{};
+			measure("engine shaders", graphics::get_engine_shaders_path(graphics::graphics_platform::direct3d12), total);
+			measure("game.bin", "game.bin", total);
+			std::error_code error;
+			for (const auto& entry : std::filesystem::recursive_directory_iterator{ content_path, error })
+			{
+				if (!entry.is_regular_file()) continue;
+				const std::string path{ entry.path().string() };
+				measure(entry.path().filename().string().c_str(), path.c_str(), total);
+			}
+			if (total.size) print("total", total);
+			std::remove(plain_path);
+			std::remove(compressed_path);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override { content::shutdown(); }
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static const char* content_path{ "Content" };
+	constexpr static const char* plain_path{ "compression_plain.bin" };
+	constexpr static const char* compressed_path{ "compression_packed.bin" };
+	constexpr static u32 runs{ 5 };
+
+	struct results
+	{
+		u64 size{ 0 };
+		u64 compressed_size{ 0 };
+		f32 compress_ms{ 0.f };
+		f32 decompress_ms{ 0.f };
+		f32 read_plain_ms{ 0.f };
+		f32 read_compressed_ms{ 0.f };
+	};
+
+	static f32 ms_since(clock::time_point start)
+	{
+		return (f32)std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count() * 0.001f;
+	}
+
+	template<typename function>
+	static f32 best_of(function func)
+	{
+		f32 best{ 1e30f };
+		for (u32 i{ 0 }; i < runs; ++i)
+		{
+			const clock::time_point start{ clock::now() };
+			func();
+			const f32 ms{ ms_since(start) };
+			best = ms < best ? ms : best;
+		}
+		return best;
+	}
+
+	static void measure(const char* name, const char* path, results& total)
+	{
+		// Files that are already compressed, like game.bin, are measured on their plain data.
+		content::file_data file{};
+		if (!content::read_file(path, file))
+		{
+			std::cout << std::left << std::setw(16) << name << std::right << " | not found: " << path << "\n";
+			return;
+		}
+		const u64 size{ file.size() };
+		if (!size) return;
+		const u64 capacity{ compression::compress_bound(size) };
+		std::unique_ptr<u8[]> compressed{ std::make_unique<u8[]>(capacity) };
+		std::unique_ptr<u8[]> decompressed{ std::make_unique<u8[]>(size) };
+
+		u64 compressed_size{ 0 };
+		const f32 compress_ms{ best_of([&]() { compressed_size = compression::compress(file.data(), size, compressed.get(), capacity); }) };
+		bool result{ true };
+		const f32 decompress_ms{ best_of([&]() { result &= compression::decompress(compressed.get(), compressed_size, decompressed.get(), size); }) };
+		assert(result && !memcmp(file.data(), decompressed.get(), size));
+
+		{
+			std::ofstream out{ plain_path, std::ios::out | std::ios::binary };
+			out.write((const char*)file.data(), size);
+		}
+		{
+			std::ofstream out{ compressed_path, std::ios::out | std::ios::binary };
+			out.write((const char*)compressed.get(), compressed_size);
+		}
+		const f32 read_plain_ms{ best_of([]() { content::file_data data{}; content::read_file(plain_path, data); touch(data); }) };
+		const f32 read_compressed_ms{ best_of([]() { content::file_data data{}; content::read_file(compressed_path, data); touch(data); }) };
+
+		const results r{ size, compressed_size, compress_ms, decompress_ms, read_plain_ms, read_compressed_ms };
+		print(name, r);
+		total.size += r.size;
+		total.compressed_size += r.compressed_size;
+		total.compress_ms += r.compress_ms;
+		total.decompress_ms += r.decompress_ms;
+		total.read_plain_ms += r.read_plain_ms;
+		total.read_compressed_ms += r.read_compressed_ms;
+	}
+
+	static void print(const char* name, const results& r)
+	{
+		const f32 mb{ (f32)r.size / (1024.f * 1024.f) };
+		std::cout << std::left << std::setw(16) << name << std::right << " | "
+			<< std::setw(10) << std::fixed << std::setprecision(2) << mb << " | "
+			<< std::setw(5) << (f32)r.size / (f32)r.compressed_size << " | "
+			<< std::setw(15) << mb / (r.compress_ms * 0.001f) << " | "
+			<< std::setw(17) << mb / 1024.f / (r.decompress_ms * 0.001f) << " | "
+			<< std::setw(15) << r.read_plain_ms << " | "
+			<< std::setw(20) << r.read_compressed_ms << "\n";
+	}
+
+	// Read every page, so that mapped files are timed with their disk reads.
+	static void touch(const content::file_data& data)
+	{
+		u8 sum{ 0 };
+		for (u64 i{ 0 }; i < data.size(); i += 4096) sum += data.data()[i];
+		[[maybe_unused]] volatile u8 touched{ sum };
+	}
+};
@@ -0,0 +1,103 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Common\CommonHeaders.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Contention benchmark: every thread allocates a handful of indices, then frees
+// them again, for a fixed number of rounds. We compare the lock-free pool with
+// the mutex-guarded free index stack that descriptor_heap used before.
+// The last column runs the lock-free pool with only as many indices as the threads hold at
+// once, so allocations often have to take indices from the caches of other threads. They
+// must never fail.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			std::cout << "threads | mutex (ms) | lock-free (ms) | speed-up | exhausted (ms)\n";
+			for (u32 thread_count{ 1 }; thread_count <= 32; thread_count <<= 1)
+			{
+				const f32 locked{ measure<mutex_index_stack>(thread_count, capacity) };
+				const f32 lock_free{ measure<utl::concurrent_index_pool>(thread_count, capacity) };
+				const f32 exhausted{ measure<utl::concurrent_index_pool>(thread_count, thread_count * batch) };
+				std::cout << std::setw(7) << thread_count << " | "
+					<< std::setw(10) << locked << " | "
+					<< std::setw(14) << lock_free << " | "
+					<< std::setw(7) << locked / lock_free << "x | "
+					<< std::setw(14) << exhausted << "\n";
+			}
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	constexpr static u32 capacity{ 4096 };
+	constexpr static u32 rounds{ 100'000 };
+	constexpr static u32 batch{ 8 };
+
+	// The old descriptor_heap scheme: a stack of free indices behind one mutex.
+	class mutex_index_stack
+	{
+	public:
+		explicit mutex_index_stack(u32 count) : _free{ std::make_unique<u32[]>(count) }, _capacity{ count }
+		{
+			for (u32 i{ 0 }; i < count; ++i) _free[i] = i;
+		}
+		u32 allocate()
+		{
+			std::lock_guard lock{ _mutex };
+			return _size < _capacity ? _free[_size++] : u32_invalid_id;
+		}
+		void free(u32 index)
+		{
+			std::lock_guard lock{ _mutex };
+			_free[--_size] = index;
+		}
+	private:
+		std::mutex				_mutex{};
+		std::unique_ptr<u32[]>	_free;
+		u32						_capacity{ 0 };
+		u32						_size{ 0 };
+	};
+
+	template<typename pool_type>
+	f32 measure(u32 thread_count, u32 pool_capacity)
+	{
+		pool_type pool{ pool_capacity };
+		std::atomic<u32> ready{ 0 };
+		utl::vector<std::thread> threads;
+		threads.reserve(thread_count);
+
+		const auto start{ std::chrono::steady_clock::now() };
+		for (u32 t{ 0 }; t < thread_count; ++t)
+		{
+			threads.emplace_back([&pool, &ready, thread_count] {
+				// Start all threads at the same time to maximize contention.
+				ready.fetch_add(1);
+				while (ready.load() < thread_count) std::this_thread::yield();
+
+				u32 indices[batch];
+				for (u32 r{ 0 }; r < rounds; ++r)
+				{
+					for (u32 i{ 0 }; i < batch; ++i) indices[i] = pool.allocate();
+					for (u32 i{ 0 }; i < batch; ++i)
+					{
+						assert(indices[i] != u32_invalid_id);
+						pool.free(indices[i]);
+					}
+				}
+			});
+		}
+		for (auto& thread : threads) thread.join();
+		const auto dt{ std::chrono::steady_clock::now() - start };
+		return (f32)std::chrono::duration_cast<std::chrono::microseconds>(dt).count() * 0.001f;
+	}
+};
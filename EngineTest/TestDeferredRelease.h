@@ -0,0 +1,119 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Common\CommonHeaders.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Contention benchmark for deferred releases: worker threads release items into the list of
+// the current frame, like streaming threads releasing resources, while the main thread moves
+// on to the next frame and processes its list, like process_deferred_releases() does. We
+// compare the lock-free lists with the mutex-guarded vectors the Direct3D12 core used before,
+// and check that every item is processed exactly once.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			std::cout << "threads | mutex (ms) | lock-free (ms) | speed-up\n";
+			for (u32 thread_count{ 1 }; thread_count <= 32; thread_count <<= 1)
+			{
+				const f32 locked{ measure<mutex_release_lists>(thread_count) };
+				const f32 lock_free{ measure<lock_free_release_lists>(thread_count) };
+				std::cout << std::setw(7) << thread_count << " | "
+					<< std::setw(10) << locked << " | "
+					<< std::setw(14) << lock_free << " | "
+					<< locked / lock_free << "x\n";
+			}
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	constexpr static u32 frame_count{ 3 };
+	constexpr static u32 releases_per_thread{ 50'000 };
+
+	// The old scheme: a vector per frame behind one mutex.
+	class mutex_release_lists
+	{
+	public:
+		explicit mutex_release_lists(u32) {}
+		void push(u32 list, u64 item)
+		{
+			std::lock_guard lock{ _mutex };
+			_lists[list].push_back(item);
+		}
+		template<typename function>
+		u32 take_all(u32 list, function&& f)
+		{
+			std::lock_guard lock{ _mutex };
+			const u32 count{ (u32)_lists[list].size() };
+			for (u32 i{ 0 }; i < count; ++i) f(_lists[list][i]);
+			_lists[list].clear();
+			return count;
+		}
+	private:
+		std::mutex			_mutex{};
+		utl::vector<u64>	_lists[frame_count];
+	};
+
+	class lock_free_release_lists : public utl::concurrent_push_lists<u64, frame_count>
+	{
+	public:
+		// Room for all items, so that we measure the lock-free path and not the overflow.
+		explicit lock_free_release_lists(u32 capacity) { initialize(capacity); }
+		~lock_free_release_lists() { release(); }
+	};
+
+	template<typename lists_type>
+	f32 measure(u32 thread_count)
+	{
+		const u64 n{ (u64)thread_count * releases_per_thread };
+		lists_type lists{ (u32)n };
+		std::atomic<u32> frame{ 0 };
+		std::atomic<u32> ready{ 0 };
+		std::atomic<u32> done{ 0 };
+		utl::vector<std::thread> threads;
+		threads.reserve(thread_count);
+		u64 processed{ 0 };
+		u64 sum{ 0 };
+		auto process = [&processed, &sum](u64 item) { ++processed; sum += item; };
+
+		const auto start{ std::chrono::steady_clock::now() };
+		for (u32 t{ 0 }; t < thread_count; ++t)
+		{
+			threads.emplace_back([&lists, &frame, &ready, &done, thread_count, t] {
+				// Start all threads at the same time to maximize contention.
+				ready.fetch_add(1);
+				while (ready.load() < thread_count) std::this_thread::yield();
+
+				for (u32 i{ 0 }; i < releases_per_thread; ++i)
+				{
+					lists.push(frame.load(std::memory_order_relaxed), (u64)t * releases_per_thread + i + 1);
+				}
+				done.fetch_add(1);
+			});
+		}
+
+		// The render thread: start the next frame and process its releases.
+		while (done.load() < thread_count)
+		{
+			const u32 next{ (frame.load(std::memory_order_relaxed) + 1) % frame_count };
+			frame.store(next, std::memory_order_relaxed);
+			lists.take_all(next, process);
+		}
+		for (auto& thread : threads) thread.join();
+		for (u32 i{ 0 }; i < frame_count; ++i) lists.take_all(i, process);
+		const auto dt{ std::chrono::steady_clock::now() - start };
+
+		// Every item was processed once: the count and the sum of 1..n match.
+		assert(processed == n && sum == n * (n + 1) / 2);
+		return (f32)std::chrono::duration_cast<std::chrono::microseconds>(dt).count() * 0.001f;
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Common\CommonHeaders.h"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Compare utl::flat_map with std::unordered_map for the kind of use the script
+// registry has: size_t keys (hashed names), inserted once and looked up often.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			std::cout << "   items | insert std (ms) | insert flat (ms) | find std (ms) | find flat (ms) | miss std (ms) | miss flat (ms)\n";
+			for (u32 count{ 1000 }; count <= 1'000'000; count *= 10)
+			{
+				generate_keys(count);
+				const results std_map{ measure<std::unordered_map<size_t, u64>>() };
+				const results flat_map{ measure<utl::flat_map<size_t, u64>>() };
+				std::cout << std::setw(8) << count << " | "
+					<< std::setw(15) << std_map.insert << " | "
+					<< std::setw(16) << flat_map.insert << " | "
+					<< std::setw(13) << std_map.find << " | "
+					<< std::setw(14) << flat_map.find << " | "
+					<< std::setw(13) << std_map.miss << " | "
+					<< std::setw(14) << flat_map.miss << "\n";
+			}
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct results
+	{
+		f32 insert;
+		f32 find;
+		f32 miss;
+	};
+
+	// Lookups are repeated so that small maps take a measurable amount of time.
+	constexpr static u32 lookup_count{ 4'000'000 };
+
+	utl::vector<size_t> _keys;
+	utl::vector<size_t> _missing_keys;
+
+	void generate_keys(u32 count)
+	{
+		std::mt19937_64 rng{ count };
+		_keys.resize(count);
+		_missing_keys.resize(count);
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			// Keys with the lowest bit set are inserted, the others are only used for misses.
+			_keys[i] = rng() | 1;
+			_missing_keys[i] = rng() & ~(size_t)1;
+		}
+	}
+
+	static f32 ms_since(clock::time_point start)
+	{
+		return (f32)std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count() * 0.001f;
+	}
+
+	template<typename map_type>
+	results measure()
+	{
+		results r{};
+		map_type map;
+		const u32 count{ (u32)_keys.size() };
+
+		clock::time_point start{ clock::now() };
+		for (u32 i{ 0 }; i < count; ++i) map.emplace(_keys[i], i);
+		r.insert = ms_since(start);
+
+		u64 sum{ 0 };
+		start = clock::now();
+		for (u32 i{ 0 }; i < lookup_count; ++i)
+		{
+			auto it{ map.find(_keys[i % count]) };
+			if (it != map.end()) sum += it->second;
+		}
+		r.find = ms_since(start);
+
+		start = clock::now();
+		for (u32 i{ 0 }; i < lookup_count; ++i)
+		{
+			if (map.find(_missing_keys[i % count]) != map.end()) ++sum;
+		}
+		r.miss = ms_since(start);
+
+		// Use the result so that the lookups can't be optimized away.
+		if (sum == u64_invalid_id) std::cout << sum;
+		return r;
+	}
+};
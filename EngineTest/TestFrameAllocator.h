@@ -0,0 +1,151 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Core\FrameAllocator.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Checks the per-frame scratch arenas the way the graphics backend drives them: every frame
+// begins by resetting the arena of its frame index, so memory allocated in a frame has to stay
+// intact while the other frames in flight run, and has to be reused once the same frame index
+// comes around again. Then it fills an arena past its capacity from several threads, which must
+// fall back to the heap without corrupting any allocation, and frees those blocks on the next reset.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return memory::initialize_frame_arenas(arena_size); }
+
+	void run() override
+	{
+		do {
+			// Start over with empty arenas and statistics.
+			memory::initialize_frame_arenas(arena_size);
+			_failed = 0;
+			test_frame_reset();
+			test_alignment();
+			test_overflow(1);
+			test_overflow(8);
+			std::cout << (_failed ? "FAILED: " : "passed ") << _failed << " checks failed\n";
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override { memory::shutdown_frame_arenas(); }
+
+private:
+	constexpr static u64 arena_size{ 64 * 1024 };
+	constexpr static u32 frame_count{ 12 };
+	constexpr static u32 allocation_size{ 1024 };
+
+	void check(bool condition, const char* what)
+	{
+		if (condition) return;
+		std::cout << "  check failed: " << what << "\n";
+		++_failed;
+	}
+
+	// Each frame writes its number into a few allocations, and a frame's data is checked
+	// just before its arena is reset, i.e. after 'frame_arena_count - 1' other frames ran.
+	void test_frame_reset()
+	{
+		u8* first[memory::frame_arena_count]{};
+		u8* data[memory::frame_arena_count][4]{};
+		for (u32 frame{ 0 }; frame < frame_count; ++frame)
+		{
+			const u32 frame_index{ frame % memory::frame_arena_count };
+			if (frame >= memory::frame_arena_count)
+			{
+				for (u32 i{ 0 }; i < _countof(data[frame_index]); ++i)
+				{
+					check(is_filled(data[frame_index][i], allocation_size, (u8)(frame - memory::frame_arena_count)),
+						"data was overwritten by the other frames in flight");
+				}
+			}
+
+			memory::begin_frame_arena(frame_index);
+			check(memory::get_frame_arena_stats().used == 0, "arena isn't empty after the reset");
+			for (u32 i{ 0 }; i < _countof(data[frame_index]); ++i)
+			{
+				u8* const p{ (u8*)memory::frame_allocate(allocation_size) };
+				memset(p, (u8)frame, allocation_size);
+				data[frame_index][i] = p;
+			}
+
+			// The arena starts over at the same address every time its frame index comes around.
+			if (frame < memory::frame_arena_count) first[frame_index] = data[frame_index][0];
+			else check(data[frame_index][0] == first[frame_index], "arena wasn't reused");
+			check(memory::get_frame_arena_stats().used == _countof(data[frame_index]) * allocation_size,
+				"wrong number of bytes used in the frame");
+		}
+		check(memory::get_frame_arena_stats().peak == _countof(data[0]) * allocation_size, "wrong peak usage");
+	}
+
+	void test_alignment()
+	{
+		memory::begin_frame_arena(0);
+		for (u64 alignment{ 1 }; alignment <= 4096; alignment <<= 1)
+		{
+			const u64 p{ (u64)memory::frame_allocate(3, alignment) };
+			check(!(p & (alignment - 1)) && !(p & 15), "misaligned allocation");
+		}
+
+		memory::frame_vector<u32> v{};
+		for (u32 i{ 0 }; i < 1000; ++i) v.emplace_back(i);
+		bool ok{ v.size() == 1000 };
+		for (u32 i{ 0 }; i < v.size(); ++i) ok = ok && v[i] == i;
+		check(ok, "frame_vector lost items while growing");
+	}
+
+	// 'thread_count' threads allocate twice the arena size. The allocations that don't fit
+	// come from the heap and have to be just as usable as the ones in the arena.
+	void test_overflow(u32 thread_count)
+	{
+		memory::begin_frame_arena(1);
+		const u32 overflows{ memory::get_frame_arena_stats().overflows };
+		const u32 count{ (u32)(2 * arena_size / allocation_size) };
+		utl::vector<u8*> allocations(count);
+		utl::vector<std::thread> threads;
+		std::atomic<u32> next{ 0 };
+		for (u32 t{ 0 }; t < thread_count; ++t)
+		{
+			threads.emplace_back(std::thread{ [&]() {
+				for (u32 i{ next.fetch_add(1) }; i < count; i = next.fetch_add(1))
+				{
+					u8* const p{ (u8*)memory::frame_allocate(allocation_size, 64) };
+					if (p) memset(p, (u8)i, allocation_size);
+					allocations[i] = p;
+				}
+			} });
+		}
+		for (u32 t{ 0 }; t < thread_count; ++t) threads[t].join();
+
+		bool ok{ true };
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			u8* const p{ allocations[i] };
+			ok = ok && p && !((u64)p & 63) && is_filled(p, allocation_size, (u8)i);
+		}
+		check(ok, "overflow allocations are invalid or overlap");
+
+		const memory::frame_arena_stats stats{ memory::get_frame_arena_stats() };
+		check(stats.used == arena_size, "used bytes aren't clamped to the capacity");
+		check(stats.overflows > overflows, "overflow wasn't counted");
+		std::cout << std::setw(2) << thread_count << " thread(s): " << stats.overflows - overflows
+			<< " of " << count << " allocations overflowed\n";
+
+		// Resetting the arena frees the overflow blocks (run with a leak checker to see it)
+		// and hands out the arena again.
+		memory::begin_frame_arena(1);
+		check(memory::get_frame_arena_stats().used == 0, "arena isn't empty after an overflow");
+		check(memory::frame_allocate(allocation_size) != nullptr, "arena isn't usable after an overflow");
+	}
+
+	static bool is_filled(const u8* p, u64 size, u8 value)
+	{
+		for (u64 i{ 0 }; i < size; ++i) if (p[i] != value) return false;
+		return true;
+	}
+
+	u32		_failed{ 0 };
+};
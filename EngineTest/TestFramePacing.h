@@ -0,0 +1,80 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\Renderer.h"
+#include "..\Engine\Graphics\Null\NullCore.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Renders with each frame pacing preset on the null graphics backend and reports the frame
+// timing stats. The emulated GPU only finishes a frame when the CPU waits for it, so the CPU
+// always runs as far ahead as the pacing allows: we check that it never has more frames in
+// flight than that.
+class engine_test : public test
+{
+public:
+	bool initialize() override
+	{
+		if (!graphics::initialize(graphics::graphics_platform::null)) return false;
+		_surface = graphics::create_surface(platform::window{});
+		return true;
+	}
+
+	void run() override
+	{
+		do {
+			std::cout << "pacing      | in flight | max in flight | frame (ms) | max frame (ms) | wait (ms)\n";
+			measure("balanced   ", graphics::frame_pacing_preset::balanced);
+			measure("low latency", graphics::frame_pacing_preset::low_latency);
+			measure("throughput ", graphics::frame_pacing_preset::throughput);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override
+	{
+		if (_surface.is_valid()) graphics::remove_surface(_surface.get_id());
+		graphics::set_frame_pacing(graphics::frame_pacing_preset::balanced);
+		graphics::shutdown();
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static u32 frame_count{ 2'000 };
+
+	void measure(const char* name, const graphics::frame_pacing& pacing)
+	{
+		graphics::set_frame_pacing(pacing);
+		assert(graphics::get_frame_pacing().frames_in_flight == pacing.frames_in_flight);
+
+		u64 max_in_flight{ 0 };
+		for (u32 frame{ 0 }; frame < frame_count; ++frame)
+		{
+			// Like a game that samples input right after the display is ready, and then does
+			// some CPU work, so that the frame times aren't just the cost of the backend.
+			graphics::wait_for_display();
+			const clock::time_point start{ clock::now() };
+			while (clock::now() - start < std::chrono::microseconds{ 50 }) {}
+
+			graphics::begin_frame();
+			_surface.render();
+			graphics::end_frame();
+			const graphics::null::core::null_stats stats{ graphics::null::core::get_stats() };
+			const u64 in_flight{ stats.fence_value - stats.completed_fence_value };
+			max_in_flight = in_flight > max_in_flight ? in_flight : max_in_flight;
+		}
+		assert(max_in_flight <= pacing.frames_in_flight);
+
+		// The timer finishes a frame when the next one begins.
+		const graphics::frame_timing_stats timing{ graphics::get_frame_timing_stats() };
+		assert(timing.frame_count == frame_count - 1);
+		std::cout << name << " | " << std::setw(9) << pacing.frames_in_flight << " | "
+			<< std::setw(13) << max_in_flight << " | "
+			<< std::setw(10) << std::fixed << std::setprecision(4) << timing.cpu_frame_time << " | "
+			<< std::setw(14) << timing.max_cpu_frame_time << " | "
+			<< std::setw(9) << timing.cpu_wait_time << "\n";
+	}
+
+	graphics::surface _surface;
+};
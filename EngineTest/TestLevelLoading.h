@@ -0,0 +1,69 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Content\ContentLoader.h"
+#include "TestLevelWriter.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Load-time benchmark: writes the same level in the old per-entity format and in
+// the sectioned format (LevelFormat.h) and measures content::load_game() for both,
+// parsing on one thread and on all hardware threads.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return content::initialize(); }
+
+	void run() override
+	{
+		do {
+			std::cout << "entities | old, 1 thread (ms) | old, all threads (ms) | new, 1 thread (ms) | new, all threads (ms)\n";
+			for (u32 count{ 1000 }; count <= 1'000'000; count *= 10)
+			{
+				_writer.generate(count);
+				_writer.write_legacy_level(legacy_path);
+				_writer.write_level(level_path);
+				std::cout << std::setw(8) << count;
+				for (const char* path : { legacy_path, level_path })
+				{
+					content::set_level_loader_thread_count(1);
+					const f32 single_thread{ measure(path) };
+					content::set_level_loader_thread_count(0);
+					const f32 all_threads{ measure(path) };
+					std::cout << " | " << std::setw(18) << single_thread << " | " << std::setw(21) << all_threads;
+				}
+				std::cout << "\n";
+			}
+			std::remove(legacy_path);
+			std::remove(level_path);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override { content::shutdown(); }
+
+private:
+	constexpr static const char* legacy_path{ "level_legacy.bin" };
+	constexpr static const char* level_path{ "level_v1.bin" };
+	constexpr static u32 runs{ 5 };
+
+	test_level_writer _writer;
+
+	// Returns the best time of a few runs, the first run also pays for reading the file from disk.
+	static f32 measure(const char* path)
+	{
+		f32 best{ 1e30f };
+		for (u32 i{ 0 }; i < runs; ++i)
+		{
+			const auto start{ std::chrono::steady_clock::now() };
+			[[maybe_unused]] const bool result{ content::load_game(path) };
+			assert(result);
+			const auto dt{ std::chrono::steady_clock::now() - start };
+			content::unload_game();
+			const f32 ms{ (f32)std::chrono::duration_cast<std::chrono::microseconds>(dt).count() * 0.001f };
+			best = ms < best ? ms : best;
+		}
+		return best;
+	}
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Content\ContentLoader.h"
+#include "TestLevelWriter.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Measures frame hitches while a level is loading. A game loop that does a fixed
+// amount of work per frame loads a level either with load_game(), which blocks
+// for the whole load, or with load_level_async() + update_level_loads().
+class engine_test : public test
+{
+public:
+	bool initialize() override { return content::initialize(); }
+
+	void run() override
+	{
+		do {
+			std::cout << "entities | blocking load (ms) | async: frames | longest frame (ms) | over budget | longest commit (ms)\n";
+			for (u32 count{ 10'000 }; count <= 1'000'000; count *= 10)
+			{
+				_writer.generate(count);
+				_writer.write_level(level_path);
+
+				const f32 blocking{ measure_blocking() };
+				content::unload_game();
+				const results async{ measure_async() };
+				content::unload_game();
+				// A load that's still running when the game is unloaded is released with it.
+				content::load_level_async(level_path);
+				content::unload_game();
+
+				std::cout << std::setw(8) << count << " | "
+					<< std::setw(18) << blocking << " | "
+					<< std::setw(13) << async.frames << " | "
+					<< std::setw(18) << async.longest_frame_ms << " | "
+					<< std::setw(11) << async.frames_over_budget << " | "
+					<< std::setw(19) << async.longest_commit_ms << "\n";
+			}
+			std::remove(level_path);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override { content::shutdown(); }
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static const char* level_path{ "level_streaming.bin" };
+	constexpr static f32 frame_budget_ms{ 16.6f };
+	// Time the simulated game spends per frame, not counting the loading.
+	constexpr static f32 game_work_ms{ 8.f };
+
+	struct results
+	{
+		u32 frames{ 0 };
+		u32 frames_over_budget{ 0 };
+		f32 longest_frame_ms{ 0.f };
+		f32 longest_commit_ms{ 0.f };
+	};
+
+	test_level_writer _writer;
+
+	static f32 ms_since(clock::time_point start)
+	{
+		return std::chrono::duration<f32, std::milli>(clock::now() - start).count();
+	}
+
+	static void do_game_work()
+	{
+		const clock::time_point start{ clock::now() };
+		while (ms_since(start) < game_work_ms) {}
+	}
+
+	// The frame that calls load_game() takes as long as the whole load.
+	static f32 measure_blocking()
+	{
+		const clock::time_point start{ clock::now() };
+		do_game_work();
+		[[maybe_unused]] const bool result{ content::load_game(level_path) };
+		assert(result);
+		return ms_since(start);
+	}
+
+	static results measure_async()
+	{
+		results r{};
+		const content::level_load_id id{ content::load_level_async(level_path) };
+		content::level_load_status status{};
+		do
+		{
+			const clock::time_point start{ clock::now() };
+			do_game_work();
+			content::update_level_loads();
+			status = content::get_level_load_status(id);
+			const f32 frame_ms{ ms_since(start) };
+			++r.frames;
+			if (frame_ms > frame_budget_ms) ++r.frames_over_budget;
+			r.longest_frame_ms = frame_ms > r.longest_frame_ms ? frame_ms : r.longest_frame_ms;
+		} while (status.state != content::level_load_state::done && status.state != content::level_load_state::failed);
+		assert(status.state == content::level_load_state::done);
+		r.longest_commit_ms = status.max_commit_ms;
+		content::release_level_load(id);
+		return r;
+	}
+};
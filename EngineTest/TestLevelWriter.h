@@ -0,0 +1,108 @@
+#pragma once
+#include "..\Engine\Content\LevelFormat.h"
+
+#include <fstream>
+#include <random>
+
+// Writes levels with random transforms for the level loading tests.
+class test_level_writer
+{
+public:
+	void generate(u32 count)
+	{
+		using namespace ferraris;
+		std::mt19937 rng{ count };
+		std::uniform_real_distribution<f32> dist{ -100.f, 100.f };
+		_positions.resize(count);
+		_rotations.resize(count);
+		_scales.resize(count);
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			_positions[i] = { dist(rng), dist(rng), dist(rng) };
+			_rotations[i] = { dist(rng) * 0.01f, dist(rng) * 0.01f, dist(rng) * 0.01f };
+			_scales[i] = { 1.f, 1.f, 1.f };
+		}
+	}
+
+	// The old format: per entity a type, a component count and the components.
+	void write_legacy_level(const char* path) const
+	{
+		std::ofstream file{ path, std::ios::out | std::ios::binary };
+		const u32 count{ (u32)_positions.size() };
+		write(file, count);
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			write(file, (u32)0);	// entity type
+			write(file, (u32)1);	// component count
+			write(file, (u32)0);	// transform component
+			write(file, _positions[i]);
+			write(file, _rotations[i]);
+			write(file, _scales[i]);
+		}
+	}
+
+	// The sectioned format, see LevelFormat.h.
+	void write_level(const char* path) const
+	{
+		using namespace ferraris;
+		namespace level = content::level;
+		std::ofstream file{ path, std::ios::out | std::ios::binary };
+		const u32 count{ (u32)_positions.size() };
+		level::header header{ level::magic, level::version, count, level::section::count, {} };
+		write(file, header);
+
+		auto begin_section = [&](level::section s) { align(file); header.sections[s].offset = (u64)file.tellp(); };
+		auto end_section = [&](level::section s) { header.sections[s].size = (u64)file.tellp() - header.sections[s].offset; };
+
+		begin_section(level::section::entities);
+		for (u32 i{ 0 }; i < count; ++i) write(file, level::entity_record{ 0, u32_invalid_id });
+		end_section(level::section::entities);
+
+		begin_section(level::section::positions);
+		file.write((const char*)_positions.data(), count * sizeof(math::v3));
+		end_section(level::section::positions);
+
+		begin_section(level::section::rotations);
+		for (u32 i{ 0 }; i < count; ++i)
+		{
+			using namespace DirectX;
+			XMFLOAT3A rot{ &_rotations[i].x };
+			XMFLOAT4 quat{};
+			XMStoreFloat4(&quat, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3A(&rot)));
+			write(file, quat);
+		}
+		end_section(level::section::rotations);
+
+		begin_section(level::section::scales);
+		file.write((const char*)_scales.data(), count * sizeof(math::v3));
+		end_section(level::section::scales);
+
+		// no scripts
+		begin_section(level::section::scripts);
+		end_section(level::section::scripts);
+		begin_section(level::section::strings);
+		end_section(level::section::strings);
+
+		file.seekp(0);
+		write(file, header);
+	}
+
+private:
+	ferraris::utl::vector<ferraris::math::v3> _positions;
+	ferraris::utl::vector<ferraris::math::v3> _rotations; // euler angles, the new format stores quaternions
+	ferraris::utl::vector<ferraris::math::v3> _scales;
+
+	template<typename T>
+	static void write(std::ofstream& file, const T& value)
+	{
+		file.write((const char*)&value, sizeof(T));
+	}
+
+	static void align(std::ofstream& file)
+	{
+		constexpr u64 alignment{ ferraris::content::level::section_alignment };
+		constexpr u8 zeros[alignment]{};
+		const u64 padding{ (alignment - (u64)file.tellp() % alignment) % alignment };
+		file.write((const char*)zeros, padding);
+	}
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Content\GeometryLoader.h"
+#include "..\Engine\Utilities\Compression.h"
+#include "TestMeshWriter.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Mesh load throughput: content::geometry_asset on a plain and on a compressed file,
+// and for comparison a loader that reads the file into memory and copies every
+// submesh into its own vertex and index buffers. Each run also copies the vertex and
+// index data into a staging buffer once, which is what an upload to the GPU costs on the CPU.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return content::initialize(); }
+
+	void run() override
+	{
+		do {
+			std::cout << "scene                   |  size (MB) | submeshes | views (MB/s) | views, compressed (MB/s) | copy (MB/s)\n";
+			measure("1 mesh, 4 LODs", 1024, 4, 1);
+			measure("64 meshes, 4 LODs", 64, 4, 64);
+			measure("4096 meshes, 1 LOD", 8, 1, 4096);
+			std::remove(plain_path);
+			std::remove(compressed_path);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override { content::shutdown(); }
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static const char* plain_path{ "mesh_plain.bin" };
+	constexpr static const char* compressed_path{ "mesh_packed.bin" };
+	constexpr static u32 runs{ 5 };
+
+	utl::vector<u8> _staging;
+
+	template<typename function>
+	static f32 best_of(function func)
+	{
+		f32 best{ 1e30f };
+		for (u32 i{ 0 }; i < runs; ++i)
+		{
+			const clock::time_point start{ clock::now() };
+			func();
+			const f32 ms{ std::chrono::duration<f32, std::milli>(clock::now() - start).count() };
+			best = ms < best ? ms : best;
+		}
+		return best;
+	}
+
+	void measure(const char* name, u32 segments, u32 lod_count, u32 meshes_per_lod)
+	{
+		test_mesh_writer{}.write(plain_path, segments, lod_count, meshes_per_lod);
+		u64 size{ 0 };
+		u32 submesh_count{ 0 };
+		{
+			content::geometry_asset asset{};
+			[[maybe_unused]] const bool result{ asset.load(plain_path) };
+			assert(result);
+			submesh_count = asset.submesh_count();
+			write_compressed(plain_path, compressed_path);
+			std::ifstream file{ plain_path, std::ios::in | std::ios::binary | std::ios::ate };
+			size = (u64)file.tellg();
+		}
+		_staging.resize(size);
+
+		const f32 views_ms{ best_of([this]() { load_views(plain_path); }) };
+		const f32 compressed_ms{ best_of([this]() { load_views(compressed_path); }) };
+		const f32 copy_ms{ best_of([this]() { load_copies(plain_path); }) };
+
+		const f32 mb{ (f32)size / (1024.f * 1024.f) };
+		std::cout << std::left << std::setw(23) << name << std::right << " | "
+			<< std::setw(10) << std::fixed << std::setprecision(2) << mb << " | "
+			<< std::setw(9) << submesh_count << " | "
+			<< std::setw(12) << mb / (views_ms * 0.001f) << " | "
+			<< std::setw(24) << mb / (compressed_ms * 0.001f) << " | "
+			<< std::setw(11) << mb / (copy_ms * 0.001f) << "\n";
+	}
+
+	static void write_compressed(const char* src_path, const char* dst_path)
+	{
+		content::mapped_file src{};
+		src.open(src_path);
+		const u64 capacity{ compression::compress_bound(src.size()) };
+		std::unique_ptr<u8[]> buffer{ std::make_unique<u8[]>(capacity) };
+		const u64 size{ compression::compress(src.data(), src.size(), buffer.get(), capacity) };
+		std::ofstream file{ dst_path, std::ios::out | std::ios::binary };
+		file.write((const char*)buffer.get(), size);
+	}
+
+	void load_views(const char* path)
+	{
+		content::geometry_asset asset{};
+		[[maybe_unused]] const bool result{ asset.load(path) };
+		assert(result);
+		u64 offset{ 0 };
+		for (u32 i{ 0 }; i < asset.submesh_count(); ++i)
+		{
+			const content::submesh_view& submesh{ asset.submesh(i) };
+			offset = stage(offset, submesh.vertices, (u64)submesh.vertex_size * submesh.vertex_count);
+			offset = stage(offset, submesh.indices, (u64)submesh.index_size * submesh.index_count);
+		}
+	}
+
+	// What a loader without views would do: read the file, then give each submesh its own buffers.
+	void load_copies(const char* path)
+	{
+		std::ifstream file{ path, std::ios::in | std::ios::binary | std::ios::ate };
+		const u64 size{ (u64)file.tellg() };
+		file.seekg(0);
+		utl::vector<u8> data(size);
+		file.read((char*)data.data(), size);
+
+		content::geometry_asset asset{};
+		[[maybe_unused]] const bool result{ asset.load(data.data(), size) };
+		assert(result);
+		utl::vector<utl::vector<u8>> vertex_buffers(asset.submesh_count());
+		utl::vector<utl::vector<u8>> index_buffers(asset.submesh_count());
+		u64 offset{ 0 };
+		for (u32 i{ 0 }; i < asset.submesh_count(); ++i)
+		{
+			const content::submesh_view& submesh{ asset.submesh(i) };
+			vertex_buffers[i].resize((u64)submesh.vertex_size * submesh.vertex_count);
+			memcpy(vertex_buffers[i].data(), submesh.vertices, vertex_buffers[i].size());
+			index_buffers[i].resize((u64)submesh.index_size * submesh.index_count);
+			memcpy(index_buffers[i].data(), submesh.indices, index_buffers[i].size());
+			offset = stage(offset, vertex_buffers[i].data(), vertex_buffers[i].size());
+			offset = stage(offset, index_buffers[i].data(), index_buffers[i].size());
+		}
+	}
+
+	u64 stage(u64 offset, const u8* data, u64 size)
+	{
+		assert(offset + size <= _staging.size());
+		memcpy(&_staging[offset], data, size);
+		return offset + size;
+	}
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include "..\Engine\Common\CommonHeaders.h"
+
+#include <fstream>
+#include <random>
+#include <string>
+
+// Writes geometry in the layout of ContentTools' pack_data() for the content tests.
+// Each mesh is a grid with a bit of noise, LOD n has half the segments of LOD n - 1.
+class test_mesh_writer
+{
+public:
+	// Same layout as packed_vertex::vertex_static in ContentTools.
+	struct vertex_static
+	{
+		ferraris::math::v3	position;
+		u8					reserved[3];
+		u8					t_sign;
+		u16					normal[2];
+		u16					tangent[2];
+		ferraris::math::v2	uv;
+	};
+
+	void write(const char* path, u32 segments, u32 lod_count, u32 meshes_per_lod) const
+	{
+		std::ofstream file{ path, std::ios::out | std::ios::binary };
+		write_name(file, "grid");
+		write(file, lod_count);
+		for (u32 lod{ 0 }; lod < lod_count; ++lod)
+		{
+			write_name(file, ("lod_" + std::to_string(lod)).c_str());
+			write(file, meshes_per_lod);
+			const u32 lod_segments{ segments >> lod ? segments >> lod : 1 };
+			for (u32 mesh{ 0 }; mesh < meshes_per_lod; ++mesh)
+			{
+				write_mesh(file, ("mesh_" + std::to_string(mesh)).c_str(), lod, lod_segments, 10.f * (f32)(lod + 1));
+			}
+		}
+	}
+
+private:
+	template<typename T>
+	static void write(std::ofstream& file, const T& value)
+	{
+		file.write((const char*)&value, sizeof(T));
+	}
+
+	static void write_name(std::ofstream& file, const char* name)
+	{
+		const u32 length{ (u32)strlen(name) };
+		write(file, length);
+		file.write(name, length);
+	}
+
+	static void write_mesh(std::ofstream& file, const char* name, u32 lod_id, u32 segments, f32 threshold)
+	{
+		std::mt19937 rng{ segments };
+		std::uniform_real_distribution<f32> noise{ -0.01f, 0.01f };
+		const u32 rows{ segments + 1 };
+		ferraris::utl::vector<vertex_static> vertices(rows * rows);
+		for (u32 y{ 0 }; y < rows; ++y)
+		{
+			for (u32 x{ 0 }; x < rows; ++x)
+			{
+				vertex_static& v{ vertices[y * rows + x] };
+				const f32 u{ (f32)x / (f32)segments };
+				const f32 w{ (f32)y / (f32)segments };
+				v = {};
+				v.position = { u - 0.5f, noise(rng), w - 0.5f };
+				v.t_sign = 3;
+				v.normal[0] = (u16)(32767 + (s32)(noise(rng) * 32767.f));
+				v.normal[1] = 32767;
+				v.tangent[0] = 65535;
+				v.tangent[1] = 32767;
+				v.uv = { u, w };
+			}
+		}
+		ferraris::utl::vector<u32> indices;
+		for (u32 y{ 0 }; y < segments; ++y)
+		{
+			for (u32 x{ 0 }; x < segments; ++x)
+			{
+				const u32 i{ y * rows + x };
+				indices.emplace_back(i); indices.emplace_back(i + rows); indices.emplace_back(i + 1);
+				indices.emplace_back(i + 1); indices.emplace_back(i + rows); indices.emplace_back(i + rows + 1);
+			}
+		}
+
+		const u32 vertex_count{ (u32)vertices.size() };
+		// pack_data() uses 16-bit indices when they can address all vertices.
+		const u32 index_size{ vertex_count < (1 << 16) ? sizeof(u16) : sizeof(u32) };
+		write_name(file, name);
+		write(file, lod_id);
+		write(file, (u32)sizeof(vertex_static));
+		write(file, vertex_count);
+		write(file, index_size);
+		write(file, (u32)indices.size());
+		write(file, threshold);
+		file.write((const char*)vertices.data(), vertices.size() * sizeof(vertex_static));
+		if (index_size == sizeof(u16))
+		{
+			for (u32 index : indices) write(file, (u16)index);
+		}
+		else
+		{
+			file.write((const char*)indices.data(), indices.size() * sizeof(u32));
+		}
+	}
+};
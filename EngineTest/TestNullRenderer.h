@@ -0,0 +1,84 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\Renderer.h"
+#include "..\Engine\Graphics\Null\NullCore.h"
+#include "..\Engine\Graphics\Null\NullResources.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Runs the render loop on the null graphics backend, without windows or a GPU, and
+// reports the CPU cost of a frame. It also checks the bookkeeping of the backend:
+// every frame is fenced, and descriptors freed by resizing surfaces come back once
+// their frame has completed.
+// NOTE: measure release builds. Debug builds fill a frame arena with garbage whenever it's reset.
+class engine_test : public test
+{
+public:
+	bool initialize() override
+	{
+		if (!graphics::initialize(graphics::graphics_platform::null)) return false;
+		for (u32 i{ 0 }; i < _countof(_surfaces); ++i)
+		{
+			_surfaces[i] = graphics::create_surface(platform::window{});
+		}
+		return true;
+	}
+
+	void run() override
+	{
+		do {
+			std::cout << "frames  | surfaces | frame (us) | fence waits | rtv in use | rtv peak\n";
+			for (u32 i{ 0 }; i < 5; ++i) measure();
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override
+	{
+		for (u32 i{ 0 }; i < _countof(_surfaces); ++i)
+		{
+			if (_surfaces[i].is_valid()) graphics::remove_surface(_surfaces[i].get_id());
+		}
+		graphics::shutdown();
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static u32 frame_count{ 10'000 };
+
+	void measure()
+	{
+		const graphics::null::core::null_stats start{ graphics::null::core::get_stats() };
+		const clock::time_point start_time{ clock::now() };
+		for (u32 frame{ 0 }; frame < frame_count; ++frame)
+		{
+			graphics::begin_frame();
+			for (u32 i{ 0 }; i < _countof(_surfaces); ++i)
+			{
+				// Resizing frees and allocates render target descriptors.
+				if (!(frame & 1023)) _surfaces[i].resize(1280 + frame % 7, 720);
+				_surfaces[i].render();
+			}
+			graphics::end_frame();
+		}
+		const f32 us{ (f32)std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start_time).count() };
+		const graphics::null::core::null_stats end{ graphics::null::core::get_stats() };
+		const graphics::null::descriptor_heap_stats rtv{ graphics::null::core::rtv_heap().stats() };
+
+		const u64 frames{ end.frame_count - start.frame_count };
+		// All surfaces are submitted in one frame.
+		assert(frames == frame_count);
+		assert(end.fence_value - end.completed_fence_value <= graphics::null::frame_buffer_count);
+		// Each surface has one descriptor per back buffer. The rest waits for its frame.
+		assert(rtv.size - rtv.deferred_count == _countof(_surfaces) * 3);
+
+		std::cout << std::setw(7) << frames << " | " << std::setw(8) << end.surface_count << " | "
+			<< std::setw(10) << std::fixed << std::setprecision(3) << us / (f32)frames << " | "
+			<< std::setw(11) << end.fence_waits - start.fence_waits << " | "
+			<< std::setw(10) << rtv.size << " | " << std::setw(8) << rtv.peak << "\n";
+	}
+
+	graphics::surface _surfaces[4];
+};
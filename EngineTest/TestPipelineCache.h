@@ -0,0 +1,133 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\PipelineCache.h"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <unordered_set>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Requests pipelines from the pipeline cache with a fake backend that takes a few milliseconds
+// to "compile" each of them, and draws a number of frames while they're being created. Until
+// a pipeline is ready the frames use its fallback. The backend keeps a "library" of the keys it
+// compiled, which survives shutdown(), so the second pass starts warm, like the next run of a game.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			_library.clear();
+			std::cout << "pass | requests | hit rate | library rate | fallbacks | misses | create (ms) | frames\n";
+			measure("cold");
+			measure("warm");
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static u32 material_count{ 64 };
+	constexpr static u32 frame_count{ 1'000 };
+	constexpr static u64 root_signature{ 0xf00d };
+
+	struct fake_state
+	{
+		u32 blend;
+		u32 cull;
+	};
+
+	struct fake_pipeline
+	{
+		u64 key;
+		u32 material;
+	};
+
+	static graphics::pipeline_cache::create_result create(const graphics::pipeline_cache::create_request& request)
+	{
+		assert(request.create_info_size == sizeof(u32));
+		bool from_library{ false };
+		{
+			std::lock_guard lock{ _library_mutex };
+			from_library = _library.count(request.key);
+		}
+		// A pipeline from the library is much quicker to load than to compile.
+		std::this_thread::sleep_for(std::chrono::microseconds{ from_library ? 100 : 3'000 });
+		if (!from_library)
+		{
+			std::lock_guard lock{ _library_mutex };
+			_library.emplace(request.key);
+		}
+		return { new fake_pipeline{ request.key, *(const u32*)request.create_info }, from_library };
+	}
+
+	static void destroy(void* pipeline) { delete (fake_pipeline*)pipeline; }
+
+	static u64 request(u64 shader, u32 material, u64 fallback)
+	{
+		const u64 shaders[]{ shader, shader + 1 };
+		const fake_state state{ material % 4, material % 2 };
+		const graphics::pipeline_cache::pipeline_desc desc{ shaders, _countof(shaders), root_signature,
+			&state, sizeof(state), &material, sizeof(material) };
+		return graphics::pipeline_cache::request(desc, fallback);
+	}
+
+	void measure(const char* name)
+	{
+		graphics::pipeline_cache::initialize({ create, destroy, 1 });
+
+		// The fallback is created up front, like the default material of a game.
+		const u64 fallback{ request(0x100, u32_invalid_id, 0) };
+		graphics::pipeline_cache::wait_idle();
+		assert(graphics::pipeline_cache::get(fallback).state == graphics::pipeline_cache::pipeline_state::ready);
+
+		u64 keys[material_count]{};
+		for (u32 i{ 0 }; i < material_count; ++i) keys[i] = request(0x200 + i * 2, i, fallback);
+		// Requesting the same pipelines again only finds them.
+		for (u32 i{ 0 }; i < material_count; ++i)
+		{
+			[[maybe_unused]] const u64 key{ request(0x200 + i * 2, i, fallback) };
+			assert(key == keys[i]);
+		}
+
+		// Draw frames until every material has its own pipeline.
+		u32 frames{ 0 };
+		bool is_done{ false };
+		while (!is_done && frames < frame_count)
+		{
+			is_done = true;
+			for (u32 i{ 0 }; i < material_count; ++i)
+			{
+				const graphics::pipeline_cache::pipeline pipeline{ graphics::pipeline_cache::get(keys[i]) };
+				assert(pipeline.handle);
+				const fake_pipeline& p{ *(const fake_pipeline*)pipeline.handle };
+				assert(pipeline.is_fallback ? p.key == fallback : (p.key == keys[i] && p.material == i));
+				is_done &= !pipeline.is_fallback;
+			}
+			++frames;
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		}
+		graphics::pipeline_cache::wait_idle();
+
+		const graphics::pipeline_cache::pipeline_cache_stats stats{ graphics::pipeline_cache::get_stats() };
+		assert(stats.requests == material_count * 2 + 1);
+		assert(!stats.failures && !stats.misses);
+		std::cout << name << " | " << std::setw(8) << stats.requests << " | "
+			<< std::setw(8) << std::fixed << std::setprecision(2) << stats.hit_rate() << " | "
+			<< std::setw(12) << stats.library_hit_rate() << " | "
+			<< std::setw(9) << stats.fallbacks << " | "
+			<< std::setw(6) << stats.misses << " | "
+			<< std::setw(11) << std::setprecision(3) << stats.create_time << " | "
+			<< std::setw(6) << frames << "\n";
+
+		graphics::pipeline_cache::shutdown();
+	}
+
+	inline static std::mutex				_library_mutex;
+	inline static std::unordered_set<u64>	_library;
+};
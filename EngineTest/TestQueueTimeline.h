@@ -0,0 +1,192 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\QueueTimeline.h"
+
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Runs the frames of a renderer with async compute and uploads on a queue_timeline with fake
+// queues. The fake queues execute their commands in order, but each one at its own random pace,
+// and a wait blocks a queue until the other queue's fence gets there, like a GPU would. Every
+// piece of work records the sync points it depends on, and executing it checks that they were
+// reached. So the test fails if the timeline skips a wait it needed, and the fake queues stall
+// forever if it waits for a point that is never signaled. It reports how many waits were skipped.
+class engine_test : public test
+{
+public:
+	bool initialize() override
+	{
+		_timeline.initialize(_queues);
+		return true;
+	}
+
+	void run() override
+	{
+		do {
+			std::cout << "frames | signals | waits | skipped waits | cpu waits | work items | frame (ns)\n";
+			for (u32 i{ 0 }; i < 5; ++i) measure(i);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override
+	{
+		_timeline.flush();
+		_timeline.release();
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+	using queue_type = graphics::queue_type;
+	using sync_point = graphics::sync_point;
+	constexpr static u32 frame_count{ 10'000 };
+	constexpr static u32 frames_in_flight{ 3 };
+	constexpr static u32 max_dependencies{ 4 };
+
+	class fake_queues
+	{
+		struct command
+		{
+			enum command_type : u32 { work, signal, wait };
+			command_type	type;
+			u32				other;		// waits: the queue to wait for. work: the number of dependencies
+			u64				value;
+			sync_point		dependencies[max_dependencies];
+		};
+
+	public:
+		u64 completed_value(u32 queue) { return _fences[queue]; }
+		void signal(u32 queue, u64 value) { _commands[queue].push_back({ command::signal, 0, value }); }
+		void wait(u32 queue, u32 other, u64 value) { _commands[queue].push_back({ command::wait, other, value }); }
+
+		void wait_on_cpu(u32 queue, u64 value)
+		{
+			while (_fences[queue] < value)
+			{
+				const bool progress{ step() };
+				// All queues are stuck: the timeline waited for a point that's never signaled.
+				assert(progress);
+				if (!progress) return;
+			}
+		}
+
+		void submit(u32 queue, const sync_point* dependencies, u32 count)
+		{
+			command c{ command::work, count, 0 };
+			for (u32 i{ 0 }; i < count; ++i) c.dependencies[i] = dependencies[i];
+			_commands[queue].push_back(c);
+		}
+
+		// Executes the next command of a random queue that can make progress.
+		bool step()
+		{
+			const u32 first{ _random() % queue_type::count };
+			for (u32 i{ 0 }; i < queue_type::count; ++i)
+			{
+				const u32 q{ (first + i) % queue_type::count };
+				std::deque<command>& commands{ _commands[q] };
+				if (commands.empty()) continue;
+				const command& c{ commands.front() };
+				if (c.type == command::wait && _fences[c.other] < c.value) continue;
+				if (c.type == command::signal) _fences[q] = c.value;
+				else if (c.type == command::work) execute(c);
+				commands.pop_front();
+				return true;
+			}
+			return false;
+		}
+
+		u64 work_count() const { return _work_count; }
+
+	private:
+		void execute(const command& c)
+		{
+			for (u32 i{ 0 }; i < c.other; ++i)
+			{
+				assert(_fences[c.dependencies[i].queue] >= c.dependencies[i].value);
+			}
+			++_work_count;
+		}
+
+		std::deque<command>		_commands[queue_type::count]{};
+		u64						_fences[queue_type::count]{};
+		u64						_work_count{ 0 };
+		std::mt19937			_random{ 7 };
+	};
+
+	// Lets the fake GPU run for a bit, so queues are at different points when the next frame starts.
+	void run_queues(u32 max_steps)
+	{
+		const u32 steps{ _random() % (max_steps + 1) };
+		for (u32 i{ 0 }; i < steps && _queues.step(); ++i) {}
+	}
+
+	void frame(u32 index)
+	{
+		// Uploads for this frame.
+		_queues.submit(queue_type::copy, nullptr, 0);
+		const sync_point uploads{ _timeline.signal(queue_type::copy) };
+
+		// Async compute uses the previous frame's depth and this frame's uploads, e.g. for culling.
+		_timeline.wait(queue_type::compute, _last_frame);
+		const bool compute_uses_uploads{ (_random() & 1) != 0 };
+		if (compute_uses_uploads) _timeline.wait(queue_type::compute, uploads);
+		const sync_point compute_dependencies[]{ _last_frame, uploads };
+		_queues.submit(queue_type::compute, &compute_dependencies[0], compute_uses_uploads ? 2 : 1);
+		const sync_point compute{ _timeline.signal(queue_type::compute) };
+
+		// Graphics needs both. If compute waited for the uploads, waiting for compute is enough.
+		_timeline.wait(queue_type::graphics, compute);
+		_timeline.wait(queue_type::graphics, uploads);
+		const sync_point graphics_dependencies[]{ compute, uploads };
+		_queues.submit(queue_type::graphics, &graphics_dependencies[0], 2);
+		_frames[index % frames_in_flight] = _last_frame = _timeline.signal(queue_type::graphics);
+
+		// Sometimes an older upload is used again, which graphics has already waited for.
+		if (index > frames_in_flight && !(_random() % 4))
+		{
+			const sync_point old_upload{ _timeline.last_signaled(queue_type::copy).value - frames_in_flight, queue_type::copy };
+			_timeline.wait(queue_type::graphics, old_upload);
+		}
+
+		run_queues(8);
+
+		// Like the frame ring: wait for the frame that used this slot before.
+		_timeline.wait_on_cpu(_frames[(index + 1) % frames_in_flight]);
+	}
+
+	void measure(u32 run)
+	{
+		const graphics::queue_timeline_stats start{ _timeline.stats() };
+		const u64 start_work{ _queues.work_count() };
+		clock::duration time{};
+		for (u32 i{ 0 }; i < frame_count; ++i)
+		{
+			const clock::time_point frame_start{ clock::now() };
+			frame(run * frame_count + i);
+			time += clock::now() - frame_start;
+		}
+		_timeline.flush();
+
+		const graphics::queue_timeline_stats end{ _timeline.stats() };
+		const u64 work{ _queues.work_count() - start_work };
+		assert(work == 3ull * frame_count);
+		// Graphics never has to wait for uploads that compute already waited for.
+		assert(end.skipped_waits - start.skipped_waits >= frame_count / 4);
+
+		const f32 ns{ (f32)std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / (f32)frame_count };
+		std::cout << std::setw(6) << frame_count << " | " << std::setw(7) << end.signals - start.signals << " | "
+			<< std::setw(5) << end.waits - start.waits << " | " << std::setw(13) << end.skipped_waits - start.skipped_waits << " | "
+			<< std::setw(9) << end.cpu_waits - start.cpu_waits << " | " << std::setw(10) << work << " | "
+			<< std::setw(10) << std::fixed << std::setprecision(1) << ns << "\n";
+	}
+
+	fake_queues										_queues{};
+	graphics::queue_timeline<fake_queues>			_timeline{};
+	sync_point										_frames[frames_in_flight]{};
+	sync_point										_last_frame{};
+	std::mt19937									_random{ 13 };
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\RenderGraph.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Builds and compiles the render graph of a deferred renderer every frame, the way the
+// renderer would, and reports the CPU time it takes together with the result: culled passes,
+// barriers and how much memory aliasing the transient resources saves. The graph has a
+// configurable number of shadow maps to see how compiling scales. It doesn't need a GPU.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			std::cout << "shadows | passes | culled | transients | barriers | aliasing | transient (MB) | heaps (MB) | build + compile (us)\n";
+			for (u32 shadow_count : { 0u, 4u, 16u, 64u, 256u }) measure(shadow_count);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static u32 frame_count{ 1000 };
+	constexpr static u32 width{ 1920 };
+	constexpr static u32 height{ 1080 };
+	constexpr static u32 bloom_mips{ 6 };
+	constexpr static u64 alignment{ 64 * 1024 };
+
+	static void execute(const graphics::render_graph&, graphics::render_pass_id, void*, void*) {}
+
+	static graphics::transient_resource_desc texture(u32 w, u32 h, u32 bytes_per_pixel)
+	{
+		return { ((u64)w * h * bytes_per_pixel + alignment - 1) & ~(alignment - 1), alignment, 0 };
+	}
+
+	void build(graphics::render_graph& graph, u32 shadow_count)
+	{
+		using usage = graphics::resource_usage;
+		graph.reset();
+		const graphics::render_resource_id back_buffer{ graph.import("back buffer", usage::present, usage::present) };
+		const graphics::render_resource_id depth{ graph.create("depth", texture(width, height, 4)) };
+		const graphics::render_resource_id albedo{ graph.create("albedo", texture(width, height, 4)) };
+		const graphics::render_resource_id normals{ graph.create("normals", texture(width, height, 8)) };
+		const graphics::render_resource_id hdr{ graph.create("hdr", texture(width, height, 8)) };
+		const graphics::render_resource_id ao{ graph.create("ambient occlusion", texture(width / 2, height / 2, 1)) };
+		const graphics::render_resource_id ldr{ graph.create("ldr", texture(width, height, 4)) };
+		const graphics::render_resource_id debug{ graph.create("debug", texture(width, height, 4)) };
+
+		graphics::render_pass_id pass{ graph.add_pass("depth prepass", execute) };
+		graph.write(pass, depth, usage::depth_write);
+
+		pass = graph.add_pass("gbuffer", execute);
+		graph.write(pass, albedo, usage::render_target);
+		graph.write(pass, normals, usage::render_target);
+		graph.read(pass, depth, usage::depth_read);
+
+		graphics::render_resource_id shadows[256]{};
+		for (u32 i{ 0 }; i < shadow_count; ++i)
+		{
+			shadows[i] = graph.create("shadow map", texture(2048, 2048, 4));
+			pass = graph.add_pass("shadow", execute);
+			graph.write(pass, shadows[i], usage::depth_write);
+		}
+
+		pass = graph.add_pass("ambient occlusion", execute);
+		graph.read(pass, depth, usage::shader_resource);
+		graph.read(pass, normals, usage::shader_resource);
+		graph.write(pass, ao, usage::unordered_access);
+		pass = graph.add_pass("ambient occlusion blur", execute);
+		graph.write(pass, ao, usage::unordered_access);
+
+		pass = graph.add_pass("lighting", execute);
+		graph.read(pass, albedo, usage::shader_resource);
+		graph.read(pass, normals, usage::shader_resource);
+		graph.read(pass, depth, usage::shader_resource);
+		graph.read(pass, ao, usage::shader_resource);
+		for (u32 i{ 0 }; i < shadow_count; ++i) graph.read(pass, shadows[i], usage::shader_resource);
+		graph.write(pass, hdr, usage::render_target);
+
+		pass = graph.add_pass("transparency", execute);
+		graph.read(pass, depth, usage::depth_read);
+		graph.write(pass, hdr, usage::render_target);
+
+		// Each bloom mip is read by the next smaller one.
+		graphics::render_resource_id source{ hdr };
+		for (u32 i{ 0 }; i < bloom_mips; ++i)
+		{
+			const graphics::render_resource_id mip{ graph.create("bloom", texture(width >> (i + 1), height >> (i + 1), 8)) };
+			pass = graph.add_pass("bloom downsample", execute);
+			graph.read(pass, source, usage::shader_resource);
+			graph.write(pass, mip, usage::render_target);
+			source = mip;
+		}
+
+		pass = graph.add_pass("tone mapping", execute);
+		graph.read(pass, hdr, usage::shader_resource);
+		graph.read(pass, source, usage::shader_resource);
+		graph.write(pass, ldr, usage::render_target);
+
+		// Nothing reads the debug view, so this pass is culled.
+		pass = graph.add_pass("debug view", execute);
+		graph.read(pass, normals, usage::shader_resource);
+		graph.write(pass, debug, usage::render_target);
+
+		pass = graph.add_pass("copy to back buffer", execute);
+		graph.read(pass, ldr, usage::copy_source);
+		graph.write(pass, back_buffer, usage::copy_destination);
+	}
+
+	void measure(u32 shadow_count)
+	{
+		graphics::render_graph graph{};
+		const clock::time_point start{ clock::now() };
+		bool result{ true };
+		for (u32 i{ 0 }; i < frame_count; ++i)
+		{
+			build(graph, shadow_count);
+			result &= graph.compile();
+		}
+		const f32 us{ (f32)std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count() / (f32)frame_count };
+		assert(result);
+
+		const graphics::render_graph_stats& stats{ graph.stats() };
+		assert(stats.culled_pass_count == 1);
+		assert(stats.heap_size <= stats.transient_size);
+		validate(graph);
+
+		const f32 mb{ 1.f / (1024.f * 1024.f) };
+		std::cout << std::setw(7) << shadow_count << " | " << std::setw(6) << stats.pass_count << " | "
+			<< std::setw(6) << stats.culled_pass_count << " | " << std::setw(10) << stats.transient_count << " | "
+			<< std::setw(8) << stats.barrier_count << " | " << std::setw(8) << stats.aliasing_barrier_count << " | "
+			<< std::setw(14) << std::fixed << std::setprecision(1) << (f32)stats.transient_size * mb << " | "
+			<< std::setw(10) << (f32)stats.heap_size * mb << " | "
+			<< std::setw(20) << std::setprecision(2) << us << "\n";
+	}
+
+	// Transient resources whose memory overlaps must never be alive at the same time.
+	static void validate(const graphics::render_graph& graph)
+	{
+		for (u32 a{ 0 }; a < graph.resource_count(); ++a)
+		{
+			const auto& x{ graph.resource(graphics::render_resource_id{ a }) };
+			if (!x.is_transient || !x.is_used) continue;
+			const u64 x_size{ graph.transient_desc(graphics::render_resource_id{ a }).size };
+			for (u32 b{ a + 1 }; b < graph.resource_count(); ++b)
+			{
+				const auto& y{ graph.resource(graphics::render_resource_id{ b }) };
+				if (!y.is_transient || !y.is_used) continue;
+				const u64 y_size{ graph.transient_desc(graphics::render_resource_id{ b }).size };
+				const bool memory_overlaps{ x.offset < y.offset + y_size && y.offset < x.offset + x_size };
+				const bool lifetimes_overlap{ !(x.last_pass < y.first_pass || y.last_pass < x.first_pass) };
+				assert(!(memory_overlaps && lifetimes_overlap));
+			}
+		}
+	}
+};
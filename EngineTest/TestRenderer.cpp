@@ -104,6 +104,7 @@ engine_test::run()
 {
 	timer.begin();
 	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	graphics::begin_frame();
 	for (u32 i{ 0 }; i < _countof(_surfaces); ++i)
 	{
 		if (_surfaces[i].surface.is_valid())
@@ -111,6 +112,7 @@ engine_test::run()
 			_surfaces[i].surface.render();
 		}
 	}
+	graphics::end_frame();
 	timer.end();
 }
 
@@ -0,0 +1,120 @@
+#pragma once
+#include "Test.h"
+#include "ShaderCompilation.h"
+#include "..\Engine\Graphics\ShaderVariants.h"
+#include "..\Engine\Graphics\Direct3D12\D3D12Shaders.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Compiles every variant of a small pixel shader with DXC through the shader variant system
+// and checks its caches. The first pass compiles all variants and the second pass finds them
+// in the on-disk cache. Then the file the shader includes changes, and the third pass has to
+// compile all of them again. The shader and the cache are written next to the executable.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			std::error_code error;
+			std::filesystem::remove_all(cache_directory, error);
+			write_include("float4(0.f, 0.f, 0.f, 1.f)");
+			{
+				std::ofstream file{ source_path };
+				file << "#include \"" << include_path << "\"\n"
+					"float4 ShaderVariantsPS() : SV_TARGET\n"
+					"{\n"
+					"    float4 color = BASE_COLOR;\n"
+					"#if RED\n"
+					"    color.r = 1.f;\n"
+					"#endif\n"
+					"#if GREEN\n"
+					"    color.g = 1.f;\n"
+					"#endif\n"
+					"#if BLUE\n"
+					"    color.b = 1.f;\n"
+					"#endif\n"
+					"    return color;\n"
+					"}\n";
+			}
+
+			std::cout << "pass    | requests | memory hits | disk hits | compiles | failures | time (ms)\n";
+			measure("cold   ", variant_count, 0);
+			measure("warm   ", 0, variant_count);
+			write_include("float4(0.5f, 0.5f, 0.5f, 1.f)");
+			measure("changed", variant_count, 0);
+
+			// Without a running system there's nothing to compile with.
+			[[maybe_unused]] const u64 key{ graphics::shader_variants::request(graphics::shader_variants::shader_id{ 0 }, 0) };
+			assert(!key);
+
+			std::remove(source_path);
+			std::remove(include_path);
+			std::filesystem::remove_all(cache_directory, error);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static const char* source_path{ "shader_variants_test.hlsl" };
+	constexpr static const char* include_path{ "shader_variants_test.hlsli" };
+	constexpr static const char* cache_directory{ "ShaderVariantsTestCache" };
+	constexpr static const char* features[]{ "RED", "GREEN", "BLUE" };
+	constexpr static u32 variant_count{ 1 << _countof(features) };
+
+	static void write_include(const char* base_color)
+	{
+		std::ofstream file{ include_path };
+		file << "#define BASE_COLOR " << base_color << "\n";
+	}
+
+	static void measure(const char* name, [[maybe_unused]] u64 expected_compiles, [[maybe_unused]] u64 expected_disk_hits)
+	{
+		namespace variants = graphics::shader_variants;
+		// NOTE: qualified, initialize() and shutdown() would be the ones of the test.
+		[[maybe_unused]] const bool result{ variants::initialize(get_shader_variant_compiler(), cache_directory) };
+		assert(result);
+
+		const clock::time_point start{ clock::now() };
+		const variants::shader_source source{ source_path, "ShaderVariantsPS", graphics::d3d12::shaders::shader_type::pixel,
+			features, _countof(features) };
+		const variants::shader_id id{ variants::add_shader(source) };
+		u64 keys[variant_count]{};
+		for (u32 i{ 0 }; i < variant_count; ++i) keys[i] = variants::request(id, i);
+		// Asking for the same variants again only finds them.
+		for (u32 i{ 0 }; i < variant_count; ++i)
+		{
+			[[maybe_unused]] const u64 key{ variants::request(id, i) };
+			assert(key && key == keys[i]);
+		}
+		variants::wait_idle();
+		const f32 ms{ std::chrono::duration<f32, std::milli>(clock::now() - start).count() };
+
+		for (u32 i{ 0 }; i < variant_count; ++i)
+		{
+			[[maybe_unused]] const variants::variant v{ variants::get(keys[i]) };
+			assert(v.state == variants::variant_state::ready && v.byte_code && v.size);
+		}
+
+		const variants::variant_stats stats{ variants::get_stats() };
+		assert(stats.requests == variant_count * 2 && stats.memory_hits == variant_count);
+		assert(stats.compiles == expected_compiles && stats.disk_hits == expected_disk_hits && !stats.failures);
+		std::cout << name << " | " << std::setw(8) << stats.requests << " | "
+			<< std::setw(11) << stats.memory_hits << " | "
+			<< std::setw(9) << stats.disk_hits << " | "
+			<< std::setw(8) << stats.compiles << " | "
+			<< std::setw(8) << stats.failures << " | "
+			<< std::setw(9) << std::fixed << std::setprecision(2) << ms << "\n";
+
+		variants::shutdown();
+	}
+};
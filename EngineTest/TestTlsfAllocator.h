@@ -0,0 +1,123 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\TlsfAllocator.h"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Benchmarks the TLSF allocator the Direct3D12 memory pools sub-allocate their heaps with.
+// Each workload allocates and frees at random in a 256 MB heap around a target fill level and
+// reports the throughput, then keeps allocating until an allocation fails, which shows how much
+// of the heap fragmentation makes unusable. In debug builds every allocation is checked against
+// the memory that's in use.
+class engine_test : public test
+{
+public:
+	bool initialize() override { return true; }
+
+	void run() override
+	{
+		do {
+			std::cout << "workload                 | Mops/s | failed | free blocks | fragmentation | full at (%)\n";
+			measure("buffers   256 B - 64 KB", 256, 64 * 1024, 256, 256);
+			measure("textures  64 KB - 16 MB", 64 * 1024, 16 * 1024 * 1024, 4096, 64 * 1024);
+			measure("mixed      4 KB -  4 MB", 4 * 1024, 4 * 1024 * 1024, 4096, 0);
+			measure("small      4 KB - 64 KB", 4 * 1024, 64 * 1024, 4096, 4096);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	using clock = std::chrono::steady_clock;
+	using allocation = graphics::tlsf_allocator::allocation;
+	constexpr static u64 capacity{ 256 * 1024 * 1024 };
+	constexpr static u32 operations{ 4'000'000 };
+	constexpr static f32 target_fill{ 0.7f };
+
+	// Sizes are spread evenly on a log scale, like texture and buffer sizes are.
+	// 'alignment' 0 picks 4 KB or 64 KB at random, like small and regular placed resources.
+	void measure(const char* name, u64 min_size, u64 max_size, u64 granularity, u64 alignment)
+	{
+		std::mt19937 random{ 42 };
+		std::uniform_real_distribution<f32> log_sizes{ std::log((f32)min_size), std::log((f32)max_size) };
+		auto next_size = [&]() { return (u64)std::exp(log_sizes(random)); };
+		auto next_alignment = [&]() { return alignment ? alignment : ((random() & 1) ? 65536ull : 4096ull); };
+		_allocator.initialize(capacity, granularity);
+		_live.clear();
+		DEBUG_OP(_units.clear());
+		DEBUG_OP(_units.resize(capacity / granularity, 0));
+		_granularity = granularity;
+		u32 failed{ 0 };
+
+		const clock::time_point start{ clock::now() };
+		for (u32 i{ 0 }; i < operations; ++i)
+		{
+			const bool allocate{ _live.empty() || (f32)_allocator.used() < target_fill * (f32)capacity };
+			if (allocate)
+			{
+				const u64 align{ next_alignment() };
+				const allocation a{ _allocator.allocate(next_size(), align) };
+				if (!a.is_valid())
+				{
+					++failed;
+					continue;
+				}
+				assert(!(a.offset & (align - 1)));
+				DEBUG_OP(mark(a, 1));
+				_live.emplace_back(a);
+			}
+			else
+			{
+				const u32 index{ (u32)(random() % _live.size()) };
+				DEBUG_OP(mark(_live[index], 0));
+				_allocator.free(_live[index]);
+				_live.erase_unordered(index);
+			}
+		}
+		const f32 seconds{ std::chrono::duration<f32>(clock::now() - start).count() };
+		const graphics::tlsf_allocator::allocator_stats churned{ _allocator.stats() };
+
+		// Fill up the churned heap.
+		for (;;)
+		{
+			const allocation a{ _allocator.allocate(next_size(), next_alignment()) };
+			if (!a.is_valid()) break;
+			DEBUG_OP(mark(a, 1));
+			_live.emplace_back(a);
+		}
+		const f32 full{ 100.f * (f32)_allocator.used() / (f32)capacity };
+
+		for (u32 i{ 0 }; i < _live.size(); ++i)
+		{
+			DEBUG_OP(mark(_live[i], 0));
+			_allocator.free(_live[i]);
+		}
+		assert(_allocator.empty() && _allocator.stats().free_block_count == 1);
+
+		std::cout << name << " | " << std::setw(6) << std::fixed << std::setprecision(1) << (f32)operations * 1e-6f / seconds
+			<< " | " << std::setw(6) << failed << " | " << std::setw(11) << churned.free_block_count << " | "
+			<< std::setw(13) << std::setprecision(3) << churned.fragmentation() << " | " << std::setw(11)
+			<< std::setprecision(1) << full << "\n";
+	}
+
+	// Checks that an allocation doesn't overlap memory that's in use, and marks it as used or free.
+	void mark(const allocation& a, u8 used)
+	{
+		assert(a.offset + a.size <= capacity);
+		for (u64 unit{ a.offset / _granularity }; unit < (a.offset + a.size) / _granularity; ++unit)
+		{
+			assert(_units[unit] != used);
+			_units[unit] = used;
+		}
+	}
+
+	graphics::tlsf_allocator	_allocator;
+	utl::vector<allocation>		_live;
+	utl::vector<u8>				_units;
+	u64							_granularity{ 1 };
+};
@@ -0,0 +1,140 @@
+#pragma once
+#include "Test.h"
+#include "..\Engine\Graphics\UploadRing.h"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace ferraris; // this usage is only spefically use in test project
+
+// Streams content through an upload_ring the way the Direct3D12 upload manager does: copies of
+// random sizes are written into the ring and submitted in batches, and a fake copy queue finishes
+// the batches some time later. The test checks that memory is never handed out twice while a
+// batch still uses it, and reports the throughput of writing into the ring, including memcpy,
+// for a few upload sizes.
+class engine_test : public test
+{
+public:
+	bool initialize() override
+	{
+		_memory = std::make_unique<u8[]>(ring_capacity);
+		_source = std::make_unique<u8[]>(max_upload_size);
+		for (u32 i{ 0 }; i < max_upload_size; ++i) _source[i] = (u8)i;
+		return true;
+	}
+
+	void run() override
+	{
+		do {
+			std::cout << "uploads (KB) | MB/s    | batches | stalls | peak used (MB)\n";
+			measure(4, 64);
+			measure(64, 1024);
+			measure(256, 4096);
+			measure(4, 4096);
+		} while (getchar() != 'q');
+	}
+
+	void shutdown() override {}
+
+private:
+	using clock = std::chrono::steady_clock;
+	constexpr static u64 ring_capacity{ 64 * 1024 * 1024 };
+	constexpr static u64 max_upload_size{ 4 * 1024 * 1024 };
+	constexpr static u64 bytes_per_run{ 4ull * 1024 * 1024 * 1024 };
+	constexpr static u32 uploads_per_batch{ 16 };
+	constexpr static u32 batches_in_flight{ 3 };		// the copy queue lags this many batches behind
+
+	struct allocation
+	{
+		u64 offset;
+		u64 size;
+		u64 fence_value;
+	};
+
+	// The fake copy queue finishes the oldest batch.
+	void complete_batch()
+	{
+		assert(_completed < _fence_value);
+		_ring.retire(++_completed);
+		for (u32 i{ 0 }; i < _live.size();)
+		{
+			if (_live[i].fence_value <= _completed) _live.erase_unordered(i);
+			else ++i;
+		}
+	}
+
+	void submit()
+	{
+		_ring.submit(++_fence_value);
+		for (u32 i{ 0 }; i < _live.size(); ++i)
+		{
+			if (!_live[i].fence_value) _live[i].fence_value = _fence_value;
+		}
+		while (_fence_value - _completed > batches_in_flight) complete_batch();
+	}
+
+	void validate(const allocation& a)
+	{
+		assert(a.offset + a.size <= ring_capacity);
+		for (u32 i{ 0 }; i < _live.size(); ++i)
+		{
+			const allocation& b{ _live[i] };
+			assert(a.offset + a.size <= b.offset || b.offset + b.size <= a.offset);
+		}
+	}
+
+	void measure(u32 min_kb, u32 max_kb)
+	{
+		std::mt19937 random{ 42 };
+		std::uniform_int_distribution<u64> sizes{ (u64)min_kb * 1024, (u64)max_kb * 1024 };
+		_ring.initialize(ring_capacity);
+		_live.clear();
+		_fence_value = 0;
+		_completed = 0;
+		u64 stalls{ 0 };
+		u64 peak{ 0 };
+		u64 bytes{ 0 };
+		u32 uploads{ 0 };
+
+		const clock::time_point start{ clock::now() };
+		while (bytes < bytes_per_run)
+		{
+			const u64 size{ sizes(random) };
+			const u64 alignment{ (random() & 1) ? 512ull : 16ull };
+			u64 offset{ _ring.allocate(size, alignment) };
+			while (offset == graphics::upload_ring::invalid_offset)
+			{
+				// Like the upload manager: submit and wait for the oldest batch.
+				if (_ring.pending()) submit();
+				complete_batch();
+				++stalls;
+				offset = _ring.allocate(size, alignment);
+			}
+			assert(!(offset & (alignment - 1)));
+			DEBUG_OP(validate({ offset, size, 0 }));
+			DEBUG_OP(_live.emplace_back(allocation{ offset, size, 0 }));
+			memcpy(&_memory[offset], &_source[0], size);
+
+			peak = _ring.used() > peak ? _ring.used() : peak;
+			bytes += size;
+			if (!(++uploads % uploads_per_batch)) submit();
+		}
+		submit();
+		while (_completed < _fence_value) complete_batch();
+		assert(!_ring.used());
+
+		const f32 seconds{ std::chrono::duration<f32>(clock::now() - start).count() };
+		const f32 mb{ 1.f / (1024.f * 1024.f) };
+		std::cout << std::setw(5) << min_kb << " - " << std::setw(4) << max_kb << " | " << std::setw(7) << std::fixed
+			<< std::setprecision(0) << (f32)bytes * mb / seconds << " | " << std::setw(7) << _fence_value << " | "
+			<< std::setw(6) << stalls << " | " << std::setw(14) << std::setprecision(1) << (f32)peak * mb << "\n";
+	}
+
+	graphics::upload_ring		_ring;
+	std::unique_ptr<u8[]>		_memory;
+	std::unique_ptr<u8[]>		_source;
+	utl::vector<allocation>		_live;
+	u64							_fence_value{ 0 };
+	u64							_completed{ 0 };
+};
@@ -5,6 +5,7 @@ using System.Linq;
 using System.Runtime.Serialization;
 using System.Text;
 using System.Threading.Tasks;
+using FerrarisEditor.Utilities;
 
 namespace FerrarisEditor.Components
 {
@@ -29,9 +30,8 @@ namespace FerrarisEditor.Components
 
         public override void WriteToBinary(BinaryWriter bw)
         {
-            var nameBytes = Encoding.UTF8.GetBytes(Name);
-            bw.Write(nameBytes.Length);
-            bw.Write(nameBytes);
+            // The engine looks scripts up by the hash of their name, so we store the hash.
+            bw.Write(Hash.Fnv1a64(Encoding.UTF8.GetBytes(Name)));
         }
 
         public Script(GameEntity owner) : base(owner) { }
@@ -77,6 +77,23 @@ namespace FerrarisEditor.DllWrapper
         [DllImport(_toolsDll)]
         private static extern void CreatePrimitiveMesh([In, Out] SceneData data, PrimitiveInitInfo info);
 
+        [DllImport(_toolsDll)]
+        private static extern void CompressSceneData([In, Out] SceneData data);
+
+        // Returns the data as a compressed container, or as is if compressing doesn't make it smaller.
+        public static byte[] Compress(byte[] data)
+        {
+            Debug.Assert(data?.Length > 0);
+            using var sceneData = new SceneData();
+            sceneData.DataSize = data.Length;
+            sceneData.Data = Marshal.AllocCoTaskMem(data.Length); // CompressSceneData() frees it with CoTaskMemFree()
+            Marshal.Copy(data, 0, sceneData.Data, data.Length);
+            CompressSceneData(sceneData);
+            var result = new byte[sceneData.DataSize];
+            Marshal.Copy(sceneData.Data, result, 0, sceneData.DataSize);
+            return result;
+        }
+
         public static void CreatePrimitiveMesh(Content.Geometry geometry, PrimitiveInitInfo info)
         {
             Debug.Assert(geometry != null);
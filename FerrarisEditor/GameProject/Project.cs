@@ -8,7 +8,9 @@ using System.Collections.ObjectModel;
 using System.Diagnostics;
 using System.IO;
 using System.Linq;
+using System.Numerics;
 using System.Runtime.Serialization;
+using System.Text;
 using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Input;
@@ -193,25 +195,97 @@ namespace FerrarisEditor.GameProject
             Serializer.ToFile(project, project.FullPath);
             Logger.Log(MessageType.Info, $"Project saved to {project.FullPath}");
         }
+        // game.bin layout, see Engine/Content/LevelFormat.h for details.
+        // Each section starts at a multiple of 16 bytes and the header stores where it is.
+        private enum LevelSection { Entities, Positions, Rotations, Scales, Scripts, Strings, Count }
+        private const uint LevelMagic = 0x4c564c46; // "FLVL"
+        private const uint LevelVersion = 1;
+        private const int LevelHeaderSize = 16 + (int)LevelSection.Count * 16;
+
         private void SaveToBinary()
         {
             var configName = GetConfigurationName(StandAloneBuildConfig);
             var bin = $@"{Path}x64\{configName}\game.bin";
+            var entities = ActiveScene.GameEntities;
+            var transforms = entities.Select(x => x.GetComponent<Transform>()).ToList();
+            Debug.Assert(transforms.All(x => x != null)); // all entities must have a transform component
+
+            // Each script name is stored once, entities refer to it by index.
+            var scriptNames = new List<string>();
+            var scriptIndices = entities.Select(x =>
+            {
+                var script = x.GetComponent<Script>();
+                if (script == null) return -1; // u32_invalid_id
+                var index = scriptNames.IndexOf(script.Name);
+                if (index == -1)
+                {
+                    index = scriptNames.Count;
+                    scriptNames.Add(script.Name);
+                }
+                return index;
+            }).ToList();
+            var names = scriptNames.Select(x => Encoding.UTF8.GetBytes(x)).ToList();
+
+            var offsets = new long[(int)LevelSection.Count];
+            var sizes = new long[(int)LevelSection.Count];
 
-            using (var bw = new BinaryWriter(File.Open(bin, FileMode.Create, FileAccess.Write)))
+            var stream = new MemoryStream();
+            using (var bw = new BinaryWriter(stream))
             {
-                bw.Write(ActiveScene.GameEntities.Count);
-                foreach(var entity in ActiveScene.GameEntities)
+                // The header is written last, when the offsets and sizes of all sections are known.
+                bw.Write(new byte[LevelHeaderSize]);
+
+                void WriteSection(LevelSection section, Action write)
                 {
-                    bw.Write(0); // entity type (reserved for latter)
-                    bw.Write(entity.Components.Count);
-                    foreach(var component in entity.Components)
+                    while (bw.BaseStream.Position % 16 != 0) bw.Write((byte)0);
+                    offsets[(int)section] = bw.BaseStream.Position;
+                    write();
+                    sizes[(int)section] = bw.BaseStream.Position - offsets[(int)section];
+                }
+
+                WriteSection(LevelSection.Entities, () =>
+                {
+                    foreach (var index in scriptIndices)
                     {
-                        bw.Write((int)component.ToEnumType());
-                        component.WriteToBinary(bw);
+                        bw.Write(0); // entity type (reserved for later)
+                        bw.Write(index);
                     }
+                });
+                // Transforms are stored as structure of arrays, so the engine can copy them in bulk.
+                WriteSection(LevelSection.Positions, () => transforms.ForEach(x => { bw.Write(x.Position.X); bw.Write(x.Position.Y); bw.Write(x.Position.Z); }));
+                WriteSection(LevelSection.Rotations, () => transforms.ForEach(x =>
+                {
+                    // Same as XMQuaternionRotationRollPitchYawFromVector() in the engine.
+                    var q = Quaternion.CreateFromYawPitchRoll(x.Rotation.Y, x.Rotation.X, x.Rotation.Z);
+                    bw.Write(q.X); bw.Write(q.Y); bw.Write(q.Z); bw.Write(q.W);
+                }));
+                WriteSection(LevelSection.Scales, () => transforms.ForEach(x => { bw.Write(x.Scale.X); bw.Write(x.Scale.Y); bw.Write(x.Scale.Z); }));
+                WriteSection(LevelSection.Scripts, () =>
+                {
+                    var nameOffset = 0;
+                    foreach (var name in names)
+                    {
+                        bw.Write(Hash.Fnv1a64(name));
+                        bw.Write(nameOffset);
+                        bw.Write(name.Length);
+                        nameOffset += name.Length;
+                    }
+                });
+                WriteSection(LevelSection.Strings, () => names.ForEach(x => bw.Write(x)));
+
+                bw.Seek(0, SeekOrigin.Begin);
+                bw.Write(LevelMagic);
+                bw.Write(LevelVersion);
+                bw.Write(entities.Count);
+                bw.Write((int)LevelSection.Count);
+                for (int i = 0; i < (int)LevelSection.Count; ++i)
+                {
+                    bw.Write(offsets[i]);
+                    bw.Write(sizes[i]);
                 }
             }
+            // The engine decompresses the file when it's loaded, see Engine/Utilities/Compression.h.
+            File.WriteAllBytes(bin, ContentToolsAPI.Compress(stream.ToArray()));
         }
         private async Task RunGame(bool debug)
         {
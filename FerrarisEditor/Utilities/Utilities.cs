@@ -27,6 +27,21 @@ namespace FerrarisEditor.Utilities
         }
     }
 
+    public static class Hash
+    {
+        // 64-bit FNV-1a, the same hash the engine uses to identify scripts (utl::fnv1a_64).
+        public static ulong Fnv1a64(byte[] data)
+        {
+            ulong hash = 0xcbf29ce484222325;
+            foreach (var b in data)
+            {
+                hash ^= b;
+                hash *= 0x00000100000001b3;
+            }
+            return hash;
+        }
+    }
+
     class DelayEventTimerArgs : EventArgs
     {
         public bool RepeatEvent { get; set; }